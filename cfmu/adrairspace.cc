@@ -174,11 +174,70 @@ AirspaceTimeSlice::Component::PointLink::PointLink(const Link& l, uint16_t poly,
 }
 
 AirspaceTimeSlice::Component::Component(void)
-	: m_gndelevmin(ElevPointIdentTimeSlice::invalid_elev),
+	: m_preparedpoly(0), m_gndelevmin(ElevPointIdentTimeSlice::invalid_elev),
 	  m_gndelevmax(ElevPointIdentTimeSlice::invalid_elev), m_flags(operator_invalid)
 {
 }
 
+AirspaceTimeSlice::Component::Component(const Component& x)
+	: m_airspace(x.m_airspace), m_poly(x.m_poly), m_preparedpoly(0), m_pointlink(x.m_pointlink),
+	  m_altrange(x.m_altrange), m_gndelevmin(x.m_gndelevmin), m_gndelevmax(x.m_gndelevmax), m_flags(x.m_flags)
+{
+	// the polygon is identical, so the prepared index can be shared
+	const PreparedPolygon *pp((const PreparedPolygon *)g_atomic_pointer_get(&x.m_preparedpoly));
+	if (pp) {
+		pp->reference();
+		m_preparedpoly = pp;
+	}
+}
+
+AirspaceTimeSlice::Component::~Component()
+{
+	clear_prepared_poly();
+}
+
+AirspaceTimeSlice::Component& AirspaceTimeSlice::Component::operator=(const Component& x)
+{
+	if (this == &x)
+		return *this;
+	clear_prepared_poly();
+	m_airspace = x.m_airspace;
+	m_poly = x.m_poly;
+	m_pointlink = x.m_pointlink;
+	m_altrange = x.m_altrange;
+	m_gndelevmin = x.m_gndelevmin;
+	m_gndelevmax = x.m_gndelevmax;
+	m_flags = x.m_flags;
+	const PreparedPolygon *pp((const PreparedPolygon *)g_atomic_pointer_get(&x.m_preparedpoly));
+	if (pp) {
+		pp->reference();
+		m_preparedpoly = pp;
+	}
+	return *this;
+}
+
+void AirspaceTimeSlice::Component::clear_prepared_poly(void)
+{
+	const PreparedPolygon *pp(m_preparedpoly);
+	m_preparedpoly = 0;
+	if (pp)
+		pp->unreference();
+}
+
+const PreparedPolygon& AirspaceTimeSlice::Component::get_prepared_poly(void) const
+{
+	// built lazily; concurrent readers may race to build it, the loser discards its copy
+	const PreparedPolygon *pp((const PreparedPolygon *)g_atomic_pointer_get(&m_preparedpoly));
+	if (pp)
+		return *pp;
+	pp = new PreparedPolygon(m_poly);
+	if (!g_atomic_pointer_compare_and_exchange(&m_preparedpoly, (const PreparedPolygon *)0, pp)) {
+		pp->unreference();
+		pp = (const PreparedPolygon *)g_atomic_pointer_get(&m_preparedpoly);
+	}
+	return *pp;
+}
+
 const std::string& to_str(ADR::AirspaceTimeSlice::Component::operator_t o)
 {
 	switch (o) {
@@ -289,7 +348,7 @@ bool AirspaceTimeSlice::Component::is_inside(const Point& pt, const timepair_t&
 			return false;
 		if (is_pointlink(uuid))
 			return false;
-		if (!get_poly().windingnumber(pt))
+		if (!get_prepared_poly().windingnumber(pt))
 			return false;
 		return true;
 	}
@@ -313,7 +372,7 @@ bool AirspaceTimeSlice::Component::is_inside(const TimeTableEval& tte, int32_t a
 			return false;
 		if (is_pointlink(uuid))
 			return false;
-		if (!get_poly().windingnumber(tte.get_point()))
+		if (!get_prepared_poly().windingnumber(tte.get_point()))
 			return false;
 		return true;
 	}
@@ -331,7 +390,7 @@ bool AirspaceTimeSlice::Component::is_intersect(const TimeTableEval& tte, const
 	if (is_poly()) {
 		if (!ar.is_inside(alt))
 			return false;
-		if (!get_poly().is_strict_intersection(tte.get_point(), pt1))
+		if (!get_prepared_poly().is_strict_intersection(tte.get_point(), pt1))
 			return false;
 		return true;
 	}
@@ -349,7 +408,7 @@ bool AirspaceTimeSlice::Component::is_intersect(const TimeTableEval& tte, const
 	if (is_poly()) {
 		if (!ar.is_overlap(alt0, alt1))
 			return false;
-		if (!get_poly().is_strict_intersection(tte.get_point(), pt1))
+		if (!get_prepared_poly().is_strict_intersection(tte.get_point(), pt1))
 			return false;
 		return true;
 	}
@@ -367,7 +426,7 @@ IntervalSet<int32_t> AirspaceTimeSlice::Component::get_point_altitudes(const Tim
 	if (is_poly()) {
 		if (is_pointlink(uuid))
 			return IntervalSet<int32_t>();
-		if (!get_poly().windingnumber(tte.get_point()))
+		if (!get_prepared_poly().windingnumber(tte.get_point()))
 			return IntervalSet<int32_t>();
 		return ar.get_interval();
 	}
@@ -383,7 +442,7 @@ IntervalSet<int32_t> AirspaceTimeSlice::Component::get_intersect_altitudes(const
 	if (is_poly() || !is_full_geometry())
 		ar.merge(m_altrange);
 	if (is_poly()) {
-		if (!get_poly().is_strict_intersection(tte.get_point(), pt1))
+		if (!get_prepared_poly().is_strict_intersection(tte.get_point(), pt1))
 			return IntervalSet<int32_t>();
 		return ar.get_interval();
 	}
@@ -401,21 +460,21 @@ IntervalSet<int32_t> AirspaceTimeSlice::Component::get_point_intersect_altitudes
 	if (is_poly()) {
 		bool onborder0(is_pointlink(uuid0));
 		bool onborder1(is_pointlink(uuid1));
-		if (!(get_poly().windingnumber(tte.get_point()) && !onborder0) &&
-		    !(get_poly().windingnumber(pt1) && !onborder1) &&
-		    !(get_poly().is_strict_intersection(tte.get_point(), pt1) ||
-		      (onborder0 && onborder1 && get_poly().windingnumber(tte.get_point().halfway(pt1)))))
+		if (!(get_prepared_poly().windingnumber(tte.get_point()) && !onborder0) &&
+		    !(get_prepared_poly().windingnumber(pt1) && !onborder1) &&
+		    !(get_prepared_poly().is_strict_intersection(tte.get_point(), pt1) ||
+		      (onborder0 && onborder1 && get_prepared_poly().windingnumber(tte.get_point().halfway(pt1)))))
 			return IntervalSet<int32_t>();
 		if (false) {
 			get_poly().print(std::cerr << "AirspaceTimeSlice::Component::get_point_intersect_altitudes: match:"
 					 << std::endl << "  ") << std::endl;
-			if (get_poly().windingnumber(tte.get_point()) && !is_pointlink(uuid0))
+			if (get_prepared_poly().windingnumber(tte.get_point()) && !is_pointlink(uuid0))
 				std::cerr << "  First Point " << tte.get_point().get_lat_str2() << ' ' << tte.get_point().get_lon_str2()
 					  << ' ' << uuid0 << " is inside" << std::endl;
-			if (get_poly().windingnumber(pt1) && !is_pointlink(uuid1))
+			if (get_prepared_poly().windingnumber(pt1) && !is_pointlink(uuid1))
 				std::cerr << "  Second Point " << pt1.get_lat_str2() << ' ' << pt1.get_lon_str2()
 					  << ' ' << uuid1 << " is inside" << std::endl;
-			if (get_poly().is_strict_intersection(tte.get_point(), pt1))
+			if (get_prepared_poly().is_strict_intersection(tte.get_point(), pt1))
 				std::cerr << "  Line " << tte.get_point().get_lat_str2() << ' ' << tte.get_point().get_lon_str2()
 					  << " to " << pt1.get_lat_str2() << ' ' << pt1.get_lon_str2() << " intersects" << std::endl;
 		}
@@ -443,7 +502,7 @@ std::vector<AirspaceTimeSlice::Trace> AirspaceTimeSlice::Component::trace_inside
 			r.push_back(Trace(aspc, comp, Trace::reason_border));
 			return r;
 		}
-		if (!get_poly().windingnumber(tte.get_point())) {
+		if (!get_prepared_poly().windingnumber(tte.get_point())) {
 			std::vector<AirspaceTimeSlice::Trace> r;
 			r.push_back(Trace(aspc, comp, Trace::reason_outside));
 			return r;
@@ -472,7 +531,7 @@ std::vector<AirspaceTimeSlice::Trace> AirspaceTimeSlice::Component::trace_inters
 			r.push_back(Trace(aspc, comp, Trace::reason_altrange));
 			return r;
 		}
-		if (!get_poly().is_strict_intersection(tte.get_point(), pt1)) {
+		if (!get_prepared_poly().is_strict_intersection(tte.get_point(), pt1)) {
 			std::vector<AirspaceTimeSlice::Trace> r;
 			r.push_back(Trace(aspc, comp, Trace::reason_nointersect));
 			return r;
@@ -506,6 +565,7 @@ bool AirspaceTimeSlice::Component::is_altitude_overlap(int32_t alt0, int32_t alt
 bool AirspaceTimeSlice::Component::recompute(const TimeSlice& ts)
 {
 	bool work(false);
+	clear_prepared_poly();
 	// extract point coordinates from linked points
 	for (pointlink_t::const_iterator i(m_pointlink.begin()), e(m_pointlink.end()); i != e; ++i) {
 		if (!i->get_link().get_obj()) {
@@ -864,15 +924,18 @@ const std::string& to_str(ADR::AirspaceTimeSlice::localtype_t t)
 MultiPolygonHole AirspaceTimeSlice::get_full_poly(void) const
 {
 	MultiPolygonHole poly;
+	std::vector<MultiPolygonHole> upoly;
 	for (components_t::const_iterator ci(m_components.begin()), ce(m_components.end()); ci != ce; ++ci) {
 		MultiPolygonHole mp(ci->get_full_poly(*this));
 		switch (ci->get_operator()) {
 		case Component::operator_base:
 			poly.swap(mp);
+			upoly.clear();
 			break;
 
 		case Component::operator_union:
-			poly.geos_union(mp);
+			upoly.push_back(MultiPolygonHole());
+			upoly.back().swap(mp);
 			break;
 
 		default:
@@ -880,6 +943,8 @@ MultiPolygonHole AirspaceTimeSlice::get_full_poly(void) const
 			break;
 		}
 	}
+	if (!upoly.empty())
+		poly.geos_union(upoly);
 	return poly;
 }
 
@@ -888,15 +953,18 @@ MultiPolygonHole AirspaceTimeSlice::get_full_poly(uint64_t tm) const
 	if (!is_inside(tm))
 		throw std::runtime_error("AirspaceTimeSlice::get_full_poly: time not within timeslice");
 	MultiPolygonHole poly;
+	std::vector<MultiPolygonHole> upoly;
 	for (components_t::const_iterator ci(m_components.begin()), ce(m_components.end()); ci != ce; ++ci) {
 		MultiPolygonHole mp(ci->get_full_poly(tm));
 		switch (ci->get_operator()) {
 		case Component::operator_base:
 			poly.swap(mp);
+			upoly.clear();
 			break;
 
 		case Component::operator_union:
-			poly.geos_union(mp);
+			upoly.push_back(MultiPolygonHole());
+			upoly.back().swap(mp);
 			break;
 
 		default:
@@ -904,6 +972,8 @@ MultiPolygonHole AirspaceTimeSlice::get_full_poly(uint64_t tm) const
 			break;
 		}
 	}
+	if (!upoly.empty())
+		poly.geos_union(upoly);
 	return poly;
 }
 
@@ -1016,6 +1086,7 @@ bool AirspaceTimeSlice::get(uint64_t tm, AirspacesDb::Airspace& el) const
 	// Polygon and Components
 	{
 		MultiPolygonHole poly;
+		std::vector<MultiPolygonHole> upoly;
 		uint8_t altlwrflag(AirspacesDb::Airspace::altflag_unkn);
 		uint8_t altuprflag(AirspacesDb::Airspace::altflag_unkn);
 		int32_t altlwr(std::numeric_limits<int32_t>::max());
@@ -1077,14 +1148,12 @@ bool AirspaceTimeSlice::get(uint64_t tm, AirspacesDb::Airspace& el) const
 				switch (ci->get_operator()) {
 				case Component::operator_base:
 					poly.swap(mp);
+					upoly.clear();
 					break;
 
 				case Component::operator_union:
-					if (poly.empty()) {
-						poly.swap(mp);
-						break;
-					}
-					poly.geos_union(mp);
+					upoly.push_back(MultiPolygonHole());
+					upoly.back().swap(mp);
 					break;
 
 				default:
@@ -1114,6 +1183,12 @@ bool AirspaceTimeSlice::get(uint64_t tm, AirspacesDb::Airspace& el) const
 			}
 			el.add_component(comp);
 		}
+		if (!upoly.empty()) {
+			if (poly.empty() && upoly.size() == 1)
+				poly.swap(upoly.front());
+			else
+				poly.geos_union(upoly);
+		}
 		el.set_polygon(poly);
 		el.compute_segments_from_poly();
 		if (altlwrflag & AirspacesDb::Airspace::altflag_unkn)
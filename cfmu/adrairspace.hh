@@ -76,6 +76,9 @@ public:
 		};
 
 		Component(void);
+		Component(const Component& x);
+		~Component();
+		Component& operator=(const Component& x);
 
 		typedef enum {
 			operator_base,
@@ -118,9 +121,11 @@ public:
 		void set_airspace(const Link& airspace) { m_airspace = airspace; }
 
 		const MultiPolygonHole& get_poly(void) const { return m_poly; }
-		MultiPolygonHole& get_poly(void) { return m_poly; }
-		void set_poly(const MultiPolygonHole& p) { m_poly = p; }
+		MultiPolygonHole& get_poly(void) { clear_prepared_poly(); return m_poly; }
+		void set_poly(const MultiPolygonHole& p) { clear_prepared_poly(); m_poly = p; }
 		bool is_poly(void) const { return !m_poly.empty(); }
+		// edge bucket index of get_poly(), built on first use
+		const PreparedPolygon& get_prepared_poly(void) const;
 
 		typedef std::vector<PointLink> pointlink_t;
 		const pointlink_t& get_pointlink(void) const { return m_pointlink; }
@@ -152,6 +157,8 @@ public:
 			ar.io(m_airspace);
 			ar.io(m_flags);
 			m_altrange.hibernate(ar);
+			if (ar.is_load())
+				clear_prepared_poly();
 			m_poly.hibernate_binary(ar);
 			ar.io(m_gndelevmin);
 			ar.io(m_gndelevmax);
@@ -166,11 +173,14 @@ public:
 	protected:
 		Link m_airspace;
 		MultiPolygonHole m_poly;
+		mutable const PreparedPolygon *m_preparedpoly;
 		pointlink_t m_pointlink;
 		AltRange m_altrange;
 		elev_t m_gndelevmin;
 		elev_t m_gndelevmax;
 		uint8_t m_flags;
+
+		void clear_prepared_poly(void);
 	};
 
 	AirspaceTimeSlice(timetype_t starttime = 0, timetype_t endtime = 0);
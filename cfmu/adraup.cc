@@ -2,6 +2,7 @@
 #include "config.h"
 #endif
 
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 
@@ -652,9 +653,109 @@ AUPDatabase::findresults_t AUPDatabase::find(timetype_t tmin, timetype_t tmax)
 	return find_tail(cmd);
 }
 
+ConditionalAvailability::CDRLevels::CDRLevels(void)
+{
+	m_keep.set_full();
+	m_open.set_empty();
+}
+
+void ConditionalAvailability::CDRLevels::add(const AUPCDR::Availability& a)
+{
+	IntervalSet<int32_t> r(a.get_altrange().get_interval());
+	if (a.get_cdr() >= 2) {
+		IntervalSet<int32_t> nr(~r);
+		m_keep &= nr;
+		m_open &= nr;
+	} else {
+		m_open |= r;
+	}
+}
+
+ConditionalAvailability::Slot::Slot(const ADRAUPObjectBase::const_ptr_t& p, timetype_t tstart, timetype_t tend)
+	: m_obj(p), m_starttime(tstart), m_endtime(tend), m_cdr(false)
+{
+	AUPCDR::const_ptr_t pc(AUPCDR::const_ptr_t::cast_dynamic(p));
+	if (!pc)
+		return;
+	m_cdr = true;
+	// same direction filter as GraphEdge::get_altrange applied per lookup
+	for (AUPCDR::availability_t::const_iterator ai(pc->get_availability().begin()), ae(pc->get_availability().end()); ai != ae; ++ai) {
+		if (ai->is_forward())
+			m_levels[1].add(*ai);
+		else
+			m_levels[0].add(*ai);
+		if (false)
+			std::cerr << "AUP: Segment " << pc->get_obj() << ' ' << ai->get_altrange().to_str()
+				  << " CDR " << ai->get_cdr() << std::endl;
+	}
+}
+
 void ConditionalAvailability::clear(void)
 {
 	m_objects.clear();
+	m_index.clear();
+}
+
+void ConditionalAvailability::build_index(void)
+{
+	m_index.clear();
+	objects_t::const_iterator oi(m_objects.begin()), oe(m_objects.end());
+	while (oi != oe) {
+		if (!*oi) {
+			++oi;
+			continue;
+		}
+		const UUID& uuid((*oi)->get_obj());
+		objects_t::const_iterator ob(oi);
+		std::set<timetype_t> bounds;
+		for (; oi != oe && *oi && (*oi)->get_obj() == uuid; ++oi) {
+			bounds.insert((*oi)->get_starttime());
+			bounds.insert((*oi)->get_endtime());
+		}
+		// split overlapping objects into disjoint slots; the first object
+		// (in m_objects order) covering a slot wins, as in a linear search
+		typedef std::vector<std::pair<ADRAUPObjectBase::const_ptr_t, timepair_t> > tmpslots_t;
+		tmpslots_t tmp;
+		for (std::set<timetype_t>::const_iterator bi(bounds.begin()), be(bounds.end()); bi != be; ) {
+			timetype_t t0(*bi);
+			if (++bi == be)
+				break;
+			objects_t::const_iterator i(ob);
+			for (; i != oi; ++i)
+				if ((*i)->is_inside(t0))
+					break;
+			if (i == oi)
+				continue;
+			if (!tmp.empty() && tmp.back().first == *i && tmp.back().second.second == t0) {
+				tmp.back().second.second = *bi;
+				continue;
+			}
+			tmp.push_back(tmpslots_t::value_type(*i, timepair_t(t0, *bi)));
+		}
+		if (tmp.empty())
+			continue;
+		slots_t& slots(m_index[uuid]);
+		slots.reserve(tmp.size());
+		for (tmpslots_t::const_iterator ti(tmp.begin()), te(tmp.end()); ti != te; ++ti)
+			slots.push_back(Slot(ti->first, ti->second.first, ti->second.second));
+	}
+	if (false)
+		std::cerr << "AUP Database: " << m_objects.size() << " objects, " << m_index.size() << " indexed" << std::endl;
+}
+
+const ConditionalAvailability::Slot *ConditionalAvailability::find_slot(const UUID& uuid, timetype_t tm) const
+{
+	index_t::const_iterator ii(m_index.find(uuid));
+	if (ii == m_index.end())
+		return 0;
+	const slots_t& slots(ii->second);
+	slots_t::const_iterator si(std::upper_bound(slots.begin(), slots.end(), Slot(ADRAUPObjectBase::const_ptr_t(), tm, tm)));
+	if (si == slots.begin())
+		return 0;
+	--si;
+	if (!si->is_inside(tm))
+		return 0;
+	return &*si;
 }
 
 void ConditionalAvailability::load(Database& db, AUPDatabase& aupdb, timetype_t starttime, timetype_t endtime)
@@ -666,6 +767,7 @@ void ConditionalAvailability::load(Database& db, AUPDatabase& aupdb, timetype_t
 		ADRAUPObjectBase::ptr_t::cast_const(*ri)->link(db);
 		m_objects.insert(*ri);
 	}
+	build_index();
 	if (false) {
 		std::cerr << "AUP Database: " << Glib::TimeVal(starttime, 0).as_iso8601() << ".."
 			  << Glib::TimeVal(endtime, 0).as_iso8601() << std::endl;
@@ -678,23 +780,10 @@ void ConditionalAvailability::load(Database& db, AUPDatabase& aupdb, timetype_t
 const ADRAUPObjectBase::const_ptr_t& ConditionalAvailability::find(const UUID& uuid, timetype_t tm) const
 {
 	static ADRAUPObjectBase::const_ptr_t nullaupptr;
-	ADRAUPObjectBase::const_ptr_t ps(new ADRAUPObjectBase(uuid, 0, 0));
-	for (objects_t::const_iterator i(m_objects.lower_bound(ps)); i != m_objects.end(); ++i) {
-		if (!*i)
-			continue;
-		{
-			int c((*i)->get_obj().compare(uuid));
-			if (false)
-				std::cerr << "CondAvail:find: " << uuid << " obj " << (*i)->get_obj() << " res " << c << std::endl;
-			if (c > 0)
-				break;
-			if (c < 0)
-				continue;
-		}
-		if ((*i)->is_inside(tm))
-			return *i;
-	}
-	return nullaupptr;
+	const Slot *slot(find_slot(uuid, tm));
+	if (!slot)
+		return nullaupptr;
+	return slot->get_obj();
 }
 
 ConditionalAvailability::results_t ConditionalAvailability::find(const UUID& uuid, timetype_t tstart, timetype_t tend) const
@@ -297,6 +297,43 @@ public:
 	typedef std::vector<ADRAUPObjectBase::const_ptr_t> results_t;
 	results_t find(const UUID& uuid, timetype_t tstart, timetype_t tend) const;
 
+	// CDR level changes of one AUP object, compiled into r' = (r & keep) | open
+	class CDRLevels {
+	public:
+		CDRLevels(void);
+		void add(const AUPCDR::Availability& a);
+		const IntervalSet<int32_t>& get_keep(void) const { return m_keep; }
+		const IntervalSet<int32_t>& get_open(void) const { return m_open; }
+		IntervalSet<int32_t> apply(const IntervalSet<int32_t>& r) const { return (r & m_keep) | m_open; }
+
+	protected:
+		IntervalSet<int32_t> m_keep;
+		IntervalSet<int32_t> m_open;
+	};
+
+	// non-overlapping time slot of an object, with the AUP object valid during the slot
+	class Slot {
+	public:
+		Slot(const ADRAUPObjectBase::const_ptr_t& p = ADRAUPObjectBase::const_ptr_t(), timetype_t tstart = 0, timetype_t tend = 0);
+		const ADRAUPObjectBase::const_ptr_t& get_obj(void) const { return m_obj; }
+		timetype_t get_starttime(void) const { return m_starttime; }
+		timetype_t get_endtime(void) const { return m_endtime; }
+		bool is_inside(timetype_t tm) const { return get_starttime() <= tm && tm < get_endtime(); }
+		bool is_cdr(void) const { return m_cdr; }
+		const CDRLevels& get_levels(bool backward) const { return m_levels[!!backward]; }
+		bool operator<(const Slot& x) const { return get_starttime() < x.get_starttime(); }
+		bool operator<(timetype_t tm) const { return get_starttime() < tm; }
+
+	protected:
+		ADRAUPObjectBase::const_ptr_t m_obj;
+		CDRLevels m_levels[2];
+		timetype_t m_starttime;
+		timetype_t m_endtime;
+		bool m_cdr;
+	};
+
+	const Slot *find_slot(const UUID& uuid, timetype_t tm) const;
+
 protected:
 	class AUPObjectSorter {
 	public:
@@ -311,6 +348,11 @@ protected:
 	};
 	typedef std::set<ADRAUPObjectBase::const_ptr_t, AUPObjectSorter> objects_t;
 	objects_t m_objects;
+	typedef std::vector<Slot> slots_t;
+	typedef std::map<UUID, slots_t> index_t;
+	index_t m_index;
+
+	void build_index(void);
 };
 
 };
@@ -24,37 +24,176 @@
 
 using namespace ADR;
 
-Database::ObjCacheEntry::ObjCacheEntry(const Object::const_ptr_t& obj)
-	: m_obj(obj), m_tv(-1, 0)
+Database::ObjCache::Entry::Entry(void)
+	: m_tv(-1, 0), m_size(0), m_prev(0), m_next(0)
 {
 }
 
-Database::ObjCacheEntry::ObjCacheEntry(const UUID& uuid)
-	: m_tv(-1, 0)
+Database::ObjCache::ObjCache(void)
+	: m_head(0), m_tail(0), m_bytes(0), m_budget(0), m_evictblock(0), m_hits(0), m_misses(0), m_evictions(0)
 {
-	Object::const_ptr_t p(new ObjectImpl<TimeSlice,Object::type_invalid>(uuid));
-	m_obj.swap(p);
 }
 
-gint Database::ObjCacheEntry::get_refcount(void) const
+Database::ObjCache::~ObjCache(void)
 {
-	if (m_obj)
-		return m_obj->get_refcount();
-	return 0;
+	clear();
 }
 
-void Database::ObjCacheEntry::access(void) const
+void Database::ObjCache::unlink(Entry& e)
 {
-	m_tv.assign_current_time();
+	if (e.m_prev)
+		e.m_prev->m_next = e.m_next;
+	else
+		m_head = e.m_next;
+	if (e.m_next)
+		e.m_next->m_prev = e.m_prev;
+	else
+		m_tail = e.m_prev;
+	e.m_prev = e.m_next = 0;
+}
+
+void Database::ObjCache::link_head(Entry& e)
+{
+	e.m_prev = 0;
+	e.m_next = m_head;
+	if (m_head)
+		m_head->m_prev = &e;
+	else
+		m_tail = &e;
+	m_head = &e;
+}
+
+void Database::ObjCache::erase(Entry& e)
+{
+	unlink(e);
+	m_bytes -= e.get_size();
+	// keep the object alive until the map node is gone, its destructor may drop further references
+	Object::const_ptr_t p;
+	p.swap(e.m_obj);
+	m_map.erase(p->get_uuid());
 }
 
-bool Database::ObjCacheEntry::operator<(const ObjCacheEntry& x) const
+const Object::const_ptr_t& Database::ObjCache::find(const UUID& uuid)
 {
-	if (!x.m_obj)
-		return false;
-	if (!m_obj)
-		return true;
-	return m_obj->get_uuid() < x.m_obj->get_uuid();
+	static const Object::const_ptr_t noobj;
+	map_t::iterator i(m_map.find(uuid));
+	if (i == m_map.end()) {
+		++m_misses;
+		return noobj;
+	}
+	++m_hits;
+	Entry& e(i->second);
+	e.m_tv.assign_current_time();
+	if (m_head != &e) {
+		unlink(e);
+		link_head(e);
+	}
+	return e.get_obj();
+}
+
+void Database::ObjCache::insert(const Object::const_ptr_t& p, unsigned int blobsize)
+{
+	std::pair<map_t::iterator,bool> ins(m_map.insert(map_t::value_type(p->get_uuid(), Entry())));
+	Entry& e(ins.first->second);
+	e.m_tv.assign_current_time();
+	if (!ins.second) {
+		if (m_head != &e) {
+			unlink(e);
+			link_head(e);
+		}
+		return;
+	}
+	e.m_obj = p;
+	// rough heap footprint of the deserialized object: the archive format is
+	// compact, the in-memory representation with containers and links is not
+	e.m_size = 4 * (uint64_t)blobsize + 128;
+	m_bytes += e.m_size;
+	link_head(e);
+	if (m_budget && m_bytes > m_budget && m_bytes > m_evictblock)
+		evict();
+}
+
+void Database::ObjCache::evict(void)
+{
+	// evict least recently used unpinned objects down to 7/8 of the budget;
+	// pinned objects are skipped in place, so the list stays in access order for flush
+	uint64_t lowmark(m_budget - (m_budget >> 3));
+	for (Entry *e(m_tail); e && m_bytes > lowmark; ) {
+		Entry *e2(e);
+		e = e->m_prev;
+		if (e2->is_pinned())
+			continue;
+		erase(*e2);
+		++m_evictions;
+	}
+	// everything left is pinned; do not try again until the cache has grown noticeably
+	m_evictblock = (m_bytes > m_budget) ? m_bytes + (m_budget >> 4) : 0;
+}
+
+unsigned int Database::ObjCache::flush(const Glib::TimeVal& tv)
+{
+	unsigned int del(0);
+	for (;;) {
+		bool work(false);
+		// walk from the least recently used end; everything beyond the first
+		// entry accessed after tv has been accessed after tv as well
+		for (Entry *e(m_tail); e && e->get_tv() <= tv; ) {
+			Entry *e2(e);
+			e = e->m_prev;
+			if (e2->is_pinned())
+				continue;
+			erase(*e2);
+			++del;
+			work = true;
+		}
+		if (!work)
+			break;
+	}
+	m_evictblock = 0;
+	return del;
+}
+
+unsigned int Database::ObjCache::clear(void)
+{
+	unsigned int del(m_map.size());
+	m_head = m_tail = 0;
+	m_bytes = 0;
+	m_evictblock = 0;
+	m_map.clear();
+	return del;
+}
+
+void Database::ObjCache::set_budget(uint64_t b)
+{
+	m_budget = b;
+	m_evictblock = 0;
+	if (m_budget && m_bytes > m_budget)
+		evict();
+}
+
+unsigned int Database::ObjCache::count_pinned(void) const
+{
+	unsigned int cnt(0);
+	for (const Entry *e(m_head); e; e = e->m_next)
+		if (e->is_pinned())
+			++cnt;
+	return cnt;
+}
+
+std::ostream& Database::ObjCache::dump(std::ostream& os, unsigned int maxentries) const
+{
+	os << "Object cache: " << size() << " objects, " << count_pinned() << " pinned, "
+	   << ((get_bytes() + 1023) >> 10) << "kB";
+	if (get_budget())
+		os << " of " << ((get_budget() + 1023) >> 10) << "kB";
+	os << ", " << get_hits() << " hits, " << get_misses() << " misses, "
+	   << get_evictions() << " evictions" << std::endl;
+	for (const Entry *e(m_head); e && maxentries; e = e->m_next, --maxentries) {
+		os << "  " << e->get_obj()->get_uuid() << ' ' << e->get_obj()->get_type()
+		   << " refs " << e->get_obj()->get_refcount() << " size " << e->get_size()
+		   << " access " << e->get_tv().as_iso8601() << std::endl;
+	}
+	return os;
 }
 
 template<int sz> const unsigned int Database::BinFileEntry<sz>::size;
@@ -262,6 +401,33 @@ void Database::BinFileHeader::set_objdirentries(uint32_t n)
 	writeu32(40, n);
 }
 
+Database::CacheStats::CacheStats(void)
+	: m_cachehits(0), m_cachemisses(0), m_cacheevictions(0), m_binfileloads(0), m_dbloads(0),
+	  m_cacheentries(0), m_cachepinned(0), m_cachebytes(0), m_cachebudget(0), m_binfilesize(0), m_binfileobjects(0), m_binfilewarmup(0),
+	  m_rss(0), m_rssshared(0)
+{
+}
+
+std::ostream& Database::CacheStats::print(std::ostream& os) const
+{
+	os << "cache " << get_cacheentries() << " objects (" << get_cachepinned() << " pinned, "
+	   << ((get_cachebytes() + 1023) >> 10) << "kB";
+	if (get_cachebudget())
+		os << " of " << ((get_cachebudget() + 1023) >> 10) << "kB";
+	os << "), " << get_cachehits() << " hits, " << get_cachemisses() << " misses, "
+	   << get_cacheevictions() << " evictions, " << get_binfileloads() << " bin file loads, " << get_dbloads() << " db loads";
+	if (get_binfilesize()) {
+		std::ostringstream oss;
+		oss << std::fixed << std::setprecision(3) << get_binfilewarmup();
+		os << ", bin file " << get_binfileobjects() << " objects, "
+		   << ((get_binfilesize() + 1023) >> 10) << "kB mapped, warm-up " << oss.str() << 's';
+	}
+	if (get_rss())
+		os << ", process " << ((get_rssprivate() + 1023) >> 10) << "kB private, "
+		   << ((get_rssshared() + 1023) >> 10) << "kB shared resident";
+	return os;
+}
+
 Database::Database(const std::string& path, bool enabinfile)
 	: m_path(path), m_binfile(0), m_binsize(0), m_enablebinfile(enabinfile), m_tempdb(false)
 {
@@ -283,22 +449,16 @@ void Database::set_path(const std::string& path)
 	open();
 }
 
-const Object::const_ptr_t& Database::cache_get(const UUID& uuid) const
+const Object::const_ptr_t& Database::cache_get(const UUID& uuid)
 {
-	static const Object::const_ptr_t noobj;
-	ObjCacheEntry ce(uuid);
-	cache_t::const_iterator i(m_cache.find(ce));
-	if (i != m_cache.end())
-		return i->get_obj();
-	return noobj;
+	return m_cache.find(uuid);
 }
 
-void Database::cache_put(const Object::const_ptr_t& p)
+void Database::cache_put(const Object::const_ptr_t& p, unsigned int blobsize)
 {
 	if (!p || p->get_uuid().is_nil())
 		return;
-	std::pair<cache_t::iterator, bool> ins(m_cache.insert(ObjCacheEntry(p)));
-	ins.first->access();
+	m_cache.insert(p, blobsize);
 }
 
 Object::const_ptr_t Database::load(const UUID& uuid)
@@ -317,6 +477,8 @@ Object::const_ptr_t Database::load(const UUID& uuid)
 			return p;
 	}
 	Object::ptr_t p;
+	unsigned int blobsize(0);
+	++m_stats.m_dbloads;
         {
 		sqlite3x::sqlite3_command cmd(m_db, "SELECT DATA,MODIFIED FROM obj WHERE UUID0=? AND UUID1=? AND UUID2=? AND UUID3=?;");
 		for (unsigned int i = 0; i < 4; ++i)
@@ -344,10 +506,11 @@ Object::const_ptr_t Database::load(const UUID& uuid)
 			if (p) {
 				p->set_modified(cursor.getint(1));
 				p->unset_dirty();
+				blobsize = sz;
 			}
 		}
 	}
-	cache_put(p);
+	cache_put(p, blobsize);
 	return p;
 }
 
@@ -355,13 +518,13 @@ void Database::save(const Object::const_ptr_t& p)
 {
 	if (!p)
 		return;
-	cache_put(p);
 	open();
 	std::ostringstream blob;
 	{
 		ArchiveWriteStream ar(blob);
 		p->save(ar);
 	}
+	cache_put(p, blob.str().size());
 	sqlite3x::sqlite3_transaction tran(m_db);
 	{
 		sqlite3x::sqlite3_command cmd(m_db, "INSERT OR REPLACE INTO obj"
@@ -488,7 +651,16 @@ void Database::save_temp(const Object::const_ptr_t& p)
 		ArchiveWriteStream ar(blob);
 		p->save(ar);
 	}
+	UUID::set_t deps;
+	p->dependencies(deps);
 	sqlite3x::sqlite3_transaction tran(m_db);
+	save_temp(p, blob.str(), deps);
+	tran.commit();
+	p->unset_dirty();	
+}
+
+void Database::save_temp(const Object::const_ptr_t& p, const std::string& blob, const UUID::set_t& deps)
+{
 	{
 		sqlite3x::sqlite3_command cmd(m_db, "INSERT OR REPLACE INTO tmpobj"
 					      " (UUID0,UUID1,UUID2,UUID3,MODIFIED,DATA)"
@@ -496,7 +668,7 @@ void Database::save_temp(const Object::const_ptr_t& p)
 		for (unsigned int i = 0; i < 4; ++i)
 			cmd.bind(i + 1, (long long int)p->get_uuid().get_word(i));
 		cmd.bind(5, (long long int)p->get_modified());
-		cmd.bind(6, blob.str().c_str(), blob.str().size());
+		cmd.bind(6, blob.c_str(), blob.size());
 		cmd.executenonquery();
 	}
 	{
@@ -505,54 +677,104 @@ void Database::save_temp(const Object::const_ptr_t& p)
 			cmd.bind(i + 1, (long long int)p->get_uuid().get_word(i));
 		cmd.executenonquery();
 	}
-	{
-		UUID::set_t deps;
-		p->dependencies(deps);
-		for (UUID::set_t::const_iterator di(deps.begin()), de(deps.end()); di != de; ++di) {
-			if (di->is_nil())
-				continue;
-			sqlite3x::sqlite3_command cmd(m_db, "INSERT INTO tmpdep"
-						      " (UUID0,UUID1,UUID2,UUID3,UUIDD0,UUIDD1,UUIDD2,UUIDD3)"
-						      " VALUES (?,?,?,?,?,?,?,?);");
-			for (unsigned int i = 0; i < 4; ++i)
-				cmd.bind(i + 1, (long long int)p->get_uuid().get_word(i));
-			for (unsigned int i = 0; i < 4; ++i)
-				cmd.bind(i + 5, (long long int)di->get_word(i));
-			cmd.executenonquery();
+	for (UUID::set_t::const_iterator di(deps.begin()), de(deps.end()); di != de; ++di) {
+		if (di->is_nil())
+			continue;
+		sqlite3x::sqlite3_command cmd(m_db, "INSERT INTO tmpdep"
+					      " (UUID0,UUID1,UUID2,UUID3,UUIDD0,UUIDD1,UUIDD2,UUIDD3)"
+					      " VALUES (?,?,?,?,?,?,?,?);");
+		for (unsigned int i = 0; i < 4; ++i)
+			cmd.bind(i + 1, (long long int)p->get_uuid().get_word(i));
+		for (unsigned int i = 0; i < 4; ++i)
+			cmd.bind(i + 5, (long long int)di->get_word(i));
+		cmd.executenonquery();
+	}
+}
+
+void Database::hibernate(const objects_t *objs, std::vector<std::string> *blobs, std::vector<UUID::set_t> *deps,
+			 unsigned int worker, unsigned int idx)
+{
+	for (objects_t::size_type i(idx), n(objs->size()); i < n; i += worker) {
+		const Object::const_ptr_t& p((*objs)[i]);
+		if (!p)
+			continue;
+		std::ostringstream blob;
+		{
+			ArchiveWriteStream ar(blob);
+			p->save(ar);
 		}
+		(*blobs)[i] = blob.str();
+		p->dependencies((*deps)[i]);
 	}
-	tran.commit();
-	p->unset_dirty();	
 }
 
-unsigned int Database::flush_cache(const Glib::TimeVal& tv)
+void Database::save_temp(const objects_t& objs, unsigned int worker)
 {
-	unsigned int del(0);
-	for (;;) {
-		bool work(false);
-		for (cache_t::iterator i(m_cache.begin()), e(m_cache.end()); i != e; ) {
-			cache_t::iterator i2(i);
-			++i;
-			if (i2->get_tv() > tv)
-				continue;
-			gint cnt(i2->get_refcount());
-			if (cnt > 1)
-				continue;
-			m_cache.erase(i2);
-			++del;
-			work = true;
+	if (objs.empty())
+		return;
+	open_temp();
+	std::vector<std::string> blobs(objs.size());
+	std::vector<UUID::set_t> deps(objs.size());
+	if (worker > 1) {
+		Glib::Threads::Thread *thread[worker];
+		for (unsigned int i = 0; i < worker; ++i)
+			thread[i] = Glib::Threads::Thread::create(sigc::bind(sigc::ptr_fun(&Database::hibernate), &objs, &blobs, &deps, worker, i));
+		for (unsigned int i = 0; i < worker; ++i)
+			thread[i]->join();
+	} else {
+		hibernate(&objs, &blobs, &deps, 1, 0);
+	}
+	sqlite3x::sqlite3_transaction tran(m_db);
+	for (objects_t::size_type i(0), n(objs.size()); i < n; ++i) {
+		if (!objs[i])
+			continue;
+		save_temp(objs[i], blobs[i], deps[i]);
+	}
+	tran.commit();
+	for (objects_t::const_iterator i(objs.begin()), e(objs.end()); i != e; ++i)
+		if (*i)
+			(*i)->unset_dirty();
+}
+
+Database::CacheStats Database::get_cache_stats(void) const
+{
+	CacheStats s(m_stats);
+	s.m_cachehits = m_cache.get_hits();
+	s.m_cachemisses = m_cache.get_misses();
+	s.m_cacheevictions = m_cache.get_evictions();
+	s.m_cacheentries = m_cache.size();
+	s.m_cachepinned = m_cache.count_pinned();
+	s.m_cachebytes = m_cache.get_bytes();
+	s.m_cachebudget = m_cache.get_budget();
+#if !defined(HAVE_WINDOWS_H)
+	// resident set of this process; the shared part is mostly clean page cache
+	// (bin file, libraries), the private part is what each router costs on its own
+	{
+		std::ifstream is("/proc/self/statm");
+		uint64_t size(0), resident(0), shared(0);
+		if (is >> size >> resident >> shared) {
+			uint64_t pgsz(sysconf(_SC_PAGE_SIZE));
+			s.m_rss = resident * pgsz;
+			s.m_rssshared = shared * pgsz;
 		}
-		if (!work)
-			break;
 	}
-	return del;
+#endif
+	return s;
+}
+
+void Database::set_cache_budget(uint64_t b)
+{
+	m_cache.set_budget(b);
+}
+
+unsigned int Database::flush_cache(const Glib::TimeVal& tv)
+{
+	return m_cache.flush(tv);
 }
 
 unsigned int Database::clear_cache(void)
 {
-	unsigned int del(m_cache.size());
-	m_cache.clear();
-	return del;
+	return m_cache.clear();
 }
 
 void Database::open(void)
@@ -1208,7 +1430,7 @@ Database::findresults_t Database::find_tail(sqlite3x::sqlite3_command& cmd, load
 		p->unset_dirty();
 		r.back().set_obj(p);
 		if (cache)
-			cache_put(p);
+			cache_put(p, sz);
 		if (loadmode == loadmode_link)
 			p->link(*this, ~0U);
 	}
@@ -1438,6 +1660,8 @@ void Database::open_binfile(void)
 		close_binfile();
 		return;
 	}
+	m_stats.m_binfilesize = m_binsize;
+	m_stats.m_binfileobjects = hdr.get_objdirentries();
 	if (true)
 		std::cerr << "Using bin file " << binfn << ": " << hdr.get_objdirentries() << " objects" << std::endl;
 }
@@ -1446,6 +1670,8 @@ void Database::close_binfile(void)
 {
 	if (!m_binfile)
 		return;
+	m_stats.m_binfilesize = 0;
+	m_stats.m_binfileobjects = 0;
 	if (!UnmapViewOfFile(m_binfile)) {
 		if (true)
 			std::cerr << "Error unmapping binfile: 0x" << std::hex << GetLastError() << std::dec << std::endl;
@@ -1479,6 +1705,7 @@ void Database::open_binfile(void)
 	}
 	struct stat binstat;
 	if (fstat(fd, &binstat)) {
+		::close(fd);
 		if (true)
 			std::cerr << "Cannot stat bin file " << binfn << ": " 
 				  << strerror(errno) << " (" << errno << ')' << std::endl;
@@ -1492,8 +1719,12 @@ void Database::open_binfile(void)
 				  << Glib::TimeVal(dbstat.st_mtime, 0).as_iso8601() << std::endl;
 		return;
 	}
+	Glib::TimeVal tv;
+	tv.assign_current_time();
 	size_t pgsz(sysconf(_SC_PAGE_SIZE));
 	m_binsize = ((binstat.st_size + pgsz - 1) / pgsz) * pgsz;
+	// read-only file mapping: clean pages come from the page cache and are shared by all
+	// router processes; objects deserialised from it still live in each process' object cache
 	m_binfile = reinterpret_cast<uint8_t *>(mmap(0, m_binsize, PROT_READ, MAP_PRIVATE, fd, 0));
 	::close(fd);
 	if (m_binfile == (const uint8_t *)-1) {
@@ -1511,14 +1742,44 @@ void Database::open_binfile(void)
 		close_binfile();
 		return;
 	}
-	if (true)
-		std::cerr << "Using bin file " << binfn << ": " << hdr.get_objdirentries() << " objects" << std::endl;
+	// object data is accessed randomly; the object directory is binary searched on every lookup,
+	// so fault it in now rather than during the first route computation
+	madvise(const_cast<uint8_t *>(m_binfile), m_binsize, MADV_RANDOM);
+	{
+		uint64_t dirbegin(hdr.get_objdiroffs());
+		uint64_t dirend(dirbegin + hdr.get_objdirentries() * (uint64_t)BinFileObjEntry::size);
+		dirbegin -= dirbegin % pgsz;
+		if (dirend > m_binsize)
+			dirend = m_binsize;
+		if (dirbegin < dirend) {
+			madvise(const_cast<uint8_t *>(m_binfile + dirbegin), dirend - dirbegin, MADV_WILLNEED);
+			volatile uint8_t sum(0);
+			for (; dirbegin < dirend; dirbegin += pgsz)
+				sum += m_binfile[dirbegin];
+		}
+	}
+	{
+		Glib::TimeVal tv1;
+		tv1.assign_current_time();
+		tv = tv1 - tv;
+	}
+	m_stats.m_binfilesize = m_binsize;
+	m_stats.m_binfileobjects = hdr.get_objdirentries();
+	m_stats.m_binfilewarmup = tv.as_double();
+	if (true) {
+		std::ostringstream oss;
+		oss << "Using bin file " << binfn << ": " << hdr.get_objdirentries() << " objects, warm-up "
+		    << std::fixed << std::setprecision(3) << tv.as_double() << 's';
+		std::cerr << oss.str() << std::endl;
+	}
 }
 
 void Database::close_binfile(void)
 {
 	if (!m_binfile)
 		return;
+	m_stats.m_binfilesize = 0;
+	m_stats.m_binfileobjects = 0;
 	munmap(const_cast<uint8_t *>(m_binfile), m_binsize);
 	m_binfile = 0;
 	m_binsize = 0;
@@ -1538,6 +1799,7 @@ Object::ptr_t Database::load_binfile(const BinFileObjEntry *oi)
 {
 	if (!oi->get_datasize())
 		return Object::ptr_t();
+	++m_stats.m_binfileloads;
 	Object::ptr_t p;
 	const uint8_t *data(m_binfile + oi->get_dataoffs());
 	unsigned int sz(oi->get_datasize());
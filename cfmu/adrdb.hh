@@ -6,6 +6,7 @@
 #endif
 
 #include <sqlite3x.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "sysdeps.h"
 #include "adr.hh"
@@ -24,6 +25,53 @@ public:
 	void save(const Object::const_ptr_t& p);
 	unsigned int flush_cache(const Glib::TimeVal& tv = Glib::TimeVal(std::numeric_limits<long>::max(), 0));
 	unsigned int clear_cache(void);
+	// approximate heap budget of the object cache in bytes, 0 means unlimited;
+	// objects referenced outside the cache (e.g. from a routing graph) are never evicted
+	void set_cache_budget(uint64_t b);
+	uint64_t get_cache_budget(void) const { return m_cache.get_budget(); }
+	std::ostream& dump_cache(std::ostream& os, unsigned int maxentries = 16) const { return m_cache.dump(os, maxentries); }
+
+	// per-process statistics; every router process keeps its own object cache,
+	// only the read-only bin file pages are shared through the page cache
+	class CacheStats {
+	public:
+		CacheStats(void);
+		uint64_t get_cachehits(void) const { return m_cachehits; }
+		uint64_t get_cachemisses(void) const { return m_cachemisses; }
+		uint64_t get_cacheevictions(void) const { return m_cacheevictions; }
+		uint64_t get_binfileloads(void) const { return m_binfileloads; }
+		uint64_t get_dbloads(void) const { return m_dbloads; }
+		unsigned int get_cacheentries(void) const { return m_cacheentries; }
+		unsigned int get_cachepinned(void) const { return m_cachepinned; }
+		uint64_t get_cachebytes(void) const { return m_cachebytes; }
+		uint64_t get_cachebudget(void) const { return m_cachebudget; }
+		uint64_t get_binfilesize(void) const { return m_binfilesize; }
+		uint32_t get_binfileobjects(void) const { return m_binfileobjects; }
+		double get_binfilewarmup(void) const { return m_binfilewarmup; }
+		uint64_t get_rss(void) const { return m_rss; }
+		uint64_t get_rssshared(void) const { return m_rssshared; }
+		uint64_t get_rssprivate(void) const { return (m_rss > m_rssshared) ? m_rss - m_rssshared : 0; }
+		std::ostream& print(std::ostream& os) const;
+
+	protected:
+		friend class Database;
+		uint64_t m_cachehits;
+		uint64_t m_cachemisses;
+		uint64_t m_cacheevictions;
+		uint64_t m_binfileloads;
+		uint64_t m_dbloads;
+		unsigned int m_cacheentries;
+		unsigned int m_cachepinned;
+		uint64_t m_cachebytes;
+		uint64_t m_cachebudget;
+		uint64_t m_binfilesize;
+		uint32_t m_binfileobjects;
+		double m_binfilewarmup;
+		uint64_t m_rss;
+		uint64_t m_rssshared;
+	};
+
+	CacheStats get_cache_stats(void) const;
 	void sync_off(void);
 	void analyze(void);
 	void vacuum(void);
@@ -85,6 +133,9 @@ public:
 
 	Object::const_ptr_t load_temp(const UUID& uuid);
 	void save_temp(const Object::const_ptr_t& p);
+	typedef std::vector<Object::const_ptr_t> objects_t;
+	// hibernate on worker threads, insert in one transaction
+	void save_temp(const objects_t& objs, unsigned int worker = 0);
 
 	findresults_t find_all_temp(loadmode_t loadmode = loadmode_obj);
 
@@ -102,19 +153,64 @@ public:
 	unsigned int count_dct(void);
 
 protected:
-	class ObjCacheEntry {
+	// hash map for lookup plus an intrusive doubly linked list in access order
+	class ObjCache {
 	public:
-		ObjCacheEntry(const Object::const_ptr_t& obj = Object::const_ptr_t());
-		ObjCacheEntry(const UUID& uuid);
-		const Object::const_ptr_t& get_obj(void) const { return m_obj; }
-		const Glib::TimeVal& get_tv(void) const { return m_tv; }
-		gint get_refcount(void) const;
-		void access(void) const;
-		bool operator<(const ObjCacheEntry& x) const;
+		ObjCache(void);
+		~ObjCache(void);
+		const Object::const_ptr_t& find(const UUID& uuid);
+		void insert(const Object::const_ptr_t& p, unsigned int blobsize);
+		unsigned int flush(const Glib::TimeVal& tv);
+		unsigned int clear(void);
+		uint64_t get_budget(void) const { return m_budget; }
+		void set_budget(uint64_t b);
+		unsigned int size(void) const { return m_map.size(); }
+		unsigned int count_pinned(void) const;
+		uint64_t get_bytes(void) const { return m_bytes; }
+		uint64_t get_hits(void) const { return m_hits; }
+		uint64_t get_misses(void) const { return m_misses; }
+		uint64_t get_evictions(void) const { return m_evictions; }
+		std::ostream& dump(std::ostream& os, unsigned int maxentries) const;
 
 	protected:
-		Object::const_ptr_t m_obj;
-		mutable Glib::TimeVal m_tv;
+		class Entry {
+		public:
+			Entry(void);
+			const Object::const_ptr_t& get_obj(void) const { return m_obj; }
+			const Glib::TimeVal& get_tv(void) const { return m_tv; }
+			uint64_t get_size(void) const { return m_size; }
+			// the cache itself holds one reference
+			bool is_pinned(void) const { return m_obj && m_obj->get_refcount() > 1; }
+
+			Object::const_ptr_t m_obj;
+			Glib::TimeVal m_tv;
+			uint64_t m_size;
+			Entry *m_prev;
+			Entry *m_next;
+		};
+
+		class UUIDHash {
+		public:
+			std::size_t operator()(const UUID& uuid) const { return boost::uuids::hash_value(uuid); }
+		};
+
+		typedef boost::unordered_map<UUID,Entry,UUIDHash> map_t;
+		map_t m_map;
+		Entry *m_head;
+		Entry *m_tail;
+		uint64_t m_bytes;
+		uint64_t m_budget;
+		uint64_t m_evictblock;
+		uint64_t m_hits;
+		uint64_t m_misses;
+		uint64_t m_evictions;
+
+		ObjCache(const ObjCache&);
+		ObjCache& operator=(const ObjCache&);
+		void unlink(Entry& e);
+		void link_head(Entry& e);
+		void erase(Entry& e);
+		void evict(void);
 	};
 
 	template<int sz> class BinFileEntry {
@@ -185,20 +281,23 @@ protected:
 
 	std::string m_path;
 	sqlite3x::sqlite3_connection m_db;
-	typedef std::set<ObjCacheEntry> cache_t;
-	cache_t m_cache;
+	ObjCache m_cache;
 	const uint8_t *m_binfile;
 	uint64_t m_binsize;
+	CacheStats m_stats;
 	bool m_enablebinfile;
 	bool m_tempdb;
 
-	const Object::const_ptr_t& cache_get(const UUID& uuid) const;
-	void cache_put(const Object::const_ptr_t& p);
+	const Object::const_ptr_t& cache_get(const UUID& uuid);
+	void cache_put(const Object::const_ptr_t& p, unsigned int blobsize);
 	void open_binfile(void);
 	void close_binfile(void);
 	bool is_binfile(void) const { return !!m_binfile; }
 	static void dbfunc_upperbound(sqlite3_context *ctxt, int, sqlite3_value **values);
 	void open_temp(void);
+	void save_temp(const Object::const_ptr_t& p, const std::string& blob, const UUID::set_t& deps);
+	static void hibernate(const objects_t *objs, std::vector<std::string> *blobs, std::vector<UUID::set_t> *deps,
+			      unsigned int worker, unsigned int idx);
 	static std::string quote_text_for_like(const std::string& s, char e);
 	findresults_t find_tail(sqlite3x::sqlite3_command& cmd, loadmode_t loadmode, bool cache);
 	dctresults_t dct_tail(sqlite3x::sqlite3_command& cmd, loadmode_t loadmode);
@@ -214,5 +313,6 @@ protected:
 
 extern const std::string& to_str(ADR::Database::comp_t c);
 inline std::ostream& operator<<(std::ostream& os, ADR::Database::comp_t c) { return os << to_str(c); }
+inline std::ostream& operator<<(std::ostream& os, const ADR::Database::CacheStats& s) { return s.print(os); }
 
 #endif /* ADRDB_H */
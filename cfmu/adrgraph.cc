@@ -477,20 +477,10 @@ IntervalSet<int32_t> GraphEdge::get_altrange(const ConditionalAvailability& cond
 		r1 |= a.get_altrange().get_interval();
 	}
 	if (hascond) {
-		AUPCDR::const_ptr_t p(AUPCDR::const_ptr_t::cast_dynamic(condavail.find(get_uuid(), tte.get_time())));
-		if (p) {
-			tuntil = std::min(tuntil, p->get_endtime());
-			for (AUPCDR::availability_t::const_iterator ai(p->get_availability().begin()), ae(p->get_availability().end()); ai != ae; ++ai) {
-				if ((is_backward() && ai->is_backward()) || (is_forward() && ai->is_forward()))
-					continue;
-				if (ai->get_cdr() >= 2)
-					r1 &= ~ai->get_altrange().get_interval();
-				else
-					r1 |= ai->get_altrange().get_interval();
-				if (true)
-					std::cerr << "AUP: Segment " << get_uuid() << ' ' << ai->get_altrange().to_str()
-						  << " CDR " << ai->get_cdr() << std::endl;
-			}
+		const ConditionalAvailability::Slot *slot(condavail.find_slot(get_uuid(), tte.get_time()));
+		if (slot && slot->is_cdr()) {
+			tuntil = std::min(tuntil, slot->get_endtime());
+			r1 = slot->get_levels(is_backward()).apply(r1);
 		}
 	}
 	r &= r1;
@@ -415,6 +415,7 @@ int main(int argc, char *argv[])
 		{ "dct-worker", required_argument, 0, 0x408 },
 		{ "airport-flags-cutofftime", no_argument, 0, 0x409 },
 		{ "airport-flags-endtime", no_argument, 0, 0x40a },
+		{ "import-worker", required_argument, 0, 0x40b },
 		{0, 0, 0, 0}
 	};
         Glib::ustring db_dir(".");
@@ -429,6 +430,7 @@ int main(int argc, char *argv[])
 	ADR::Database::findresults_t dctpt;
 	double dctlimit(100);
 	unsigned int dctworker(0);
+	unsigned int importworker(0);
 	bool verbose(false), dct(false), dctall(false), dctverbose(false), dctfuturecutoffrel(false), arptflags(0);
 	int c, err(0);
 	{
@@ -583,13 +585,17 @@ int main(int argc, char *argv[])
 			}
 			break;
 
+		case 0x40b:
+			importworker = strtoul(optarg, 0, 0);
+			break;
+
 		default:
 			err++;
 			break;
 		}
 	}
 	if (err) {
-		std::cerr << "usage: adrimport [-d <dir>] [-b <borderfile>] [-m <modtime>] [-v] [--dct]" << std::endl;
+		std::cerr << "usage: adrimport [-d <dir>] [-b <borderfile>] [-m <modtime>] [-v] [--import-worker <n>] [--dct]" << std::endl;
 		return EX_USAGE;
 	}
 	try {
@@ -609,15 +615,27 @@ int main(int argc, char *argv[])
 				std::cerr << "Border File Import: " << err << " errors, " << warn << " warnings" << std::endl;
 			}
 			{
+				Glib::TimeVal tv;
+				tv.assign_current_time();
 				ADR::ParseXML parser(db, verbose);
 				parser.set_validate(false); // Do not validate, we do not have a DTD
 				parser.set_substitute_entities(true);
+				parser.set_worker(importworker);
 				for (; optind < argc; optind++) {
 					std::cerr << "Parsing file " << argv[optind] << std::endl;
 					parser.parse_file(argv[optind]);
 				}
+				parser.flush();
 				err += parser.get_errorcnt();
 				warn += parser.get_warncnt();
+				Glib::TimeVal tv1;
+				tv1.assign_current_time();
+				tv1 -= tv;
+				double tparse(std::max(tv1.as_double() - parser.get_storetime(), 1e-3));
+				double tstore(std::max(parser.get_storetime(), 1e-3));
+				std::cerr << "Import: " << parser.get_objcnt() << " objects, parse " << tparse << "s ("
+					  << (parser.get_objcnt() / tparse) << " objects/s), store " << tstore << "s ("
+					  << (parser.get_objcnt() / tstore) << " objects/s)" << std::endl;
 			}
 			std::cerr << "Import: " << err << " errors, " << warn << " warnings" << std::endl;
 			std::string topodbpath(db_dir);
@@ -625,12 +643,21 @@ int main(int argc, char *argv[])
 				topodbpath = PACKAGE_DATA_DIR;
 			TopoDb30 topodb;
 			topodb.open(topodbpath);
+			Glib::TimeVal tv;
+			tv.assign_current_time();
 			std::pair<unsigned int,unsigned int> stats(recompute(db, topodb, modtime, verbose));
 			// very big and no win
 			if (false)
 				db.create_simple_transitive_closure();
-			std::cerr << "Recompute: " << err << " errors, " << warn << " warnings, "
-				  << stats.first << " modified, " << stats.second << " unmodified" << std::endl;
+			{
+				Glib::TimeVal tv1;
+				tv1.assign_current_time();
+				tv1 -= tv;
+				double t(std::max(tv1.as_double(), 1e-3));
+				std::cerr << "Recompute: " << err << " errors, " << warn << " warnings, "
+					  << stats.first << " modified, " << stats.second << " unmodified, "
+					  << t << "s (" << ((stats.first + stats.second) / t) << " objects/s)" << std::endl;
+			}
 			{
 				unsigned int mc(recompute_db(db, verbose));
 				std::cerr << "Recompute Restrictions Airway Segments: " << mc << " restrictions modified" << std::endl;
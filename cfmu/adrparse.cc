@@ -6233,7 +6233,7 @@ void ParseXML::NodeAIXMObject::on_timeslice(const NodeAIXMTimeSlice::ptr_t& el)
 		}
 		typename BT::ptr_t p;
 		{
-			Object::const_ptr_t p1(m_parser.m_db.load_temp(m_uuid));
+			Object::const_ptr_t p1(m_parser.load_temp(m_uuid));
 			if (!p1)
 				p1 = m_parser.m_db.load(m_uuid);
 			if (p1) {
@@ -6252,7 +6252,7 @@ void ParseXML::NodeAIXMObject::on_timeslice(const NodeAIXMTimeSlice::ptr_t& el)
 		}
 		p->add_timeslice(elx->get_timeslice());
 		if (p->is_dirty()) {
-			m_parser.m_db.save_temp(p);
+			m_parser.save_temp(p);
 			if (m_parser.m_verbose)
 				p->print(std::cout);
 		}
@@ -6530,7 +6530,7 @@ void ParseXML::NodeADRMessage::on_subelement(const NodeADRMessageMember::ptr_t&
 const bool ParseXML::tracestack;
 
 ParseXML::ParseXML(Database& db, bool verbose)
-	: m_db(db), m_errorcnt(0), m_warncnt(0), m_verbose(verbose)
+	: m_db(db), m_errorcnt(0), m_warncnt(0), m_objcnt(0), m_worker(0), m_storetime(0), m_verbose(verbose)
 {
 	NodeText::check_type_order();
 	NodeLink::check_type_order();
@@ -6675,6 +6675,51 @@ ParseXML::ParseXML(Database& db, bool verbose)
 
 ParseXML::~ParseXML()
 {
+	try {
+		flush();
+	} catch (const std::exception& e) {
+		std::cerr << "ADR Loader: cannot save objects: " << e.what() << std::endl;
+	}
+}
+
+Object::const_ptr_t ParseXML::load_temp(const UUID& uuid)
+{
+	tempobj_t::const_iterator i(m_tempobj.find(uuid));
+	if (i != m_tempobj.end())
+		return i->second;
+	return m_db.load_temp(uuid);
+}
+
+void ParseXML::save_temp(const Object::ptr_t& p)
+{
+	if (!p)
+		return;
+	std::pair<tempobj_t::iterator,bool> ins(m_tempobj.insert(tempobj_t::value_type(p->get_uuid(), p)));
+	if (!ins.second)
+		ins.first->second = p;
+	if (m_tempobj.size() >= tempobj_batch)
+		flush();
+}
+
+void ParseXML::flush(void)
+{
+	if (m_tempobj.empty())
+		return;
+	Glib::TimeVal tv;
+	tv.assign_current_time();
+	Database::objects_t objs;
+	objs.reserve(m_tempobj.size());
+	for (tempobj_t::const_iterator i(m_tempobj.begin()), e(m_tempobj.end()); i != e; ++i)
+		objs.push_back(i->second);
+	m_db.save_temp(objs, m_worker);
+	m_objcnt += objs.size();
+	m_tempobj.clear();
+	{
+		Glib::TimeVal tv1;
+		tv1.assign_current_time();
+		tv1 -= tv;
+		m_storetime += tv1.as_double();
+	}
 }
 
 void ParseXML::error(const std::string& text)
@@ -6723,6 +6768,7 @@ void ParseXML::on_end_document(void)
 			std::cerr << "ADR Loader: parse stack not empty at end of document" << std::endl;
 		error("parse stack not empty at end of document");
 	}
+	flush();
 }
 
 void ParseXML::on_start_element(const Glib::ustring& name, const AttributeList& properties)
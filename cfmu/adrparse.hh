@@ -33,9 +33,14 @@ public:
 
 	unsigned int get_errorcnt(void) const { return m_errorcnt; }
 	unsigned int get_warncnt(void) const { return m_warncnt; }
+	unsigned int get_objcnt(void) const { return m_objcnt; }
+	double get_storetime(void) const { return m_storetime; }
 
 	Database& get_db(void) { return m_db; }
 
+	void set_worker(unsigned int worker = 0) { m_worker = worker; }
+	void flush(void);
+
 protected:
 	class NodeIgnore;
 	class NodeText;
@@ -3466,9 +3471,17 @@ protected:
 	virtual void on_fatal_error(const Glib::ustring& text);
 
 	static const bool tracestack = false;
+	static const unsigned int tempobj_batch = 4096;
+
+	Object::const_ptr_t load_temp(const UUID& uuid);
+	void save_temp(const Object::ptr_t& p);
 
 	Database& m_db;
 
+	// objects parsed but not yet written to the temp tables
+	typedef std::map<UUID,Object::ptr_t> tempobj_t;
+	tempobj_t m_tempobj;
+
 	typedef Node::ptr_t (*factoryfunc_t)(ParseXML&, const std::string&, unsigned int, const AttributeList&);
 	typedef std::map<std::string,factoryfunc_t> factory_t;
 	factory_t m_factory;
@@ -3482,6 +3495,9 @@ protected:
 
 	unsigned int m_errorcnt;
 	unsigned int m_warncnt;
+	unsigned int m_objcnt;
+	unsigned int m_worker;
+	double m_storetime;
 
 	bool m_verbose;
 };
@@ -180,7 +180,7 @@ public:
 	timetype_t get_end(void) const { return m_end; }
 	void set_end(timetype_t x) { m_end = x; }
 
-	typedef IntervalSet<uint16_t> daytimeset_t;
+	typedef IntervalSet<uint16_t, IntervalSmallVector<uint16_t> > daytimeset_t;
 	daytimeset_t& operator[](unsigned int idx) { return m_set[idx]; }
 	const daytimeset_t& operator[](unsigned int idx) const { return m_set[idx]; }
 
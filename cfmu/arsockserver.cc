@@ -10,6 +10,8 @@
 #include <iostream>
 #include <iomanip>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #ifdef HAVE_SYS_PRCTL_H
 #include <sys/prctl.h>
@@ -28,8 +30,12 @@
 #include "icaofpl.h"
 #include "wmm.h"
 
+const std::string::size_type SocketServer::Client::txhighwater;
+const char SocketServer::Router::cachestats_cmdseq[] = "arsockserver-cachestats";
+
 SocketServer::Client::Client(SocketServer *server, const Glib::RefPtr<Gio::SocketConnection>& connection, bool log)
-: m_server(server), m_connection(connection), m_refcount(1), m_closeprotect(0), m_firstreply(true), m_shutdown(false), m_log(log)
+: m_server(server), m_txoffs(0), m_connection(connection), m_refcount(1), m_closeprotect(0), m_firstreply(true), m_shutdown(false),
+  m_encoding(false), m_inputpaused(false), m_log(log)
 {
 	if (true)
 		std::cout << "client create " << (unsigned long long)this << " pid " << getpid() << std::endl;
@@ -72,9 +78,12 @@ void SocketServer::Client::unreference(void) const
 void SocketServer::Client::close(void)
 {
 	m_rxbuf.clear();
+	m_txbuf.clear();
+	m_txoffs = 0;
 	m_connin.disconnect();
 	m_connout.disconnect();
 	m_sendqueue.clear();
+	m_inputpaused = false;
 	if (m_longpoll)
 		m_longpoll->unset_longpoll(get_ptr());
 	m_longpoll.reset();
@@ -102,8 +111,9 @@ void SocketServer::Client::shutdown(void)
 	}
 	m_rxbuf.clear();
 	m_connin.disconnect();
+	m_inputpaused = false;
 	m_connin = Glib::signal_io().connect(sigc::mem_fun(*this, &Client::on_input_eof), m_connection->get_socket()->get_fd(), Glib::IO_IN | Glib::IO_ERR | Glib::IO_HUP);
-	if (!m_sendqueue.empty())
+	if (!m_sendqueue.empty() || m_encoding || m_txoffs < m_txbuf.size())
 		return;
 	m_connout.disconnect();
 	if (m_longpoll)
@@ -147,9 +157,61 @@ void SocketServer::Client::send(const Json::Value& v)
 	if (!m_connection)
 		return;
 	m_sendqueue.push_back(v);
+	m_firstreply = false;
+	if (m_server && m_server->m_encoder) {
+		encode_next();
+		return;
+	}
+	start_output();
+}
+
+void SocketServer::Client::start_output(void)
+{
 	m_connout.disconnect();
 	m_connout = Glib::signal_io().connect(sigc::mem_fun(*this, &Client::on_output), m_connection->get_socket()->get_fd(), Glib::IO_OUT | Glib::IO_ERR);
-	m_firstreply = false;
+}
+
+void SocketServer::Client::encode_next(void)
+{
+	// one message in flight per client keeps the replies in order
+	if (m_encoding || m_sendqueue.empty() || !m_connection || !m_server || !m_server->m_encoder)
+		return;
+	if (m_txbuf.size() - m_txoffs >= txhighwater)
+		return;
+	m_encoding = true;
+	m_server->m_encoder->submit(get_ptr(), m_sendqueue.front());
+	m_sendqueue.pop_front();
+}
+
+void SocketServer::Client::encoded(std::string& msg)
+{
+	m_encoding = false;
+	if (!m_connection)
+		return;
+	if (m_txoffs >= m_txbuf.size()) {
+		m_txbuf.swap(msg);
+		m_txoffs = 0;
+	} else {
+		m_txbuf.erase(0, m_txoffs);
+		m_txoffs = 0;
+		m_txbuf += msg;
+	}
+	start_output();
+	encode_next();
+}
+
+std::string SocketServer::Client::encode(const Json::Value& v)
+{
+	Json::FastWriter writer;
+	std::string msg1(writer.write(v));
+	std::ostringstream msg;
+	msg << "size: " << msg1.size() << '\n' << msg1 << '\n';
+	return msg.str();
+}
+
+bool SocketServer::Client::is_congested(void) const
+{
+	return m_txbuf.size() - m_txoffs >= txhighwater || m_sendqueue.size() >= 4;
 }
 
 int SocketServer::decode_json(Json::Value& root, std::string& rxbuf)
@@ -240,20 +302,20 @@ int SocketServer::decode_json(Json::Value& root, std::string& rxbuf)
 bool SocketServer::Client::on_output(Glib::IOCondition iocond)
 {
 	m_connout.disconnect();
-	if (m_txbuf.empty()) {
+	if (m_txoffs >= m_txbuf.size()) {
+		m_txbuf.clear();
+		m_txoffs = 0;
+		if (m_encoding)
+			return true;
 		if (m_sendqueue.empty())
 			return true;
-		Json::FastWriter writer;
-		std::ostringstream msg;
-		{
-			std::string msg1(writer.write(*m_sendqueue.begin()));
-			msg << "size: " << msg1.size() << '\n' << msg1 << '\n';
-		}
-		m_txbuf = msg.str();
-		m_sendqueue.erase(m_sendqueue.begin());
+		m_txbuf = encode(m_sendqueue.front());
+		m_sendqueue.pop_front();
 	}
 	try {
-		gssize r(m_connection->get_socket()->send(m_txbuf.c_str(), m_txbuf.size()));
+		// advance an offset instead of erasing the sent part; large replies
+		// would otherwise be moved once per partial send
+		gssize r(m_connection->get_socket()->send(m_txbuf.c_str() + m_txoffs, m_txbuf.size() - m_txoffs));
 		if (r == -1) {
 			if (true)
 				std::cerr << "client " << (unsigned long long)this << " pid " << getpid() << " socket output return value: " << r << std::endl;
@@ -261,11 +323,16 @@ bool SocketServer::Client::on_output(Glib::IOCondition iocond)
 			return true;
 		}
 		if (r >= 0)
-			m_txbuf.erase(0, r);
-		if (m_txbuf.empty() && m_sendqueue.empty() && m_shutdown)
-			shutdown();
+			m_txoffs += r;
 		if (m_log)
-			std::cout << "client " << (unsigned long long)this << " pid " << getpid() << " tx " << m_txbuf << std::endl;
+			std::cout << "client " << (unsigned long long)this << " pid " << getpid() << " tx " << m_txbuf.substr(m_txoffs) << std::endl;
+		if (m_txoffs >= m_txbuf.size()) {
+			m_txbuf.clear();
+			m_txoffs = 0;
+			encode_next();
+			if (m_txbuf.empty() && m_sendqueue.empty() && !m_encoding && m_shutdown)
+				shutdown();
+		}
 	} catch (const Gio::Error& error) {
 		if (error.code() == Gio::Error::WOULD_BLOCK) {
 			if (true)
@@ -277,7 +344,13 @@ bool SocketServer::Client::on_output(Glib::IOCondition iocond)
 			return true;
 		}
 	}
-	if (!m_txbuf.empty() || !m_sendqueue.empty())
+	if (!m_connection)
+		return true;
+	if (m_inputpaused && !is_congested()) {
+		m_inputpaused = false;
+		m_connin = Glib::signal_io().connect(sigc::mem_fun(*this, &Client::on_input), m_connection->get_socket()->get_fd(), Glib::IO_IN | Glib::IO_ERR | Glib::IO_HUP);
+	}
+	if (m_txoffs < m_txbuf.size() || (!m_sendqueue.empty() && !m_encoding))
 		m_connout = Glib::signal_io().connect(sigc::mem_fun(*this, &Client::on_output), m_connection->get_socket()->get_fd(), Glib::IO_OUT | Glib::IO_ERR);
 	return true;
 }
@@ -296,6 +369,13 @@ bool SocketServer::Client::on_input(Glib::IOCondition iocond)
 		close();
 		return false;
 	}
+	if (is_congested()) {
+		// backpressure: do not accept further requests until the client has read its replies
+		m_connin.disconnect();
+		m_inputpaused = true;
+		start_output();
+		return true;
+	}
 	Json::Value root;
 	Json::Value reply;
 	if (m_firstreply) {
@@ -530,7 +610,7 @@ void SocketServer::Client::msgavailable(void)
 }
 
 SocketServer::Router::Router(SocketServer *server, pid_t pid, const Glib::RefPtr<Gio::Socket>& sock, const std::string& sess, int xdisplay, bool log)
-	: m_server(server), m_socket(sock), m_session(sess), m_refcount(1), m_xdisplay(xdisplay), m_pid(pid), m_lifecycle(lifecycle_run), m_log(log)
+	: m_server(server), m_socket(sock), m_cachestatspending(0), m_session(sess), m_refcount(1), m_xdisplay(xdisplay), m_pid(pid), m_lifecycle(lifecycle_run), m_log(log)
 {
 	m_accesstime.assign_current_time();
 	m_starttime = m_accesstime;
@@ -672,18 +752,26 @@ bool SocketServer::Router::on_input(Glib::IOCondition iocond)
 		tv.assign_current_time();
 		root["timestampenqueue"] = (std::string)tv.as_iso8601();
 	}
+	// replies to our own statistics requests are kept, cachestats commands of the client are passed on
+	if (m_cachestatspending && root.isMember("cmdname") && root["cmdname"].isString() && root["cmdname"].asString() == "cachestats" &&
+	    root.isMember("cmdseq") && root["cmdseq"].isString() && root["cmdseq"].asString() == cachestats_cmdseq) {
+		--m_cachestatspending;
+		m_cachestats.swap(root);
+		return true;
+	}
 	m_recvqueue.push_back(root);
 	notify_longpoll();
 	return true;
 }
 
-void SocketServer::Router::send(const Json::Value& v)
+void SocketServer::Router::send(const Json::Value& v, bool access)
 {
 	if (!is_running())
 		return;
 	if (!m_socket)
 		return;
-	m_accesstime.assign_current_time();
+	if (access)
+		m_accesstime.assign_current_time();
 	m_sendqueue.push_back(v);
 	if (false) {
 		Json::FastWriter writer;
@@ -693,6 +781,19 @@ void SocketServer::Router::send(const Json::Value& v)
 	m_connout = Glib::signal_io().connect(sigc::mem_fun(*this, &Router::on_output), m_socket->get_fd(), Glib::IO_OUT | Glib::IO_ERR);
 }
 
+void SocketServer::Router::request_cachestats(unsigned int cachedump)
+{
+	if (!is_running() || !m_socket)
+		return;
+	Json::Value req;
+	req["cmdname"] = "cachestats";
+	req["cmdseq"] = cachestats_cmdseq;
+	if (cachedump)
+		req["cachedump"] = cachedump;
+	send(req, false);
+	++m_cachestatspending;
+}
+
 void SocketServer::Router::receive(Json::Value& reply, const stringset_t& logfilter, const stringset_t& logdiscard)
 {
 	Json::Value& replycmds(reply["cmds"]);
@@ -865,13 +966,114 @@ void SocketServer::Router::notify_longpoll(void)
 	m_longpoll.reset();
 }
 
+SocketServer::Encoder::Encoder(unsigned int nrthreads)
+	: m_quit(false)
+{
+	m_pipe[0] = m_pipe[1] = -1;
+	if (pipe(m_pipe))
+		throw std::runtime_error("Encoder: cannot create pipe");
+	fcntl(m_pipe[0], F_SETFL, fcntl(m_pipe[0], F_GETFL) | O_NONBLOCK);
+	for (unsigned int i = 0; i < nrthreads; ++i)
+		m_threads.push_back(Glib::Threads::Thread::create(sigc::mem_fun(*this, &Encoder::run)));
+}
+
+SocketServer::Encoder::~Encoder()
+{
+	{
+		Glib::Threads::Mutex::Lock lock(m_mutex);
+		m_quit = true;
+		m_cond.broadcast();
+	}
+	for (std::vector<Glib::Threads::Thread *>::iterator ti(m_threads.begin()), te(m_threads.end()); ti != te; ++ti)
+		(*ti)->join();
+	m_threads.clear();
+	m_jobs.clear();
+	m_results.clear();
+	for (unsigned int i = 0; i < 2; ++i)
+		if (m_pipe[i] != -1)
+			::close(m_pipe[i]);
+}
+
+void SocketServer::Encoder::abandon(void)
+{
+	// the mutex may have been held by a worker at fork time, so do not touch it;
+	// the object is leaked intentionally
+	for (unsigned int i = 0; i < 2; ++i) {
+		if (m_pipe[i] != -1)
+			::close(m_pipe[i]);
+		m_pipe[i] = -1;
+	}
+	m_threads.clear();
+}
+
+void SocketServer::Encoder::submit(const Client::ptr_t& clnt, Json::Value& v)
+{
+	Glib::Threads::Mutex::Lock lock(m_mutex);
+	m_jobs.push_back(Job());
+	m_jobs.back().m_client = clnt;
+	m_jobs.back().m_value.swap(v);
+	m_cond.signal();
+}
+
+void SocketServer::Encoder::get_results(results_t& r)
+{
+	char buf[64];
+	while (read(m_pipe[0], buf, sizeof(buf)) > 0);
+	Glib::Threads::Mutex::Lock lock(m_mutex);
+	r.splice(r.end(), m_results);
+}
+
+void SocketServer::Encoder::run(void)
+{
+	Glib::Threads::Mutex::Lock lock(m_mutex);
+	for (;;) {
+		if (m_quit)
+			return;
+		if (m_jobs.empty()) {
+			m_cond.wait(m_mutex);
+			continue;
+		}
+		// splice nodes between lists so that client references are never
+		// dropped on a worker thread
+		jobs_t job;
+		job.splice(job.end(), m_jobs, m_jobs.begin());
+		lock.release();
+		std::string msg(Client::encode(job.front().m_value));
+		job.front().m_value = Json::Value();
+		results_t res;
+		res.push_back(result_t());
+		res.back().first.swap(job.front().m_client);
+		res.back().second.swap(msg);
+		lock.acquire();
+		bool notify(m_results.empty());
+		m_results.splice(m_results.end(), res);
+		if (notify) {
+			char ch(0);
+			while (write(m_pipe[1], &ch, 1) == -1 && errno == EINTR);
+		}
+	}
+}
+
+bool SocketServer::on_encoder(Glib::IOCondition iocond)
+{
+	if (!m_encoder)
+		return false;
+	Encoder::results_t res;
+	m_encoder->get_results(res);
+	for (Encoder::results_t::iterator ri(res.begin()), re(res.end()); ri != re; ++ri)
+		if (ri->first)
+			ri->first->encoded(ri->second);
+	return true;
+}
+
 SocketServer::SocketServer(CFMUAutoroute *autoroute, const Glib::RefPtr<Glib::MainLoop>& mainloop, unsigned int connlimit,
 			   unsigned int actlimit, unsigned int timeout, unsigned int maxruntime, int xdisplay,
-			   bool logclient, bool logrouter, bool logsockcli, bool setprocname)
+			   bool logclient, bool logrouter, bool logsockcli, bool setprocname, unsigned int encoderthreads)
 	: m_autoroute(autoroute), m_mainloop(mainloop), m_logdir("/tmp/cfmuautoroute"),
 	  m_connectlimit(connlimit), m_activelimit(actlimit),
 	  m_timeout(timeout), m_maxruntime(maxruntime), m_xdisplay(xdisplay), m_quit(false),
-	  m_logclient(logclient), m_logrouter(logrouter), m_logsockcli(logsockcli), m_setprocname(setprocname)
+	  m_logclient(logclient), m_logrouter(logrouter), m_logsockcli(logsockcli), m_setprocname(setprocname),
+	  m_encoderthreads(encoderthreads), m_encoder(0)
 {
 	m_cmdlist["nop"] = &SocketServer::cmd_nop;
 	m_cmdlist["quit"] = &SocketServer::cmd_quit;
@@ -894,6 +1096,7 @@ SocketServer::SocketServer(CFMUAutoroute *autoroute, const Glib::RefPtr<Glib::Ma
 	m_cmdlist["clear"] = &SocketServer::cmd_clear;
 	m_cmdlist["fplparse"] = &SocketServer::cmd_fplparse;
 	m_cmdlist["fplparseadr"] = &SocketServer::cmd_fplparseadr;
+	m_cmdlist["cachestats"] = &SocketServer::cmd_cachestats;
 	m_servercmdlist["scangrib2"] = &SocketServer::servercmd_scangrib2;
 	m_servercmdlist["reloaddb"] = &SocketServer::servercmd_reloaddb;
 	m_servercmdlist["processes"] = &SocketServer::servercmd_processes;
@@ -907,6 +1110,9 @@ SocketServer::SocketServer(CFMUAutoroute *autoroute, const Glib::RefPtr<Glib::Ma
 
 SocketServer::~SocketServer()
 {
+	m_encoderconn.disconnect();
+	delete m_encoder;
+	m_encoder = 0;
 	m_rtrtimeoutconn.disconnect();
 	m_clients.clear();
 	m_routers.clear();
@@ -1001,6 +1207,10 @@ void SocketServer::listen(const std::string& path, uid_t socketuid, gid_t socket
 		}
 		m_quit = false;
 	}
+	if (!m_encoder && m_encoderthreads) {
+		m_encoder = new Encoder(m_encoderthreads);
+		m_encoderconn = Glib::signal_io().connect(sigc::mem_fun(*this, &SocketServer::on_encoder), m_encoder->get_fd(), Glib::IO_IN);
+	}
 	m_listenservice = Gio::SocketService::create();
 	m_listenservice->signal_incoming().connect(sigc::mem_fun(*this, &SocketServer::on_connect));
 	if (!m_listenservice->add_socket(m_listensock))
@@ -1085,6 +1295,11 @@ SocketServer::Router::ptr_t SocketServer::find_router(const std::string& session
 	if (!pid) {
 		// child
 		close(socks[0]);
+		m_encoderconn.disconnect();
+		if (m_encoder) {
+			m_encoder->abandon();
+			m_encoder = 0;
+		}
 		m_listenservice->stop();
 		m_listensockaddr.reset();
 		m_listenservice.reset();
@@ -1170,6 +1385,9 @@ bool SocketServer::router_timeout_handler(void)
 		Router::ptr_t p(i->second);
 		++i;
 		p->handle_timeout(tvacc, tvrun);
+		// keep the statistics reported by the processes server command current
+		if (!p->is_cachestats_pending())
+			p->request_cachestats();
 	}
 	return true;
 }
@@ -1331,6 +1549,17 @@ void SocketServer::sockcli_statuschange(CFMUAutoroute::statusmask_t status)
 			reply["internalerror"] = !!(status & CFMUAutoroute::statusmask_stoppingerrorinternalerror);
 			reply["iterationerror"] = !!(status & CFMUAutoroute::statusmask_stoppingerroriteration);
 			reply["userstop"] = !!(status & CFMUAutoroute::statusmask_stoppingerroruser);
+			CFMUAutoroute51 *ar51(dynamic_cast<CFMUAutoroute51 *>(m_autoroute));
+			if (ar51) {
+				const CFMUAutoroute51::RouteCache& rc(ar51->get_routecache());
+				Json::Value& cache(reply["routecache"]);
+				cache["hit"] = ar51->is_routecache_hit();
+				cache["entries"] = rc.size();
+				cache["hits"] = (Json::LargestUInt)rc.get_hits();
+				cache["misses"] = (Json::LargestUInt)rc.get_misses();
+				cache["rejects"] = (Json::LargestUInt)rc.get_rejects();
+				cache["expired"] = (Json::LargestUInt)rc.get_expired();
+			}
                 }
 		sockcli_timestamp(reply);
                 sockcli_send(reply);
@@ -2262,6 +2491,213 @@ void SocketServer::check_fplan(Json::Value& localvalidate, const ADR::FlightPlan
 	}
 }
 
+SocketServer::JsonStreamWriter::JsonStreamWriter(int fd, std::string::size_type chunksize)
+	: m_chunksize(std::max(chunksize, (std::string::size_type)256)), m_fd(fd), m_afterkey(false), m_error(fd == -1)
+{
+	m_buf.reserve(m_chunksize);
+}
+
+SocketServer::JsonStreamWriter::~JsonStreamWriter()
+{
+	flush();
+}
+
+void SocketServer::JsonStreamWriter::flush(void)
+{
+	const char *p(m_buf.c_str());
+	std::string::size_type n(m_buf.size());
+	while (n && !m_error) {
+		ssize_t r(write(m_fd, p, n));
+		if (r == -1) {
+			if (errno == EINTR)
+				continue;
+			m_error = true;
+			break;
+		}
+		p += r;
+		n -= r;
+	}
+	m_buf.clear();
+}
+
+void SocketServer::JsonStreamWriter::check_flush(void)
+{
+	if (m_buf.size() >= m_chunksize)
+		flush();
+}
+
+void SocketServer::JsonStreamWriter::put(char ch)
+{
+	m_buf.push_back(ch);
+	check_flush();
+}
+
+void SocketServer::JsonStreamWriter::put(const char *s, std::string::size_type n)
+{
+	m_buf.append(s, n);
+	check_flush();
+}
+
+void SocketServer::JsonStreamWriter::put_string(const std::string& s)
+{
+	static const char hexdigits[] = "0123456789abcdef";
+	m_buf.push_back('"');
+	for (std::string::const_iterator i(s.begin()), e(s.end()); i != e; ++i) {
+		unsigned char ch(*i);
+		switch (ch) {
+		case '"':
+			m_buf.append("\\\"", 2);
+			break;
+
+		case '\\':
+			m_buf.append("\\\\", 2);
+			break;
+
+		case '\b':
+			m_buf.append("\\b", 2);
+			break;
+
+		case '\f':
+			m_buf.append("\\f", 2);
+			break;
+
+		case '\n':
+			m_buf.append("\\n", 2);
+			break;
+
+		case '\r':
+			m_buf.append("\\r", 2);
+			break;
+
+		case '\t':
+			m_buf.append("\\t", 2);
+			break;
+
+		default:
+			if (ch < 0x20) {
+				m_buf.append("\\u00", 4);
+				m_buf.push_back(hexdigits[ch >> 4]);
+				m_buf.push_back(hexdigits[ch & 15]);
+				break;
+			}
+			m_buf.push_back(ch);
+			break;
+		}
+		if (m_buf.size() >= m_chunksize)
+			flush();
+	}
+	put('"');
+}
+
+void SocketServer::JsonStreamWriter::separator(void)
+{
+	if (m_afterkey) {
+		m_afterkey = false;
+		return;
+	}
+	if (m_first.empty())
+		return;
+	if (m_first.back()) {
+		m_first.back() = false;
+		return;
+	}
+	put(',');
+}
+
+void SocketServer::JsonStreamWriter::begin_object(void)
+{
+	separator();
+	put('{');
+	m_first.push_back(true);
+}
+
+void SocketServer::JsonStreamWriter::end_object(void)
+{
+	if (!m_first.empty())
+		m_first.pop_back();
+	put('}');
+}
+
+void SocketServer::JsonStreamWriter::begin_array(void)
+{
+	separator();
+	put('[');
+	m_first.push_back(true);
+}
+
+void SocketServer::JsonStreamWriter::end_array(void)
+{
+	if (!m_first.empty())
+		m_first.pop_back();
+	put(']');
+}
+
+void SocketServer::JsonStreamWriter::key(const std::string& k)
+{
+	separator();
+	put_string(k);
+	put(':');
+	m_afterkey = true;
+}
+
+void SocketServer::JsonStreamWriter::value(const Json::Value& v)
+{
+	separator();
+	switch (v.type()) {
+	case Json::nullValue:
+		put("null", 4);
+		break;
+
+	case Json::booleanValue:
+		if (v.asBool())
+			put("true", 4);
+		else
+			put("false", 5);
+		break;
+
+	case Json::intValue:
+	case Json::uintValue:
+	{
+		std::ostringstream oss;
+		if (v.type() == Json::intValue)
+			oss << v.asLargestInt();
+		else
+			oss << v.asLargestUInt();
+		std::string x(oss.str());
+		put(x.c_str(), x.size());
+		break;
+	}
+
+	case Json::realValue:
+	{
+		double x(v.asDouble());
+		if (std::isnan(x) || std::isinf(x)) {
+			put("null", 4);
+			break;
+		}
+		// locale independent
+		char buf[G_ASCII_DTOSTR_BUF_SIZE];
+		g_ascii_dtostr(buf, sizeof(buf), x);
+		put(buf, strlen(buf));
+		break;
+	}
+
+	case Json::stringValue:
+		put_string(v.asString());
+		break;
+
+	default:
+	{
+		Json::FastWriter writer;
+		std::string x(writer.write(v));
+		if (!x.empty() && x[x.size() - 1] == '\n')
+			x.resize(x.size() - 1);
+		put(x.c_str(), x.size());
+		break;
+	}
+	}
+}
+
 void SocketServer::routeweather(Json::Value& wxval, const FPlanRoute& route)
 {
 	if (!m_autoroute) {
@@ -2275,96 +2711,105 @@ void SocketServer::routeweather(Json::Value& wxval, const FPlanRoute& route)
 		return;
 	}
 	wxval["file"] = fname;
-	Json::Value wx;
-	// Route Profile
-	try {
-		TopoDb30 topodb;
-                topodb.open(m_autoroute->get_db_auxdir().empty() ? Engine::get_default_aux_dir() : m_autoroute->get_db_auxdir());
-		TopoDb30::RouteProfile p(topodb.get_profile(route, 5));
-		topodb.close();
-		Json::Value& wxterrain(wx["terrain"]);
-		for (TopoDb30::RouteProfile::const_iterator pi(p.begin()), pe(p.end()); pi != pe; ++pi) {
-			Json::Value v;
-			v.append(Json::Value(pi->get_dist()));
-			v.append(Json::Value(pi->get_routedist()));
-			v.append(Json::Value(pi->get_routeindex()));
-			v.append(Json::Value(pi->get_elev()));
-			v.append(Json::Value(pi->get_minelev()));
-			v.append(Json::Value(pi->get_maxelev()));
-			wxterrain.append(v);
-		}
-        } catch (const std::exception& e) {
-		wxval["error"] = std::string("topo db error: ") + e.what();
-        }
-	// Weather Profile
+	// the profiles can be large, stream them to the file instead of building a Json::Value tree
 	{
-		static const unsigned int nrsfc(sizeof(GRIB2::WeatherProfilePoint::isobaric_levels)/sizeof(GRIB2::WeatherProfilePoint::isobaric_levels[0]));
-		{
-			Json::Value& wxsfc(wx["wxsurfaces"]);
-			for (unsigned int i = 0; i < nrsfc; ++i) {
-				Json::Value v;
-				if (GRIB2::WeatherProfilePoint::isobaric_levels[i] >= 0)
-					v["pressure"] = GRIB2::WeatherProfilePoint::isobaric_levels[i];
-				v["altitude"] = GRIB2::WeatherProfilePoint::altitudes[i];
-				wxsfc.append(v);
+		JsonStreamWriter wx(fd);
+		wx.begin_object();
+		// Route Profile
+		try {
+			TopoDb30 topodb;
+			topodb.open(m_autoroute->get_db_auxdir().empty() ? Engine::get_default_aux_dir() : m_autoroute->get_db_auxdir());
+			TopoDb30::RouteProfile p(topodb.get_profile(route, 5));
+			topodb.close();
+			wx.key("terrain");
+			wx.begin_array();
+			for (TopoDb30::RouteProfile::const_iterator pi(p.begin()), pe(p.end()); pi != pe; ++pi) {
+				wx.begin_array();
+				wx.value(pi->get_dist());
+				wx.value(pi->get_routedist());
+				wx.value(pi->get_routeindex());
+				wx.value(pi->get_elev());
+				wx.value(pi->get_minelev());
+				wx.value(pi->get_maxelev());
+				wx.end_array();
 			}
+			wx.end_array();
+		} catch (const std::exception& e) {
+			wxval["error"] = std::string("topo db error: ") + e.what();
 		}
-		GRIB2::WeatherProfile p(m_autoroute->get_grib2().get_profile(route));
-		Json::Value& wxprof(wx["wxprofile"]);
-		for (GRIB2::WeatherProfile::const_iterator pi(p.begin()), pe(p.end()); pi != pe; ++pi) {
-			Json::Value v;
-			v.append(Json::Value(pi->get_pt().get_lat_deg_dbl()));
-			v.append(Json::Value(pi->get_pt().get_lon_deg_dbl()));
-			v.append(Json::Value((Json::LargestInt)pi->get_efftime()));
-			v.append(Json::Value(pi->get_alt()));
-			v.append(Json::Value(pi->get_dist()));
-			v.append(Json::Value(pi->get_routedist()));
-			v.append(Json::Value(pi->get_routeindex()));
-			v.append(Json::Value(pi->get_zerodegisotherm()));
-			v.append(Json::Value(pi->get_tropopause()));
-			v.append(Json::Value(pi->get_cldbdrycover()));
-			v.append(Json::Value(pi->get_cldlowcover()));
-			v.append(Json::Value(pi->get_cldlowbase()));
-			v.append(Json::Value(pi->get_cldlowtop()));
-			v.append(Json::Value(pi->get_cldmidcover()));
-			v.append(Json::Value(pi->get_cldmidbase()));
-			v.append(Json::Value(pi->get_cldmidtop()));
-			v.append(Json::Value(pi->get_cldhighcover()));
-			v.append(Json::Value(pi->get_cldhighbase()));
-			v.append(Json::Value(pi->get_cldhightop()));
-			v.append(Json::Value(pi->get_cldconvcover()));
-			v.append(Json::Value(pi->get_cldconvbase()));
-			v.append(Json::Value(pi->get_cldconvtop()));
-			v.append(Json::Value(pi->get_precip()));
-			v.append(Json::Value(pi->get_preciprate()));
-			v.append(Json::Value(pi->get_convprecip()));
-			v.append(Json::Value(pi->get_convpreciprate()));
-			v.append(Json::Value(pi->get_flags() & GRIB2::WeatherProfilePoint::flags_daymask));
-			v.append(Json::Value(!!(pi->get_flags() & GRIB2::WeatherProfilePoint::flags_rain)));
-			v.append(Json::Value(!!(pi->get_flags() & GRIB2::WeatherProfilePoint::flags_freezingrain)));
-			v.append(Json::Value(!!(pi->get_flags() & GRIB2::WeatherProfilePoint::flags_icepellets)));
-			v.append(Json::Value(!!(pi->get_flags() & GRIB2::WeatherProfilePoint::flags_snow)));
-			Json::Value vs;
+		// Weather Profile
+		{
+			static const unsigned int nrsfc(sizeof(GRIB2::WeatherProfilePoint::isobaric_levels)/sizeof(GRIB2::WeatherProfilePoint::isobaric_levels[0]));
+			wx.key("wxsurfaces");
+			wx.begin_array();
 			for (unsigned int i = 0; i < nrsfc; ++i) {
-				const GRIB2::WeatherProfilePoint::Surface& sfc(pi->operator[](i));
-				Json::Value vv;
-				vv.append(Json::Value(sfc.get_uwind()));
-				vv.append(Json::Value(sfc.get_vwind()));
-				vv.append(Json::Value(sfc.get_temp()));
-				vv.append(Json::Value(sfc.get_rh()));
-				vv.append(Json::Value(sfc.get_hwsh()));
-				vv.append(Json::Value(sfc.get_vwsh()));
-				vs.append(vv);
+				wx.begin_object();
+				if (GRIB2::WeatherProfilePoint::isobaric_levels[i] >= 0) {
+					wx.key("pressure");
+					wx.value(GRIB2::WeatherProfilePoint::isobaric_levels[i]);
+				}
+				wx.key("altitude");
+				wx.value(GRIB2::WeatherProfilePoint::altitudes[i]);
+				wx.end_object();
+			}
+			wx.end_array();
+			GRIB2::WeatherProfile p(m_autoroute->get_grib2().get_profile(route));
+			wx.key("wxprofile");
+			wx.begin_array();
+			for (GRIB2::WeatherProfile::const_iterator pi(p.begin()), pe(p.end()); pi != pe; ++pi) {
+				wx.begin_array();
+				wx.value(pi->get_pt().get_lat_deg_dbl());
+				wx.value(pi->get_pt().get_lon_deg_dbl());
+				wx.value((Json::LargestInt)pi->get_efftime());
+				wx.value(pi->get_alt());
+				wx.value(pi->get_dist());
+				wx.value(pi->get_routedist());
+				wx.value(pi->get_routeindex());
+				wx.value(pi->get_zerodegisotherm());
+				wx.value(pi->get_tropopause());
+				wx.value(pi->get_cldbdrycover());
+				wx.value(pi->get_cldlowcover());
+				wx.value(pi->get_cldlowbase());
+				wx.value(pi->get_cldlowtop());
+				wx.value(pi->get_cldmidcover());
+				wx.value(pi->get_cldmidbase());
+				wx.value(pi->get_cldmidtop());
+				wx.value(pi->get_cldhighcover());
+				wx.value(pi->get_cldhighbase());
+				wx.value(pi->get_cldhightop());
+				wx.value(pi->get_cldconvcover());
+				wx.value(pi->get_cldconvbase());
+				wx.value(pi->get_cldconvtop());
+				wx.value(pi->get_precip());
+				wx.value(pi->get_preciprate());
+				wx.value(pi->get_convprecip());
+				wx.value(pi->get_convpreciprate());
+				wx.value(pi->get_flags() & GRIB2::WeatherProfilePoint::flags_daymask);
+				wx.value(!!(pi->get_flags() & GRIB2::WeatherProfilePoint::flags_rain));
+				wx.value(!!(pi->get_flags() & GRIB2::WeatherProfilePoint::flags_freezingrain));
+				wx.value(!!(pi->get_flags() & GRIB2::WeatherProfilePoint::flags_icepellets));
+				wx.value(!!(pi->get_flags() & GRIB2::WeatherProfilePoint::flags_snow));
+				wx.begin_array();
+				for (unsigned int i = 0; i < nrsfc; ++i) {
+					const GRIB2::WeatherProfilePoint::Surface& sfc(pi->operator[](i));
+					wx.begin_array();
+					wx.value(sfc.get_uwind());
+					wx.value(sfc.get_vwind());
+					wx.value(sfc.get_temp());
+					wx.value(sfc.get_rh());
+					wx.value(sfc.get_hwsh());
+					wx.value(sfc.get_vwsh());
+					wx.end_array();
+				}
+				wx.end_array();
+				wx.end_array();
 			}
-			v.append(vs);
-			wxprof.append(v);
+			wx.end_array();
 		}
-	}
-	// write file
-	{
-		Json::FastWriter writer;
-		std::string msg(writer.write(wx));
-		write(fd, msg.c_str(), msg.size());
+		wx.end_object();
+		wx.flush();
+		if (wx.is_error() && !wxval.isMember("error"))
+			wxval["error"] = "cannot write file " + fname;
 	}
 	close(fd);
 }
@@ -2381,6 +2826,7 @@ void SocketServer::weathercharts(Json::Value& wxval, const FPlanRoute& route, do
 		wxval["error"] = "no charts requested";
 		return;
 	}
+	gint64 tstart(g_get_monotonic_time());
 	MeteoProfile prof(route);
 	MeteoChart chart(route, std::vector<FPlanAlternate>(), std::vector<FPlanRoute>(), m_autoroute->get_grib2());
 	if (gramet) {
@@ -2400,6 +2846,7 @@ void SocketServer::weathercharts(Json::Value& wxval, const FPlanRoute& route, do
 			return;
 		}
 	}
+	double profiletime((g_get_monotonic_time() - tstart) * 1e-6);
 	std::string fname(Glib::build_filename(m_autoroute->get_logprefix(), "weather-XXXXXX"));
 	int fd(Glib::mkstemp(fname));
 	if (fd == -1) {
@@ -2415,8 +2862,10 @@ void SocketServer::weathercharts(Json::Value& wxval, const FPlanRoute& route, do
 		surface = pdfsurface = Cairo::PdfSurface::create(fname, width, height);
 	}
 	close(fd);
+	// the output context is only used for text metrics; pages are rendered
+	// concurrently into recording surfaces and replayed onto the output
 	Cairo::RefPtr<Cairo::Context> ctx(Cairo::Context::create(surface));
-	ctx->translate(20, 20);
+	MeteoPageRenderer renderer;
 	if (gramet) {
 		static const double maxprofilepagedist(200);
 		double pagedist(route.total_distance_nmi_dbl());
@@ -2434,11 +2883,9 @@ void SocketServer::weathercharts(Json::Value& wxval, const FPlanRoute& route, do
 			scaleelev = prof.get_scaleelev(ctx, height - 40, profilemaxalt, profileyaxis);
 			originelev = 0;
 		}
-		for (unsigned int pgnr(0); pgnr < nrpages; ++pgnr) {
-			prof.draw(ctx, width - 40, height - 40, pgnr * pagedist, scaledist, originelev, scaleelev, profileyaxis);
-			ctx->show_page();
-			//surface->show_page();
-		}
+		for (unsigned int pgnr(0); pgnr < nrpages; ++pgnr)
+			renderer.add_profile(prof, width, height, width - 40, height - 40, pgnr * pagedist, scaledist,
+					     originelev, scaleelev, profileyaxis);
 	}
 	if (!hpa.empty()) {
 		Point center;
@@ -2453,18 +2900,28 @@ void SocketServer::weathercharts(Json::Value& wxval, const FPlanRoute& route, do
 				scalelon = scalelon1;
 				scalelat = scalelat1;
 				std::swap(width, height);
-				pdfsurface->set_size(width, height);
-				ctx = Cairo::Context::create(surface);
-				ctx->translate(20, 20);
 			}
 		}
-		for (std::vector<double>::const_iterator i(hpa.begin()), e(hpa.end()); i != e; ++i) {
-			chart.draw(ctx, width - 40, height - 40, center, scalelon, scalelat, 100.0 * *i);
-			ctx->show_page();
-			//surface->show_page();
+		for (std::vector<double>::const_iterator i(hpa.begin()), e(hpa.end()); i != e; ++i)
+			renderer.add_chart(chart, width, height, width - 40, height - 40, center, scalelon, scalelat, 100.0 * *i);
+	}
+	ctx.clear();
+	renderer.render();
+	renderer.output(surface);
+	Json::Value& timing(wxval["timing"]);
+	timing["profile"] = profiletime;
+	timing["render"] = renderer.get_rendertime();
+	timing["output"] = renderer.get_outputtime();
+	for (unsigned int i = 0; i < renderer.size(); ++i) {
+		Json::Value pg;
+		pg["time"] = renderer.get_pagetime(i);
+		if (!renderer.get_pageerror(i).empty()) {
+			pg["error"] = renderer.get_pageerror(i);
+			if (!wxval.isMember("error"))
+				wxval["error"] = "page render error: " + renderer.get_pageerror(i);
 		}
+		timing["pages"].append(pg);
 	}
-	surface->finish();
 }
 
 void SocketServer::navlog(Json::Value& nlog, const FPlanRoute& route, const std::string& templ, const FPlanRoute::GFSResult& gfsr, bool hidewbpage)
@@ -2502,6 +2959,35 @@ void SocketServer::cmd_nop(const Json::Value& cmdin, Json::Value& cmdout)
 {
 }
 
+void SocketServer::cmd_cachestats(const Json::Value& cmdin, Json::Value& cmdout)
+{
+	CFMUAutoroute51 *ar51(dynamic_cast<CFMUAutoroute51 *>(m_autoroute));
+	if (!ar51)
+		return;
+	const ADR::Database& db(ar51->get_db());
+	ADR::Database::CacheStats st(db.get_cache_stats());
+	Json::Value& cache(cmdout["adrcache"]);
+	cache["entries"] = st.get_cacheentries();
+	cache["pinned"] = st.get_cachepinned();
+	cache["bytes"] = (Json::LargestUInt)st.get_cachebytes();
+	cache["budget"] = (Json::LargestUInt)st.get_cachebudget();
+	cache["hits"] = (Json::LargestUInt)st.get_cachehits();
+	cache["misses"] = (Json::LargestUInt)st.get_cachemisses();
+	cache["evictions"] = (Json::LargestUInt)st.get_cacheevictions();
+	cache["binfileloads"] = (Json::LargestUInt)st.get_binfileloads();
+	cache["dbloads"] = (Json::LargestUInt)st.get_dbloads();
+	cache["binfilesize"] = (Json::LargestUInt)st.get_binfilesize();
+	cache["binfilewarmup"] = st.get_binfilewarmup();
+	cache["rss"] = (Json::LargestUInt)st.get_rss();
+	cache["rssshared"] = (Json::LargestUInt)st.get_rssshared();
+	cache["rssprivate"] = (Json::LargestUInt)st.get_rssprivate();
+	if (cmdin.isMember("cachedump") && cmdin["cachedump"].isUInt()) {
+		std::ostringstream oss;
+		db.dump_cache(oss, cmdin["cachedump"].asUInt());
+		cache["dump"] = oss.str();
+	}
+}
+
 void SocketServer::cmd_quit(const Json::Value& cmdin, Json::Value& cmdout)
 {
 	if (m_mainloop)
@@ -3620,8 +4106,25 @@ void SocketServer::servercmd_processes(const Json::Value& cmdin, Json::Value& cm
 		rtr["pid"] = ri->second->get_pid();
 		rtr["running"] = ri->second->is_running();
 		rtr["dead"] = ri->second->is_dead();
+		{
+			const Json::Value& st(ri->second->get_cachestats());
+			if (st.isMember("adrcache"))
+				rtr["adrcache"] = st["adrcache"];
+			if (st.isMember("timestampenqueue"))
+				rtr["cachestatstime"] = st["timestampenqueue"];
+			rtr["cachestatspending"] = ri->second->is_cachestats_pending();
+		}
 		rtrs.append(rtr);
 	}
+	// the statistics are refreshed by the router timer; a cache dump is requested here
+	// and reported once the router processes have answered
+	if (cmdin.isMember("cachedump") && cmdin["cachedump"].isUInt()) {
+		for (routers_t::const_iterator ri(m_routers.begin()), re(m_routers.end()); ri != re; ++ri) {
+			if (!ri->second)
+				continue;
+			ri->second->request_cachestats(cmdin["cachedump"].asUInt());
+		}
+	}
 }
 
 void SocketServer::servercmd_ruleinfo(const Json::Value& cmdin, Json::Value& cmdout)
@@ -24,7 +24,8 @@ class SocketServer {
 public:
 	SocketServer(CFMUAutoroute *autoroute, const Glib::RefPtr<Glib::MainLoop>& mainloop, unsigned int connlimit = ~0U,
 		     unsigned int actlimit = ~0U, unsigned int timeout = ~0U, unsigned int maxruntime = ~0U, int xdisplay = -1,
-		     bool logclient = true, bool logrouter = true, bool logsockcli = true, bool setprocname = false);
+		     bool logclient = true, bool logrouter = true, bool logsockcli = true, bool setprocname = false,
+		     unsigned int encoderthreads = 2);
 	~SocketServer();
 	void listen(const std::string& path, uid_t socketuid, gid_t socketgid, mode_t socketmode, bool sdterminate);
 	void sockclient(int fd, int xdisplay);
@@ -48,6 +49,7 @@ protected:
 	bool m_logrouter;
 	bool m_logsockcli;
 	bool m_setprocname;
+	unsigned int m_encoderthreads;
 
 	void remove_listensockaddr(void);
 	bool on_connect(const Glib::RefPtr<Gio::SocketConnection>& connection, const Glib::RefPtr<Glib::Object>& source_object);
@@ -66,14 +68,20 @@ protected:
 		void close(void);
 		void shutdown(void);
 		void send(const Json::Value& v);
+		void encoded(std::string& msg);
+		static std::string encode(const Json::Value& v);
 		void msgavailable(void);
 		ptr_t get_ptr(void) { reference(); return ptr_t(this); }
 		const_ptr_t get_ptr(void) const { reference(); return const_ptr_t(this); }
 
 	protected:
+		// stop reading requests while this much encoded output is not yet sent
+		static const std::string::size_type txhighwater = 1024 * 1024;
+
 		SocketServer *m_server;
 		std::string m_rxbuf;
 		std::string m_txbuf;
+		std::string::size_type m_txoffs;
 		Glib::RefPtr<Gio::SocketConnection> m_connection;
 		sigc::connection m_connin;
 		sigc::connection m_connout;
@@ -86,13 +94,55 @@ protected:
 		unsigned int m_closeprotect;
 		bool m_firstreply;
 		bool m_shutdown;
+		bool m_encoding;
+		bool m_inputpaused;
 		bool m_log;
 
 		bool on_input(Glib::IOCondition iocond);
 		bool on_output(Glib::IOCondition iocond);
 		bool on_input_eof(Glib::IOCondition iocond);
+		bool is_congested(void) const;
+		void start_output(void);
+		void encode_next(void);
+	};
+
+	// serializes client replies on worker threads, so large replies
+	// (weather charts, navlogs) do not stall the main loop
+	class Encoder {
+	public:
+		Encoder(unsigned int nrthreads);
+		~Encoder();
+		void submit(const Client::ptr_t& clnt, Json::Value& v);
+		// call in a forked child: the worker threads do not exist there
+		void abandon(void);
+		int get_fd(void) const { return m_pipe[0]; }
+		typedef std::pair<Client::ptr_t,std::string> result_t;
+		typedef std::list<result_t> results_t;
+		void get_results(results_t& r);
+
+	protected:
+		class Job {
+		public:
+			Client::ptr_t m_client;
+			Json::Value m_value;
+		};
+		typedef std::list<Job> jobs_t;
+		jobs_t m_jobs;
+		results_t m_results;
+		std::vector<Glib::Threads::Thread *> m_threads;
+		Glib::Threads::Mutex m_mutex;
+		Glib::Threads::Cond m_cond;
+		int m_pipe[2];
+		bool m_quit;
+
+		void run(void);
 	};
 
+	Encoder *m_encoder;
+	sigc::connection m_encoderconn;
+
+	bool on_encoder(Glib::IOCondition iocond);
+
 	typedef std::set<Client::ptr_t> clients_t;
 	clients_t m_clients;
 
@@ -107,7 +157,8 @@ protected:
 		~Router();
 		void reference(void) const;
 		void unreference(void) const;
-		void send(const Json::Value& v);
+		// access false: do not count as session activity for the idle timeout
+		void send(const Json::Value& v, bool access = true);
 		typedef std::set<std::string> stringset_t;
 		void receive(Json::Value& reply, const stringset_t& logfilter = stringset_t(), const stringset_t& logdiscard = stringset_t());
 		void zap(void);
@@ -123,6 +174,10 @@ protected:
 		const Glib::TimeVal& get_accesstime(void) const { return m_accesstime; }
 		const Glib::TimeVal& get_starttime(void) const { return m_starttime; }
 		pid_t get_pid(void) const { return m_pid; }
+		const Json::Value& get_cachestats(void) const { return m_cachestats; }
+		// ask the router process for cache statistics; the reply is kept, not passed to the client
+		void request_cachestats(unsigned int cachedump = 0);
+		bool is_cachestats_pending(void) const { return !!m_cachestatspending; }
 
 	protected:
 		SocketServer *m_server;
@@ -132,6 +187,10 @@ protected:
 		sigc::connection m_connchildwatch;
 		std::list<Json::Value> m_sendqueue;
 		std::list<Json::Value> m_recvqueue;
+		// tags the statistics requests sent by the server itself
+		static const char cachestats_cmdseq[];
+		Json::Value m_cachestats;
+		unsigned int m_cachestatspending;
 		Glib::TimeVal m_accesstime;
 		Glib::TimeVal m_starttime;
 		Client::ptr_t m_longpoll;
@@ -175,6 +234,37 @@ protected:
 	cmdlist_t m_cmdlist;
 	cmdlist_t m_servercmdlist;
 
+	// writes JSON directly to a file descriptor through a fixed size buffer,
+	// without building a Json::Value tree or a string of the whole document
+	class JsonStreamWriter {
+	public:
+		JsonStreamWriter(int fd, std::string::size_type chunksize = 65536);
+		~JsonStreamWriter();
+		void begin_object(void);
+		void end_object(void);
+		void begin_array(void);
+		void end_array(void);
+		void key(const std::string& k);
+		// scalars are written directly, arrays and objects through Json::FastWriter
+		void value(const Json::Value& v);
+		void flush(void);
+		bool is_error(void) const { return m_error; }
+
+	protected:
+		std::string m_buf;
+		std::vector<bool> m_first;
+		std::string::size_type m_chunksize;
+		int m_fd;
+		bool m_afterkey;
+		bool m_error;
+
+		void separator(void);
+		void put(char ch);
+		void put(const char *s, std::string::size_type n);
+		void put_string(const std::string& s);
+		void check_flush(void);
+	};
+
 	static Point get_point(const Json::Value& cmd, const std::string& name);
 	static void set_point(Json::Value& cmd, const std::string& name, const Point& pt);
 	static void set_double(Json::Value& cmd, const std::string& name, double x);
@@ -219,6 +309,7 @@ protected:
 	void cmd_clear(const Json::Value& cmdin, Json::Value& cmdout);
 	void cmd_fplparse(const Json::Value& cmdin, Json::Value& cmdout);
 	void cmd_fplparseadr(const Json::Value& cmdin, Json::Value& cmdout);
+	void cmd_cachestats(const Json::Value& cmdin, Json::Value& cmdout);
 
 	Json::Value servercmd(const Json::Value& cmdin);
 	void servercmd_scangrib2(const Json::Value& cmdin, Json::Value& cmdout);
@@ -1062,6 +1062,7 @@ int main(int argc, char *argv[])
 		unsigned int routeractivelimit(~0U);
 		unsigned int routertimeout(~0U);
 		unsigned int routermaxruntime(~0U);
+		unsigned int encoderthreads(2);
 		std::string sockserverpath(PACKAGE_RUN_DIR "/autoroute/socket");
 		uid_t sockservuid(0);
 		gid_t sockservgid(0);
@@ -1163,6 +1164,7 @@ int main(int argc, char *argv[])
 				{ "routeractivelimit", required_argument, 0, 0x148 },
 				{ "routertimeout", required_argument, 0, 0x128 },
 				{ "routermaxruntime", required_argument, 0, 0x129 },
+				{ "encoderthreads", required_argument, 0, 0x16e },
 				{ "noterminate", no_argument, 0, 0x12a },
 				{ "uid", required_argument, 0, 0x12b },
 				{ "gid", required_argument, 0, 0x12c },
@@ -1616,6 +1618,11 @@ int main(int argc, char *argv[])
 						routermaxruntime = strtoul(optarg, 0, 0);
 					break;
 
+				case 0x16e:
+					if (optarg)
+						encoderthreads = strtoul(optarg, 0, 0);
+					break;
+
 				case 0x12a:
 					socketterminate = false;
 					break;
@@ -1983,7 +1990,7 @@ int main(int argc, char *argv[])
 				autoroute->set_wind_enabled(wind);
 			}
 			SocketServer sserv(autoroute, mainloop, routerlimit, routeractivelimit, routertimeout, routermaxruntime,
-					   xdisplay, logclient, logrouter, logsockcli, setproctitle);
+					   xdisplay, logclient, logrouter, logsockcli, setproctitle, encoderthreads);
 			sserv.listen(sockserverpath, socketuid, socketgid, socketmode, socketterminate);
 			if (sockservgid && setgid(sockservgid))
 				std::cerr << "Cannot set gid to " << sockservgid << ": "
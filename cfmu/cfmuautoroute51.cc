@@ -6,12 +6,91 @@
 #include <sstream>
 #include <iostream>
 #include <iomanip>
+#include <glib/gstdio.h>
 
 #include "cfmuautoroute51.hh"
 
+CFMUAutoroute51::RouteCache::RouteCache(void)
+	: m_ttl(30 * 60), m_maxentries(64), m_hits(0), m_misses(0), m_rejects(0), m_expired(0)
+{
+}
+
+void CFMUAutoroute51::RouteCache::clear(void)
+{
+	m_cache.clear();
+}
+
+unsigned int CFMUAutoroute51::RouteCache::expire(const Glib::TimeVal& tv)
+{
+	Glib::TimeVal tvx(tv);
+	tvx.subtract_seconds(m_ttl);
+	unsigned int cnt(0);
+	for (cache_t::iterator i(m_cache.begin()), e(m_cache.end()); i != e; ) {
+		cache_t::iterator i2(i);
+		++i;
+		if (!(i2->second.get_time() < tvx))
+			continue;
+		m_cache.erase(i2);
+		++cnt;
+	}
+	m_expired += cnt;
+	return cnt;
+}
+
+const ADR::FlightPlan *CFMUAutoroute51::RouteCache::find(const std::string& key, const std::string& revision, const Glib::TimeVal& tv)
+{
+	expire(tv);
+	cache_t::iterator i(m_cache.find(key));
+	if (i == m_cache.end()) {
+		++m_misses;
+		return 0;
+	}
+	if (i->second.get_revision() != revision) {
+		// database synced since the route was found
+		m_cache.erase(i);
+		++m_expired;
+		++m_misses;
+		return 0;
+	}
+	return &i->second.get_fplan();
+}
+
+void CFMUAutoroute51::RouteCache::add(const std::string& key, const std::string& revision, const ADR::FlightPlan& fpl, const Glib::TimeVal& tv)
+{
+	if (!m_maxentries)
+		return;
+	expire(tv);
+	m_cache.erase(key);
+	while (m_cache.size() >= m_maxentries) {
+		cache_t::iterator io(m_cache.begin());
+		for (cache_t::iterator i(m_cache.begin()), e(m_cache.end()); i != e; ++i)
+			if (i->second.get_time() < io->second.get_time())
+				io = i;
+		m_cache.erase(io);
+		++m_expired;
+	}
+	m_cache.insert(cache_t::value_type(key, Entry(revision, fpl, tv)));
+}
+
+void CFMUAutoroute51::RouteCache::reject(const std::string& key)
+{
+	m_cache.erase(key);
+	++m_rejects;
+}
+
+double CFMUAutoroute51::RouteCache::get_hitrate(void) const
+{
+	uint64_t n(m_hits + m_rejects + m_misses);
+	if (!n)
+		return 0;
+	return m_hits / (double)n;
+}
+
 CFMUAutoroute51::CFMUAutoroute51()
-	: CFMUAutoroute(), m_vertexdep(0), m_vertexdest(0)
+	: CFMUAutoroute(), m_vertexdep(0), m_vertexdest(0), m_routecachehit(false)
 {
+	// routers are long running; objects linked into the routing graph are pinned and not counted against this
+	m_db.set_cache_budget(256ULL << 20);
 	// test compile regexes
 	for (const char * const *ignrx(ignoreregex); *ignrx; ++ignrx) {
 		Glib::RefPtr<Glib::Regex> rx(Glib::Regex::create(*ignrx));
@@ -43,6 +122,7 @@ bool CFMUAutoroute51::check_fplan(std::vector<ADR::Message>& msgs, ADR::Restrict
 
 void CFMUAutoroute51::reload(void)
 {
+	m_routecache.clear();
 	m_eval = ADR::RestrictionEval();
 	m_db.close();
 	m_db.open();
@@ -79,6 +159,7 @@ void CFMUAutoroute51::clear(void)
 {
 	CFMUAutoroute::clear();
 	clearlgraph();
+	m_airspacecache.clear();
 }
 
 void CFMUAutoroute51::precompute_graph(const Rect& bbox, const std::string& fn)
@@ -124,12 +205,149 @@ void CFMUAutoroute51::debug_print_rules(const std::string& fname)
 	}
 }
 
+std::string CFMUAutoroute51::routecache_key(void) const
+{
+	std::ostringstream oss;
+	oss << std::setprecision(9)
+	    << get_departure().get_icao() << ' ' << get_departure_ifr() << ' ' << get_sidident() << ' '
+	    << get_sidlimit() << ' ' << get_sidpenalty() << ' ' << get_sidoffset() << ' ' << get_sidminimum() << ' '
+	    << get_siddb() << ' ' << get_sidonly();
+	{
+		const sidstarfilter_t filt(get_sidfilter());
+		for (sidstarfilter_t::const_iterator i(filt.begin()), e(filt.end()); i != e; ++i)
+			oss << ',' << *i;
+	}
+	oss << '\n' << get_destination().get_icao() << ' ' << get_destination_ifr() << ' ' << get_starident() << ' '
+	    << get_starlimit() << ' ' << get_starpenalty() << ' ' << get_staroffset() << ' ' << get_starminimum() << ' '
+	    << get_stardb() << ' ' << get_staronly();
+	{
+		const sidstarfilter_t filt(get_starfilter());
+		for (sidstarfilter_t::const_iterator i(filt.begin()), e(filt.end()); i != e; ++i)
+			oss << ',' << *i;
+	}
+	oss << '\n';
+	for (unsigned int i = 0, n = get_crossing_size(); i < n; ++i)
+		oss << get_crossing_ident(i) << ' ' << get_crossing(i).get_lat() << ' ' << get_crossing(i).get_lon() << ' '
+		    << get_crossing_radius(i) << ' ' << get_crossing_minlevel(i) << ' ' << get_crossing_maxlevel(i) << ';';
+	oss << '\n' << get_dctlimit() << ' ' << get_dctpenalty() << ' ' << get_dctoffset() << ' ' << get_vfraspclimit() << ' '
+	    << get_baselevel() << ' ' << get_toplevel() << ' ' << get_maxdescent() << ' '
+	    << get_honour_levelchangetrackmiles() << get_honour_opsperftrackmiles() << get_honour_awy_levels()
+	    << get_honour_profilerules() << get_force_enroute_ifr() << ' '
+	    << get_preferred_level() << ' ' << get_preferred_penalty() << ' ' << get_preferred_climb() << ' '
+	    << get_preferred_descent() << ' ' << (int)get_opttarget() << ' ' << (int)get_validator() << '\n';
+	for (excluderegions_t::const_iterator i(get_excluderegions().begin()), e(get_excluderegions().end()); i != e; ++i) {
+		if (i->is_airspace())
+			oss << i->get_airspace_id() << '/' << i->get_airspace_type();
+		else
+			oss << i->get_bbox();
+		oss << ' ' << i->get_minlevel() << ' ' << i->get_maxlevel() << ' ' << i->get_awylimit() << ' '
+		    << i->get_dctlimit() << ' ' << i->get_dctoffset() << ' ' << i->get_dctscale() << ';';
+	}
+	oss << '\n' << get_tfr_disable() << '\n'
+	    << get_wind_enabled() << ' ' << get_qnh() << ' ' << get_isaoffs() << ' '
+	    << get_engine_rpm() << ' ' << get_engine_mp() << ' ' << get_engine_bhp() << '\n'
+	    << get_aircraft().save_string() << '\n';
+	// AUP day (0600-0600 UTC); with winds, also the forecast interval
+	oss << (get_deptime() - 6 * 60 * 60) / (24 * 60 * 60);
+	if (get_wind_enabled())
+		oss << ' ' << get_deptime() / (3 * 60 * 60);
+	return oss.str();
+}
+
+std::string CFMUAutoroute51::routecache_revision(void)
+{
+	std::ostringstream oss;
+	static const char * const dbfiles[] = { "adr.db", "adr.bin", "aup.db", "aup.db-wal", 0 };
+	std::string dir(get_db_auxdir().empty() ? PACKAGE_DATA_DIR : get_db_auxdir());
+	for (const char * const *fn(dbfiles); *fn; ++fn) {
+		GStatBuf st;
+		if (g_stat(Glib::build_filename(dir, *fn).c_str(), &st))
+			oss << "- ";
+		else
+			oss << st.st_mtime << ',' << st.st_size << ' ';
+	}
+	if (get_wind_enabled()) {
+		GRIB2::layerlist_t ll(get_grib2().find_layers());
+		gint64 reftime(0);
+		for (GRIB2::layerlist_t::const_iterator li(ll.begin()), le(ll.end()); li != le; ++li)
+			if (*li)
+				reftime = std::max(reftime, (*li)->get_reftime());
+		oss << ll.size() << ',' << reftime;
+	}
+	return oss.str();
+}
+
+bool CFMUAutoroute51::routecache_replay(void)
+{
+	Glib::TimeVal tv;
+	tv.assign_current_time();
+	const ADR::FlightPlan *fplc(m_routecache.find(m_routecachekey, m_routecacherevision, tv));
+	if (!fplc)
+		return false;
+	ADR::FlightPlan fpl(*fplc);
+	fpl.set_aircraftid(m_callsign);
+	fpl.set_departuretime(get_deptime());
+	// check against a graph around the cached route only; the routing graph has not been built yet
+	m_eval.set_graph(0);
+	m_eval.set_fplan(fpl);
+	bool ok(m_eval.check_fplan(get_honour_profilerules()));
+	ok = ok && m_eval.get_results().is_ok();
+	m_eval.clear_messages();
+	m_eval.clear_results();
+	m_eval.set_graph(&m_graph);
+	{
+		Glib::TimeVal tv1;
+		tv1.assign_current_time();
+		tv = tv1 - tv;
+	}
+	if (!ok) {
+		m_routecache.reject(m_routecachekey);
+		std::ostringstream oss;
+		oss << "Cached route no longer valid, " << std::fixed << std::setprecision(3) << tv.as_double() << 's';
+		m_signal_log(log_normal, oss.str());
+		return false;
+	}
+	m_routecache.accept();
+	m_routecachehit = true;
+	m_eval.set_fplan(fpl);
+	while (m_route.get_nrwpt())
+		m_route.delete_wpt(0);
+	for (ADR::FlightPlan::const_iterator fi(fpl.begin()), fe(fpl.end()); fi != fe; ++fi)
+		m_route.insert_wpt(~0, *fi);
+	updatefpl();
+	if (true) {
+		std::ostringstream oss;
+		oss << "Reusing cached route, " << std::fixed << std::setprecision(3) << tv.as_double() << "s; route cache: "
+		    << m_routecache.size() << " entries, " << m_routecache.get_hits() << " hits, "
+		    << m_routecache.get_misses() << " misses, " << m_routecache.get_rejects() << " rejected, "
+		    << std::setprecision(1) << (m_routecache.get_hitrate() * 100) << "% hit rate";
+		m_signal_log(log_normal, oss.str());
+	}
+	m_done = true;
+	m_iterationcount[0] = 1;
+	m_signal_log(log_fplproposal, get_simplefpl());
+	stop(statusmask_none);
+	return true;
+}
+
+void CFMUAutoroute51::routecache_store(void)
+{
+	if (m_routecachekey.empty() || m_routecachehit)
+		return;
+	Glib::TimeVal tv;
+	tv.assign_current_time();
+	m_routecache.add(m_routecachekey, m_routecacherevision, m_eval.get_fplan(), tv);
+}
+
 bool CFMUAutoroute51::start_ifr(bool cont, bool optfuel)
 {
 	m_db.set_path(get_db_auxdir().empty() ? PACKAGE_DATA_DIR : get_db_auxdir());
 	m_aupdb.set_path(get_db_auxdir().empty() ? PACKAGE_DATA_DIR : get_db_auxdir());
 	m_eval.set_graph(&m_graph);
 	m_eval.set_db(&m_db);
+	// a replayed cached route has no routing graph to continue from
+	bool nocache(cont && m_routecachehit);
+	m_routecachehit = false;
 	// set departure time
 	{
 		ADR::FlightPlan fpl;
@@ -158,6 +376,8 @@ bool CFMUAutoroute51::start_ifr(bool cont, bool optfuel)
 	ADR::timetype_t tmroute(3600);
 	if (!cont) {
 		clear();
+		m_routecachekey.clear();
+		m_routecacherevision.clear();
 		m_callsign.clear();
 		for (unsigned int i = 0; i < 5; ++i) {
 			char ch('A' + (rand() % ('Z' - 'A' + 1)));
@@ -363,6 +583,15 @@ bool CFMUAutoroute51::start_ifr(bool cont, bool optfuel)
 			m_signal_log(log_normal, "Traffic flow restrictions disabled");
 		}
 	}
+	// without restriction checking, a cached route cannot be revalidated locally
+	if (!cont && get_tfr_enabled()) {
+		m_routecachekey = routecache_key();
+		m_routecacherevision = routecache_revision();
+		if (nocache)
+			m_signal_log(log_normal, "Continuing from a cached route, building routing graph");
+		else if (routecache_replay())
+			return true;
+	}
 	m_signal_log(log_normal, cont ? "Restarting IFR router" : "Starting IFR router");
 	if (!cont) {
 		m_iterationcount[0] = m_iterationcount[1] = 0;
@@ -17,9 +17,62 @@ public:
 	CFMUAutoroute51();
 
 	const std::vector<Glib::RefPtr<ADR::FlightRestriction> >& get_tfr(void) const { return m_eval.get_rules(); }
+	const ADR::Database& get_db(void) const { return m_db; }
 
 	bool check_fplan(std::vector<ADR::Message>& msgs, ADR::RestrictionResults& res, ADR::FlightPlan& route);
 
+	// solutions of previous requests, keyed by a request fingerprint and the database revisions;
+	// a cached solution is only reused after it passes the local restriction check again
+	class RouteCache {
+	public:
+		RouteCache(void);
+		void clear(void);
+		unsigned int expire(const Glib::TimeVal& tv);
+		const ADR::FlightPlan *find(const std::string& key, const std::string& revision, const Glib::TimeVal& tv);
+		void add(const std::string& key, const std::string& revision, const ADR::FlightPlan& fpl, const Glib::TimeVal& tv);
+		void accept(void) { ++m_hits; }
+		void reject(const std::string& key);
+		unsigned int size(void) const { return m_cache.size(); }
+		unsigned int get_ttl(void) const { return m_ttl; }
+		void set_ttl(unsigned int ttl) { m_ttl = ttl; }
+		unsigned int get_maxentries(void) const { return m_maxentries; }
+		void set_maxentries(unsigned int n) { m_maxentries = n; }
+		uint64_t get_hits(void) const { return m_hits; }
+		uint64_t get_misses(void) const { return m_misses; }
+		uint64_t get_rejects(void) const { return m_rejects; }
+		uint64_t get_expired(void) const { return m_expired; }
+		double get_hitrate(void) const;
+
+	protected:
+		class Entry {
+		public:
+			Entry(const std::string& revision = "", const ADR::FlightPlan& fpl = ADR::FlightPlan(),
+			      const Glib::TimeVal& tv = Glib::TimeVal(0, 0))
+				: m_revision(revision), m_fplan(fpl), m_time(tv) {}
+			const std::string& get_revision(void) const { return m_revision; }
+			const ADR::FlightPlan& get_fplan(void) const { return m_fplan; }
+			const Glib::TimeVal& get_time(void) const { return m_time; }
+
+		protected:
+			std::string m_revision;
+			ADR::FlightPlan m_fplan;
+			Glib::TimeVal m_time;
+		};
+
+		typedef std::map<std::string,Entry> cache_t;
+		cache_t m_cache;
+		unsigned int m_ttl;
+		unsigned int m_maxentries;
+		uint64_t m_hits;
+		uint64_t m_misses;
+		uint64_t m_rejects;
+		uint64_t m_expired;
+	};
+
+	const RouteCache& get_routecache(void) const { return m_routecache; }
+	RouteCache& get_routecache(void) { return m_routecache; }
+	bool is_routecache_hit(void) const { return m_routecachehit; }
+
 	virtual void preload(bool validator = true);
 	virtual void reload(void);
 	virtual void stop(statusmask_t sm);
@@ -37,6 +90,10 @@ protected:
 
 	void debug_print_rules(const std::string& fname);
 	virtual bool start_ifr(bool cont = false, bool optfuel = false);
+	std::string routecache_key(void) const;
+	std::string routecache_revision(void);
+	bool routecache_replay(void);
+	void routecache_store(void);
 
 	void parse_response(void);
 	bool parse_response_route42(Glib::MatchInfo& minfo);
@@ -83,7 +140,48 @@ protected:
 	bool parse_response_efpm228(Glib::MatchInfo& minfo);
 	bool parse_response_fail(Glib::MatchInfo& minfo);
 
-	class AirspaceCache;
+	// memoizes airspace / graph segment crossing results across TFR iterations
+	class AirspaceCache {
+	public:
+		AirspaceCache(void);
+		void clear(void);
+		// altitudes at which the point wpt0 (wpt1 null) or the segment wpt0-wpt1 lies inside the airspace
+		IntervalSet<int32_t> get_altitudes(const ADR::AirspaceTimeSlice& ts, const ADR::UUID& aspc,
+						   const ADR::Object::const_ptr_t& wpt0, const ADR::Object::const_ptr_t& wpt1,
+						   const ADR::AltRange& altrange, ADR::timetype_t tm,
+						   const ADR::TimeTableSpecialDateEval& ttsde);
+		// whether the segment pt0-pt1 crosses the airspace at any altitude
+		bool is_intersect(const ADR::AirspaceTimeSlice& ts, const ADR::UUID& aspc, const ADR::UUID& uuid0, const Point& pt0,
+				  const ADR::UUID& uuid1, const Point& pt1, ADR::timetype_t tm,
+				  const ADR::TimeTableSpecialDateEval& ttsde);
+		unsigned int size(void) const { return m_altcache.size() + m_isectcache.size(); }
+		uint64_t get_hits(void) const { return m_hits; }
+		uint64_t get_misses(void) const { return m_misses; }
+		double get_hitrate(void) const;
+
+	protected:
+		class Key {
+		public:
+			Key(const ADR::UUID& aspc, const ADR::UUID& uuid0, const ADR::UUID& uuid1,
+			    const ADR::AltRange& altrange, ADR::timetype_t tm);
+			int compare(const Key& x) const;
+			bool operator<(const Key& x) const { return compare(x) < 0; }
+
+		protected:
+			ADR::UUID m_aspc;
+			ADR::UUID m_uuid0;
+			ADR::UUID m_uuid1;
+			ADR::AltRange m_altrange;
+			ADR::timetype_t m_time;
+		};
+
+		typedef std::map<Key,IntervalSet<int32_t> > altcache_t;
+		altcache_t m_altcache;
+		typedef std::map<Key,bool> isectcache_t;
+		isectcache_t m_isectcache;
+		uint64_t m_hits;
+		uint64_t m_misses;
+	};
 
 	class LVertexLevel {
 	public:
@@ -229,6 +327,11 @@ protected:
 	ADR::Graph::vertex_descriptor m_vertexdep;
 	ADR::Graph::vertex_descriptor m_vertexdest;
 	LGMandatory m_crossingmandatory;
+	AirspaceCache m_airspacecache;
+	RouteCache m_routecache;
+	std::string m_routecachekey;
+	std::string m_routecacherevision;
+	bool m_routecachehit;
 	static const bool lgraphawyvertdct = false;
 	static constexpr double localforbiddenpenalty = 1.1;
 
@@ -207,6 +207,116 @@ void CFMUAutoroute51::logmessage(const ADR::Message& msg)
 	m_signal_log(lt, oss.str());
 }
 
+CFMUAutoroute51::AirspaceCache::Key::Key(const ADR::UUID& aspc, const ADR::UUID& uuid0, const ADR::UUID& uuid1,
+					 const ADR::AltRange& altrange, ADR::timetype_t tm)
+	: m_aspc(aspc), m_uuid0(uuid0), m_uuid1(uuid1), m_altrange(altrange), m_time(tm)
+{
+}
+
+int CFMUAutoroute51::AirspaceCache::Key::compare(const Key& x) const
+{
+	int c(m_aspc.compare(x.m_aspc));
+	if (c)
+		return c;
+	c = m_uuid0.compare(x.m_uuid0);
+	if (c)
+		return c;
+	c = m_uuid1.compare(x.m_uuid1);
+	if (c)
+		return c;
+	if (m_time < x.m_time)
+		return -1;
+	if (x.m_time < m_time)
+		return 1;
+	if (m_altrange.get_lower_alt() < x.m_altrange.get_lower_alt())
+		return -1;
+	if (x.m_altrange.get_lower_alt() < m_altrange.get_lower_alt())
+		return 1;
+	if (m_altrange.get_upper_alt() < x.m_altrange.get_upper_alt())
+		return -1;
+	if (x.m_altrange.get_upper_alt() < m_altrange.get_upper_alt())
+		return 1;
+	if (m_altrange.get_lower_mode() < x.m_altrange.get_lower_mode())
+		return -1;
+	if (x.m_altrange.get_lower_mode() < m_altrange.get_lower_mode())
+		return 1;
+	if (m_altrange.get_upper_mode() < x.m_altrange.get_upper_mode())
+		return -1;
+	if (x.m_altrange.get_upper_mode() < m_altrange.get_upper_mode())
+		return 1;
+	return 0;
+}
+
+CFMUAutoroute51::AirspaceCache::AirspaceCache(void)
+	: m_hits(0), m_misses(0)
+{
+}
+
+void CFMUAutoroute51::AirspaceCache::clear(void)
+{
+	m_altcache.clear();
+	m_isectcache.clear();
+	m_hits = m_misses = 0;
+}
+
+double CFMUAutoroute51::AirspaceCache::get_hitrate(void) const
+{
+	uint64_t n(m_hits + m_misses);
+	if (!n)
+		return 0;
+	return m_hits / (double)n;
+}
+
+IntervalSet<int32_t> CFMUAutoroute51::AirspaceCache::get_altitudes(const ADR::AirspaceTimeSlice& ts, const ADR::UUID& aspc,
+								   const ADR::Object::const_ptr_t& wpt0, const ADR::Object::const_ptr_t& wpt1,
+								   const ADR::AltRange& altrange, ADR::timetype_t tm,
+								   const ADR::TimeTableSpecialDateEval& ttsde)
+{
+	if (!wpt0)
+		return IntervalSet<int32_t>();
+	Key key(aspc, wpt0->get_uuid(), wpt1 ? wpt1->get_uuid() : ADR::UUID::niluuid, altrange, tm);
+	{
+		altcache_t::const_iterator i(m_altcache.find(key));
+		if (i != m_altcache.end()) {
+			++m_hits;
+			return i->second;
+		}
+	}
+	++m_misses;
+	IntervalSet<int32_t> r;
+	const ADR::PointIdentTimeSlice& ts0(wpt0->operator()(tm).as_point());
+	if (ts0.is_valid()) {
+		if (!wpt1) {
+			r = ts.get_point_altitudes(ADR::TimeTableEval(tm, ts0.get_coord(), ttsde), altrange, wpt0->get_uuid());
+		} else {
+			const ADR::PointIdentTimeSlice& ts1(wpt1->operator()(tm).as_point());
+			if (ts1.is_valid())
+				r = ts.get_point_intersect_altitudes(ADR::TimeTableEval(tm, ts0.get_coord(), ttsde),
+								     ts1.get_coord(), altrange, wpt0->get_uuid(), wpt1->get_uuid());
+		}
+	}
+	m_altcache.insert(altcache_t::value_type(key, r));
+	return r;
+}
+
+bool CFMUAutoroute51::AirspaceCache::is_intersect(const ADR::AirspaceTimeSlice& ts, const ADR::UUID& aspc, const ADR::UUID& uuid0, const Point& pt0,
+						  const ADR::UUID& uuid1, const Point& pt1, ADR::timetype_t tm,
+						  const ADR::TimeTableSpecialDateEval& ttsde)
+{
+	Key key(aspc, uuid0, uuid1, ADR::AltRange(), tm);
+	{
+		isectcache_t::const_iterator i(m_isectcache.find(key));
+		if (i != m_isectcache.end()) {
+			++m_hits;
+			return i->second;
+		}
+	}
+	++m_misses;
+	bool r(ts.is_intersect(ADR::TimeTableEval(tm, pt0, ttsde), pt1, ADR::AltRange::altignore));
+	m_isectcache.insert(isectcache_t::value_type(key, r));
+	return r;
+}
+
 void CFMUAutoroute51::clearlgraph(void)
 {
 	m_graph.clear();
@@ -526,6 +636,11 @@ bool CFMUAutoroute51::lgraphload(const Rect& bbox)
 			oss << ", descriptor sizes: vertex " << sizeof(ADR::Graph::vertex_descriptor) << " edge " << sizeof(ADR::Graph::edge_descriptor);
 		m_signal_log(log_debug0, oss.str());
 	}
+	if (true) {
+		std::ostringstream oss;
+		oss << "ADR database: " << m_db.get_cache_stats();
+		m_signal_log(log_debug0, oss.str());
+	}
 	return true;
 }
 
@@ -620,8 +735,9 @@ bool CFMUAutoroute51::lgraphexcluderegions(void)
 							continue;
 						if (inters == -1) {
 							if (aspc)
-								inters = aspcts->is_intersect(ADR::TimeTableEval(get_deptime(), vv0.get_coord(), m_eval.get_specialdateeval()),
-											      vv1.get_coord(), ADR::AltRange::altignore);
+								inters = m_airspacecache.is_intersect(*aspcts, aspc->get_uuid(), vv0.get_uuid(), vv0.get_coord(),
+												      vv1.get_uuid(), vv1.get_coord(), get_deptime(),
+												      m_eval.get_specialdateeval());
 							else
 								inters = lgraphcheckintersect(vv0.get_coord(), vv1.get_coord(), bbox);
 							if (!inters)
@@ -671,8 +787,9 @@ bool CFMUAutoroute51::lgraphexcluderegions(void)
 							continue;
 						if (inters == -1) {
 							if (aspc)
-								inters = aspcts->is_intersect(ADR::TimeTableEval(get_deptime(), vv1.get_coord(), m_eval.get_specialdateeval()),
-											      vv0.get_coord(), ADR::AltRange::altignore);
+								inters = m_airspacecache.is_intersect(*aspcts, aspc->get_uuid(), vv1.get_uuid(), vv1.get_coord(),
+												      vv0.get_uuid(), vv0.get_coord(), get_deptime(),
+												      m_eval.get_specialdateeval());
 							else
 								inters = lgraphcheckintersect(vv0.get_coord(), vv1.get_coord(), bbox);
 							if (!inters)
@@ -4197,7 +4314,9 @@ void CFMUAutoroute51::lgraphroute(void)
 			if (true) {
 				std::ostringstream oss;
 				oss << "Next route computation: " << std::fixed << std::setprecision(3) << tv.as_double()
-				    << "s, solution pool size " << m_solutionpool.size();
+				    << "s, solution pool size " << m_solutionpool.size()
+				    << ", airspace cache " << m_airspacecache.size() << " entries, hit rate "
+				    << std::setprecision(1) << (100.0 * m_airspacecache.get_hitrate()) << '%';
 				m_signal_log(log_debug0, oss.str());
 			}
 		}
@@ -5249,20 +5368,10 @@ IntervalSet<int32_t> CFMUAutoroute51::lgraphcrossinggate(const ADR::RuleSegment&
 				m_signal_log(log_debug0, oss.str());
 				return IntervalSet<int32_t>();
 			}
-			const ADR::PointIdentTimeSlice& ts0(seq.get_wpt0()->operator()(get_deptime()).as_point());
-			if (!ts0.is_valid())
-				return IntervalSet<int32_t>();
-			IntervalSet<int32_t> altrange;
-			if (seq.get_type() == ADR::RuleSegment::type_point) {
-				altrange = ts.get_point_altitudes(ADR::TimeTableEval(get_deptime(), ts0.get_coord(), m_eval.get_specialdateeval()),
-								  cc.get_alt(), seq.get_uuid0());
-			} else {
-				const ADR::PointIdentTimeSlice& ts1(seq.get_wpt1()->operator()(get_deptime()).as_point());
-				if (!ts1.is_valid())
-					return IntervalSet<int32_t>();
-				altrange = ts.get_point_intersect_altitudes(ADR::TimeTableEval(get_deptime(), ts0.get_coord(), m_eval.get_specialdateeval()),
-									    ts1.get_coord(), cc.get_alt(), seq.get_uuid0(), seq.get_uuid1());
-			}
+			IntervalSet<int32_t> altrange(m_airspacecache.get_altitudes(ts, cc.get_uuid0(), seq.get_wpt0(),
+										       (seq.get_type() == ADR::RuleSegment::type_point) ?
+										       ADR::Object::const_ptr_t() : seq.get_wpt1(),
+										       cc.get_alt(), get_deptime(), m_eval.get_specialdateeval()));
 			altrange &= seq.get_alt().get_interval();
 			return altrange;
 		}
@@ -6978,6 +7087,7 @@ void CFMUAutoroute51::parse_response(void)
 				return;
 			}
 			m_done = true;
+			routecache_store();
 			m_signal_log(log_fplproposal, get_simplefpl());
 			stop(statusmask_none);
 			return;
@@ -653,6 +653,7 @@ void TrafficFlowRestrictions::start_add_rules(void)
 	m_loadedtfr.clear();
 	m_tfr.clear();
 	m_dcttfr.clear();
+	m_resolvedairspaces.clear();
 }
 
 void TrafficFlowRestrictions::end_add_rules(void)
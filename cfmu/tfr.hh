@@ -753,6 +753,9 @@ protected:
 		int32_t get_lower_alt(void) const { return m_lwralt; }
 		int32_t get_upper_alt(void) const { return m_upralt; }
 		void add_component(const_ptr_t aspc, AirspacesDb::Airspace::Component::operator_t oper);
+		unsigned int get_nrcomponents(void) const { return m_comps.size(); }
+		const_ptr_t get_component(unsigned int i) const { return m_comps[i].first; }
+		AirspacesDb::Airspace::Component::operator_t get_component_operator(unsigned int i) const { return m_comps[i].second; }
 		bool is_inside(const Point& coord) const { return is_inside(coord, 0, 0, std::numeric_limits<int32_t>::max()); }
 		bool is_inside(const Point& coord, int32_t alt) const { return is_inside(coord, alt, std::numeric_limits<int32_t>::min(),
 											 std::numeric_limits<int32_t>::min()); }
@@ -842,6 +845,29 @@ protected:
 		TFRAirspace::const_ptr_t find_airspace(const std::string& id, char bdryclass, uint8_t typecode = AirspacesDb::Airspace::typecode_ead);
 		const AirportsDb::Airport& find_airport(const std::string& icao);
 		void fill_airport_cache(void);
+		// preload an airspace lookup result, e.g. from a binary rule pack
+		void add_airspace_cache(const std::string& id, char bc, uint8_t tc, TFRAirspace::const_ptr_t aspc);
+
+		class AirspaceCache {
+		public:
+			AirspaceCache(const std::string& id, char bc, uint8_t tc, TFRAirspace::const_ptr_t aspc = TFRAirspace::const_ptr_t());
+			AirspaceCache(TFRAirspace::const_ptr_t aspc = TFRAirspace::const_ptr_t());
+
+			const std::string& get_id(void) const { return m_id; }
+			char get_bdryclass(void) const { return m_bdryclass; }
+			uint8_t get_typecode(void) const { return m_typecode; }
+			TFRAirspace::const_ptr_t get_airspace(void) const { return m_airspace; }
+			const Glib::ustring& get_type(void) const;
+
+			bool operator<(const AirspaceCache& x) const;
+
+		protected:
+			std::string m_id;
+			TFRAirspace::const_ptr_t m_airspace;
+			char m_bdryclass;
+			uint8_t m_typecode;
+		};
+		typedef std::set<AirspaceCache> airspacecache_t;
 
 	protected:
 		TrafficFlowRestrictions& m_tfrs;
@@ -870,27 +896,6 @@ protected:
 		static const AirspaceMapping *find_airspace_mapping(const std::string& name, char bc);
 		static void check_airspace_mapping(void);
 	
-
-		class AirspaceCache {
-		public:
-			AirspaceCache(const std::string& id, char bc, uint8_t tc);
-			AirspaceCache(TFRAirspace::const_ptr_t aspc = TFRAirspace::const_ptr_t());
-
-			const std::string& get_id(void) const { return m_id; }
-			char get_bdryclass(void) const { return m_bdryclass; }
-			uint8_t get_typecode(void) const { return m_typecode; }
-			TFRAirspace::const_ptr_t get_airspace(void) const { return m_airspace; }
-			const Glib::ustring& get_type(void) const;
-
-			bool operator<(const AirspaceCache& x) const;
-
-		protected:
-			std::string m_id;
-			TFRAirspace::const_ptr_t m_airspace;
-			char m_bdryclass;
-			uint8_t m_typecode;
-		};
-		typedef std::set<AirspaceCache> airspacecache_t;
 		airspacecache_t m_airspacecache;
 
 		class AirportCache : public AirportsDb::Airport {
@@ -1757,6 +1762,8 @@ protected:
 	TrafficFlowRules m_dcttfr;
 	typedef std::set<AirspacesDb::Airspace, CompareAirspaces> airspacecache_t;
 	airspacecache_t m_airspacecache;
+	// airspace lookups resolved while loading the rules; embedded into V3 binary rule files
+	DbLoader::airspacecache_t m_resolvedairspaces;
 	tracerules_t m_tracerules;
 	disabledrules_t m_disabledrules;
 	typedef std::vector<RuleResult> rules_t;
@@ -1783,6 +1790,7 @@ protected:
 
 	static const char binfile_signature_v1[];
 	static const char binfile_signature_v2[];
+	static const char binfile_signature_v3[];
 
 	static uint8_t loadbinu8(std::istream& is);
 	static uint16_t loadbinu16(std::istream& is);
@@ -1791,6 +1799,7 @@ protected:
 	static double loadbindbl(std::istream& is);
 	static std::string loadbinstring(std::istream& is);
 	static Point loadbinpt(std::istream& is);
+	static MultiPolygonHole loadbinpoly(std::istream& is);
 	static void savebinu8(std::ostream& os, uint8_t v);
 	static void savebinu16(std::ostream& os, uint16_t v);
 	static void savebinu32(std::ostream& os, uint32_t v);
@@ -1798,6 +1807,8 @@ protected:
 	static void savebindbl(std::ostream& os, double v);
 	static void savebinstring(std::ostream& os, const std::string& v);
 	static void savebinpt(std::ostream& os, const Point& v);
+	static void savebinpoly(std::ostream& os, const MultiPolygonHole& v);
+	void save_airspace_pack(std::ostream& os) const;
 };
 
 #endif /* TFR_H */
@@ -4,6 +4,7 @@
 
 #include <iomanip>
 #include <fstream>
+#include <map>
 
 #include "tfr.hh"
 
@@ -28,6 +29,7 @@ public:
 	double loadbindbl(void) { return TrafficFlowRestrictions::loadbindbl(get_is()); }
 	std::string loadbinstring(void) { return TrafficFlowRestrictions::loadbinstring(get_is()); }
 	Point loadbinpt(void) { return TrafficFlowRestrictions::loadbinpt(get_is()); }
+	MultiPolygonHole loadbinpoly(void) { return TrafficFlowRestrictions::loadbinpoly(get_is()); }
 
 	std::istream& get_is(void) { return m_is; }
 	TrafficFlowRestrictions& get_tfrs(void) const { return m_dbldr.get_tfrs(); }
@@ -41,6 +43,7 @@ public:
 	TFRAirspace::const_ptr_t find_airspace(const std::string& id, char bdryclass, uint8_t typecode = AirspacesDb::Airspace::typecode_ead) { return m_dbldr.find_airspace(id, bdryclass, typecode); }
 	const AirportsDb::Airport& find_airport(const std::string& icao) { return m_dbldr.find_airport(icao); }
 	void fill_airport_cache(void) { m_dbldr.fill_airport_cache(); }
+	void load_airspace_pack(void);
 
 	bool is_v2(void) const { return m_v2; }
 
@@ -78,6 +81,54 @@ void TrafficFlowRestrictions::BinLoader::message(Message::type_t mt, const std::
 		throw std::runtime_error(str);	
 }
 
+void TrafficFlowRestrictions::BinLoader::load_airspace_pack(void)
+{
+	std::vector<TFRAirspace::ptr_t> aspcs;
+	{
+		uint32_t n(loadbinu32());
+		aspcs.reserve(n);
+		for (; n; --n) {
+			std::string id(loadbinstring());
+			std::string type(loadbinstring());
+			char bc(loadbinu8());
+			uint8_t tc(loadbinu8());
+			int32_t altlwr(loadbinu32());
+			int32_t altupr(loadbinu32());
+			Point sw(loadbinpt());
+			Point ne(loadbinpt());
+			MultiPolygonHole poly(loadbinpoly());
+			TFRAirspace::ptr_t aspc(new TFRAirspace(id, type, poly, Rect(sw, ne), bc, tc, altlwr, altupr));
+			for (uint32_t nc(loadbinu32()); nc; --nc) {
+				uint32_t idx(loadbinu32());
+				AirspacesDb::Airspace::Component::operator_t oper((AirspacesDb::Airspace::Component::operator_t)loadbinu8());
+				// components are stored before the airspaces referring to them
+				if (idx >= aspcs.size())
+					throw std::runtime_error("airspace pack: invalid component index");
+				aspc->add_component(aspcs[idx], oper);
+			}
+			aspcs.push_back(aspc);
+		}
+	}
+	for (uint32_t n(loadbinu32()); n; --n) {
+		std::string id(loadbinstring());
+		char bc(loadbinu8());
+		uint8_t tc(loadbinu8());
+		uint32_t idx(loadbinu32());
+		if (idx == ~0U) {
+			m_dbldr.add_airspace_cache(id, bc, tc, TFRAirspace::const_ptr_t());
+			continue;
+		}
+		if (idx >= aspcs.size())
+			throw std::runtime_error("airspace pack: invalid airspace index");
+		m_dbldr.add_airspace_cache(id, bc, tc, aspcs[idx]);
+	}
+	if (true) {
+		std::ostringstream oss;
+		oss << aspcs.size() << " airspaces loaded from rule file";
+		info(oss.str());
+	}
+}
+
 void TrafficFlowRestrictions::BinLoader::error(const std::string& text) const
 {
 	error("", text);
@@ -179,6 +230,42 @@ Point TrafficFlowRestrictions::loadbinpt(std::istream& is)
 	return pt;
 }
 
+MultiPolygonHole TrafficFlowRestrictions::loadbinpoly(std::istream& is)
+{
+	MultiPolygonHole mp;
+	std::vector<uint8_t> buf;
+	for (uint32_t np(loadbinu32(is)); np; --np) {
+		mp.push_back(PolygonHole());
+		PolygonHole& ph(mp.back());
+		for (uint32_t nr(loadbinu32(is)), r(0); r < nr; ++r) {
+			uint32_t n(loadbinu32(is));
+			if (n > (1U << 24))
+				throw std::runtime_error("loadbinpoly: invalid ring size");
+			// read the whole ring at once, points are 8 byte lat/lon pairs as in loadbinpt
+			buf.resize(8 * n);
+			if (n) {
+				is.read(reinterpret_cast<char *>(&buf[0]), buf.size());
+				if (!is)
+					throw std::runtime_error("loadbinpoly: short read");
+			}
+			PolygonSimple ps;
+			ps.reserve(n);
+			for (uint32_t i(0); i < n; ++i) {
+				const uint8_t *b(&buf[8 * i]);
+				Point pt;
+				pt.set_lat(b[0] | (b[1] << 8) | (b[2] << 16) | (b[3] << 24));
+				pt.set_lon(b[4] | (b[5] << 8) | (b[6] << 16) | (b[7] << 24));
+				ps.push_back(pt);
+			}
+			if (!r)
+				ph.set_exterior(ps);
+			else
+				ph.add_interior(ps);
+		}
+	}
+	return mp;
+}
+
 void TrafficFlowRestrictions::savebinu8(std::ostream& os, uint8_t v)
 {
 	uint8_t buf[1];
@@ -250,8 +337,90 @@ void TrafficFlowRestrictions::savebinpt(std::ostream& os, const Point& v)
 	savebinu32(os, v.get_lon());
 }
 
+void TrafficFlowRestrictions::savebinpoly(std::ostream& os, const MultiPolygonHole& v)
+{
+	savebinu32(os, v.size());
+	for (MultiPolygonHole::const_iterator pi(v.begin()), pe(v.end()); pi != pe; ++pi) {
+		const PolygonHole& ph(*pi);
+		savebinu32(os, ph.get_nrinterior() + 1);
+		for (unsigned int r = 0; r <= ph.get_nrinterior(); ++r) {
+			const PolygonSimple& ps(r ? ph[r - 1] : ph.get_exterior());
+			savebinu32(os, ps.size());
+			for (PolygonSimple::const_iterator i(ps.begin()), e(ps.end()); i != e; ++i)
+				savebinpt(os, *i);
+		}
+	}
+}
+
+void TrafficFlowRestrictions::save_airspace_pack(std::ostream& os) const
+{
+	// number the airspaces so that components precede the airspaces using them
+	typedef std::map<const TFRAirspace *,uint32_t> aspcindex_t;
+	aspcindex_t aspcindex;
+	std::vector<TFRAirspace::const_ptr_t> aspcs;
+	for (DbLoader::airspacecache_t::const_iterator i(m_resolvedairspaces.begin()), e(m_resolvedairspaces.end()); i != e; ++i) {
+		if (!i->get_airspace())
+			continue;
+		std::vector<std::pair<TFRAirspace::const_ptr_t,unsigned int> > stk;
+		stk.push_back(std::make_pair(i->get_airspace(), 0U));
+		while (!stk.empty()) {
+			TFRAirspace::const_ptr_t aspc(stk.back().first);
+			if (aspcindex.find(aspc.operator->()) != aspcindex.end()) {
+				stk.pop_back();
+				continue;
+			}
+			unsigned int c(stk.back().second);
+			if (c < aspc->get_nrcomponents()) {
+				++stk.back().second;
+				if (aspc->get_component(c))
+					stk.push_back(std::make_pair(aspc->get_component(c), 0U));
+				continue;
+			}
+			aspcindex.insert(aspcindex_t::value_type(aspc.operator->(), aspcs.size()));
+			aspcs.push_back(aspc);
+			stk.pop_back();
+		}
+	}
+	savebinu32(os, aspcs.size());
+	for (std::vector<TFRAirspace::const_ptr_t>::const_iterator ai(aspcs.begin()), ae(aspcs.end()); ai != ae; ++ai) {
+		const TFRAirspace& aspc(**ai);
+		savebinstring(os, aspc.get_ident());
+		savebinstring(os, aspc.get_type());
+		savebinu8(os, aspc.get_bdryclass());
+		savebinu8(os, aspc.get_typecode());
+		savebinu32(os, aspc.get_lower_alt());
+		savebinu32(os, aspc.get_upper_alt());
+		savebinpt(os, aspc.get_bbox().get_southwest());
+		savebinpt(os, aspc.get_bbox().get_northeast());
+		savebinpoly(os, aspc.get_poly());
+		uint32_t nc(0);
+		for (unsigned int c = 0; c < aspc.get_nrcomponents(); ++c)
+			if (aspc.get_component(c))
+				++nc;
+		savebinu32(os, nc);
+		for (unsigned int c = 0; c < aspc.get_nrcomponents(); ++c) {
+			if (!aspc.get_component(c))
+				continue;
+			savebinu32(os, aspcindex.find(aspc.get_component(c).operator->())->second);
+			savebinu8(os, aspc.get_component_operator(c));
+		}
+	}
+	savebinu32(os, m_resolvedairspaces.size());
+	for (DbLoader::airspacecache_t::const_iterator i(m_resolvedairspaces.begin()), e(m_resolvedairspaces.end()); i != e; ++i) {
+		savebinstring(os, i->get_id());
+		savebinu8(os, i->get_bdryclass());
+		savebinu8(os, i->get_typecode());
+		if (!i->get_airspace()) {
+			savebinu32(os, ~0U);
+			continue;
+		}
+		savebinu32(os, aspcindex.find(i->get_airspace().operator->())->second);
+	}
+}
+
 const char TrafficFlowRestrictions::binfile_signature_v1[] = "vfrnav Traffic Flow Restrictions V1\n";
 const char TrafficFlowRestrictions::binfile_signature_v2[] = "vfrnav Traffic Flow Restrictions V2\n";
+const char TrafficFlowRestrictions::binfile_signature_v3[] = "vfrnav Traffic Flow Restrictions V3\n";
 
 bool TrafficFlowRestrictions::add_binary_rules(std::vector<Message>& msg, const std::string& fname, AirportsDb& airportdb,
 					       NavaidsDb& navaiddb, WaypointsDb& waypointdb, AirwaysDb& airwaydb, AirspacesDb& airspacedb)
@@ -270,13 +439,15 @@ bool TrafficFlowRestrictions::add_binary_rules(std::vector<Message>& msg, std::i
 	if (!is)
 		return false;
 	try {
-		bool v2(false);
+		bool v2(false), v3(false);
 		{
 			char buf[sizeof(binfile_signature_v2)];
 			is.read(buf, sizeof(binfile_signature_v2));
 			if (!is)
 				throw std::runtime_error("cannot read signature");
-			if (!memcmp(buf, binfile_signature_v2, sizeof(binfile_signature_v2)))
+			if (!memcmp(buf, binfile_signature_v3, sizeof(binfile_signature_v3)))
+				v2 = v3 = true;
+			else if (!memcmp(buf, binfile_signature_v2, sizeof(binfile_signature_v2)))
 				v2 = true;
 			else if (memcmp(buf, binfile_signature_v1, sizeof(binfile_signature_v1)))
 				throw std::runtime_error("invalid signature");
@@ -297,6 +468,9 @@ bool TrafficFlowRestrictions::add_binary_rules(std::vector<Message>& msg, std::i
 			if (!s.empty())
 				set_effective(s);
 		}
+		// V3 files carry the resolved airspaces, so rule loading needs no airspace database queries
+		if (v3)
+			ldr.load_airspace_pack();
 		m_loadedtfr.load_binary(ldr);
 		uint8_t buf[64];
 		is.read(reinterpret_cast<char *>(buf), sizeof(buf));
@@ -336,12 +510,13 @@ bool TrafficFlowRestrictions::save_binary_rules(std::ostream& os) const
 	if (!os)
 		return false;
 	try {
-		os.write(binfile_signature_v2, sizeof(binfile_signature_v2));
+		os.write(binfile_signature_v3, sizeof(binfile_signature_v3));
 		if (!os)
 			throw std::runtime_error("cannot write signature");
 		savebinstring(os, get_origin());
 		savebinstring(os, get_created());
 		savebinstring(os, get_effective());
+		save_airspace_pack(os);
 		m_loadedtfr.save_binary(os);
 	} catch (const std::exception& e) {
 		if (true)
@@ -6,8 +6,8 @@
 
 #include "tfr.hh"
 
-TrafficFlowRestrictions::DbLoader::AirspaceCache::AirspaceCache(const std::string& id, char bc, uint8_t tc)
-	: m_id(id), m_airspace(), m_bdryclass(bc), m_typecode(tc)
+TrafficFlowRestrictions::DbLoader::AirspaceCache::AirspaceCache(const std::string& id, char bc, uint8_t tc, TFRAirspace::const_ptr_t aspc)
+	: m_id(id), m_airspace(aspc), m_bdryclass(bc), m_typecode(tc)
 {
 }
 
@@ -55,6 +55,7 @@ TrafficFlowRestrictions::DbLoader::DbLoader(TrafficFlowRestrictions& tfrs, const
 
 TrafficFlowRestrictions::DbLoader::~DbLoader()
 {
+	m_tfrs.m_resolvedairspaces.insert(m_airspacecache.begin(), m_airspacecache.end());
 }
 
 void TrafficFlowRestrictions::DbLoader::error(const std::string& text) const
@@ -239,6 +240,11 @@ TrafficFlowRestrictions::TFRAirspace::const_ptr_t TrafficFlowRestrictions::DbLoa
 	return TFRAirspace::ptr_t();
 }
 
+void TrafficFlowRestrictions::DbLoader::add_airspace_cache(const std::string& id, char bc, uint8_t tc, TFRAirspace::const_ptr_t aspc)
+{
+	m_airspacecache.insert(AirspaceCache(id, bc, tc, aspc));
+}
+
 const AirportsDb::Airport& TrafficFlowRestrictions::DbLoader::find_airport(const std::string& icao)
 {
 	{
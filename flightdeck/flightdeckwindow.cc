@@ -183,6 +183,12 @@ FlightDeckWindow::FlightDeckWindow(BaseObjectType *castitem, const Glib::RefPtr<
 #endif //GLIBMM_DEFAULT_SIGNAL_HANDLERS_ENABLED
 
 	m_wxdb.open(FPlan::get_userdbpath(), "wx.db");
+	{
+		time_t curtime;
+		time(&curtime);
+		metartaf_store(m_wxdb.find_metartaf(Rect(Point(Point::lon_min, Point::lat_min), Point(Point::lon_max, Point::lat_max)),
+						    curtime - 24*60*60, curtime - 2*24*60*60));
+	}
 	m_softkeysconn = m_softkeys.signal_clicked().connect(sigc::mem_fun(*this, &FlightDeckWindow::menubutton_clicked));
 	get_widget_derived(refxml, "altwindow", m_altdialog);
 	get_widget_derived(refxml, "hsiwindow", m_hsidialog);
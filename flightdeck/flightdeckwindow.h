@@ -374,6 +374,8 @@ protected:
 	void metartaf_fetch(void);
 	void metartaf_fetch_cb(const NWXWeather::metartaf_t& metartaf);
 	void metartaf_adds_fetch_cb(const ADDS::metartaf_t& metartaf);
+	void metartaf_store(const WXDatabase::metartafresult_t& metartaf);
+	void metartaf_row(Gtk::TreeModel::Row& row, const std::string& icao, const MetarTafSet::METARTAF& m);
 	bool wxchartlist_next(void);
 	bool wxchartlist_prev(void);
 	bool wxchartlist_nextepoch(void);
@@ -3192,6 +3194,8 @@ protected:
 	Engine *m_engine;
 	Sensors *m_sensors;
 	WXDatabase m_wxdb;
+	// downloaded METAR/TAF, queried by the METAR/TAF list instead of the database
+	MetarTafStore m_wxmetartaf;
 	// Screen Saver Disable
 	sigc::connection m_screensaverheartbeat;
 	typedef enum {
@@ -52,86 +52,88 @@ void FlightDeckWindow::metartaf_update(void)
 		return;
 	time_t curtime;
 	time(&curtime);
-	WXDatabase::metartafresult_t mt(m_wxdb.find_metartaf(fpl.get_bbox().oversize_nmi(50), curtime - 24*60*60, curtime - 2*24*60*60, 1000));
+	time_t metarcutoff(curtime - 24*60*60), tafcutoff(curtime - 2*24*60*60);
+	MetarTafSet mtset;
+	m_wxmetartaf.load(mtset, fpl.get_bbox().oversize_nmi(50), 1, 0, 3, 1);
+	std::set<std::string> stnshown;
 	for (unsigned int wnr = 0; wnr < fpl.get_nrwpt(); ++wnr) {
 		const FPlanWaypoint& wpt(fpl[wnr]);
-		std::string nrststn;
+		const MetarTafSet::Station *nrststn(0);
 		{
 			uint64_t dist(std::numeric_limits<uint64_t>::max());
-			for (WXDatabase::metartafresult_t::const_iterator mi(mt.begin()), me(mt.end()); mi != me; ++mi) {
-				const WXDatabase::MetarTaf& m(*mi);
-			        uint64_t d(m.get_coord().simple_distance_rel(wpt.get_coord()));
+			for (MetarTafSet::stations_t::const_iterator si(mtset.get_stations().begin()), se(mtset.get_stations().end()); si != se; ++si) {
+				if (stnshown.find(si->get_stationid()) != stnshown.end())
+					continue;
+				if ((si->get_metar().empty() || si->get_metar().rbegin()->get_time() < metarcutoff) &&
+				    (si->get_taf().empty() || si->get_taf().rbegin()->get_time() < tafcutoff))
+					continue;
+			        uint64_t d(si->get_coord().simple_distance_rel(wpt.get_coord()));
 				if (d >= dist)
 					continue;
 				dist = d;
-				nrststn = m.get_icao();
+				nrststn = &*si;
 			}
 		}
-		if (nrststn.empty())
+		if (!nrststn)
 			continue;
-		{
-			unsigned int nrtaf(0), nrmetar(0);
-			for (WXDatabase::metartafresult_t::const_iterator mi(mt.begin()), me(mt.end()); mi != me;) {
-				const WXDatabase::MetarTaf& m(*mi);
-				WXDatabase::metartafresult_t::iterator mi2(mi);
-				++mi;
-				if (m.get_icao() != nrststn)
-					continue;
-				bool add(false);
-				if (m.is_metar()) {
-					add = nrmetar < 3;
-					if (add)
-						++nrmetar;
-				} else if (m.is_taf()) {
-					add = nrtaf < 1;
-					if (add)
-						++nrtaf;
-				}
-				if (add) {
-					Gtk::TreeModel::iterator iter(m_metartafstore->append());
-					Gtk::TreeModel::Row row(*iter);
-					row[m_metartafcolumns.m_icao] = m.get_icao();
-					{
-						char buf[64];
-						struct tm utm;
-						time_t e(m.get_epoch());
-						strftime(buf, sizeof(buf), "%m-%d %H:%M", gmtime_r(&e, &utm));
-						row[m_metartafcolumns.m_issue] = buf;
-					}
-					{
-						std::string msg(m.get_message());
-						WXDatabase::MetarTaf::remove_linefeeds(msg);
-						row[m_metartafcolumns.m_message] = msg;
-					}
-					Gdk::Color col;
-					switch (m.get_type()) {
-					case NWXWeather::MetarTaf::type_metar:
-						col.set_rgb(0, 0, 0);
-						row[m_metartafcolumns.m_type] = "METAR";
-						row[m_metartafcolumns.m_weight] = 400;
-						row[m_metartafcolumns.m_style] = Pango::STYLE_ITALIC;
-						break;
+		stnshown.insert(nrststn->get_stationid());
+		for (MetarTafSet::Station::metar_t::const_reverse_iterator mi(nrststn->get_metar().rbegin()), me(nrststn->get_metar().rend()); mi != me; ++mi) {
+			if (mi->get_time() < metarcutoff)
+				break;
+			Gtk::TreeModel::iterator iter(m_metartafstore->append());
+			Gtk::TreeModel::Row row(*iter);
+			metartaf_row(row, nrststn->get_stationid(), *mi);
+			Gdk::Color col;
+			col.set_rgb(0, 0, 0);
+			row[m_metartafcolumns.m_type] = "METAR";
+			row[m_metartafcolumns.m_weight] = 400;
+			row[m_metartafcolumns.m_style] = Pango::STYLE_ITALIC;
+			row[m_metartafcolumns.m_color] = col;
+		}
+		for (MetarTafSet::Station::taf_t::const_reverse_iterator ti(nrststn->get_taf().rbegin()), te(nrststn->get_taf().rend()); ti != te; ++ti) {
+			if (ti->get_time() < tafcutoff)
+				break;
+			Gtk::TreeModel::iterator iter(m_metartafstore->append());
+			Gtk::TreeModel::Row row(*iter);
+			metartaf_row(row, nrststn->get_stationid(), *ti);
+			Gdk::Color col;
+			col.set_rgb(0, 0, 0x8000);
+			row[m_metartafcolumns.m_type] = "TAF";
+			row[m_metartafcolumns.m_weight] = 400;
+			row[m_metartafcolumns.m_style] = Pango::STYLE_NORMAL;
+			row[m_metartafcolumns.m_color] = col;
+		}
+	}
+}
 
-					case NWXWeather::MetarTaf::type_taf:
-						col.set_rgb(0, 0, 0x8000);
-						row[m_metartafcolumns.m_type] = "TAF";
-						row[m_metartafcolumns.m_weight] = 400;
-						row[m_metartafcolumns.m_style] = Pango::STYLE_NORMAL;
-						break;
+void FlightDeckWindow::metartaf_row(Gtk::TreeModel::Row& row, const std::string& icao, const MetarTafSet::METARTAF& m)
+{
+	row[m_metartafcolumns.m_icao] = icao;
+	{
+		char buf[64];
+		struct tm utm;
+		time_t e(m.get_time());
+		strftime(buf, sizeof(buf), "%m-%d %H:%M", gmtime_r(&e, &utm));
+		row[m_metartafcolumns.m_issue] = buf;
+	}
+	{
+		std::string msg(m.get_rawtext());
+		WXDatabase::MetarTaf::remove_linefeeds(msg);
+		row[m_metartafcolumns.m_message] = msg;
+	}
+}
 
-					default:
-						col.set_rgb(0xffff, 0, 0);
-						row[m_metartafcolumns.m_type] = "?";
-						row[m_metartafcolumns.m_weight] = 400;
-						row[m_metartafcolumns.m_style] = Pango::STYLE_NORMAL;
-						break;
-					}
-					row[m_metartafcolumns.m_color] = col;
-				}
-				mt.erase(mi2);
-			}
-		}
+void FlightDeckWindow::metartaf_store(const WXDatabase::metartafresult_t& metartaf)
+{
+	MetarTafSet mtset;
+	for (WXDatabase::metartafresult_t::const_iterator mi(metartaf.begin()), me(metartaf.end()); mi != me; ++mi) {
+		MetarTafSet::Station& stn(mtset.add_station(mi->get_icao(), mi->get_coord()));
+		if (mi->is_metar())
+			stn.get_metar().insert(MetarTafSet::METAR(mi->get_epoch(), mi->get_message()));
+		else if (mi->is_taf())
+			stn.get_taf().insert(MetarTafSet::TAF(mi->get_epoch(), mi->get_message()));
 	}
+	m_wxmetartaf.update(mtset);
 }
 
 void FlightDeckWindow::metartaf_fetch(void)
@@ -155,6 +157,7 @@ void FlightDeckWindow::metartaf_fetch_cb(const NWXWeather::metartaf_t& metartaf)
 		for (NWXWeather::metartaf_t::const_iterator mi(metartaf.begin()), me(metartaf.end()); mi != me; ++mi)
 			m_wxdb.save(*mi);
 	}
+	metartaf_store(metartaf);
 	metartaf_update();
 }
 
@@ -168,6 +171,7 @@ void FlightDeckWindow::metartaf_adds_fetch_cb(const ADDS::metartaf_t& metartaf)
 		for (ADDS::metartaf_t::const_iterator mi(metartaf.begin()), me(metartaf.end()); mi != me; ++mi) 
 			m_wxdb.save(*mi);
 	}
+	metartaf_store(metartaf);
 	metartaf_update();
 }
 
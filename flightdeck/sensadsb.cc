@@ -42,6 +42,7 @@ Sensors::SensorADSB::SensorADSB(Sensors& sensors, const Glib::ustring& configgro
         if (!cf.has_key(get_configgroup(), "correctbiterrors"))
 		get_sensors().get_configfile().set_integer(get_configgroup(), "correctbiterrors", m_correctbiterrors);
 	m_correctbiterrors = cf.get_integer(get_configgroup(), "correctbiterrors");
+	update_addr_corrections();
 	{
 		std::pair<adsbtargets_t::const_iterator,bool> ins(m_targets.insert(ADSBTarget(m_ownship, true)));
 		ADSBTarget& t(const_cast<ADSBTarget&>(*ins.first));
@@ -59,6 +60,7 @@ Sensors::SensorADSB::SensorADSB(Sensors& sensors, const Glib::ustring& configgro
 Sensors::SensorADSB::~SensorADSB()
 {
 	m_connexpire.disconnect();
+	m_connupdate.disconnect();
 }
 
 unsigned int Sensors::SensorADSB::get_position_priority(void) const
@@ -185,7 +187,7 @@ bool Sensors::SensorADSB::is_heading_true(void) const
 
 void Sensors::SensorADSB::receive(const ModeSMessage& msg)
 {
-	if (true) {
+	if (false) {
 		std::cerr << "ADSB: " << msg.get_raw_string();
 		if (msg.is_adsb() && !msg.crc()) {
 			uint32_t addr((msg[1] << 16) | (msg[2] << 8) | msg[3]);
@@ -231,29 +233,9 @@ void Sensors::SensorADSB::receive(const ModeSMessage& msg)
 	{
 		if (msg1.is_long() == !(msg1.get_format() & 16))
 			break;
-		adsbtargets_t::const_iterator ti;
-		if (m_correctbiterrors) {
-			adsbtargets_t::const_iterator te(m_targets.end());
-			for (ti = m_targets.begin(); ti != te; ++ti) {
-				ModeSMessage msg2(msg1);
-				frameerr = msg2.correct(ti->get_icaoaddr());
-				if (frameerr < 0 || frameerr > m_correctbiterrors)
-					continue;
-				if (true && msg2.addr() != ti->get_icaoaddr()) {
-					std::cerr << "ADSB: error correction failed: " << msg2.get_raw_string()
-						  << " (original " << msg.get_raw_string() << ')' << std::endl;
-					continue;
-				}
-				msg1 = msg2;
-				break;
-			}
-			if (ti == m_targets.end())
-				break;
-		} else {
-			ti = m_targets.find(ADSBTarget(msg1.addr()));
-			if (ti == m_targets.end())
-				break;
-		}
+		adsbtargets_t::const_iterator ti(find_target(msg1, frameerr, msg));
+		if (ti == m_targets.end())
+			break;
 		frameok = true;
 		ADSBTarget& t(const_cast<ADSBTarget&>(*ti));
 		uint16_t ac((msg1[2] << 8) | msg1[3]);
@@ -270,29 +252,9 @@ void Sensors::SensorADSB::receive(const ModeSMessage& msg)
 	{
 		if (msg1.is_long() == !(msg1.get_format() & 16))
 			break;
-		adsbtargets_t::const_iterator ti;
-		if (m_correctbiterrors) {
-			adsbtargets_t::const_iterator te(m_targets.end());
-			for (ti = m_targets.begin(); ti != te; ++ti) {
-				ModeSMessage msg2(msg1);
-				frameerr = msg2.correct(ti->get_icaoaddr());
-				if (frameerr < 0 || frameerr > m_correctbiterrors)
-					continue;
-				if (true && msg2.addr() != ti->get_icaoaddr()) {
-					std::cerr << "ADSB: error correction failed: " << msg2.get_raw_string()
-						  << " (original " << msg.get_raw_string() << ')' << std::endl;
-					continue;
-				}
-				msg1 = msg2;
-				break;
-			}
-			if (ti == m_targets.end())
-				break;
-		} else {
-			ti = m_targets.find(ADSBTarget(msg1.addr()));
-			if (ti == m_targets.end())
-				break;
-		}
+		adsbtargets_t::const_iterator ti(find_target(msg1, frameerr, msg));
+		if (ti == m_targets.end())
+			break;
 		frameok = true;
 		ADSBTarget& t(const_cast<ADSBTarget&>(*ti));
 		uint16_t ac((msg1[2] << 8) | msg1[3]);
@@ -310,29 +272,9 @@ void Sensors::SensorADSB::receive(const ModeSMessage& msg)
 	{
 		if (msg1.is_long() == !(msg1.get_format() & 16))
 			break;
-		adsbtargets_t::const_iterator ti;
-		if (m_correctbiterrors) {
-			adsbtargets_t::const_iterator te(m_targets.end());
-			for (ti = m_targets.begin(); ti != te; ++ti) {
-				ModeSMessage msg2(msg1);
-				frameerr = msg2.correct(ti->get_icaoaddr());
-				if (frameerr < 0 || frameerr > m_correctbiterrors)
-					continue;
-				if (true && msg2.addr() != ti->get_icaoaddr()) {
-					std::cerr << "ADSB: error correction failed: " << msg2.get_raw_string()
-						  << " (original " << msg.get_raw_string() << ')' << std::endl;
-					continue;
-				}
-				msg1 = msg2;
-				break;
-			}
-			if (ti == m_targets.end())
-				break;
-		} else {
-			ti = m_targets.find(ADSBTarget(msg1.addr()));
-			if (ti == m_targets.end())
-				break;
-		}
+		adsbtargets_t::const_iterator ti(find_target(msg1, frameerr, msg));
+		if (ti == m_targets.end())
+			break;
 		frameok = true;
 		ADSBTarget& t(const_cast<ADSBTarget&>(*ti));
 		uint16_t id((msg1[2] << 8) | msg1[3]);
@@ -371,26 +313,22 @@ void Sensors::SensorADSB::receive(const ModeSMessage& msg)
 		if (msg1.is_adsb_position()) {
 			Point pt;
 			pt.set_invalid();
-			for (unsigned int i = t.size(); i > 0; ) {
-				--i;
-				const ADSBTarget::Position& pos(t[i]);
-				if (pos.get_cprformat() == msg1.get_adsb_cprformat())
-					continue;
-				Glib::TimeVal tvdiff(tv - pos.get_timestamp());
+			// global decode against the cached most recent frame of the opposite format
+			if (t.is_cprframe_valid(!msg1.get_adsb_cprformat())) {
+				bool fmt(!msg1.get_adsb_cprformat());
+				Glib::TimeVal tvdiff(tv - t.get_cprtimestamp(fmt));
 				tvdiff.subtract_seconds(10);
-				if (!tvdiff.negative())
-					continue;
-				if (msg1.get_adsb_cprformat()) {
-					std::pair<Point,Point> r(ModeSMessage::decode_global_cpr17(pos.get_cprlat(), pos.get_cprlon(),
-												   msg1.get_adsb_cprlat(), msg1.get_adsb_cprlon()));
-					pt = r.second;
-				} else {
-					std::pair<Point,Point> r(ModeSMessage::decode_global_cpr17(msg1.get_adsb_cprlat(), msg1.get_adsb_cprlon(),
-												   pos.get_cprlat(), pos.get_cprlon()));
-					pt = r.first;
+				if (tvdiff.negative()) {
+					if (msg1.get_adsb_cprformat()) {
+						std::pair<Point,Point> r(ModeSMessage::decode_global_cpr17(t.get_cprlat(fmt), t.get_cprlon(fmt),
+													   msg1.get_adsb_cprlat(), msg1.get_adsb_cprlon()));
+						pt = r.second;
+					} else {
+						std::pair<Point,Point> r(ModeSMessage::decode_global_cpr17(msg1.get_adsb_cprlat(), msg1.get_adsb_cprlon(),
+													   t.get_cprlat(fmt), t.get_cprlon(fmt)));
+						pt = r.first;
+					}
 				}
-				if (!pt.is_invalid())
-					break;
 			}
 			if (pt.is_invalid()) {
 				if (!t.empty())
@@ -493,13 +431,94 @@ void Sensors::SensorADSB::receive(const ModeSMessage& msg)
 			m_tracefile << " (bit errors " << frameerr << " original " << msg.get_msg_string(true) << ')';
 		m_tracefile << std::endl;
 	}
-	expire_targets(pc);
-	update(pc);
+	// a pending expiry timer already covers all targets; the new timestamps expire later
+	if (!m_connexpire.connected())
+		expire_targets(pc);
+	queue_update(pc);
+}
+
+Sensors::SensorADSB::adsbtargets_t::const_iterator Sensors::SensorADSB::find_target(ModeSMessage& msg, int& frameerr, const ModeSMessage& msgorig) const
+{
+	if (!m_correctbiterrors)
+		return m_targets.find(ADSBTarget(msg.addr()));
+	// a target matches if its address differs from the received address field by a
+	// correctable syndrome; probe whichever of the two sets is smaller
+	uint32_t addr(msg.addr());
+	adsbtargets_t::const_iterator ti(m_targets.end());
+	const ModeSMessage::addrcorrections_t& ac(m_addrcorr[msg.is_long()]);
+	if (ac.size() <= m_targets.size()) {
+		for (ModeSMessage::addrcorrections_t::const_iterator ai(ac.begin()), ae(ac.end()); ai != ae; ++ai) {
+			ti = m_targets.find(ADSBTarget(addr ^ ai->first));
+			if (ti != m_targets.end())
+				break;
+		}
+	} else {
+		const addrcorrindex_t& aci(m_addrcorrindex[msg.is_long()]);
+		unsigned int besterr(std::numeric_limits<unsigned int>::max());
+		for (adsbtargets_t::const_iterator ti2(m_targets.begin()), te(m_targets.end()); ti2 != te; ++ti2) {
+			addrcorrindex_t::const_iterator ai(aci.find(addr ^ ti2->get_icaoaddr()));
+			if (ai == aci.end() || ai->second >= besterr)
+				continue;
+			ti = ti2;
+			besterr = ai->second;
+			if (!besterr)
+				break;
+		}
+	}
+	if (ti == m_targets.end())
+		return ti;
+	ModeSMessage msg2(msg);
+	frameerr = msg2.correct(ti->get_icaoaddr());
+	if (frameerr < 0 || frameerr > m_correctbiterrors)
+		return m_targets.end();
+	if (true && msg2.addr() != ti->get_icaoaddr()) {
+		std::cerr << "ADSB: error correction failed: " << msg2.get_raw_string()
+			  << " (original " << msgorig.get_raw_string() << ')' << std::endl;
+		return m_targets.end();
+	}
+	msg = msg2;
+	return ti;
+}
+
+void Sensors::SensorADSB::update_addr_corrections(void)
+{
+	for (unsigned int i = 0; i < 2; ++i) {
+		m_addrcorr[i] = ModeSMessage::get_addr_corrections(i, m_correctbiterrors);
+		m_addrcorrindex[i].clear();
+		for (ModeSMessage::addrcorrections_t::const_iterator ai(m_addrcorr[i].begin()), ae(m_addrcorr[i].end()); ai != ae; ++ai)
+			m_addrcorrindex[i].insert(*ai);
+	}
+}
+
+void Sensors::SensorADSB::queue_update(const ParamChanged& pc)
+{
+	m_pendingchanged |= pc;
+	if (!m_pendingchanged)
+		return;
+	// own ship state is forwarded immediately, target list changes are rate limited
+	if (m_pendingchanged.is_changed(parnrtime, parnrgroundspeed)) {
+		flush_update();
+		return;
+	}
+	if (!m_connupdate.connected())
+		m_connupdate = Glib::signal_timeout().connect(sigc::mem_fun(*this, &SensorADSB::flush_update), 200);
+}
+
+bool Sensors::SensorADSB::flush_update(void)
+{
+	m_connupdate.disconnect();
+	ParamChanged pc(m_pendingchanged);
+	m_pendingchanged.clear_all_changed();
+	if (pc)
+		update(pc);
+	return false;
 }
 
 void Sensors::SensorADSB::clear(void)
 {
 	m_connexpire.disconnect();
+	m_connupdate.disconnect();
+	m_pendingchanged.clear_all_changed();
 	m_targets.clear();
 	{
 		std::pair<adsbtargets_t::const_iterator,bool> ins(m_targets.insert(ADSBTarget(m_ownship, true)));
@@ -533,6 +552,8 @@ void Sensors::SensorADSB::expire_targets(ParamChanged& pc)
 			tvold = ti->get_timestamp();
 		++ti;
 	}
+	if (tvold.tv_sec == std::numeric_limits<long>::max())
+		return;
 	tvold -= tv;
 	m_connexpire = Glib::signal_timeout().connect(sigc::mem_fun(*this, &SensorADSB::expire), tvold.tv_sec * 1000 + (tvold.tv_usec + 999) / 1000);
 }
@@ -541,8 +562,7 @@ bool Sensors::SensorADSB::expire(void)
 {
 	ParamChanged pc;
 	expire_targets(pc);
-	if (pc)
-		update(pc);
+	queue_update(pc);
 	return false;
 }
 
@@ -767,6 +787,7 @@ void Sensors::SensorADSB::set_param(unsigned int nr, int v)
 		if (m_correctbiterrors == (unsigned int)v)
 			return;
 		m_correctbiterrors = v;
+		update_addr_corrections();
 		get_sensors().get_configfile().set_integer(get_configgroup(), "correctbiterrors", m_correctbiterrors);
 		break;
 
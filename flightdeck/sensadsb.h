@@ -13,6 +13,8 @@
 #ifndef SENSADSB_H
 #define SENSADSB_H
 
+#include <boost/unordered_map.hpp>
+
 #include "sensors.h"
 #include "modes.h"
 
@@ -90,12 +92,21 @@ class Sensors::SensorADSB : public Sensors::SensorInstance {
 	void receive(const ModeSMessage& msg);
 	void clear(void);
 
+	adsbtargets_t::const_iterator find_target(ModeSMessage& msg, int& frameerr, const ModeSMessage& msgorig) const;
+	void update_addr_corrections(void);
 	void expire_targets(ParamChanged& pc);
 	bool expire(void);
+	void queue_update(const ParamChanged& pc);
+	bool flush_update(void);
 
 	sigc::connection m_connexpire;
+	sigc::connection m_connupdate;
+	ParamChanged m_pendingchanged;
 	adsbtargets_t m_targets;
 	adsbtargets_t::const_iterator m_ownshipptr;
+	typedef boost::unordered_map<uint32_t,unsigned int> addrcorrindex_t;
+	ModeSMessage::addrcorrections_t m_addrcorr[2];
+	addrcorrindex_t m_addrcorrindex[2];
 	uint32_t m_ownship;
 	unsigned int m_correctbiterrors;
 	unsigned int m_positionpriority;
@@ -256,6 +256,10 @@ Sensors::Sensor::ADSBTarget::ADSBTarget(uint32_t icaoaddr, bool ownship)
 	  m_nicsuppb(std::numeric_limits<uint8_t>::max()), m_nicsuppc(std::numeric_limits<uint8_t>::max()),
 	  m_lmotion(lmotion_invalid), m_vmotion(vmotion_invalid), m_ownship(ownship)
 {
+	for (unsigned int i = 0; i < 2; ++i) {
+		m_cprtimestamp[i] = Glib::TimeVal(-1, -1);
+		m_cprlat[i] = m_cprlon[i] = 0;
+	}
 }
 
 Sensors::Sensor::ADSBTarget::ADSBTarget(const Glib::TimeVal& ts, uint32_t icaoaddr, bool ownship)
@@ -267,6 +271,10 @@ Sensors::Sensor::ADSBTarget::ADSBTarget(const Glib::TimeVal& ts, uint32_t icaoad
 	  m_nicsuppb(std::numeric_limits<uint8_t>::max()), m_nicsuppc(std::numeric_limits<uint8_t>::max()),
 	  m_lmotion(lmotion_invalid), m_vmotion(vmotion_invalid), m_ownship(ownship)
 {
+	for (unsigned int i = 0; i < 2; ++i) {
+		m_cprtimestamp[i] = Glib::TimeVal(-1, -1);
+		m_cprlat[i] = m_cprlon[i] = 0;
+	}
 }
 
 void Sensors::Sensor::ADSBTarget::set_baroalt(const Glib::TimeVal& tv, int32_t baroalt)
@@ -336,15 +344,22 @@ void Sensors::Sensor::ADSBTarget::add_position(const Position& pos)
 {
 	m_timestamp = pos.get_timestamp();
 	m_positions.push_back(pos);
-	for (unsigned int i = 0; i + 1 < m_positions.size(); ) {
+	{
+		unsigned int i(!!pos.get_cprformat());
+		m_cprtimestamp[i] = pos.get_timestamp();
+		m_cprlat[i] = pos.get_cprlat();
+		m_cprlon[i] = pos.get_cprlon();
+	}
+	// positions are appended in time order, so stale ones form a prefix
+	unsigned int i(0);
+	for (; i + 1 < m_positions.size(); ++i) {
 		Glib::TimeVal tv(m_positions.back().get_timestamp() - m_positions[i].get_timestamp());
 		tv.subtract_seconds(60);
-		if (tv.negative()) {
-			++i;
-			continue;
-		}
-		m_positions.erase(m_positions.begin() + i);
+		if (tv.negative())
+			break;
 	}
+	if (i)
+		m_positions.erase(m_positions.begin(), m_positions.begin() + i);
 }
 
 Sensors::Sensor::ParamChanged::ParamChanged(void)
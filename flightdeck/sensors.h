@@ -311,6 +311,12 @@ class Sensors : public sigc::trackable {
 			uint8_t get_nicsuppb(void) const { return m_nicsuppb; }
 			uint8_t get_nicsuppc(void) const { return m_nicsuppc; }
 
+			// most recent even (false) / odd (true) CPR frame, for global position decoding
+			bool is_cprframe_valid(bool cprformat) const { return m_cprtimestamp[!!cprformat].valid(); }
+			const Glib::TimeVal& get_cprtimestamp(bool cprformat) const { return m_cprtimestamp[!!cprformat]; }
+			uint32_t get_cprlat(bool cprformat) const { return m_cprlat[!!cprformat]; }
+			uint32_t get_cprlon(bool cprformat) const { return m_cprlon[!!cprformat]; }
+
 			void set_ownship(bool os) { m_ownship = os; }
 			void set_baroalt(const Glib::TimeVal& tv, int32_t baroalt);
 			void set_baroalt(const Glib::TimeVal& tv, int32_t baroalt, int32_t verticalspeed);
@@ -331,6 +337,9 @@ class Sensors : public sigc::trackable {
 			Glib::TimeVal m_motiontimestamp;
 			Glib::TimeVal m_baroalttimestamp;
 			Glib::TimeVal m_gnssalttimestamp;
+			Glib::TimeVal m_cprtimestamp[2];
+			uint32_t m_cprlat[2];
+			uint32_t m_cprlon[2];
 			uint32_t m_icaoaddr;
 			int32_t m_baroalt;
 			int32_t m_gnssalt;
@@ -79,24 +79,24 @@ void Sensors::SensorRemoteADSB::read_finished(Glib::RefPtr<Gio::AsyncResult>& ar
 		return;
 	}
 	m_buffer += std::string(m_readbuffer, m_readbuffer + ret);
-	std::string::iterator si(m_buffer.begin()), se(m_buffer.end());
+	// parse all complete lines, then drop them from the buffer in one go
+	std::string::iterator sb(m_buffer.begin()), si(sb), se(m_buffer.end());
 	for (;;) {
 		if (si == se)
 			break;
 		if (*si == '\r' || *si == '\n') {
 			ModeSMessage msg;
-			if (msg.parse_line(m_buffer.begin(), si) != m_buffer.begin())
+			if (msg.parse_line(sb, si) != sb)
 				receive(msg);
 			do {
 				++si;
 			} while (si != se && (*si == '\r' || *si == '\n'));
-			m_buffer.erase(m_buffer.begin(), si);
-			si = m_buffer.begin();
-			se = m_buffer.end();
+			sb = si;
 			continue;
 		}
 		++si;
 	}
+	m_buffer.erase(m_buffer.begin(), sb);
  	m_sockconn->get_input_stream()->read_async(m_readbuffer, sizeof(m_readbuffer),
 						   sigc::mem_fun(*this, &SensorRemoteADSB::read_finished), m_cancel);
 }
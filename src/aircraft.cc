@@ -3682,6 +3682,81 @@ std::ostream& Aircraft::ClimbDescent::print(std::ostream& os, const std::string&
 	return os;
 }
 
+Aircraft::Climb::CalcCache::Key::Key(const std::string& name, double mass, double isaoffs, double qnh)
+	: m_name(name),
+	  m_mass(std::isnan(mass) ? std::numeric_limits<int64_t>::min() : Point::round<int64_t,double>(mass)),
+	  m_isaoffset(std::isnan(isaoffs) ? std::numeric_limits<int64_t>::min() : Point::round<int64_t,double>(isaoffs * 10)),
+	  m_qnh(std::isnan(qnh) ? std::numeric_limits<int64_t>::min() : Point::round<int64_t,double>(qnh * 10))
+{
+}
+
+int Aircraft::Climb::CalcCache::Key::compare(const Key& x) const
+{
+	int c(m_name.compare(x.m_name));
+	if (c)
+		return c;
+	if (m_mass < x.m_mass)
+		return -1;
+	if (x.m_mass < m_mass)
+		return 1;
+	if (m_isaoffset < x.m_isaoffset)
+		return -1;
+	if (x.m_isaoffset < m_isaoffset)
+		return 1;
+	if (m_qnh < x.m_qnh)
+		return -1;
+	if (x.m_qnh < m_qnh)
+		return 1;
+	return 0;
+}
+
+void Aircraft::Climb::CalcCache::quantise(double& mass, double& isaoffs, double& qnh)
+{
+	// a fuel burning flight plan produces a slightly different mass on almost every call
+	if (!std::isnan(mass))
+		mass = Point::round<int64_t,double>(mass);
+	if (!std::isnan(isaoffs))
+		isaoffs = Point::round<int64_t,double>(isaoffs * 10) * 0.1;
+	if (!std::isnan(qnh))
+		qnh = Point::round<int64_t,double>(qnh * 10) * 0.1;
+}
+
+bool Aircraft::Climb::CalcCache::find(ClimbDescent& cd, const std::string& name, double mass, double isaoffs, double qnh)
+{
+	Glib::Threads::Mutex::Lock lock(m_mutex);
+	cache_t::iterator i(m_cache.find(Key(name, mass, isaoffs, qnh)));
+	if (i == m_cache.end())
+		return false;
+	m_lru.splice(m_lru.begin(), m_lru, i->second.second);
+	cd = i->second.first;
+	return true;
+}
+
+void Aircraft::Climb::CalcCache::insert(const ClimbDescent& cd, const std::string& name, double mass, double isaoffs, double qnh)
+{
+	Glib::Threads::Mutex::Lock lock(m_mutex);
+	Key key(name, mass, isaoffs, qnh);
+	cache_t::iterator i(m_cache.find(key));
+	if (i != m_cache.end()) {
+		i->second.first = cd;
+		m_lru.splice(m_lru.begin(), m_lru, i->second.second);
+		return;
+	}
+	m_lru.push_front(key);
+	m_cache.insert(cache_t::value_type(key, cache_t::mapped_type(cd, m_lru.begin())));
+	while (m_cache.size() > max_entries) {
+		m_cache.erase(m_lru.back());
+		m_lru.pop_back();
+	}
+}
+
+void Aircraft::Climb::CalcCache::clear(void)
+{
+	Glib::Threads::Mutex::Lock lock(m_mutex);
+	m_cache.clear();
+	m_lru.clear();
+}
+
 Aircraft::Climb::Climb(double altfactor, double ratefactor, double fuelflowfactor, double casfactor,
 		       double timefactor, double fuelfactor, double distfactor)
 	: m_altfactor(altfactor), m_ratefactor(ratefactor), m_fuelflowfactor(fuelflowfactor), m_casfactor(casfactor),
@@ -3698,7 +3773,15 @@ Aircraft::ClimbDescent Aircraft::Climb::calculate(const std::string& name, doubl
 		if (ci == m_curves.end())
 			return ClimbDescent("", 2600);
 	}
-	return calculate(ci->second, mass, isaoffs, qnh);
+	CalcCache::quantise(mass, isaoffs, qnh);
+	{
+		ClimbDescent cd("", 2600);
+		if (m_calccache.find(cd, ci->first, mass, isaoffs, qnh))
+			return cd;
+	}
+	ClimbDescent cd(calculate(ci->second, mass, isaoffs, qnh));
+	m_calccache.insert(cd, ci->first, mass, isaoffs, qnh);
+	return cd;
 }
 
 Aircraft::ClimbDescent Aircraft::Climb::calculate(std::string& name, const std::string& dfltname, double mass, double isaoffs, double qnh) const
@@ -3714,7 +3797,15 @@ Aircraft::ClimbDescent Aircraft::Climb::calculate(std::string& name, const std::
 			name = dfltname;
 		}
 	}
-	return calculate(ci->second, mass, isaoffs, qnh);
+	CalcCache::quantise(mass, isaoffs, qnh);
+	{
+		ClimbDescent cd("", 2600);
+		if (m_calccache.find(cd, ci->first, mass, isaoffs, qnh))
+			return cd;
+	}
+	ClimbDescent cd(calculate(ci->second, mass, isaoffs, qnh));
+	m_calccache.insert(cd, ci->first, mass, isaoffs, qnh);
+	return cd;
 }
 
 Aircraft::ClimbDescent Aircraft::Climb::calculate(const massmap_t& ci, double mass, double isaoffs, double qnh) const
@@ -3812,6 +3903,7 @@ void Aircraft::Climb::load_xml(const xmlpp::Element *el)
 {
 	if (!el)
 		return;
+	m_calccache.clear();
 	m_curves.clear();
 	m_remark.clear();
 	m_altfactor = 1;
@@ -3923,11 +4015,13 @@ void Aircraft::Climb::save_xml(xmlpp::Element *el) const
 
 void Aircraft::Climb::clear(void)
 {
+	m_calccache.clear();
 	m_curves.clear();
 }
 
 void Aircraft::Climb::add(const ClimbDescent& cd)
 {
+	m_calccache.clear();
 	double m(cd.get_mass());
 	if (std::isnan(m) || m <= 0)
 		m = 0;
@@ -3936,6 +4030,7 @@ void Aircraft::Climb::add(const ClimbDescent& cd)
 
 bool Aircraft::Climb::recalculatepoly(bool force)
 {
+	m_calccache.clear();
 	bool work(false);
 	for (curves_t::iterator ci(m_curves.begin()), ce(m_curves.end()); ci != ce; ++ci)
 		for (massmap_t::iterator mi(ci->second.begin()), me(ci->second.end()); mi != me; ++mi)
@@ -3946,6 +4041,7 @@ bool Aircraft::Climb::recalculatepoly(bool force)
 
 void Aircraft::Climb::set_point_vy(double vy)
 {
+	m_calccache.clear();
 	for (curves_t::iterator ci(m_curves.begin()), ce(m_curves.end()); ci != ce; ++ci)
 		for (massmap_t::iterator mi(ci->second.begin()), me(ci->second.end()); mi != me; ++mi)
 			for (isamap_t::iterator ii(mi->second.begin()), ie(mi->second.end()); ii != ie; ++ii)
@@ -3956,6 +4052,7 @@ void Aircraft::Climb::set_mass(double mass)
 {
 	if (std::isnan(mass) || mass <= 0)
 		return;
+	m_calccache.clear();
 	for (curves_t::iterator ci(m_curves.begin()), ce(m_curves.end()); ci != ce; ++ci) {
 		massmap_t::iterator mi(ci->second.find(0));
 		if (mi == ci->second.end())
@@ -4228,7 +4325,15 @@ Aircraft::ClimbDescent Aircraft::Descent::calculate(const std::string& name, dou
 		if (ci == m_curves.end())
 			return ClimbDescent("", 2600);
 	}
-	return calculate(ci->second, mass, isaoffs, qnh);
+	CalcCache::quantise(mass, isaoffs, qnh);
+	{
+		ClimbDescent cd("", 2600);
+		if (m_calccache.find(cd, ci->first, mass, isaoffs, qnh))
+			return cd;
+	}
+	ClimbDescent cd(calculate(ci->second, mass, isaoffs, qnh));
+	m_calccache.insert(cd, ci->first, mass, isaoffs, qnh);
+	return cd;
 }
 
 Aircraft::ClimbDescent Aircraft::Descent::calculate(std::string& name, const std::string& dfltname, double mass, double isaoffs, double qnh) const
@@ -4244,7 +4349,15 @@ Aircraft::ClimbDescent Aircraft::Descent::calculate(std::string& name, const std
 			name = dfltname;
 		}
 	}
-	return calculate(ci->second, mass, isaoffs, qnh);
+	CalcCache::quantise(mass, isaoffs, qnh);
+	{
+		ClimbDescent cd("", 2600);
+		if (m_calccache.find(cd, ci->first, mass, isaoffs, qnh))
+			return cd;
+	}
+	ClimbDescent cd(calculate(ci->second, mass, isaoffs, qnh));
+	m_calccache.insert(cd, ci->first, mass, isaoffs, qnh);
+	return cd;
 }
 
 Aircraft::ClimbDescent Aircraft::Descent::calculate(const massmap_t& ci, double mass, double isaoffs, double qnh) const
@@ -4290,6 +4403,7 @@ void Aircraft::Glide::load_xml(const xmlpp::Element *el, double ceiling)
 {
 	if (!el)
 		return;
+	m_calccache.clear();
 	m_curves.clear();
 	m_remark.clear();
 	m_altfactor = 1;
@@ -4454,6 +4568,7 @@ void Aircraft::Glide::set_default(double mass, double ceiling, double vbg, doubl
 	if (std::isnan(ceiling) || std::isnan(vbg) || std::isnan(glideslope) ||
 	    ceiling <= 0 || vbg <= 0 || glideslope <= 0)
 		return;
+	m_calccache.clear();
 	m_curves.clear();
 	{
 		ClimbDescent cd("", mass);
@@ -6669,7 +6784,8 @@ void Aircraft::Cruise::build_altmap(propulsion_t prop)
 {
 	if (prop != propulsion_fixedpitch && prop != propulsion_constantspeed)
 		m_pistonpower.clear();
-	m_bhpmap.clear();
+	m_bhptable.clear();
+	bhpmap_t bhpmap;
 	for (curves_t::const_iterator ci(m_curves.begin()), ce(m_curves.end()); ci != ce; ++ci) {
 		for (massmap_t::const_iterator mi(ci->second.begin()), me(ci->second.end()); mi != me; ++mi) {
 			for (isamap_t::const_iterator ii(mi->second.begin()), ie(mi->second.end()); ii != ie; ++ii) {
@@ -6678,13 +6794,13 @@ void Aircraft::Cruise::build_altmap(propulsion_t prop)
 				for (Curve::const_iterator pi(ii->second.begin()), pe(ii->second.end()); pi != pe; ++pi) {
 					if (std::isnan(pi->get_pressurealt()) || std::isnan(pi->get_bhp()))
 						continue;
-					m_bhpmap[ii->second.get_mass()][ii->second.get_isaoffset()][pi->get_pressurealt()][pi->get_bhp()] = Point1(pi->get_tas(), pi->get_fuelflow());
+					bhpmap[ii->second.get_mass()][ii->second.get_isaoffset()][pi->get_pressurealt()][pi->get_bhp()] = Point1(pi->get_tas(), pi->get_fuelflow());
 				}
 			}
 		}
 	}
 	if (false) {
-		for (bhpmap_t::const_iterator i(m_bhpmap.begin()), e(m_bhpmap.end()); i != e; ++i) {
+		for (bhpmap_t::const_iterator i(bhpmap.begin()), e(bhpmap.end()); i != e; ++i) {
 			std::cout << "Mass = " << i->first << std::endl;
 			for (bhpisamap_t::const_iterator i2(i->second.begin()), e2(i->second.end()); i2 != e2; ++i2) {
 				std::cout << "  ISA = " << i2->first << std::endl;
@@ -6698,192 +6814,126 @@ void Aircraft::Cruise::build_altmap(propulsion_t prop)
 			}
 		}
 	}
+	for (bhpmap_t::const_iterator i(bhpmap.begin()), e(bhpmap.end()); i != e; ++i)
+		for (bhpisamap_t::const_iterator i2(i->second.begin()), e2(i->second.end()); i2 != e2; ++i2)
+			for (bhpaltmap_t::const_iterator i3(i2->second.begin()), e3(i2->second.end()); i3 != e3; ++i3)
+				for (bhpbhpmap_t::const_iterator i4(i3->second.begin()), e4(i3->second.end()); i4 != e4; ++i4)
+					m_bhptable.add(i->first, i2->first, i3->first, i4->first, i4->second.get_tas(), i4->second.get_fuelflow());
 }
 
-void Aircraft::Cruise::calculate(double& mass, double& isaoffs, double& pa, double& bhp, double& tas, double& ff) const
+Aircraft::Cruise::BHPTable::BHPTable(void)
 {
-	if (std::isnan(mass)) {
-		mass = isaoffs = pa = bhp = tas = ff = std::numeric_limits<double>::quiet_NaN();
-		return;
-	}
-	bhpmap_t::const_iterator iu(m_bhpmap.lower_bound(mass));
-	if (iu == m_bhpmap.end()) {
-		if (iu == m_bhpmap.begin()) {
-			mass = isaoffs = pa = bhp = tas = ff = std::numeric_limits<double>::quiet_NaN();
-			return;
-		}
-		--iu;
-		mass = iu->first;
-		calculate(iu, isaoffs, pa, bhp, tas, ff);
-		return;
-	}
-	bhpmap_t::const_iterator il(iu);
-	if (iu == m_bhpmap.begin()) {
-		++iu;
-		if (iu == m_bhpmap.end()) {
-			mass = il->first;
-			calculate(il, isaoffs, pa, bhp, tas, ff);
-			return;
-		}
-	} else {
-		--il;
-	}
-	double t((mass - il->first) / (iu->first - il->first));
-	if (t <= 0) {
-		calculate(il, isaoffs, pa, bhp, tas, ff);
-		return;
-	}
-	if (t >= 1) {
-		calculate(iu, isaoffs, pa, bhp, tas, ff);
-		return;
-	}
-	double lisaoffs(isaoffs), lpa(pa), lbhp(bhp), ltas(tas), lff(ff);
-	calculate(il, lisaoffs, lpa, lbhp, ltas, lff);
-	double uisaoffs(isaoffs), upa(pa), ubhp(bhp), utas(tas), uff(ff);
-	calculate(iu, uisaoffs, upa, ubhp, utas, uff);
-	isaoffs = uisaoffs * t + lisaoffs * (1 - t);
-	pa = upa * t + lpa * (1 - t);
-	bhp = ubhp * t + lbhp * (1 - t);
-	tas = utas * t + ltas * (1 - t);
-	ff = uff * t + lff * (1 - t);
+	clear();
 }
 
-void Aircraft::Cruise::calculate(bhpmap_t::const_iterator it, double& isaoffs, double& pa, double& bhp, double& tas, double& ff) const
+void Aircraft::Cruise::BHPTable::clear(void)
 {
-	if (std::isnan(isaoffs)) {
-		isaoffs = pa = bhp = tas = ff = std::numeric_limits<double>::quiet_NaN();
-		return;
-	}
-	bhpisamap_t::const_iterator iu(it->second.lower_bound(isaoffs));
-	if (iu == it->second.end()) {
-		if (iu == it->second.begin()) {
-			isaoffs = pa = bhp = tas = ff = std::numeric_limits<double>::quiet_NaN();
-			return;
-		}
-		--iu;
-		isaoffs = iu->first;
-		calculate(iu, pa, bhp, tas, ff);
-		return;
+	for (unsigned int l = 0; l < nrlevels; ++l)
+		m_keys[l].clear();
+	for (unsigned int l = 0; l + 1 < nrlevels; ++l) {
+		m_start[l].clear();
+		m_start[l].push_back(0);
 	}
-	bhpisamap_t::const_iterator il(iu);
-	if (iu == it->second.begin()) {
-		++iu;
-		if (iu == it->second.end()) {
-			isaoffs = il->first;
-			calculate(il, pa, bhp, tas, ff);
-			return;
-		}
-	} else {
-		--il;
-	}
-	double t((isaoffs - il->first) / (iu->first - il->first));
-	if (t <= 0) {
-		calculate(il, pa, bhp, tas, ff);
-		return;
-	}
-	if (t >= 1) {
-		calculate(iu, pa, bhp, tas, ff);
-		return;
-	}
-	double lpa(pa), lbhp(bhp), ltas(tas), lff(ff);
-	calculate(il, lpa, lbhp, ltas, lff);
-	double upa(pa), ubhp(bhp), utas(tas), uff(ff);
-	calculate(iu, upa, ubhp, utas, uff);
-	pa = upa * t + lpa * (1 - t);
-	bhp = ubhp * t + lbhp * (1 - t);
-	tas = utas * t + ltas * (1 - t);
-	ff = uff * t + lff * (1 - t);
+	m_tas.clear();
+	m_ff.clear();
 }
 
-void Aircraft::Cruise::calculate(bhpisamap_t::const_iterator it, double& pa, double& bhp, double& tas, double& ff) const
+void Aircraft::Cruise::BHPTable::add(double mass, double isaoffs, double pa, double bhp, double tas, double ff)
 {
-	if (std::isnan(pa)) {
-		pa = bhp = tas = ff = std::numeric_limits<double>::quiet_NaN();
-		return;
-	}
-	bhpaltmap_t::const_iterator iu(it->second.lower_bound(pa));
-	if (iu == it->second.end()) {
-		if (iu == it->second.begin()) {
-			pa = bhp = tas = ff = std::numeric_limits<double>::quiet_NaN();
-			return;
-		}
-		--iu;
-		pa = iu->first;
-		calculate(iu, bhp, tas, ff);
-		return;
-	}
-	bhpaltmap_t::const_iterator il(iu);
-	if (iu == it->second.begin()) {
-		++iu;
-		if (iu == it->second.end()) {
-			pa = il->first;
-			calculate(il, bhp, tas, ff);
-			return;
-		}
-	} else {
-		--il;
-	}
-	double t((pa - il->first) / (iu->first - il->first));
-	if (t <= 0) {
-		calculate(il, bhp, tas, ff);
+	// points must be added in lexicographic (mass, isaoffs, pa, bhp) order
+	const double k[nrlevels] = { mass, isaoffs, pa, bhp };
+	bool isnew(false);
+	for (unsigned int l = 0; l < nrlevels; ++l) {
+		if (!isnew && !m_keys[l].empty() && m_keys[l].back() == k[l])
+			continue;
+		isnew = true;
+		m_keys[l].push_back(k[l]);
+		if (l)
+			m_start[l - 1].back() = m_keys[l].size();
+		if (l + 1 < nrlevels)
+			m_start[l].push_back(m_keys[l + 1].size());
+	}
+	if (!isnew) {
+		m_tas.back() = tas;
+		m_ff.back() = ff;
 		return;
 	}
-	if (t >= 1) {
-		calculate(iu, bhp, tas, ff);
+	m_tas.push_back(tas);
+	m_ff.push_back(ff);
+}
+
+void Aircraft::Cruise::BHPTable::calculate(double& mass, double& isaoffs, double& pa, double& bhp, double& tas, double& ff) const
+{
+	double v[nrlevels] = { mass, isaoffs, pa, bhp };
+	calculate(0, 0, m_keys[0].size(), v, tas, ff);
+	mass = v[0];
+	isaoffs = v[1];
+	pa = v[2];
+	bhp = v[3];
+}
+
+void Aircraft::Cruise::BHPTable::calculate_child(unsigned int level, unsigned int i, double *v, double& tas, double& ff) const
+{
+	if (level + 1 >= nrlevels) {
+		tas = m_tas[i];
+		ff = m_ff[i];
 		return;
 	}
-	double lbhp(bhp), ltas(tas), lff(ff);
-	calculate(il, lbhp, ltas, lff);
-	double ubhp(bhp), utas(tas), uff(ff);
-	calculate(iu, ubhp, utas, uff);
-	bhp = ubhp * t + lbhp * (1 - t);
-	tas = utas * t + ltas * (1 - t);
-	ff = uff * t + lff * (1 - t);
+	calculate(level + 1, m_start[level][i], m_start[level][i + 1], v, tas, ff);
 }
 
-void Aircraft::Cruise::calculate(bhpaltmap_t::const_iterator it, double& bhp, double& tas, double& ff) const
+void Aircraft::Cruise::BHPTable::calculate(unsigned int level, unsigned int b, unsigned int e, double *v, double& tas, double& ff) const
 {
-	if (std::isnan(bhp)) {
-		bhp = tas = ff = std::numeric_limits<double>::quiet_NaN();
+	const double x(v[level]);
+	if (std::isnan(x)) {
+		for (unsigned int l = level; l < nrlevels; ++l)
+			v[l] = std::numeric_limits<double>::quiet_NaN();
+		tas = ff = std::numeric_limits<double>::quiet_NaN();
 		return;
 	}
-	bhpbhpmap_t::const_iterator iu(it->second.lower_bound(bhp));
-	if (iu == it->second.end()) {
-		if (iu == it->second.begin()) {
-			bhp = tas = ff = std::numeric_limits<double>::quiet_NaN();
+	const std::vector<double>& keys(m_keys[level]);
+	unsigned int iu(std::lower_bound(keys.begin() + b, keys.begin() + e, x) - keys.begin());
+	if (iu == e) {
+		if (iu == b) {
+			for (unsigned int l = level; l < nrlevels; ++l)
+				v[l] = std::numeric_limits<double>::quiet_NaN();
+			tas = ff = std::numeric_limits<double>::quiet_NaN();
 			return;
 		}
 		--iu;
-		bhp = iu->first;
-		tas = iu->second.get_tas();
-		ff = iu->second.get_fuelflow();
+		v[level] = keys[iu];
+		calculate_child(level, iu, v, tas, ff);
 		return;
 	}
-	bhpbhpmap_t::const_iterator il(iu);
-	if (iu == it->second.begin()) {
+	unsigned int il(iu);
+	if (iu == b) {
 		++iu;
-		if (iu == it->second.end()) {
-			bhp = il->first;
-			tas = il->second.get_tas();
-			ff = il->second.get_fuelflow();
+		if (iu == e) {
+			v[level] = keys[il];
+			calculate_child(level, il, v, tas, ff);
 			return;
 		}
 	} else {
 		--il;
 	}
-	double t((bhp - il->first) / (iu->first - il->first));
+	double t((x - keys[il]) / (keys[iu] - keys[il]));
 	if (t <= 0) {
-		tas = il->second.get_tas();
-		ff = il->second.get_fuelflow();
+		calculate_child(level, il, v, tas, ff);
 		return;
 	}
 	if (t >= 1) {
-		tas = iu->second.get_tas();
-		ff = iu->second.get_fuelflow();
+		calculate_child(level, iu, v, tas, ff);
 		return;
 	}
-	tas = iu->second.get_tas() * t + il->second.get_tas() * (1 - t);
-	ff = iu->second.get_fuelflow() * t + il->second.get_fuelflow() * (1 - t);
+	double lv[nrlevels], uv[nrlevels], ltas, lff, utas, uff;
+	for (unsigned int l = level; l < nrlevels; ++l)
+		lv[l] = uv[l] = v[l];
+	calculate_child(level, il, lv, ltas, lff);
+	calculate_child(level, iu, uv, utas, uff);
+	for (unsigned int l = level + 1; l < nrlevels; ++l)
+		v[l] = uv[l] * t + lv[l] * (1 - t);
+	tas = utas * t + ltas * (1 - t);
+	ff = uff * t + lff * (1 - t);
 }
 
 Aircraft::Cruise::Curve::flags_t Aircraft::Cruise::calculate(curves_t::const_iterator it, double& tas, double& ff, double& pa, double& mass, double& isaoffs, CruiseEngineParams& ep) const
@@ -7067,8 +7117,8 @@ void Aircraft::Cruise::calculate(propulsion_t prop, double& tas, double& fuelflo
 		double bhp(ep.get_bhp()), rpm(ep.get_rpm()), mp(ep.get_mp());
 		if (std::isnan(bhp) && !std::isnan(rpm))
 			m_pistonpower.calculate(pa, isaoffs, bhp, rpm, mp);
-		if (!std::isnan(bhp) && !m_bhpmap.empty()) {
-			calculate(mass, isaoffs, pa, bhp, tas, fuelflow);
+		if (!std::isnan(bhp) && !m_bhptable.empty()) {
+			m_bhptable.calculate(mass, isaoffs, pa, bhp, tas, fuelflow);
 			double pa1(pa), isaoffs1(isaoffs), bhp1(bhp);
 			m_pistonpower.calculate(pa1, isaoffs1, bhp1, rpm, mp);
 			ep.set_bhp(bhp);
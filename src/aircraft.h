@@ -22,6 +22,7 @@
 #include <limits>
 #include <cmath>
 #include <set>
+#include <list>
 #include <glibmm.h>
 #include <libxml++/libxml++.h>
 
@@ -885,6 +886,43 @@ public:
 		double m_fuelfactor;
 		double m_distfactor;
 
+		// memoizes the mass/atmosphere adapted curves; copies start out empty
+		class CalcCache {
+		public:
+			CalcCache(void) {}
+			CalcCache(const CalcCache& x) {}
+			CalcCache& operator=(const CalcCache& x) { clear(); return *this; }
+			// round the parameters to the cache granularity: mass 1, ISA offset and QNH 0.1
+			static void quantise(double& mass, double& isaoffs, double& qnh);
+			bool find(ClimbDescent& cd, const std::string& name, double mass, double isaoffs, double qnh);
+			void insert(const ClimbDescent& cd, const std::string& name, double mass, double isaoffs, double qnh);
+			void clear(void);
+
+		protected:
+			class Key {
+			public:
+				Key(const std::string& name, double mass, double isaoffs, double qnh);
+				int compare(const Key& x) const;
+				bool operator<(const Key& x) const { return compare(x) < 0; }
+
+			protected:
+				std::string m_name;
+				int64_t m_mass;
+				int64_t m_isaoffset;
+				int64_t m_qnh;
+			};
+
+			static const unsigned int max_entries = 1024;
+			// least recently used entries are at the back
+			typedef std::list<Key> lru_t;
+			typedef std::map<Key, std::pair<ClimbDescent,lru_t::iterator> > cache_t;
+			cache_t m_cache;
+			lru_t m_lru;
+			Glib::Threads::Mutex m_mutex;
+		};
+
+		mutable CalcCache m_calccache;
+
 		ClimbDescent calculate(const massmap_t& ci, double mass, double isaoffs, double qnh) const;
 		ClimbDescent calculate(const isamap_t& mi, double isaoffs, double qnh) const;
 		const ClimbDescent *find_single_curve(void) const;
@@ -1345,6 +1383,27 @@ public:
 			double m_fuelflow;
 		};
 
+		// flattened mass / isaoffs / pa / bhp tree, stored level by level in contiguous arrays
+		class BHPTable {
+		public:
+			BHPTable(void);
+			void clear(void);
+			bool empty(void) const { return m_keys[0].empty(); }
+			void add(double mass, double isaoffs, double pa, double bhp, double tas, double ff);
+			void calculate(double& mass, double& isaoffs, double& pa, double& bhp, double& tas, double& ff) const;
+
+		protected:
+			static const unsigned int nrlevels = 4;
+			// m_keys[l][i]: key of node i at level l; its children are m_start[l][i] .. m_start[l][i+1]-1 at level l+1
+			std::vector<double> m_keys[nrlevels];
+			std::vector<unsigned int> m_start[nrlevels - 1];
+			std::vector<double> m_tas;
+			std::vector<double> m_ff;
+
+			void calculate(unsigned int level, unsigned int b, unsigned int e, double *v, double& tas, double& ff) const;
+			void calculate_child(unsigned int level, unsigned int i, double *v, double& tas, double& ff) const;
+		};
+
 		class PistonPowerBHPRPM {
 		public:
 			PistonPowerBHPRPM(double bhp, double rpm);
@@ -1568,7 +1627,7 @@ public:
 		typedef std::map<double,bhpbhpmap_t> bhpaltmap_t;
 		typedef std::map<double,bhpaltmap_t> bhpisamap_t;
 		typedef std::map<double,bhpisamap_t> bhpmap_t;
-		bhpmap_t m_bhpmap;
+		BHPTable m_bhptable;
 		typedef std::map<double, Curve> isamap_t;
 		typedef std::map<double, isamap_t> massmap_t;
 		typedef std::map<std::string, massmap_t> curves_t;
@@ -1583,11 +1642,6 @@ public:
 		double m_bhpfactor;
 		double m_massfactor;
 
-		void calculate(double& mass, double& isaoffs, double& pa, double& bhp, double& tas, double& ff) const;
-		void calculate(bhpmap_t::const_iterator it, double& isaoffs, double& pa, double& bhp, double& tas, double& ff) const;
-		void calculate(bhpisamap_t::const_iterator it, double& pa, double& bhp, double& tas, double& ff) const;
-		void calculate(bhpaltmap_t::const_iterator it, double& bhp, double& tas, double& ff) const;
-
 		Curve::flags_t calculate(curves_t::const_iterator it, double& tas, double& fuelflow, double& pa, double& mass, double& isaoffs, CruiseEngineParams& ep) const;
 		Curve::flags_t calculate(massmap_t::const_iterator it, double& tas, double& fuelflow, double& pa, double& isaoffs, CruiseEngineParams& ep) const;
 		std::pair<double,double> get_bhp_range(curves_t::const_iterator it) const;
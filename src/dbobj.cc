@@ -22,6 +22,8 @@
 #include "dbobj.h"
 #include "dbser.h"
 
+#include <algorithm>
+
 Glib::ustring Conversions::time_str(time_t t)
 {
 	struct tm tm;
@@ -369,6 +371,8 @@ void DbBaseCommon::close(void)
 	if (m_open != openstate_closed)
 		m_db.close();
 	m_open = openstate_closed;
+	if (m_memindex)
+		m_memindex->invalidate();
 }
 
 void DbBaseCommon::detach(void)
@@ -461,6 +465,180 @@ void DbBaseCommon::interrupt(void)
 	sqlite3_interrupt(m_db.db());
 }
 
+void DbBaseCommon::set_memindex(bool ena)
+{
+	if (!ena) {
+		m_memindex.reset();
+		return;
+	}
+	if (!m_memindex)
+		m_memindex.reset(new MemIndex());
+}
+
+DbBaseCommon::MemIndex::MemIndex(void)
+	: m_area(false), m_hasaux(false), m_valid(false)
+{
+	m_dataversion[0] = m_dataversion[1] = -1;
+}
+
+void DbBaseCommon::MemIndex::clear(void)
+{
+	m_id.clear();
+	m_aux.clear();
+	m_swlon.clear();
+	m_swlat.clear();
+	m_nelon.clear();
+	m_nelat.clear();
+	m_tiles.clear();
+	for (unsigned int i = 0; i < field_count; ++i)
+		m_text[i].clear();
+	m_valid = false;
+}
+
+int64_t DbBaseCommon::MemIndex::get_dataversion(sqlite3x::sqlite3_connection& db, bool aux)
+{
+	// changes whenever another connection, e.g. an import in another process, commits
+	try {
+		sqlite3x::sqlite3_command cmd(db, aux ? "PRAGMA aux.data_version;" : "PRAGMA main.data_version;");
+		return cmd.executeint64();
+	} catch (...) {
+		return -1;
+	}
+}
+
+bool DbBaseCommon::MemIndex::is_current(sqlite3x::sqlite3_connection& db) const
+{
+	for (unsigned int i = 0; i < (m_hasaux ? 2U : 1U); ++i) {
+		if (m_dataversion[i] == -1)
+			continue;
+		if (get_dataversion(db, i) != m_dataversion[i])
+			return false;
+	}
+	return true;
+}
+
+std::string DbBaseCommon::MemIndex::casefold(const std::string& s)
+{
+	// same folding as sqlite NOCASE collation: ASCII only
+	std::string r(s);
+	for (std::string::iterator i(r.begin()), e(r.end()); i != e; ++i)
+		if (*i >= 'a' && *i <= 'z')
+			*i += 'A' - 'a';
+	return r;
+}
+
+void DbBaseCommon::MemIndex::load(sqlite3x::sqlite3_connection& db, const char *table, const char *delfield, const char *order, bool area, bool aux)
+{
+	clear();
+	m_area = area;
+	m_hasaux = aux;
+	m_dataversion[0] = get_dataversion(db, false);
+	m_dataversion[1] = aux ? get_dataversion(db, true) : -1;
+	const char *coordcols(area ? "ICAO,NAME,SWLON,SWLAT,NELON,NELAT" : "ICAO,NAME,LON,LAT,LON,LAT");
+	std::string qs;
+	if (aux)
+		qs += std::string("SELECT ID,1,SRCID,") + coordcols + " FROM aux." + table + " WHERE " + delfield +
+			" NOT IN (SELECT " + delfield + " FROM " + table + "_deleted) UNION ";
+	qs += std::string("SELECT ID,0,SRCID,") + coordcols + " FROM " + table;
+	if (order)
+		qs += std::string(" ORDER BY ") + order;
+	qs += ";";
+	sqlite3x::sqlite3_command cmd(db, qs);
+	sqlite3x::sqlite3_cursor cursor(cmd.executecursor());
+	while (cursor.step()) {
+		unsigned int idx(m_id.size());
+		m_id.push_back(cursor.getint64(0));
+		m_aux.push_back(!!cursor.getint(1));
+		m_text[field_icao].push_back(textindex_t::value_type(casefold(cursor.getstring(3)), idx));
+		m_text[field_name].push_back(textindex_t::value_type(casefold(cursor.getstring(4)), idx));
+		m_swlon.push_back(cursor.getint(5));
+		m_swlat.push_back(cursor.getint(6));
+		m_nelon.push_back(cursor.getint(7));
+		m_nelat.push_back(cursor.getint(8));
+		Rect r(get_rect(idx));
+		int64_t lat0(((int64_t)r.get_south()) >> tile_shift), lat1(((int64_t)r.get_north()) >> tile_shift);
+		int64_t lon0(((int64_t)r.get_west()) >> tile_shift), lon1(r.get_east_unwrapped() >> tile_shift);
+		lon1 = std::min(lon1, lon0 + tile_mask);
+		for (int64_t lat = lat0; lat <= lat1; ++lat)
+			for (int64_t lon = lon0; lon <= lon1; ++lon)
+				m_tiles[((lat & tile_mask) << (32 - tile_shift)) | (lon & tile_mask)].push_back(idx);
+	}
+	for (unsigned int i = 0; i < field_count; ++i)
+		std::sort(m_text[i].begin(), m_text[i].end());
+	m_valid = true;
+	if (false)
+		std::cerr << "MemIndex: " << table << ": " << m_id.size() << " rows, " << m_tiles.size() << " tiles" << std::endl;
+}
+
+DbBaseCommon::MemIndex::indexvector_t DbBaseCommon::MemIndex::find_nearest(const Point& pt, const Rect& r, unsigned int limit) const
+{
+	indexvector_t idx;
+	{
+		int64_t lat0(((int64_t)r.get_south()) >> tile_shift), lat1(((int64_t)r.get_north()) >> tile_shift);
+		int64_t lon0(((int64_t)r.get_west()) >> tile_shift), lon1(r.get_east_unwrapped() >> tile_shift);
+		lon1 = std::min(lon1, lon0 + tile_mask);
+		for (int64_t lat = lat0; lat <= lat1; ++lat)
+			for (int64_t lon = lon0; lon <= lon1; ++lon) {
+				tiles_t::const_iterator ti(m_tiles.find(((lat & tile_mask) << (32 - tile_shift)) | (lon & tile_mask)));
+				if (ti == m_tiles.end())
+					continue;
+				idx.insert(idx.end(), ti->second.begin(), ti->second.end());
+			}
+		std::sort(idx.begin(), idx.end());
+		idx.erase(std::unique(idx.begin(), idx.end()), idx.end());
+	}
+	typedef std::vector<std::pair<uint64_t,unsigned int> > distvector_t;
+	distvector_t dist;
+	dist.reserve(idx.size());
+	for (indexvector_t::const_iterator i(idx.begin()), e(idx.end()); i != e; ++i) {
+		if (m_area) {
+			Rect r1(get_rect(*i));
+			if (!r1.is_intersect(r))
+				continue;
+			dist.push_back(distvector_t::value_type(r1.simple_distance_rel(pt), *i));
+			continue;
+		}
+		Point pt1(m_swlon[*i], m_swlat[*i]);
+		if (!r.is_inside(pt1))
+			continue;
+		dist.push_back(distvector_t::value_type(pt1.simple_distance_rel(pt), *i));
+	}
+	if (limit && limit < dist.size()) {
+		std::partial_sort(dist.begin(), dist.begin() + limit, dist.end());
+		dist.resize(limit);
+	} else {
+		std::sort(dist.begin(), dist.end());
+	}
+	idx.clear();
+	idx.reserve(dist.size());
+	for (distvector_t::const_iterator i(dist.begin()), e(dist.end()); i != e; ++i)
+		idx.push_back(i->second);
+	return idx;
+}
+
+DbBaseCommon::MemIndex::indexvector_t DbBaseCommon::MemIndex::find_text(field_t fld, const std::string& pattern, bool prefix, unsigned int limit) const
+{
+	indexvector_t idx;
+	if (fld >= field_count)
+		return idx;
+	std::string pat(casefold(pattern));
+	const textindex_t& ti(m_text[fld]);
+	for (textindex_t::const_iterator i(std::lower_bound(ti.begin(), ti.end(), textindex_t::value_type(pat, 0))), e(ti.end()); i != e; ++i) {
+		if (prefix) {
+			if (i->first.compare(0, pat.size(), pat))
+				break;
+		} else if (i->first != pat) {
+			break;
+		}
+		idx.push_back(i->second);
+	}
+	// row index order is database order_field order
+	std::sort(idx.begin(), idx.end());
+	if (limit && limit < idx.size())
+		idx.resize(limit);
+	return idx;
+}
+
 std::string DbBaseCommon::filename_to_uri(const std::string& fn)
 {
 	std::string fn2;
@@ -734,6 +912,7 @@ template<class T> void DbBase<T>::take(sqlite3 * dbh)
 
 template<class T> void DbBase<T>::purgedb(void)
 {
+	memindex_invalidate();
 	drop_indices();
 	drop_tables();
 	create_tables();
@@ -878,8 +1057,82 @@ template <class T> void DbBase<T>::for_each_by_rect(ForEach & cb, const Rect & r
 	}
 }
 
+template <class T> bool DbBase<T>::memindex_revalidate(void)
+{
+	if (!m_memindex || m_open == openstate_closed)
+		return false;
+	bool aux(m_open == openstate_auxopen);
+	if (m_memindex->is_valid(aux)) {
+		if (m_memindex->is_current(m_db))
+			return true;
+		if (true)
+			std::cerr << "DbBase: " << main_table_name << " changed by another process, reloading memory index" << std::endl;
+	}
+	try {
+		m_memindex->load(m_db, main_table_name, delete_field, order_field, area_data, aux);
+	} catch (const std::exception& e) {
+		std::cerr << "DbBase: cannot load memory index for " << main_table_name << ": " << e.what() << std::endl;
+		m_memindex->clear();
+		return false;
+	}
+	return m_memindex->is_valid(aux);
+}
+
+template <class T> typename DbBase<T>::elementvector_t DbBase<T>::memindex_load(const typename MemIndex::indexvector_t& idx, unsigned int loadsubtables)
+{
+	// one query per table for all rows, then restore the index order
+	typedef std::map<std::pair<int64_t,bool>,unsigned int> posmap_t;
+	posmap_t pos;
+	std::ostringstream ids[2];
+	for (unsigned int i = 0; i < idx.size(); ++i) {
+		int64_t id(m_memindex->get_id(idx[i]));
+		bool aux(m_memindex->is_aux(idx[i]));
+		if (!pos.insert(posmap_t::value_type(posmap_t::key_type(id, aux), i)).second)
+			continue;
+		if (ids[aux].tellp() > 0)
+			ids[aux] << ',';
+		ids[aux] << id;
+	}
+	elementvector_t el(idx.size());
+	for (unsigned int aux = 0; aux < 2; ++aux) {
+		std::string idlist(ids[aux].str());
+		if (idlist.empty())
+			continue;
+		std::string qs;
+		if (aux) {
+			if (m_open != openstate_auxopen)
+				continue;
+			qs = "SELECT " + std::string(element_t::db_aux_query_string) + " FROM aux." + main_table_name + " WHERE ID IN (" + idlist + ")" +
+				" AND " + delete_field + " NOT IN (SELECT " + delete_field + " FROM " + main_table_name + "_deleted);";
+		} else {
+			qs = "SELECT " + std::string(element_t::db_query_string) + " FROM " + main_table_name + " WHERE ID IN (" + idlist + ");";
+		}
+		sqlite3x::sqlite3_command cmd(m_db, qs);
+		sqlite3x::sqlite3_cursor cursor(cmd.executecursor());
+		for (;;) {
+			element_t e;
+			e.load(cursor, m_db, loadsubtables);
+			if (!e.is_valid())
+				break;
+			posmap_t::const_iterator pi(pos.find(posmap_t::key_type(e.get_id(), e.get_table() == element_t::table_aux)));
+			if (pi != pos.end())
+				el[pi->second] = e;
+		}
+	}
+	elementvector_t ret;
+	ret.reserve(el.size());
+	for (typename elementvector_t::const_iterator i(el.begin()), e(el.end()); i != e; ++i)
+		if (i->is_valid())
+			ret.push_back(*i);
+	return ret;
+}
+
 template <class T> typename DbBase<T>::elementvector_t DbBase<T>::find(const std::string& fldname, const std::string& pattern, char escape, comp_t comp, unsigned int limit, unsigned int loadsubtables)
 {
+	if ((comp == DbQueryInterfaceCommon::comp_startswith || comp == DbQueryInterfaceCommon::comp_exact) &&
+	    (fldname == "ICAO" || fldname == "NAME") && memindex_revalidate())
+		return memindex_load(m_memindex->find_text(fldname == "ICAO" ? MemIndex::field_icao : MemIndex::field_name,
+							   pattern, comp == DbQueryInterfaceCommon::comp_startswith, limit), loadsubtables);
 	std::string qsfld;
 	Glib::ustring pat(pattern);
 	switch (comp) {
@@ -945,6 +1198,98 @@ template <class T> typename DbBase<T>::elementvector_t DbBase<T>::find(const std
 	return ret;
 }
 
+template <class T> typename DbBase<T>::elementvector_t DbBase<T>::find_by_field(const std::string& fldname, const std::vector<std::string>& patterns, comp_t comp, unsigned int loadsubtables)
+{
+	// stay well below the sqlite host parameter limit
+	static const std::vector<std::string>::size_type maxpatterns = 256;
+	if (patterns.size() > maxpatterns) {
+		elementvector_t ret;
+		for (std::vector<std::string>::size_type i(0), n(patterns.size()); i < n; i += maxpatterns) {
+			elementvector_t r(find_by_field(fldname, std::vector<std::string>(patterns.begin() + i, patterns.begin() + std::min(n, i + maxpatterns)),
+							comp, loadsubtables));
+			ret.insert(ret.end(), r.begin(), r.end());
+		}
+		return ret;
+	}
+	if (patterns.empty())
+		return elementvector_t();
+	if ((comp == DbQueryInterfaceCommon::comp_startswith || comp == DbQueryInterfaceCommon::comp_exact) &&
+	    (fldname == "ICAO" || fldname == "NAME") && memindex_revalidate()) {
+		typename MemIndex::indexvector_t idx;
+		for (std::vector<std::string>::const_iterator pi(patterns.begin()), pe(patterns.end()); pi != pe; ++pi) {
+			typename MemIndex::indexvector_t idx1(m_memindex->find_text(fldname == "ICAO" ? MemIndex::field_icao : MemIndex::field_name,
+										    *pi, comp == DbQueryInterfaceCommon::comp_startswith, 0));
+			idx.insert(idx.end(), idx1.begin(), idx1.end());
+		}
+		std::sort(idx.begin(), idx.end());
+		idx.erase(std::unique(idx.begin(), idx.end()), idx.end());
+		return memindex_load(idx, loadsubtables);
+	}
+	std::vector<Glib::ustring> pat(patterns.begin(), patterns.end());
+	std::string qsfld("(");
+	for (std::vector<Glib::ustring>::size_type i(0), n(pat.size()); i < n; ++i) {
+		std::string par;
+		{
+			std::ostringstream oss;
+			oss << '?' << (i + 1);
+			par = oss.str();
+		}
+		if (i)
+			qsfld += " OR ";
+		switch (comp) {
+		default:
+		case DbQueryInterfaceCommon::comp_startswith:
+			qsfld += std::string("((") + fldname + ">=" + par + " COLLATE NOCASE) AND (" + fldname + "<upperbound(" + par + ") COLLATE NOCASE))";
+			break;
+
+		case DbQueryInterfaceCommon::comp_exact:
+			qsfld += std::string("(") + fldname + "=" + par + " COLLATE NOCASE)";
+			break;
+
+		case DbQueryInterfaceCommon::comp_exact_casesensitive:
+			qsfld += std::string("(") + fldname + "=" + par + ")";
+			break;
+
+		case DbQueryInterfaceCommon::comp_contains:
+			pat[i] = std::string("%") + quote_text_for_like(pat[i], '!') + "%";
+			qsfld += std::string("(") + fldname + " LIKE " + par + " ESCAPE '!')";
+			break;
+
+		case DbQueryInterfaceCommon::comp_like:
+			qsfld += std::string("(") + fldname + " LIKE " + par + ")";
+			break;
+		}
+	}
+	qsfld += ")";
+	std::string qs;
+	if (m_open == openstate_auxopen) {
+		qs += "SELECT " + std::string(element_t::db_aux_query_string) + " FROM aux." + main_table_name + " WHERE " + qsfld +
+		      " AND " + delete_field + " NOT IN (SELECT " + delete_field + " FROM " + main_table_name + "_deleted) UNION ";
+	}
+	qs += "SELECT " + std::string(element_t::db_query_string) + " FROM " + main_table_name + " WHERE " + qsfld;
+	if (order_field) {
+		qs += " ORDER BY ";
+		qs += order_field;
+	}
+	qs += ";";
+	if (false)
+		std::cerr << "sql: " << qs << std::endl;
+	sqlite3x::sqlite3_command cmd(m_db, qs);
+	for (std::vector<Glib::ustring>::size_type i(0), n(pat.size()); i < n; ++i)
+		cmd.bind(i + 1, pat[i]);
+	elementvector_t ret;
+	sqlite3x::sqlite3_cursor cursor = cmd.executecursor();
+	for (;;) {
+		ret.push_back(element_t());
+		ret.back().load(cursor, m_db, loadsubtables);
+		if (ret.back().is_valid())
+			continue;
+		ret.pop_back();
+		break;
+	}
+	return ret;
+}
+
 template <class T> typename DbBase<T>::elementvector_t DbBase<T>::find_by_text(const std::string& pattern, char escape, comp_t comp,  unsigned int limit, unsigned int loadsubtables)
 {
 	std::string qsfld;
@@ -1249,6 +1594,8 @@ template <class T> typename DbBase<T>::elementvector_t DbBase<T>::find_by_rect(c
 
 template <class T> typename DbBase<T>::elementvector_t DbBase<T>::find_nearest(const Point & pt, const Rect & r, unsigned int limit, unsigned int loadsubtables)
 {
+	if (memindex_revalidate())
+		return memindex_load(m_memindex->find_nearest(pt, r, limit), loadsubtables);
 	const char *sortcol(area_data ? "(simplerectdist(SWLON,SWLAT,NELON,NELAT,?5,?6)) AS 'SORTCOL'" : "(simpledist(LON,LAT,?5,?6)) AS 'SORTCOL'");
 	std::string qs;
 	if (m_open == openstate_auxopen) {
@@ -2330,6 +2677,65 @@ template <class T> typename PGDbBase<T>::elementvector_t PGDbBase<T>::find(const
 	return ret;
 }
 
+template <class T> typename PGDbBase<T>::elementvector_t PGDbBase<T>::find_by_field(const std::string& fldname, const std::vector<std::string>& patterns, comp_t comp, unsigned int loadsubtables)
+{
+	if (patterns.empty())
+		return elementvector_t();
+	pqxx::read_transaction w(m_conn);
+	std::string qsfld("(");
+	for (std::vector<std::string>::const_iterator pb(patterns.begin()), pi(pb), pe(patterns.end()); pi != pe; ++pi) {
+		if (pi != pb)
+			qsfld += " OR ";
+		switch (comp) {
+		default:
+		case DbQueryInterfaceCommon::comp_startswith:
+			qsfld += std::string("((") + fldname + "::ext.CITEXT>=" + w.quote(*pi) + "::ext.CITEXT) AND (" + fldname +
+				"::ext.CITEXT<aviationdb.upperbound(" + w.quote(*pi) + ")::ext.CITEXT))";
+			break;
+
+		case DbQueryInterfaceCommon::comp_exact:
+			qsfld += std::string("(") + fldname + "::ext.CITEXT=" + w.quote(*pi) + "::ext.CITEXT)";
+			break;
+
+		case DbQueryInterfaceCommon::comp_exact_casesensitive:
+			qsfld += std::string("(") + fldname + "=" + w.quote(*pi) + ")";
+			break;
+
+		case DbQueryInterfaceCommon::comp_contains:
+		{
+			std::string pat(std::string("%") + quote_text_for_like(*pi, '!') + "%");
+			qsfld += std::string("(") + fldname + "::ext.CITEXT ILIKE " + w.quote(pat) + "::ext.CITEXT ESCAPE '!')";
+			break;
+		}
+
+		case DbQueryInterfaceCommon::comp_like:
+			qsfld += std::string("(") + fldname + "::ext.CITEXT ILIKE " + w.quote(*pi) + "::ext.CITEXT)";
+			break;
+		}
+	}
+	qsfld += ")";
+	std::string qs;
+	qs = "SELECT " + std::string(element_t::db_query_string) + " FROM " + main_table_name + " WHERE " + qsfld;
+	if (order_field) {
+		qs += " ORDER BY ";
+		qs += order_field;
+	}
+	qs += ";";
+	if (false)
+		std::cerr << "sql: " << qs << std::endl;
+	pqxx::result r(w.exec(qs));
+	elementvector_t ret;
+	for (pqxx::result::const_iterator ri(r.begin()), re(r.end()); ri != re; ++ri) {
+		ret.push_back(element_t());
+		ret.back().load(*ri, w, loadsubtables);
+		if (ret.back().is_valid())
+			continue;
+		ret.pop_back();
+		break;
+	}
+	return ret;
+}
+
 template <class T> typename PGDbBase<T>::elementvector_t PGDbBase<T>::loadid(uint64_t startid, table_t table, const std::string& order, unsigned int limit, unsigned int loadsubtables)
 {
 	elementvector_t ret;
@@ -15,8 +15,11 @@
 
 #include <limits>
 #include <iostream>
+#include <fstream>
 #include <list>
 #include <set>
+#include <map>
+#include <memory>
 #include <glibmm.h>
 #include <gdkmm.h>
 #include <sqlite3x.hpp>
@@ -2547,6 +2550,8 @@ public:
 	virtual void for_each(ForEach& cb, bool include_aux = true, unsigned int loadsubtables = element_t::subtables_all) = 0;
 	virtual void for_each_by_rect(ForEach& cb, const Rect& r, bool include_aux = true, unsigned int loadsubtables = element_t::subtables_all) = 0;
 	virtual elementvector_t find_by_text(const std::string& pattern, char escape, comp_t comp = comp_exact, unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all) = 0;
+	// elements whose ICAO or NAME field matches any of the patterns, in a single query
+	virtual elementvector_t find_by_field(const std::string& fldname, const std::vector<std::string>& patterns, comp_t comp = comp_exact, unsigned int loadsubtables = element_t::subtables_all) = 0;
 	virtual elementvector_t find_by_time(time_t fromtime, time_t totime, unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all) = 0;
 	virtual elementvector_t find_by_rect(const Rect& r, unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all) = 0;
 	virtual elementvector_t find_nearest(const Point& pt, const Rect& r, unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all) = 0;
@@ -2650,6 +2655,11 @@ public:
 	bool is_open(void) const { return m_open != openstate_closed; }
 	bool is_aux_attached(void) const { return m_open == openstate_auxopen; }
 	void interrupt(void);
+	// keep coordinates and ICAO/NAME of all rows in memory and answer
+	// find_nearest and ICAO/NAME prefix/exact searches from there;
+	// only for tables with ICAO and NAME columns
+	void set_memindex(bool ena = true);
+	bool is_memindex(void) const { return !!m_memindex; }
 	// for the benefit of utilities that need special sql statements;
 	// not for normal use
 	sqlite3x::sqlite3_connection& get_db(void) { return m_db; }
@@ -2658,6 +2668,50 @@ public:
 protected:
 	class DbSchemaArchiver;
 
+	class MemIndex {
+	public:
+		typedef std::vector<unsigned int> indexvector_t;
+		typedef enum {
+			field_icao,
+			field_name,
+			field_count
+		} field_t;
+
+		MemIndex(void);
+		void clear(void);
+		void load(sqlite3x::sqlite3_connection& db, const char *table, const char *delfield, const char *order, bool area, bool aux);
+		bool is_valid(bool aux) const { return m_valid && m_hasaux == aux; }
+		// false if another connection committed to the database files since load
+		bool is_current(sqlite3x::sqlite3_connection& db) const;
+		void invalidate(void) { m_valid = false; }
+		indexvector_t find_nearest(const Point& pt, const Rect& r, unsigned int limit) const;
+		indexvector_t find_text(field_t fld, const std::string& pattern, bool prefix, unsigned int limit) const;
+		int64_t get_id(unsigned int i) const { return m_id[i]; }
+		bool is_aux(unsigned int i) const { return m_aux[i]; }
+
+	protected:
+		static const unsigned int tile_shift = 24;
+		static const unsigned int tile_mask = (1U << (32 - tile_shift)) - 1U;
+		typedef std::map<unsigned int,indexvector_t> tiles_t;
+		typedef std::vector<std::pair<std::string,unsigned int> > textindex_t;
+		std::vector<int64_t> m_id;
+		std::vector<bool> m_aux;
+		std::vector<Point::coord_t> m_swlon;
+		std::vector<Point::coord_t> m_swlat;
+		std::vector<Point::coord_t> m_nelon;
+		std::vector<Point::coord_t> m_nelat;
+		tiles_t m_tiles;
+		textindex_t m_text[field_count];
+		int64_t m_dataversion[2];
+		bool m_area;
+		bool m_hasaux;
+		bool m_valid;
+
+		static std::string casefold(const std::string& s);
+		static int64_t get_dataversion(sqlite3x::sqlite3_connection& db, bool aux);
+		Rect get_rect(unsigned int i) const { return Rect(Point(m_swlon[i], m_swlat[i]), Point(m_nelon[i], m_nelat[i])); }
+	};
+
 	typedef enum {
 		openstate_closed,
 		openstate_mainopen,
@@ -2667,6 +2721,7 @@ protected:
 	openstate_t m_open;
 	bool m_has_rtree;
 	bool m_has_aux_rtree;
+	std::unique_ptr<MemIndex> m_memindex;
 
 	static void dbfunc_simpledist(sqlite3_context *ctxt, int, sqlite3_value **values);
 	static void dbfunc_simplerectdist(sqlite3_context *ctxt, int, sqlite3_value **values);
@@ -2710,13 +2765,14 @@ public:
 	element_t operator()(Address addr, unsigned int loadsubtables = element_t::subtables_all) { return operator()(addr.get_id(), addr.get_table(), loadsubtables); }
 	void loadfirst(element_t& e, bool include_aux = true, unsigned int loadsubtables = element_t::subtables_all);
 	void loadnext(element_t& e, bool include_aux = true, unsigned int loadsubtables = element_t::subtables_all);
-	void save(element_t& e) { e.save(m_db, m_has_rtree, m_has_aux_rtree); }
-	void erase(element_t& e) { e.erase(m_db, m_has_rtree, m_has_aux_rtree); }
-	void update_index(element_t& e) { e.update_index(m_db, m_has_rtree, m_has_aux_rtree); }
+	void save(element_t& e) { e.save(m_db, m_has_rtree, m_has_aux_rtree); memindex_invalidate(); }
+	void erase(element_t& e) { e.erase(m_db, m_has_rtree, m_has_aux_rtree); memindex_invalidate(); }
+	void update_index(element_t& e) { e.update_index(m_db, m_has_rtree, m_has_aux_rtree); memindex_invalidate(); }
 
 	void for_each(ForEach& cb, bool include_aux = true, unsigned int loadsubtables = element_t::subtables_all);
 	void for_each_by_rect(ForEach& cb, const Rect& r, bool include_aux = true, unsigned int loadsubtables = element_t::subtables_all);
 	elementvector_t find_by_text(const std::string& pattern, char escape, comp_t comp = DbQueryInterface<T>::comp_exact, unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all);
+	elementvector_t find_by_field(const std::string& fldname, const std::vector<std::string>& patterns, comp_t comp = DbQueryInterface<T>::comp_exact, unsigned int loadsubtables = element_t::subtables_all);
 	elementvector_t find_by_time(time_t fromtime, time_t totime, unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all);
 	elementvector_t find_by_rect(const Rect& r, unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all);
 	elementvector_t find_nearest(const Point& pt, const Rect& r, unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all);
@@ -2737,6 +2793,9 @@ protected:
 
 	std::string get_area_select_string(bool auxtable, const Rect& r, const char *sortcol = 0);
 	elementvector_t find(const std::string& fldname, const std::string& pattern, char escape, comp_t comp = DbQueryInterface<T>::comp_exact, unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all);
+	void memindex_invalidate(void) { if (m_memindex) m_memindex->invalidate(); }
+	bool memindex_revalidate(void);
+	elementvector_t memindex_load(const typename MemIndex::indexvector_t& idx, unsigned int loadsubtables);
 	elementvector_t loadid(uint64_t startid = 0, table_t table = element_t::table_main, const std::string& order = "", unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all);
 	void open(const Glib::ustring& path, const char *dbfilename);
 	void open_readonly(const Glib::ustring& path, const char *dbfilename);
@@ -2793,6 +2852,8 @@ public:
 	elementvector_t find_by_end_name(const std::string& pattern, char escape = 0, comp_t comp = comp_exact, unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all) { return find("ENAME", pattern, escape, comp, limit, loadsubtables); }
 	elementvector_t find_by_name(const std::string& pattern, char escape = 0, comp_t comp = comp_exact, unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all) { return find("NAME", pattern, escape, comp, limit, loadsubtables); }
 	elementvector_t find_by_area(const Rect& r, unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all);
+	// update terrain and corridor elevation of existing main table airways in one transaction
+	void save_elev(const elementvector_t& ev);
 
 protected:
 	std::string get_airways_area_select_string(bool auxtable, const Rect& r, const char *sortcol = 0);
@@ -2829,6 +2890,8 @@ public:
 	elementvector_t find_by_icao(const std::string& pattern, char escape = 0, comp_t comp = comp_exact, unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all) { return find("ICAO", pattern, escape, comp, limit, loadsubtables); }
 	elementvector_t find_by_name(const std::string& pattern, char escape = 0, comp_t comp = comp_exact, unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all) { return find("NAME", pattern, escape, comp, limit, loadsubtables); }
 	elementvector_t find_by_ident(const std::string& pattern, char escape = 0, comp_t comp = comp_exact, unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all) { return find("IDENT", pattern, escape, comp, limit, loadsubtables); }
+	// update ground elevation of existing main table airspaces in one transaction
+	void save_gndelev(const elementvector_t& ev);
 };
 
 class MapelementsDb : public DbBase<DbBaseElements::Mapelement> {
@@ -2889,6 +2952,8 @@ public:
 
 	void take(LabelsDb& db) { DbBase<element_t>::take(db.m_db.take()); }
 	elementvector_t find_mutable_by_metric(unsigned int limit = 0, unsigned int offset = 0, unsigned int loadsubtables = element_t::subtables_all);
+	// update coordinate, placement and metric of existing labels in one transaction
+	void save_placement(const elementvector_t& ev);
 };
 
 #ifdef HAVE_PQXX
@@ -2956,6 +3021,7 @@ public:
 	void for_each(ForEach& cb, bool include_aux = true, unsigned int loadsubtables = element_t::subtables_all);
 	void for_each_by_rect(ForEach& cb, const Rect& r, bool include_aux = true, unsigned int loadsubtables = element_t::subtables_all);
 	elementvector_t find_by_text(const std::string& pattern, char escape, comp_t comp = DbQueryInterface<T>::comp_exact, unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all);
+	elementvector_t find_by_field(const std::string& fldname, const std::vector<std::string>& patterns, comp_t comp = DbQueryInterface<T>::comp_exact, unsigned int loadsubtables = element_t::subtables_all);
 	elementvector_t find_by_time(time_t fromtime, time_t totime, unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all);
 	elementvector_t find_by_rect(const Rect& r, unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all);
 	elementvector_t find_nearest(const Point& pt, const Rect& r, unsigned int limit = 0, unsigned int loadsubtables = element_t::subtables_all);
@@ -3109,6 +3175,7 @@ public:
 
 	class BinFileHeader;
 	class TopoCoordinate;
+	class TileWriter;
 
 	class TopoTileCoordinate {
 	public:
@@ -3203,9 +3270,15 @@ public:
 		void unreference(void) const;
 		void load(sqlite3x::sqlite3_cursor& cursor);
 		void save(sqlite3x::sqlite3_connection& db);
+		// save with a blob previously produced by compress; does not check the dirty flag
+		void save(sqlite3x::sqlite3_connection& db, const std::vector<uint8_t>& blob, bool tran = true) const;
+		// deflate the elevation data; the blob is empty for constant tiles
+		void compress(std::vector<uint8_t>& blob) const;
 		tile_index_t get_index(void) const { return m_index; }
 		elev_t get_elev(pixel_index_t index) const;
 		void set_elev(pixel_index_t index, elev_t elev);
+		// little endian elevation data, pixels_per_tile entries
+		const uint8_t *get_data(void) const { return m_elevdata; }
 		elev_t get_minelev(void) const { if (is_minmaxinvalid()) update_minmax(); return m_minelev; }
 		elev_t get_maxelev(void) const { if (is_minmaxinvalid()) update_minmax(); return m_maxelev; }
 		bool is_dirty(void) const { return m_flags & flags_dirty; }
@@ -3340,6 +3413,11 @@ public:
 	minmax_elev_t get_minmax_elev(const PolygonSimple& p);
 	minmax_elev_t get_minmax_elev(const PolygonHole& p);
 	minmax_elev_t get_minmax_elev(const MultiPolygonHole& p);
+	// part of p within one tile; lets batch updaters visit each tile once
+	minmax_elev_t get_minmax_elev(const PolygonHole& p, const Tile& tile);
+	static minmax_elev_t merge_minmax_elev(const minmax_elev_t& a, const minmax_elev_t& b);
+	// tile view, from the bin file if open; safe to call from multiple threads
+	typename Tile::const_ptr_t get_tile(tile_index_t index);
 	ProfilePoint get_profile(const Point& pt, double corridor_nmi);
 	Profile get_profile(const Point& p0, const Point& p1, double corridor_nmi);
 	RouteProfile get_profile(const FPlanRoute& fpl, double corridor_nmi);
@@ -3410,6 +3488,36 @@ public:
 		Tile m_tiles[nr_tiles];
 	};
 
+	// bulk writer for tile importers: saves complete tiles in batched
+	// transactions and optionally streams them into a bin file, bypassing
+	// the tile cache; finish() adds all other database tiles to the bin file
+	class TileWriter {
+	public:
+		TileWriter(TopoDbN& db, const Glib::ustring& binname = "");
+		~TileWriter();
+		bool is_saved(tile_index_t index) const;
+		void save(const Tile& tile, const std::vector<uint8_t>& blob);
+		void save(const Tile& tile);
+		void commit(void);
+		void finish(void);
+		unsigned int get_count(void) const { return m_count; }
+
+	protected:
+		static const unsigned int commit_interval = 64;
+		TopoDbN& m_db;
+		sqlite3x::sqlite3_transaction m_tran;
+		Glib::ustring m_binname;
+		std::unique_ptr<std::ofstream> m_binfile;
+		std::unique_ptr<BinFileHeader> m_binhdr;
+		uint64_t m_binptr;
+		std::vector<bool> m_saved;
+		std::vector<bool> m_binsaved;
+		unsigned int m_count;
+		bool m_intrans;
+
+		void write_bin(const Tile& tile);
+	};
+
 	void close_bin(void);
 	void open_bin(const Glib::ustring& dbname, const Glib::ustring& binname);
 };
@@ -827,6 +827,7 @@ void DbBaseElements::Airspace::recompute_lineapprox_expand(void)
 	if (get_nrsegments() < 2)
 		return;
 	double w(get_width_nmi() * 0.5);
+	std::vector<MultiPolygonHole> upoly;
 	for (unsigned int i = 1; i < get_nrsegments(); ++i) {
 		Segment& seg1(operator[](i - 1));
 		Segment& seg2(operator[](i));
@@ -854,14 +855,15 @@ void DbBaseElements::Airspace::recompute_lineapprox_expand(void)
 			Point pt(seg2.get_coord1().spheric_course_distance_nmi(crs + k * (360.0 / 128.0), w));
 			r.push_back(pt);
 		}
-		MultiPolygonHole mp;
-		mp.push_back(r);
-		if (m_polygon.empty()) {
-			m_polygon.swap(mp);
-			continue;
-		}
-		m_polygon.geos_union(mp);
+		upoly.push_back(MultiPolygonHole());
+		upoly.back().push_back(r);
 	}
+	if (upoly.empty())
+		return;
+	m_polygon.swap(upoly.back());
+	upoly.pop_back();
+	if (!upoly.empty())
+		m_polygon.geos_union(upoly);
 }
 
 void DbBaseElements::Airspace::recompute_lineapprox_circle(void)
@@ -1215,6 +1217,22 @@ template<> const char *DbBase<DbBaseElements::Airspace>::order_field = "SRCID";
 template<> const char *DbBase<DbBaseElements::Airspace>::delete_field = "SRCID";
 template<> const bool DbBase<DbBaseElements::Airspace>::area_data = true;
 
+void AirspacesDb::save_gndelev(const elementvector_t& ev)
+{
+	sqlite3x::sqlite3_transaction tran(m_db);
+	for (elementvector_t::const_iterator ei(ev.begin()), ee(ev.end()); ei != ee; ++ei) {
+		if (!ei->is_valid() || ei->get_table() != element_t::table_main)
+			continue;
+		sqlite3x::sqlite3_command cmd(m_db, "UPDATE airspaces SET GNDELEVMIN=?,GNDELEVMAX=? WHERE ID=?;");
+		cmd.bind(1, (long long int)ei->get_gndelevmin());
+		cmd.bind(2, (long long int)ei->get_gndelevmax());
+		cmd.bind(3, (long long int)ei->get_id());
+		cmd.executenonquery();
+	}
+	tran.commit();
+	memindex_invalidate();
+}
+
 #ifdef HAVE_PQXX
 
 template<> void PGDbBase<DbBaseElements::Airspace>::drop_tables(void)
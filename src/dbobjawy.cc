@@ -577,6 +577,22 @@ AirwaysDb::elementvector_t AirwaysDb::find_by_area(const Rect& r, unsigned int l
 
 }
 
+void AirwaysDb::save_elev(const elementvector_t& ev)
+{
+	sqlite3x::sqlite3_transaction tran(m_db);
+	for (elementvector_t::const_iterator ei(ev.begin()), ee(ev.end()); ei != ee; ++ei) {
+		if (!ei->is_valid() || ei->get_table() != element_t::table_main)
+			continue;
+		sqlite3x::sqlite3_command cmd(m_db, "UPDATE airways SET TELEV=?,C5ELEV=? WHERE ID=?;");
+		cmd.bind(1, (int)ei->get_terrain_elev());
+		cmd.bind(2, (int)ei->get_corridor5_elev());
+		cmd.bind(3, (long long int)ei->get_id());
+		cmd.executenonquery();
+	}
+	tran.commit();
+	memindex_invalidate();
+}
+
 #ifdef HAVE_PQXX
 
 template<> void PGDbBase<DbBaseElements::Airway>::drop_tables(void)
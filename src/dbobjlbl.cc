@@ -303,6 +303,36 @@ LabelsDb::elementvector_t LabelsDb::find_mutable_by_metric(unsigned int limit, u
 	return ret;
 }
 
+void LabelsDb::save_placement(const elementvector_t& ev)
+{
+	sqlite3x::sqlite3_transaction tran(m_db);
+	for (elementvector_t::const_iterator ei(ev.begin()), ee(ev.end()); ei != ee; ++ei) {
+		if (!ei->is_valid() || ei->get_table() != element_t::table_main)
+			continue;
+		{
+			sqlite3x::sqlite3_command cmd(m_db, "UPDATE labels SET LAT=?,LON=?,LABELPLACEMENT=?,METRIC=?,TILE=? WHERE ID=?;");
+			cmd.bind(1, ei->get_coord().get_lat());
+			cmd.bind(2, ei->get_coord().get_lon());
+			cmd.bind(3, ei->get_label_placement());
+			cmd.bind(4, ei->get_metric());
+			cmd.bind(5, (int)element_t::TileNumber::to_tilenumber(ei->get_coord()));
+			cmd.bind(6, (long long int)ei->get_id());
+			cmd.executenonquery();
+		}
+		if (m_has_rtree) {
+			sqlite3x::sqlite3_command cmd(m_db, "UPDATE labels_rtree SET SWLAT=?,NELAT=?,SWLON=?,NELON=? WHERE ID=?;");
+			cmd.bind(1, ei->get_coord().get_lat());
+			cmd.bind(2, ei->get_coord().get_lat());
+			cmd.bind(3, ei->get_coord().get_lon());
+			cmd.bind(4, ei->get_coord().get_lon());
+			cmd.bind(5, (long long int)ei->get_id());
+			cmd.executenonquery();
+		}
+	}
+	tran.commit();
+	memindex_invalidate();
+}
+
 #ifdef HAVE_PQXX
 
 template<> void PGDbBase<DbBaseElements::Label>::drop_tables(void)
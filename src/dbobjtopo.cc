@@ -13,6 +13,7 @@
 #include "sysdeps.h"
 
 #include <limits>
+#include <stdexcept>
 #include <zlib.h>
 
 #if defined(HAVE_WINDOWS_H)
@@ -347,6 +348,52 @@ void TopoDbN<resolution,tilesize>::Tile::unreference(void) const
 	delete this;
 }
 
+template<int resolution, int tilesize>
+void TopoDbN<resolution,tilesize>::Tile::compress(std::vector<uint8_t>& blob) const
+{
+	blob.clear();
+	if (is_minmaxinvalid())
+		update_minmax();
+	if (m_minelev == m_maxelev)
+		return;
+	blob.resize(2*pixels_per_tile+64);
+	z_stream c_stream;
+	memset(&c_stream, 0, sizeof(c_stream));
+	c_stream.zalloc = (alloc_func)0;
+	c_stream.zfree = (free_func)0;
+	c_stream.opaque = (voidpf)0;
+	int err = deflateInit(&c_stream, Z_BEST_COMPRESSION);
+	if (err) {
+		std::cerr << "deflateInit error " << err << ", " << c_stream.msg << std::endl;
+		blob.clear();
+		return;
+	}
+	c_stream.next_out = &blob[0];
+	c_stream.avail_out = blob.size();
+	c_stream.next_in = (Bytef *)m_elevdata;
+	c_stream.avail_in = 2*pixels_per_tile;
+	err = deflate(&c_stream, Z_FINISH);
+	if (err != Z_STREAM_END) {
+		std::cerr << "deflate error " << err << ", " << c_stream.msg << std::endl;
+		deflateEnd(&c_stream);
+		blob.clear();
+		return;
+	}
+	if (c_stream.avail_in != 0 || c_stream.total_in != 2*pixels_per_tile) {
+		std::cerr << "deflate did not consume all input" << std::endl;
+		deflateEnd(&c_stream);
+		blob.clear();
+		return;
+	}
+	blob.resize(c_stream.total_out);
+	err = deflateEnd(&c_stream);
+	if (err) {
+		std::cerr << "deflateEnd error " << err << ", " << c_stream.msg << std::endl;
+		blob.clear();
+		return;
+	}
+}
+
 template<int resolution, int tilesize>
 void TopoDbN<resolution,tilesize>::Tile::save(sqlite3x::sqlite3_connection & db)
 {
@@ -355,7 +402,21 @@ void TopoDbN<resolution,tilesize>::Tile::save(sqlite3x::sqlite3_connection & db)
 	if (is_minmaxinvalid())
 		update_minmax();
 	std::cerr << "Saving tile: ID " << m_index << " min: " << m_minelev << " max: " << m_maxelev << std::endl;
-	sqlite3x::sqlite3_transaction tran(db);
+	std::vector<uint8_t> blob;
+	compress(blob);
+	if (!blob.empty())
+		std::cerr << "Tile compression: input: " << (2*pixels_per_tile) << " output: " << blob.size() << std::endl;
+	save(db, blob, true);
+	set_loaded(true);
+	set_dirty(false);
+}
+
+template<int resolution, int tilesize>
+void TopoDbN<resolution,tilesize>::Tile::save(sqlite3x::sqlite3_connection & db, const std::vector<uint8_t>& blob, bool tran) const
+{
+	if (is_minmaxinvalid())
+		update_minmax();
+	sqlite3x::sqlite3_transaction tr(db, tran);
 	{
 		sqlite3x::sqlite3_command cmd(db, "INSERT OR REPLACE INTO topo (ID) VALUES(?);");
 		cmd.bind(1, (int)m_index);
@@ -372,46 +433,14 @@ void TopoDbN<resolution,tilesize>::Tile::save(sqlite3x::sqlite3_connection & db)
 			cmd.bind(2, (long long int)m_minelev);
 			cmd.bind(3, (long long int)m_maxelev);
 		}
-		cmd.bind(4);
-		if (m_minelev != m_maxelev) {
-			uint8_t cdata[2*pixels_per_tile+64];
-			z_stream c_stream;
-			memset(&c_stream, 0, sizeof(c_stream));
-			c_stream.zalloc = (alloc_func)0;
-			c_stream.zfree = (free_func)0;
-			c_stream.opaque = (voidpf)0;
-			int err = deflateInit(&c_stream, Z_BEST_COMPRESSION);
-			if (err) {
-				std::cerr << "deflateInit error " << err << ", " << c_stream.msg << std::endl;
-				goto outerr2;
-			}
-			c_stream.next_out = cdata;
-			c_stream.avail_out = 2*pixels_per_tile+64;
-			c_stream.next_in = (Bytef *)m_elevdata;
-			c_stream.avail_in = 2*pixels_per_tile;
-			err = deflate(&c_stream, Z_FINISH);
-			if (err != Z_STREAM_END) {
-				std::cerr << "deflate error " << err << ", " << c_stream.msg << std::endl;
-				goto outerr2;
-			}
-			if (c_stream.avail_in != 0 || c_stream.total_in != 2*pixels_per_tile) {
-				std::cerr << "deflate did not consume all input" << std::endl;
-				goto outerr2;
-			}
-			cmd.bind(4, cdata, c_stream.total_out);
-			std::cerr << "Tile compression: input: " << (2*pixels_per_tile) << " output: " << c_stream.total_out << std::endl;
-			err = deflateEnd(&c_stream);
-			if (err) {
-				std::cerr << "deflateEnd error " << err << ", " << c_stream.msg << std::endl;
-				goto outerr2;
-			}
-		  outerr2:;
-		}
+		if (blob.empty())
+			cmd.bind(4);
+		else
+			cmd.bind(4, &blob[0], blob.size());
 		cmd.executenonquery();
 	}
-	tran.commit();
-	set_loaded(true);
-	set_dirty(false);
+	if (tran)
+		tr.commit();
 }
 
 template<int resolution, int tilesize>
@@ -442,7 +471,7 @@ void TopoDbN<resolution,tilesize>::Tile::set_elev(pixel_index_t index, elev_t el
 	set_dirty(true);
 	m_elevdata[2 * index] = e[0];
 	m_elevdata[2 * index + 1] = e[1];
-	set_minmaxinvalid(false);
+	set_minmaxinvalid(true);
 }
 
 template<int resolution, int tilesize>
@@ -848,6 +877,128 @@ void TopoDbN<resolution,tilesize>::BinFileHeader::set_signature(void)
 	memcpy(m_signature, signature, sizeof(signature));
 }
 
+template<int resolution, int tilesize>
+TopoDbN<resolution,tilesize>::TileWriter::TileWriter(TopoDbN& db, const Glib::ustring& binname)
+	: m_db(db), m_tran(db.m_db, false), m_binname(binname), m_binptr(0), m_saved(nr_tiles, false),
+	  m_binsaved(nr_tiles, false), m_count(0), m_intrans(false)
+{
+	// tiles are written behind the cache's back
+	m_db.cache_commit();
+	m_db.m_cache.clear();
+	m_db.close_bin();
+	{
+		sqlite3x::sqlite3_command cmd(m_db.m_db, "SELECT ID FROM topo;");
+		sqlite3x::sqlite3_cursor cursor(cmd.executecursor());
+		while (cursor.step()) {
+			tile_index_t idx(cursor.getint(0));
+			if (idx < nr_tiles)
+				m_saved[idx] = true;
+		}
+	}
+	if (!m_binname.empty()) {
+		m_binfile.reset(new std::ofstream(m_binname.c_str(), std::ofstream::binary | std::ofstream::trunc));
+		if (!m_binfile->good())
+			throw std::runtime_error("Cannot write to file " + m_binname);
+		m_binhdr.reset(new BinFileHeader());
+		m_binptr = sizeof(BinFileHeader);
+	}
+}
+
+template<int resolution, int tilesize>
+TopoDbN<resolution,tilesize>::TileWriter::~TileWriter()
+{
+	try {
+		commit();
+	} catch (const std::exception& e) {
+		std::cerr << "TopoDbN::TileWriter: commit error " << e.what() << std::endl;
+	}
+}
+
+template<int resolution, int tilesize>
+bool TopoDbN<resolution,tilesize>::TileWriter::is_saved(tile_index_t index) const
+{
+	if (index >= nr_tiles)
+		return false;
+	return m_saved[index];
+}
+
+template<int resolution, int tilesize>
+void TopoDbN<resolution,tilesize>::TileWriter::write_bin(const Tile& tile)
+{
+	if (!m_binfile || tile.get_index() >= nr_tiles || m_binsaved[tile.get_index()])
+		return;
+	typename BinFileHeader::Tile& htile((*m_binhdr)[tile.get_index()]);
+	htile.set_minelev(tile.get_minelev());
+	htile.set_maxelev(tile.get_maxelev());
+	htile.set_offset(m_binptr);
+	m_binfile->seekp(m_binptr, std::ofstream::beg);
+	m_binfile->write((const char *)tile.get_data(), 2 * pixels_per_tile);
+	m_binptr += 2 * pixels_per_tile;
+	m_binsaved[tile.get_index()] = true;
+}
+
+template<int resolution, int tilesize>
+void TopoDbN<resolution,tilesize>::TileWriter::save(const Tile& tile, const std::vector<uint8_t>& blob)
+{
+	if (tile.get_index() >= nr_tiles)
+		return;
+	if (!m_intrans) {
+		m_tran.begin();
+		m_intrans = true;
+	}
+	tile.save(m_db.m_db, blob, false);
+	m_saved[tile.get_index()] = true;
+	write_bin(tile);
+	if (!(++m_count % commit_interval)) {
+		// committed tiles survive an interrupted import
+		m_tran.commit();
+		m_tran.begin();
+	}
+}
+
+template<int resolution, int tilesize>
+void TopoDbN<resolution,tilesize>::TileWriter::save(const Tile& tile)
+{
+	std::vector<uint8_t> blob;
+	tile.compress(blob);
+	save(tile, blob);
+}
+
+template<int resolution, int tilesize>
+void TopoDbN<resolution,tilesize>::TileWriter::commit(void)
+{
+	if (!m_intrans)
+		return;
+	m_tran.commit();
+	m_intrans = false;
+}
+
+template<int resolution, int tilesize>
+void TopoDbN<resolution,tilesize>::TileWriter::finish(void)
+{
+	commit();
+	if (!m_binfile)
+		return;
+	{
+		sqlite3x::sqlite3_command cmd(m_db.m_db, "SELECT MINELEV,MAXELEV,ELEV,ID FROM topo ORDER BY ID;");
+		sqlite3x::sqlite3_cursor cursor(cmd.executecursor());
+		while (cursor.step()) {
+			tile_index_t idx(cursor.getint(3));
+			if (idx >= nr_tiles || m_binsaved[idx])
+				continue;
+			Tile tile(cursor);
+			write_bin(tile);
+		}
+	}
+	m_binfile->seekp(0, std::ofstream::beg);
+	m_binfile->write((const char *)m_binhdr.get(), sizeof(BinFileHeader));
+	m_binfile->close();
+	if (m_binfile->fail())
+		throw std::runtime_error("Error writing file " + m_binname);
+	m_binfile.reset();
+	m_binhdr.reset();
+}
+
 template<int resolution, int tilesize>
 TopoDbN<resolution,tilesize>::TopoDbN()
 	: m_binhdr(0), m_binsz(0)
@@ -1359,82 +1510,107 @@ typename TopoDbN<resolution,tilesize>::minmax_elev_t TopoDbN<resolution,tilesize
 }
 
 template<int resolution, int tilesize>
-typename TopoDbN<resolution,tilesize>::minmax_elev_t TopoDbN<resolution,tilesize>::get_minmax_elev(const PolygonHole& p)
+typename TopoDbN<resolution,tilesize>::minmax_elev_t TopoDbN<resolution,tilesize>::get_minmax_elev(const PolygonHole& p, const Tile& tile)
 {
-        if (p.get_exterior().empty())
+        if (p.get_exterior().empty() || tile.get_index() >= nr_tiles)
                 return minmax_elev_t(nodata, nodata);
         Point pdim(TopoCoordinate::get_pointsize()), pdim2(pdim.get_lon()/2, pdim.get_lat()/2);
         Rect r(p.get_bbox());
         TopoTileCoordinate tmin(r.get_southwest()), tmax(r.get_northeast());
+        TopoTileCoordinate tc(tile.get_index() % lon_tiles, tile.get_index() / lon_tiles);
         minmax_elev_t ret(std::numeric_limits<elev_t>::max(), std::numeric_limits<elev_t>::min());
-        for (TopoTileCoordinate tc(tmin);;) {
-                pixel_index_t ymin((tc.get_lat_tile() == tmin.get_lat_tile()) ? tmin.get_lat_offs() : 0);
-                pixel_index_t ymax((tc.get_lat_tile() == tmax.get_lat_tile()) ? tmax.get_lat_offs() : tile_size - 1);
-                pixel_index_t xmin((tc.get_lon_tile() == tmin.get_lon_tile()) ? tmin.get_lon_offs() : 0);
-                pixel_index_t xmax((tc.get_lon_tile() == tmax.get_lon_tile()) ? tmax.get_lon_offs() : tile_size - 1);
-                Rect rtile((Point)(TopoCoordinate)TopoTileCoordinate(tc.get_lon_tile(), tc.get_lat_tile(), xmin, ymin),
-                           (Point)(TopoCoordinate)TopoTileCoordinate(tc.get_lon_tile(), tc.get_lat_tile(), xmax, ymax) + pdim);
-                bool intersect(p.is_intersection(rtile));
-                bool poly_inside(!intersect && rtile.is_inside(p.get_exterior()[0]));
-                bool tile_inside(!intersect && !poly_inside && p.windingnumber(rtile.get_southwest()));
-                if (false) {
-                        minmax_elev_t mm(get_tile_minmax_elev(tc));
-                        std::cerr << "get_minmax_elev: bbox " << r << " tile " << rtile << " intersect " << (intersect ? "yes" : "no")
-                                  << " poly_inside " << (poly_inside ? "yes" : "no") << " tile_inside " << (tile_inside ? "yes" : "no")
-                                  << " tile elev " << mm.first << " / " << mm.second << std::endl;
-                }
-                if (tile_inside) {
-                        minmax_elev_t mm(get_tile_minmax_elev(tc));
-                        ret.first = std::min(ret.first, mm.first);
-                        ret.second = std::max(ret.second, mm.second);
-                } else if (poly_inside || intersect) {
-                        for (pixel_index_t y(ymin); y <= ymax; y++) {
-                                tc.set_lat_offs(y);
+        if (tc.get_lat_tile() < tmin.get_lat_tile() || tc.get_lat_tile() > tmax.get_lat_tile() ||
+            (tc.get_lon_tile() + lon_tiles - tmin.get_lon_tile()) % lon_tiles >
+            (tmax.get_lon_tile() + lon_tiles - tmin.get_lon_tile()) % lon_tiles)
+                return minmax_elev_t(nodata, nodata);
+        pixel_index_t ymin((tc.get_lat_tile() == tmin.get_lat_tile()) ? tmin.get_lat_offs() : 0);
+        pixel_index_t ymax((tc.get_lat_tile() == tmax.get_lat_tile()) ? tmax.get_lat_offs() : tile_size - 1);
+        pixel_index_t xmin((tc.get_lon_tile() == tmin.get_lon_tile()) ? tmin.get_lon_offs() : 0);
+        pixel_index_t xmax((tc.get_lon_tile() == tmax.get_lon_tile()) ? tmax.get_lon_offs() : tile_size - 1);
+        Rect rtile((Point)(TopoCoordinate)TopoTileCoordinate(tc.get_lon_tile(), tc.get_lat_tile(), xmin, ymin),
+                   (Point)(TopoCoordinate)TopoTileCoordinate(tc.get_lon_tile(), tc.get_lat_tile(), xmax, ymax) + pdim);
+        bool intersect(p.is_intersection(rtile));
+        bool poly_inside(!intersect && rtile.is_inside(p.get_exterior()[0]));
+        bool tile_inside(!intersect && !poly_inside && p.windingnumber(rtile.get_southwest()));
+        if (false) {
+                minmax_elev_t mm(tile.get_minelev(), tile.get_maxelev());
+                std::cerr << "get_minmax_elev: bbox " << r << " tile " << rtile << " intersect " << (intersect ? "yes" : "no")
+                          << " poly_inside " << (poly_inside ? "yes" : "no") << " tile_inside " << (tile_inside ? "yes" : "no")
+                          << " tile elev " << mm.first << " / " << mm.second << std::endl;
+        }
+        if (tile_inside) {
+                minmax_elev_t mm(tile.get_minelev(), tile.get_maxelev());
+                ret.first = std::min(ret.first, mm.first);
+                ret.second = std::max(ret.second, mm.second);
+        } else if (poly_inside || intersect) {
+                for (pixel_index_t y(ymin); y <= ymax; y++) {
+                        tc.set_lat_offs(y);
 #if 1
-				Point pt2(pdim2 + (Point)(TopoCoordinate)tc);
-				PolygonSimple::ScanLine sl(p.scanline(pt2.get_lat()));
-				PolygonSimple::ScanLine::const_iterator sli(sl.begin()), sle(sl.end());
-				int wn(0);
-                                for (pixel_index_t x(xmin); x <= xmax; x++) {
-                                        tc.set_lon_offs(x);
-                                        Point pt2 = pdim2 + (Point)(TopoCoordinate)tc;
-                                        if (!r.is_inside(pt2))
-						continue;
-					while (sli != sle && sli->first <= pt2.get_lat()) {
-						wn = sli->second;
-						++sli;
-					}
-					if (!wn)
-						continue;
-					elev_t e(get_elev(tc));
-					if (false)
-						std::cerr << "get_minmax_elev: " << e << " @ " << pt2 << std::endl;
-					if (e == ocean)
-						e = 0;
-					if (e != nodata) {
-						ret.first = std::min(ret.first, e);
-						ret.second = std::max(ret.second, e);
-					}
-                                }
+			Point pt2(pdim2 + (Point)(TopoCoordinate)tc);
+			PolygonSimple::ScanLine sl(p.scanline(pt2.get_lat()));
+			PolygonSimple::ScanLine::const_iterator sli(sl.begin()), sle(sl.end());
+			int wn(0);
+                        for (pixel_index_t x(xmin); x <= xmax; x++) {
+                                tc.set_lon_offs(x);
+                                Point pt2 = pdim2 + (Point)(TopoCoordinate)tc;
+                                if (!r.is_inside(pt2))
+					continue;
+				while (sli != sle && sli->first <= pt2.get_lat()) {
+					wn = sli->second;
+					++sli;
+				}
+				if (!wn)
+					continue;
+				elev_t e(tile.get_elev(tc.get_pixel_index()));
+				if (false)
+					std::cerr << "get_minmax_elev: " << e << " @ " << pt2 << std::endl;
+				if (e == ocean)
+					e = 0;
+				if (e != nodata) {
+					ret.first = std::min(ret.first, e);
+					ret.second = std::max(ret.second, e);
+				}
+                        }
 #else
-                                for (pixel_index_t x(xmin); x <= xmax; x++) {
-                                        tc.set_lon_offs(x);
-                                        Point pt2(pdim2 + (Point)(TopoCoordinate)tc);
-                                        if (!r.is_inside(pt2) || !p.windingnumber(pt2))
-						continue;
-					elev_t e(get_elev(tc));
-					if (false)
-						std::cerr << "get_minmax_elev: " << e << " @ " << pt2 << std::endl;
-					if (e == ocean)
-						e = 0;
-					if (e != nodata) {
-						ret.first = std::min(ret.first, e);
-						ret.second = std::max(ret.second, e);
-					}
-                                }
-#endif
+                        for (pixel_index_t x(xmin); x <= xmax; x++) {
+                                tc.set_lon_offs(x);
+                                Point pt2(pdim2 + (Point)(TopoCoordinate)tc);
+                                if (!r.is_inside(pt2) || !p.windingnumber(pt2))
+					continue;
+				elev_t e(tile.get_elev(tc.get_pixel_index()));
+				if (false)
+					std::cerr << "get_minmax_elev: " << e << " @ " << pt2 << std::endl;
+				if (e == ocean)
+					e = 0;
+				if (e != nodata) {
+					ret.first = std::min(ret.first, e);
+					ret.second = std::max(ret.second, e);
+				}
                         }
+#endif
                 }
+        }
+        if (ret.first == std::numeric_limits<elev_t>::max())
+                ret.first = nodata;
+        if (ret.second == std::numeric_limits<elev_t>::min())
+                ret.second = nodata;
+        return ret;
+}
+
+template<int resolution, int tilesize>
+typename TopoDbN<resolution,tilesize>::minmax_elev_t TopoDbN<resolution,tilesize>::get_minmax_elev(const PolygonHole& p)
+{
+        if (p.get_exterior().empty())
+                return minmax_elev_t(nodata, nodata);
+        Rect r(p.get_bbox());
+        TopoTileCoordinate tmin(r.get_southwest()), tmax(r.get_northeast());
+        minmax_elev_t ret(nodata, nodata);
+        for (TopoTileCoordinate tc(tmin);;) {
+                typename Tile::const_ptr_t t(get_tile(tc.get_tile_index()));
+                if (t)
+                        ret = merge_minmax_elev(ret, get_minmax_elev(p, *t));
+                else
+                        std::cerr << "TopoDbN: cannot find tile " << tc.get_tile_index() << std::endl;
                 if (tc.get_lon_tile() != tmax.get_lon_tile()) {
                         tc.advance_tile_east();
                         continue;
@@ -1444,28 +1620,40 @@ typename TopoDbN<resolution,tilesize>::minmax_elev_t TopoDbN<resolution,tilesize
                 tc.set_lon_tile(tmin.get_lon_tile());
                 tc.advance_tile_north();
         }
-        if (ret.first == std::numeric_limits<elev_t>::max())
-                ret.first = nodata;
-        if (ret.second == std::numeric_limits<elev_t>::min())
-                ret.second = nodata;
         return ret;
 }
 
+template<int resolution, int tilesize>
+typename TopoDbN<resolution,tilesize>::minmax_elev_t TopoDbN<resolution,tilesize>::merge_minmax_elev(const minmax_elev_t& a, const minmax_elev_t& b)
+{
+	minmax_elev_t r(a);
+	if (r.first == nodata)
+		r.first = b.first;
+	else if (b.first != nodata)
+		r.first = std::min(r.first, b.first);
+	if (r.second == nodata)
+		r.second = b.second;
+	else if (b.second != nodata)
+		r.second = std::max(r.second, b.second);
+	return r;
+}
+
+template<int resolution, int tilesize>
+typename TopoDbN<resolution,tilesize>::Tile::const_ptr_t TopoDbN<resolution,tilesize>::get_tile(tile_index_t index)
+{
+        if (index >= nr_tiles)
+                return typename Tile::const_ptr_t();
+	if (m_binhdr)
+		return typename Tile::const_ptr_t(new Tile(*(const BinFileHeader *)m_binhdr, index));
+	return find(index);
+}
+
 template<int resolution, int tilesize>
 typename TopoDbN<resolution,tilesize>::minmax_elev_t TopoDbN<resolution,tilesize>::get_minmax_elev(const MultiPolygonHole& p)
 {
 	minmax_elev_t r(nodata, nodata);
-	for (MultiPolygonHole::const_iterator pi(p.begin()), pe(p.end()); pi != pe; ++pi) {
-		minmax_elev_t m(get_minmax_elev(*pi));
-		if (r.first == nodata)
-			r.first = m.first;
-		else if (m.first != nodata)
-			r.first = std::min(r.first, m.first);
-		if (r.second == nodata)
-			r.second = m.second;
-		else if (m.second != nodata)
-			r.second = std::max(r.second, m.second);
-	}
+	for (MultiPolygonHole::const_iterator pi(p.begin()), pe(p.end()); pi != pe; ++pi)
+		r = merge_minmax_elev(r, get_minmax_elev(*pi));
 	return r;
 }
 
@@ -21,9 +21,12 @@
 #include "sysdeps.h"
 #include "engine.h"
 #include "baro.h"
+#include "icaofpl.h"
 
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <algorithm>
 #ifdef HAVE_SYS_SYSCALL_H
 #include <sys/syscall.h>
 #endif
@@ -204,9 +207,31 @@ PalmDbBase::PalmStringCompare::comp_t Engine::to_palm_compare(DbQueryInterfaceCo
 }
 #endif
 
+Engine::DbThread::LaneStats::LaneStats(void)
+	: m_latency(0), m_maxlatency(0), m_executed(0), m_cancelled(0), m_queued(0)
+{
+}
+
+void Engine::DbThread::LaneStats::executed(double latency)
+{
+	++m_executed;
+	m_latency += latency;
+	m_maxlatency = std::max(m_maxlatency, latency);
+}
+
+Engine::DbThread::Task::Task(const Glib::RefPtr<ResultBase>& task)
+	: m_task(task)
+{
+	m_queuetime.assign_current_time();
+}
+
+gint Engine::DbThread::serialcounter = 0;
+
 Engine::DbThread::DbThread(const std::string & dir_main, const std::string & dir_aux, bool pg)
-	: m_terminate(false), m_thread(0)
+	: m_serial(g_atomic_int_add(&serialcounter, 1)), m_revision(0), m_terminate(false)
 {
+	for (unsigned int i = 0; i < worker_count; ++i)
+		m_thread[i] = 0;
 #ifdef HAVE_PQXX
 	m_pgconn.reset();
 	if (pg)
@@ -227,6 +252,7 @@ Engine::DbThread::DbThread(const std::string & dir_main, const std::string & dir
 				db->attach_readonly(dir_aux);
 			if (false && db->is_aux_attached())
 				std::cerr << "Auxillary airports database attached" << std::endl;
+			db->set_memindex();
 		}
 	} catch (const std::exception& e) {
 		std::cerr << "Error opening airports database: " << e.what() << std::endl;
@@ -245,6 +271,7 @@ Engine::DbThread::DbThread(const std::string & dir_main, const std::string & dir
 				db->attach_readonly(dir_aux);
 			if (false && db->is_aux_attached())
 				std::cerr << "Auxillary navaids database attached" << std::endl;
+			db->set_memindex();
 		}
 	} catch (const std::exception& e) {
 		std::cerr << "Error opening navaids database: " << e.what() << std::endl;
@@ -263,6 +290,7 @@ Engine::DbThread::DbThread(const std::string & dir_main, const std::string & dir
 				db->attach_readonly(dir_aux);
 			if (false && db->is_aux_attached())
 				std::cerr << "Auxillary waypoints database attached" << std::endl;
+			db->set_memindex();
 		}
 	} catch (const std::exception& e) {
 		std::cerr << "Error opening waypoints database: " << e.what() << std::endl;
@@ -299,10 +327,18 @@ Engine::DbThread::DbThread(const std::string & dir_main, const std::string & dir
 				db->attach_readonly(dir_aux);
 			if (false && db->is_aux_attached())
 				std::cerr << "Auxillary airways database attached" << std::endl;
+#ifdef HAVE_BOOST
+			m_airwaycache.reset(new AirwayCache(db, dir_main.empty() ? std::string(FPlan::get_userdbpath()) : dir_main,
+							    db->is_aux_attached() ? dir_aux : ""));
+#endif
 		}
 	} catch (const std::exception& e) {
 		std::cerr << "Error opening airways database: " << e.what() << std::endl;
 	}
+#ifdef HAVE_BOOST
+	if (!m_airwaycache)
+		m_airwaycache.reset(new AirwayCache(m_airwaydb.get()));
+#endif
 	try {
 #ifdef HAVE_PQXX
 		if (pg) {
@@ -360,46 +396,69 @@ Engine::DbThread::DbThread(const std::string & dir_main, const std::string & dir
 			std::cerr << "Error opening palm gtopo database: " << e.what() << std::endl;
 	}
 #endif
-	m_thread = Glib::Thread::create(sigc::mem_fun(*this, &Engine::DbThread::thread), 0, true, true, Glib::THREAD_PRIORITY_NORMAL);
+	for (unsigned int i = 0; i < worker_count; ++i)
+		m_thread[i] = Glib::Thread::create(sigc::bind(sigc::mem_fun(*this, &Engine::DbThread::thread), (worker_t)i), 0, true, true, Glib::THREAD_PRIORITY_NORMAL);
 }
 
 Engine::DbThread::~DbThread()
 {
-	if (m_thread) {
+	{
+		Glib::Mutex::Lock lock(m_mutex);
 		m_terminate = true;
 		m_cond.broadcast();
-		m_thread->join();
-		m_thread = 0;
 	}
+	for (unsigned int i = 0; i < worker_count; ++i) {
+		if (!m_thread[i])
+			continue;
+		m_thread[i]->join();
+		m_thread[i] = 0;
+	}
+	// lookup results of this database are unreachable now
+	IcaoFlightPlan::FindCoord::cache_clear();
 }
 
-void Engine::DbThread::thread(void)
+void Engine::DbThread::thread(worker_t worker)
 {
+	std::list<Task> (&tasklist)[lane_count] = m_tasklist[worker];
 	m_mutex.lock();
 	while (!m_terminate) {
-		if (m_tasklist.empty()) {
+		unsigned int lane(0);
+		while (lane < lane_count && tasklist[lane].empty())
+			++lane;
+		if (lane >= lane_count) {
 			m_cond.wait(m_mutex);
-			if (m_tasklist.empty())
-				continue;
+			continue;
+		}
+		Task task(tasklist[lane].front());
+		tasklist[lane].pop_front();
+		m_stats[lane].dequeue();
+		if (task.get_task()->is_error()) {
+			// cancelled or superseded while waiting in the queue
+			m_stats[lane].cancelled();
+			continue;
 		}
-		Glib::RefPtr<ResultBase> task(m_tasklist.front());
-		m_tasklist.pop_front();
 		m_mutex.unlock();
-		if (!task->is_error())
-			task->execute();
+		task.get_task()->execute();
+		Glib::TimeVal tv;
+		tv.assign_current_time();
+		tv -= task.get_queuetime();
 		m_mutex.lock();
+		m_stats[lane].executed(tv.as_double());
 	}
-	while (!m_tasklist.empty()) {
-		Glib::RefPtr<ResultBase> task(m_tasklist.front());
-		m_tasklist.pop_front();
-		m_mutex.unlock();
-		task->seterror();
-		m_mutex.lock();
+	for (unsigned int lane = 0; lane < lane_count; ++lane) {
+		while (!tasklist[lane].empty()) {
+			Task task(tasklist[lane].front());
+			tasklist[lane].pop_front();
+			m_stats[lane].dequeue();
+			m_mutex.unlock();
+			task.get_task()->seterror();
+			m_mutex.lock();
+		}
 	}
 	m_mutex.unlock();
 }
 
-template<class T> void Engine::DbThread::queue(Glib::RefPtr<T>& p)
+template<class T> void Engine::DbThread::queue(Glib::RefPtr<T>& p, lane_t lane, worker_t worker)
 {
 	if (!p)
 		return;
@@ -409,11 +468,20 @@ template<class T> void Engine::DbThread::queue(Glib::RefPtr<T>& p)
 	}
 	{
 		Glib::Mutex::Lock lock(m_mutex);
-		m_tasklist.push_back(p);
+		m_tasklist[worker][lane].push_back(Task(p));
+		m_stats[lane].enqueue();
 		m_cond.broadcast();
 	}
 }
 
+Engine::DbThread::LaneStats Engine::DbThread::get_stats(lane_t lane) const
+{
+	if (lane >= lane_count)
+		return LaneStats();
+	Glib::Mutex::Lock lock(m_mutex);
+	return m_stats[lane];
+}
+
 Engine::DbThread::ResultBase::ResultBase(const sigc::slot<void> & dbaction, const sigc::slot<void>& dbcancel)
 	: m_dbcancel(dbcancel), m_dbaction(dbaction), m_refcount(1), m_done(false), m_error(false), m_executing(false)
 {
@@ -1124,6 +1192,163 @@ void Engine::DbThread::ElevationMapCairoResult::execute_palm(PalmGtopo& topodb)
 
 #ifdef HAVE_BOOST
 
+class Engine::DbThread::AirwayCache::Loader : public AirwaysDb::ForEach {
+public:
+	Loader(elementvector_t& ev) : m_ev(ev) {}
+	bool operator()(const element_t& e) { m_ev.push_back(e); return true; }
+	bool operator()(const std::string&) { return true; }
+
+protected:
+	elementvector_t& m_ev;
+};
+
+Engine::DbThread::AirwayCache::AirwayCache(AirwaysDbQueryInterface *db, const std::string& dir_main, const std::string& dir_aux)
+	: m_db(db), m_loaded(false)
+{
+	if (!dir_main.empty())
+		m_path[0] = Glib::build_filename(dir_main, "airways.db");
+	if (!dir_aux.empty())
+		m_path[1] = Glib::build_filename(dir_aux, "airways.db");
+	for (unsigned int i = 0; i < 2; ++i)
+		m_mtime[i] = 0;
+}
+
+void Engine::DbThread::AirwayCache::invalidate(void)
+{
+	m_elements.clear();
+	m_bbox.clear();
+	m_tiles.clear();
+	m_names.clear();
+	m_loaded = false;
+}
+
+void Engine::DbThread::AirwayCache::revalidate(void)
+{
+	// the database files are the revision: reload after an import replaced them
+	for (unsigned int i = 0; i < 2; ++i) {
+		if (m_path[i].empty())
+			continue;
+		struct stat st;
+		time_t t(0);
+		if (!stat(m_path[i].c_str(), &st))
+			t = st.st_mtime;
+		if (t == m_mtime[i])
+			continue;
+		m_mtime[i] = t;
+		invalidate();
+	}
+}
+
+void Engine::DbThread::AirwayCache::add_tiles(const Rect& r, unsigned int idx)
+{
+	int64_t lat0(((int64_t)r.get_south()) >> tile_shift), lat1(((int64_t)r.get_north()) >> tile_shift);
+	int64_t lon0(((int64_t)r.get_west()) >> tile_shift), lon1(r.get_east_unwrapped() >> tile_shift);
+	lon1 = std::min(lon1, lon0 + tile_mask);
+	for (int64_t lat = lat0; lat <= lat1; ++lat)
+		for (int64_t lon = lon0; lon <= lon1; ++lon)
+			m_tiles[((lat & tile_mask) << (32 - tile_shift)) | (lon & tile_mask)].push_back(idx);
+}
+
+void Engine::DbThread::AirwayCache::load(void)
+{
+	invalidate();
+	if (!m_db)
+		return;
+	Glib::TimeVal tv;
+	tv.assign_current_time();
+	{
+		Loader ldr(m_elements);
+		try {
+			m_db->for_each(ldr, true, AirwaysDb::Airway::subtables_all);
+		} catch (...) {
+			invalidate();
+			throw;
+		}
+	}
+	m_bbox.reserve(m_elements.size());
+	for (unsigned int i = 0; i < m_elements.size(); ++i) {
+		const element_t& e(m_elements[i]);
+		m_bbox.push_back(e.get_bbox());
+		add_tiles(m_bbox.back(), i);
+		m_names[e.get_name()].push_back(i);
+	}
+	m_loaded = true;
+	if (true) {
+		Glib::TimeVal tv1;
+		tv1.assign_current_time();
+		tv = tv1 - tv;
+		std::cerr << "Airway cache: " << m_elements.size() << " segments, " << m_tiles.size()
+			  << " tiles, " << m_names.size() << " airways, " << tv.as_double() << "s" << std::endl;
+	}
+}
+
+Engine::DbThread::AirwayCache::indexvector_t Engine::DbThread::AirwayCache::find_indices(const Rect& r) const
+{
+	indexvector_t idx;
+	int64_t lat0(((int64_t)r.get_south()) >> tile_shift), lat1(((int64_t)r.get_north()) >> tile_shift);
+	int64_t lon0(((int64_t)r.get_west()) >> tile_shift), lon1(r.get_east_unwrapped() >> tile_shift);
+	lon1 = std::min(lon1, lon0 + tile_mask);
+	for (int64_t lat = lat0; lat <= lat1; ++lat)
+		for (int64_t lon = lon0; lon <= lon1; ++lon) {
+			tiles_t::const_iterator ti(m_tiles.find(((lat & tile_mask) << (32 - tile_shift)) | (lon & tile_mask)));
+			if (ti == m_tiles.end())
+				continue;
+			for (indexvector_t::const_iterator i(ti->second.begin()), e(ti->second.end()); i != e; ++i)
+				if (m_bbox[*i].is_intersect(r))
+					idx.push_back(*i);
+		}
+	// segments spanning several tiles are found more than once; sorting restores database order
+	std::sort(idx.begin(), idx.end());
+	idx.erase(std::unique(idx.begin(), idx.end()), idx.end());
+	return idx;
+}
+
+Engine::DbThread::AirwayCache::elementvector_t Engine::DbThread::AirwayCache::get_elements(const indexvector_t& idx, unsigned int limit) const
+{
+	elementvector_t ev;
+	unsigned int sz(idx.size());
+	if (limit)
+		sz = std::min(sz, limit);
+	ev.reserve(sz);
+	for (indexvector_t::const_iterator i(idx.begin()), e(idx.begin() + sz); i != e; ++i)
+		ev.push_back(m_elements[*i]);
+	return ev;
+}
+
+Engine::DbThread::AirwayCache::elementvector_t Engine::DbThread::AirwayCache::find_by_rect(const Rect& r, unsigned int limit)
+{
+	if (m_path[0].empty())
+		return m_db ? m_db->find_by_rect(r, limit, AirwaysDb::Airway::subtables_all) : elementvector_t();
+	revalidate();
+	if (!m_loaded)
+		load();
+	return get_elements(find_indices(r), limit);
+}
+
+Engine::DbThread::AirwayCache::elementvector_t Engine::DbThread::AirwayCache::find_by_area(const Rect& r, unsigned int limit)
+{
+	if (m_path[0].empty())
+		return m_db ? m_db->find_by_area(r, limit, AirwaysDb::Airway::subtables_all) : elementvector_t();
+	revalidate();
+	if (!m_loaded)
+		load();
+	indexvector_t idx;
+	{
+		std::set<Glib::ustring> names;
+		indexvector_t idx1(find_indices(r));
+		for (indexvector_t::const_iterator i(idx1.begin()), e(idx1.end()); i != e; ++i)
+			names.insert(m_elements[*i].get_name());
+		for (std::set<Glib::ustring>::const_iterator i(names.begin()), e(names.end()); i != e; ++i) {
+			names_t::const_iterator ni(m_names.find(*i));
+			if (ni == m_names.end())
+				continue;
+			idx.insert(idx.end(), ni->second.begin(), ni->second.end());
+		}
+	}
+	std::sort(idx.begin(), idx.end());
+	return get_elements(idx, limit);
+}
+
 Engine::DbThread::AirwayGraphResult::AirwayGraphResult(const sigc::slot<elementvector_t>& dbaction, const sigc::slot<void>& dbcancel)
 	: ResultBase(sigc::compose(sigc::mem_fun(*this, &Engine::DbThread::AirwayGraphResult::set_result), dbaction), dbcancel)
 {
@@ -1158,12 +1383,12 @@ void Engine::DbThread::AirwayGraphResult::set_result_mapelements(const Mapelemen
 	m_graph.add(ev);
 }
 
-Engine::DbThread::AreaGraphResult::AreaGraphResult(const Rect& rect, bool area, AirwaysDbQueryInterface *airwaydb,
+Engine::DbThread::AreaGraphResult::AreaGraphResult(const Rect& rect, bool area, AirwayCache *airwaycache,
 						   AirportsDbQueryInterface *airportdb, NavaidsDbQueryInterface *navaiddb,
 						   WaypointsDbQueryInterface *waypointdb, MapelementsDbQueryInterface *mapelementdb,
 						   const sigc::slot<void>& dbcancel)
 	: AirwayGraphResult(sigc::mem_fun(*this, &Engine::DbThread::AreaGraphResult::dbaction), dbcancel),
-	  m_rect(rect), m_airwaydb(airwaydb), m_airportdb(airportdb), m_navaiddb(navaiddb), m_waypointdb(waypointdb), m_mapelementdb(mapelementdb), m_area(area)
+	  m_rect(rect), m_airwaycache(airwaycache), m_airportdb(airportdb), m_navaiddb(navaiddb), m_waypointdb(waypointdb), m_mapelementdb(mapelementdb), m_area(area)
 {
 }
 
@@ -1177,11 +1402,11 @@ Engine::DbThread::AreaGraphResult::elementvector_t Engine::DbThread::AreaGraphRe
 		set_result_waypoints(m_waypointdb->find_by_rect(m_rect, ~0, WaypointsDb::Waypoint::subtables_none));
 	if (m_mapelementdb)
 		set_result_mapelements(m_mapelementdb->find_by_rect(m_rect, ~0, MapelementsDb::Mapelement::subtables_none));
-	if (!m_airwaydb)
+	if (!m_airwaycache)
 		return elementvector_t();
 	if (m_area)
-		return m_airwaydb->find_by_area(m_rect, ~0, AirwaysDb::Airway::subtables_all);
-	return m_airwaydb->find_by_rect(m_rect, ~0, AirwaysDb::Airway::subtables_all);
+		return m_airwaycache->find_by_area(m_rect);
+	return m_airwaycache->find_by_rect(m_rect);
 }
 #endif
 
@@ -1195,7 +1420,20 @@ Glib::RefPtr<Engine::DbThread::AirportResult> Engine::DbThread::airport_find_by_
 #endif
 		p = Glib::RefPtr<AirportResult>(new AirportResult(sigc::bind(sigc::mem_fun(m_airportdb.get(), &AirportsDbQueryInterface::find_by_icao), nm, 0, comp, limit, loadsubtables),
 								  sigc::mem_fun(m_airportdb.get(), &AirportsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
+	return p;
+}
+
+Glib::RefPtr<Engine::DbThread::AirportResult> Engine::DbThread::airport_find_by_icao(const std::vector<std::string>& nm, AirportsDb::comp_t comp, unsigned int loadsubtables)
+{
+	Glib::RefPtr<AirportResult> p;
+#ifdef HAVE_PILOTLINK
+	if (m_palmairportdb.is_open())
+		return p;
+#endif
+	p = Glib::RefPtr<AirportResult>(new AirportResult(sigc::bind(sigc::mem_fun(m_airportdb.get(), &AirportsDbQueryInterface::find_by_field), std::string("ICAO"), nm, comp, loadsubtables),
+					     sigc::mem_fun(m_airportdb.get(), &AirportsDbQueryInterface::interrupt)));
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1209,7 +1447,7 @@ Glib::RefPtr<Engine::DbThread::AirportResult> Engine::DbThread::airport_find_by_
 #endif
 		p = Glib::RefPtr<AirportResult>(new AirportResult(sigc::bind(sigc::mem_fun(m_airportdb.get(), &AirportsDbQueryInterface::find_by_name), nm, 0, comp, limit, loadsubtables),
 								  sigc::mem_fun(m_airportdb.get(), &AirportsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1223,7 +1461,7 @@ Glib::RefPtr<Engine::DbThread::AirportResult> Engine::DbThread::airport_find_by_
 #endif
 		p = Glib::RefPtr<AirportResult>(new AirportResult(sigc::bind(sigc::mem_fun(m_airportdb.get(), &AirportsDbQueryInterface::find_by_text), nm, 0, comp, limit, loadsubtables),
 								  sigc::mem_fun(m_airportdb.get(), &AirportsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1237,7 +1475,7 @@ Glib::RefPtr<Engine::DbThread::AirportResult> Engine::DbThread::airport_find_bbo
 #endif
 		p = Glib::RefPtr<AirportResult>(new AirportResult(sigc::bind(sigc::mem_fun(m_airportdb.get(), &AirportsDbQueryInterface::find_by_rect), rect, limit, loadsubtables),
 								  sigc::mem_fun(m_airportdb.get(), &AirportsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_rendering);
 	return p;
 }
 
@@ -1251,15 +1489,21 @@ Glib::RefPtr<Engine::DbThread::AirportResult> Engine::DbThread::airport_find_nea
 #endif
 		p = Glib::RefPtr<AirportResult>(new AirportResult(sigc::bind(sigc::mem_fun(m_airportdb.get(), &AirportsDbQueryInterface::find_nearest), pt, rect, limit, loadsubtables),
 								  sigc::mem_fun(m_airportdb.get(), &AirportsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
+void Engine::DbThread::airport_save_action(AirportsDb::Airport& e)
+{
+	m_airportdb->save(e);
+	db_changed();
+}
+
 Glib::RefPtr<Engine::DbThread::AirportSaveResult> Engine::DbThread::airport_save(const AirportsDb::Airport & e)
 {
-	Glib::RefPtr<AirportSaveResult> p(new AirportSaveResult(sigc::bind(sigc::mem_fun(m_airportdb.get(), &AirportsDbQueryInterface::save), e),
+	Glib::RefPtr<AirportSaveResult> p(new AirportSaveResult(sigc::bind(sigc::mem_fun(*this, &DbThread::airport_save_action), e),
 								sigc::mem_fun(m_airportdb.get(), &AirportsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1273,7 +1517,7 @@ Glib::RefPtr<Engine::DbThread::AirspaceResult> Engine::DbThread::airspace_find_b
 #endif
 		p = Glib::RefPtr<AirspaceResult>(new AirspaceResult(sigc::bind(sigc::mem_fun(m_airspacedb.get(), &AirspacesDbQueryInterface::find_by_icao), nm, 0, comp, limit, loadsubtables),
 								    sigc::mem_fun(m_airspacedb.get(), &AirspacesDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1287,7 +1531,7 @@ Glib::RefPtr<Engine::DbThread::AirspaceResult> Engine::DbThread::airspace_find_b
 #endif
 		p = Glib::RefPtr<AirspaceResult>(new AirspaceResult(sigc::bind(sigc::mem_fun(m_airspacedb.get(), &AirspacesDbQueryInterface::find_by_name), nm, 0, comp, limit, loadsubtables),
 								    sigc::mem_fun(m_airspacedb.get(), &AirspacesDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1301,7 +1545,7 @@ Glib::RefPtr<Engine::DbThread::AirspaceResult> Engine::DbThread::airspace_find_b
 #endif
 		p = Glib::RefPtr<AirspaceResult>(new AirspaceResult(sigc::bind(sigc::mem_fun(m_airspacedb.get(), &AirspacesDbQueryInterface::find_by_text), nm, 0, comp, limit, loadsubtables),
 								    sigc::mem_fun(m_airspacedb.get(), &AirspacesDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1315,7 +1559,7 @@ Glib::RefPtr<Engine::DbThread::AirspaceResult> Engine::DbThread::airspace_find_b
 #endif
 		p = Glib::RefPtr<AirspaceResult>(new AirspaceResult(sigc::bind(sigc::mem_fun(m_airspacedb.get(), &AirspacesDbQueryInterface::find_by_rect), rect, limit, loadsubtables),
 								    sigc::mem_fun(m_airspacedb.get(), &AirspacesDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_rendering);
 	return p;
 }
 
@@ -1329,7 +1573,7 @@ Glib::RefPtr<Engine::DbThread::AirspaceResult> Engine::DbThread::airspace_find_n
 #endif
 		p = Glib::RefPtr<AirspaceResult>(new AirspaceResult(sigc::bind(sigc::mem_fun(m_airspacedb.get(), &AirspacesDbQueryInterface::find_nearest), pt, rect, limit, loadsubtables),
 								    sigc::mem_fun(m_airspacedb.get(), &AirspacesDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1337,7 +1581,7 @@ Glib::RefPtr<Engine::DbThread::AirspaceSaveResult> Engine::DbThread::airspace_sa
 {
 	Glib::RefPtr<AirspaceSaveResult> p(new AirspaceSaveResult(sigc::bind(sigc::mem_fun(m_airspacedb.get(), &AirspacesDbQueryInterface::save), e),
 								  sigc::mem_fun(m_airspacedb.get(), &AirspacesDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1351,7 +1595,20 @@ Glib::RefPtr<Engine::DbThread::NavaidResult> Engine::DbThread::navaid_find_by_ic
 #endif
 		p = Glib::RefPtr<NavaidResult>(new NavaidResult(sigc::bind(sigc::mem_fun(m_navaiddb.get(), &NavaidsDbQueryInterface::find_by_icao), nm, 0, comp, limit, loadsubtables),
 								sigc::mem_fun(m_navaiddb.get(), &NavaidsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
+	return p;
+}
+
+Glib::RefPtr<Engine::DbThread::NavaidResult> Engine::DbThread::navaid_find_by_icao(const std::vector<std::string>& nm, NavaidsDb::comp_t comp, unsigned int loadsubtables)
+{
+	Glib::RefPtr<NavaidResult> p;
+#ifdef HAVE_PILOTLINK
+	if (m_palmnavaiddb.is_open())
+		return p;
+#endif
+	p = Glib::RefPtr<NavaidResult>(new NavaidResult(sigc::bind(sigc::mem_fun(m_navaiddb.get(), &NavaidsDbQueryInterface::find_by_field), std::string("ICAO"), nm, comp, loadsubtables),
+					     sigc::mem_fun(m_navaiddb.get(), &NavaidsDbQueryInterface::interrupt)));
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1365,7 +1622,7 @@ Glib::RefPtr<Engine::DbThread::NavaidResult> Engine::DbThread::navaid_find_by_na
 #endif
 		p = Glib::RefPtr<NavaidResult>(new NavaidResult(sigc::bind(sigc::mem_fun(m_navaiddb.get(), &NavaidsDbQueryInterface::find_by_name), nm, 0, comp, limit, loadsubtables),
 								sigc::mem_fun(m_navaiddb.get(), &NavaidsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1379,7 +1636,7 @@ Glib::RefPtr<Engine::DbThread::NavaidResult> Engine::DbThread::navaid_find_by_te
 #endif
 		p = Glib::RefPtr<NavaidResult>(new NavaidResult(sigc::bind(sigc::mem_fun(m_navaiddb.get(), &NavaidsDbQueryInterface::find_by_text), nm, 0, comp, limit, loadsubtables),
 								sigc::mem_fun(m_navaiddb.get(), &NavaidsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1393,7 +1650,7 @@ Glib::RefPtr<Engine::DbThread::NavaidResult> Engine::DbThread::navaid_find_bbox(
 #endif
 		p = Glib::RefPtr<NavaidResult>(new NavaidResult(sigc::bind(sigc::mem_fun(m_navaiddb.get(), &NavaidsDbQueryInterface::find_by_rect), rect, limit, loadsubtables),
 								sigc::mem_fun(m_navaiddb.get(), &NavaidsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_rendering);
 	return p;
 }
 
@@ -1407,15 +1664,21 @@ Glib::RefPtr<Engine::DbThread::NavaidResult> Engine::DbThread::navaid_find_neare
 #endif
 		p = Glib::RefPtr<NavaidResult>(new NavaidResult(sigc::bind(sigc::mem_fun(m_navaiddb.get(), &NavaidsDbQueryInterface::find_nearest), pt, rect, limit, loadsubtables),
 								sigc::mem_fun(m_navaiddb.get(), &NavaidsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
+void Engine::DbThread::navaid_save_action(NavaidsDb::Navaid& e)
+{
+	m_navaiddb->save(e);
+	db_changed();
+}
+
 Glib::RefPtr<Engine::DbThread::NavaidSaveResult> Engine::DbThread::navaid_save(const NavaidsDb::Navaid & e)
 {
-	Glib::RefPtr<NavaidSaveResult> p(new NavaidSaveResult(sigc::bind(sigc::mem_fun(m_navaiddb.get(), &NavaidsDbQueryInterface::save), e),
+	Glib::RefPtr<NavaidSaveResult> p(new NavaidSaveResult(sigc::bind(sigc::mem_fun(*this, &DbThread::navaid_save_action), e),
 							      sigc::mem_fun(m_navaiddb.get(), &NavaidsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1429,7 +1692,20 @@ Glib::RefPtr<Engine::DbThread::WaypointResult> Engine::DbThread::waypoint_find_b
 #endif
 		p = Glib::RefPtr<WaypointResult>(new WaypointResult(sigc::bind(sigc::mem_fun(m_waypointdb.get(), &WaypointsDbQueryInterface::find_by_name), nm, 0, comp, limit, loadsubtables),
 								    sigc::mem_fun(m_waypointdb.get(), &WaypointsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
+	return p;
+}
+
+Glib::RefPtr<Engine::DbThread::WaypointResult> Engine::DbThread::waypoint_find_by_name(const std::vector<std::string>& nm, WaypointsDb::comp_t comp, unsigned int loadsubtables)
+{
+	Glib::RefPtr<WaypointResult> p;
+#ifdef HAVE_PILOTLINK
+	if (m_palmwaypointdb.is_open())
+		return p;
+#endif
+	p = Glib::RefPtr<WaypointResult>(new WaypointResult(sigc::bind(sigc::mem_fun(m_waypointdb.get(), &WaypointsDbQueryInterface::find_by_field), std::string("NAME"), nm, comp, loadsubtables),
+					     sigc::mem_fun(m_waypointdb.get(), &WaypointsDbQueryInterface::interrupt)));
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1443,7 +1719,7 @@ Glib::RefPtr<Engine::DbThread::WaypointResult> Engine::DbThread::waypoint_find_b
 #endif
 		p = Glib::RefPtr<WaypointResult>(new WaypointResult(sigc::bind(sigc::mem_fun(m_waypointdb.get(), &WaypointsDbQueryInterface::find_by_rect), rect, limit, loadsubtables),
 								    sigc::mem_fun(m_waypointdb.get(), &WaypointsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_rendering);
 	return p;
 }
 
@@ -1457,15 +1733,21 @@ Glib::RefPtr<Engine::DbThread::WaypointResult> Engine::DbThread::waypoint_find_n
 #endif
 		p = Glib::RefPtr<WaypointResult>(new WaypointResult(sigc::bind(sigc::mem_fun(m_waypointdb.get(), &WaypointsDbQueryInterface::find_nearest), pt, rect, limit, loadsubtables),
 								    sigc::mem_fun(m_waypointdb.get(), &WaypointsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
+void Engine::DbThread::waypoint_save_action(WaypointsDb::Waypoint& e)
+{
+	m_waypointdb->save(e);
+	db_changed();
+}
+
 Glib::RefPtr<Engine::DbThread::WaypointSaveResult> Engine::DbThread::waypoint_save(const WaypointsDb::Waypoint & e)
 {
-	Glib::RefPtr<WaypointSaveResult> p(new WaypointSaveResult(sigc::bind(sigc::mem_fun(m_waypointdb.get(), &WaypointsDbQueryInterface::save), e),
+	Glib::RefPtr<WaypointSaveResult> p(new WaypointSaveResult(sigc::bind(sigc::mem_fun(*this, &DbThread::waypoint_save_action), e),
 								  sigc::mem_fun(m_waypointdb.get(), &WaypointsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1474,7 +1756,16 @@ Glib::RefPtr<Engine::DbThread::AirwayResult> Engine::DbThread::airway_find_by_na
 	Glib::RefPtr<AirwayResult> p;
 	p = Glib::RefPtr<AirwayResult>(new AirwayResult(sigc::bind(sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::find_by_name), nm, 0, comp, limit, loadsubtables),
 				       sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
+	return p;
+}
+
+Glib::RefPtr<Engine::DbThread::AirwayResult> Engine::DbThread::airway_find_by_name(const std::vector<std::string>& nm, AirwaysDb::comp_t comp, unsigned int loadsubtables)
+{
+	Glib::RefPtr<AirwayResult> p;
+	p = Glib::RefPtr<AirwayResult>(new AirwayResult(sigc::bind(sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::find_by_field), std::string("NAME"), nm, comp, loadsubtables),
+					     sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::interrupt)));
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1483,7 +1774,7 @@ Glib::RefPtr<Engine::DbThread::AirwayResult> Engine::DbThread::airway_find_by_te
 	Glib::RefPtr<AirwayResult> p;
 	p = Glib::RefPtr<AirwayResult>(new AirwayResult(sigc::bind(sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::find_by_text), nm, 0, comp, limit, loadsubtables),
 				       sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1492,7 +1783,7 @@ Glib::RefPtr<Engine::DbThread::AirwayResult> Engine::DbThread::airway_find_bbox(
 	Glib::RefPtr<AirwayResult> p;
 	p = Glib::RefPtr<AirwayResult>(new AirwayResult(sigc::bind(sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::find_by_rect), rect, limit, loadsubtables),
 				       sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_rendering);
 	return p;
 }
 
@@ -1501,7 +1792,7 @@ Glib::RefPtr<Engine::DbThread::AirwayResult> Engine::DbThread::airway_find_area(
 	Glib::RefPtr<AirwayResult> p;
 	p = Glib::RefPtr<AirwayResult>(new AirwayResult(sigc::bind(sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::find_by_area), rect, limit, loadsubtables),
 				       sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_rendering);
 	return p;
 }
 
@@ -1510,15 +1801,30 @@ Glib::RefPtr<Engine::DbThread::AirwayResult> Engine::DbThread::airway_find_neare
 	Glib::RefPtr<AirwayResult> p;
 	p = Glib::RefPtr<AirwayResult>(new AirwayResult(sigc::bind(sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::find_nearest), pt, rect, limit, loadsubtables),
 				       sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
+void Engine::DbThread::db_changed(void)
+{
+	g_atomic_int_inc(&m_revision);
+	IcaoFlightPlan::FindCoord::cache_clear();
+}
+
+void Engine::DbThread::airway_save_action(AirwaysDb::Airway& e)
+{
+	m_airwaydb->save(e);
+#ifdef HAVE_BOOST
+	m_airwaycache->invalidate();
+#endif
+	db_changed();
+}
+
 Glib::RefPtr<Engine::DbThread::AirwaySaveResult> Engine::DbThread::airway_save(const AirwaysDb::Airway & e)
 {
-	Glib::RefPtr<AirwaySaveResult> p(new AirwaySaveResult(sigc::bind(sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::save), e),
+	Glib::RefPtr<AirwaySaveResult> p(new AirwaySaveResult(sigc::bind(sigc::mem_fun(*this, &DbThread::airway_save_action), e),
 					 sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1529,7 +1835,7 @@ Glib::RefPtr<Engine::DbThread::AirwayGraphResult> Engine::DbThread::airway_graph
 	Glib::RefPtr<AirwayGraphResult> p;
 	p = Glib::RefPtr<AirwayGraphResult>(new AirwayGraphResult(sigc::bind(sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::find_by_name), nm, 0, comp, limit, loadsubtables),
 								  sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1538,25 +1844,25 @@ Glib::RefPtr<Engine::DbThread::AirwayGraphResult> Engine::DbThread::airway_graph
 	Glib::RefPtr<AirwayGraphResult> p;
 	p = Glib::RefPtr<AirwayGraphResult>(new AirwayGraphResult(sigc::bind(sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::find_by_text), nm, 0, comp, limit, loadsubtables),
 								  sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
 Glib::RefPtr<Engine::DbThread::AirwayGraphResult> Engine::DbThread::airway_graph_find_bbox(const Rect & rect, unsigned int limit, unsigned int loadsubtables)
 {
 	Glib::RefPtr<AirwayGraphResult> p;
-	p = Glib::RefPtr<AirwayGraphResult>(new AirwayGraphResult(sigc::bind(sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::find_by_rect), rect, limit, loadsubtables),
+	p = Glib::RefPtr<AirwayGraphResult>(new AirwayGraphResult(sigc::bind(sigc::mem_fun(m_airwaycache.get(), &AirwayCache::find_by_rect), rect, limit),
 								  sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_rendering);
 	return p;
 }
 
 Glib::RefPtr<Engine::DbThread::AirwayGraphResult> Engine::DbThread::airway_graph_find_area(const Rect & rect, unsigned int limit, unsigned int loadsubtables)
 {
 	Glib::RefPtr<AirwayGraphResult> p;
-	p = Glib::RefPtr<AirwayGraphResult>(new AirwayGraphResult(sigc::bind(sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::find_by_area), rect, limit, loadsubtables),
+	p = Glib::RefPtr<AirwayGraphResult>(new AirwayGraphResult(sigc::bind(sigc::mem_fun(m_airwaycache.get(), &AirwayCache::find_by_area), rect, limit),
 								  sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_rendering);
 	return p;
 }
 
@@ -1565,7 +1871,7 @@ Glib::RefPtr<Engine::DbThread::AirwayGraphResult> Engine::DbThread::airway_graph
 	Glib::RefPtr<AirwayGraphResult> p;
 	p = Glib::RefPtr<AirwayGraphResult>(new AirwayGraphResult(sigc::bind(sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::find_nearest), pt, rect, limit, loadsubtables),
 								  sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1573,13 +1879,13 @@ Glib::RefPtr<Engine::DbThread::AreaGraphResult> Engine::DbThread::area_graph_fin
 {
 	Glib::RefPtr<AreaGraphResult> p;
 	p = Glib::RefPtr<AreaGraphResult>(new AreaGraphResult(rect, false,
-							      (tmask & AreaGraphResult::Vertex::typemask_airway) ? m_airwaydb.get() : 0,
+							      (tmask & AreaGraphResult::Vertex::typemask_airway) ? m_airwaycache.get() : 0,
 							      (tmask & AreaGraphResult::Vertex::typemask_airport) ? m_airportdb.get() : 0,
 							      (tmask & AreaGraphResult::Vertex::typemask_navaid) ? m_navaiddb.get() : 0,
 							      (tmask & AreaGraphResult::Vertex::typemask_intersection) ? m_waypointdb.get() : 0,
 							      (tmask & AreaGraphResult::Vertex::typemask_mapelement) ? m_mapelementdb.get() : 0,
 							      sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_rendering);
 	return p;
 }
 
@@ -1587,13 +1893,13 @@ Glib::RefPtr<Engine::DbThread::AreaGraphResult> Engine::DbThread::area_graph_fin
 {
 	Glib::RefPtr<AreaGraphResult> p;
 	p = Glib::RefPtr<AreaGraphResult>(new AreaGraphResult(rect, true,
-							      (tmask & AreaGraphResult::Vertex::typemask_airway) ? m_airwaydb.get() : 0,
+							      (tmask & AreaGraphResult::Vertex::typemask_airway) ? m_airwaycache.get() : 0,
 							      (tmask & AreaGraphResult::Vertex::typemask_airport) ? m_airportdb.get() : 0,
 							      (tmask & AreaGraphResult::Vertex::typemask_navaid) ? m_navaiddb.get() : 0,
 							      (tmask & AreaGraphResult::Vertex::typemask_intersection) ? m_waypointdb.get() : 0,
 							      (tmask & AreaGraphResult::Vertex::typemask_mapelement) ? m_mapelementdb.get() : 0,
 							      sigc::mem_fun(m_airwaydb.get(), &AirwaysDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_rendering);
 	return p;
 }
 #endif
@@ -1608,7 +1914,20 @@ Glib::RefPtr<Engine::DbThread::MapelementResult> Engine::DbThread::mapelement_fi
 #endif
 		p = Glib::RefPtr<MapelementResult>(new MapelementResult(sigc::bind(sigc::mem_fun(m_mapelementdb.get(), &MapelementsDbQueryInterface::find_by_name), nm, 0, comp, limit, loadsubtables),
 									sigc::mem_fun(m_mapelementdb.get(), &MapelementsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
+	return p;
+}
+
+Glib::RefPtr<Engine::DbThread::MapelementResult> Engine::DbThread::mapelement_find_by_name(const std::vector<std::string>& nm, MapelementsDb::comp_t comp, unsigned int loadsubtables)
+{
+	Glib::RefPtr<MapelementResult> p;
+#ifdef HAVE_PILOTLINK
+	if (m_palmmapelementdb.is_open())
+		return p;
+#endif
+	p = Glib::RefPtr<MapelementResult>(new MapelementResult(sigc::bind(sigc::mem_fun(m_mapelementdb.get(), &MapelementsDbQueryInterface::find_by_field), std::string("NAME"), nm, comp, loadsubtables),
+					     sigc::mem_fun(m_mapelementdb.get(), &MapelementsDbQueryInterface::interrupt)));
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1622,7 +1941,7 @@ Glib::RefPtr<Engine::DbThread::MapelementResult> Engine::DbThread::mapelement_fi
 #endif
 		p = Glib::RefPtr<MapelementResult>(new MapelementResult(sigc::bind(sigc::mem_fun(m_mapelementdb.get(), &MapelementsDbQueryInterface::find_by_rect), rect, limit, loadsubtables),
 									sigc::mem_fun(m_mapelementdb.get(), &MapelementsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_rendering);
 	return p;
 }
 
@@ -1636,15 +1955,21 @@ Glib::RefPtr<Engine::DbThread::MapelementResult> Engine::DbThread::mapelement_fi
 #endif
 		p = Glib::RefPtr<MapelementResult>(new MapelementResult(sigc::bind(sigc::mem_fun(m_mapelementdb.get(), &MapelementsDbQueryInterface::find_nearest), pt, rect, limit, loadsubtables),
 									sigc::mem_fun(m_mapelementdb.get(), &MapelementsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
+void Engine::DbThread::mapelement_save_action(MapelementsDb::Mapelement& e)
+{
+	m_mapelementdb->save(e);
+	db_changed();
+}
+
 Glib::RefPtr<Engine::DbThread::MapelementSaveResult> Engine::DbThread::mapelement_save(const MapelementsDb::Mapelement & e)
 {
-	Glib::RefPtr<MapelementSaveResult> p(new MapelementSaveResult(sigc::bind(sigc::mem_fun(m_mapelementdb.get(), &MapelementsDbQueryInterface::save), e),
+	Glib::RefPtr<MapelementSaveResult> p(new MapelementSaveResult(sigc::bind(sigc::mem_fun(*this, &DbThread::mapelement_save_action), e),
 								      sigc::mem_fun(m_mapelementdb.get(), &MapelementsDbQueryInterface::interrupt)));
-	queue(p);
+	queue(p, lane_interactive);
 	return p;
 }
 
@@ -1657,7 +1982,7 @@ Glib::RefPtr<Engine::DbThread::ElevationResult> Engine::DbThread::elevation_poin
 	else
 #endif
 		p = Glib::RefPtr<ElevationResult>(new ElevationResult(pt, m_topodb));
-	queue(p);
+	queue(p, lane_interactive, worker_topo);
 	return p;
 }
 
@@ -1670,7 +1995,7 @@ Glib::RefPtr<Engine::DbThread::ElevationMapResult> Engine::DbThread::elevation_m
 	else
 #endif
 		p = Glib::RefPtr<ElevationMapResult>(new ElevationMapResult(bbox, m_topodb));
-	queue(p);
+	queue(p, lane_rendering, worker_topo);
 	return p;
 }
 
@@ -1683,7 +2008,7 @@ Glib::RefPtr<Engine::DbThread::ElevationMapCairoResult> Engine::DbThread::elevat
 	else
 #endif
 		p = Glib::RefPtr<ElevationMapCairoResult>(new ElevationMapCairoResult(bbox, m_topodb));
-	queue(p);
+	queue(p, lane_rendering, worker_topo);
 	return p;
 }
 
@@ -1696,7 +2021,7 @@ Glib::RefPtr<Engine::DbThread::ElevationMinMaxResult> Engine::DbThread::elevatio
 	else
 #endif
 		p = Glib::RefPtr<ElevationMinMaxResult>(new ElevationMinMaxResult(r, m_topodb));
-	queue(p);
+	queue(p, lane_bulk, worker_topo);
 	return p;
 }
 
@@ -1709,7 +2034,7 @@ Glib::RefPtr<Engine::DbThread::ElevationMinMaxResult> Engine::DbThread::elevatio
 	else
 #endif
 		p = Glib::RefPtr<ElevationMinMaxResult>(new ElevationMinMaxResult(po, m_topodb));
-	queue(p);
+	queue(p, lane_bulk, worker_topo);
 	return p;
 }
 
@@ -1722,7 +2047,7 @@ Glib::RefPtr<Engine::DbThread::ElevationMinMaxResult> Engine::DbThread::elevatio
 	else
 #endif
 		p = Glib::RefPtr<ElevationMinMaxResult>(new ElevationMinMaxResult(po, m_topodb));
-	queue(p);
+	queue(p, lane_bulk, worker_topo);
 	return p;
 }
 
@@ -1735,7 +2060,7 @@ Glib::RefPtr<Engine::DbThread::ElevationMinMaxResult> Engine::DbThread::elevatio
 	else
 #endif
 		p = Glib::RefPtr<ElevationMinMaxResult>(new ElevationMinMaxResult(po, m_topodb));
-	queue(p);
+	queue(p, lane_bulk, worker_topo);
 	return p;
 }
 
@@ -1748,7 +2073,7 @@ Glib::RefPtr<Engine::DbThread::ElevationProfileResult> Engine::DbThread::elevati
 	else
 #endif
 		p = Glib::RefPtr<ElevationProfileResult>(new ElevationProfileResult(p0, p1, corridor_width, m_topodb));
-	queue(p);
+	queue(p, lane_bulk, worker_topo);
 	return p;
 }
 
@@ -1761,6 +2086,6 @@ Glib::RefPtr<Engine::DbThread::ElevationRouteProfileResult> Engine::DbThread::el
 	else
 #endif
 		p = Glib::RefPtr<ElevationRouteProfileResult>(new ElevationRouteProfileResult(fpl, corridor_width, m_topodb));
-	queue(p);
+	queue(p, lane_bulk, worker_topo);
 	return p;
 }
@@ -295,6 +295,37 @@ private:
 		};
 
 	public:
+		// query priority: interactive lookups are served before map rendering, which
+		// is served before bulk terrain evaluation
+		typedef enum {
+			lane_interactive,
+			lane_rendering,
+			lane_bulk,
+			lane_count
+		} lane_t;
+
+		class LaneStats {
+		public:
+			LaneStats(void);
+			unsigned int get_queued(void) const { return m_queued; }
+			uint64_t get_executed(void) const { return m_executed; }
+			uint64_t get_cancelled(void) const { return m_cancelled; }
+			// latencies are from queueing to completion, in seconds
+			double get_avg_latency(void) const { return m_executed ? m_latency / m_executed : 0; }
+			double get_max_latency(void) const { return m_maxlatency; }
+			void enqueue(void) { ++m_queued; }
+			void dequeue(void) { if (m_queued) --m_queued; }
+			void cancelled(void) { ++m_cancelled; }
+			void executed(double latency);
+
+		protected:
+			double m_latency;
+			double m_maxlatency;
+			uint64_t m_executed;
+			uint64_t m_cancelled;
+			unsigned int m_queued;
+		};
+
 		template <class Db> class Result : public ResultBase {
 		public:
 			typedef typename Db::element_t element_t;
@@ -483,6 +514,41 @@ private:
 		};
 
 #ifdef HAVE_BOOST
+		class AirwayCache {
+		public:
+			typedef AirwaysDb::element_t element_t;
+			typedef AirwaysDb::elementvector_t elementvector_t;
+
+			AirwayCache(AirwaysDbQueryInterface *db = 0, const std::string& dir_main = "", const std::string& dir_aux = "");
+			void invalidate(void);
+			elementvector_t find_by_rect(const Rect& r, unsigned int limit = 0);
+			elementvector_t find_by_area(const Rect& r, unsigned int limit = 0);
+
+		protected:
+			static const unsigned int tile_shift = 26;
+			static const unsigned int tile_mask = (1U << (32 - tile_shift)) - 1U;
+			typedef std::vector<unsigned int> indexvector_t;
+			typedef std::map<unsigned int,indexvector_t> tiles_t;
+			typedef std::map<Glib::ustring,indexvector_t> names_t;
+
+			class Loader;
+
+			AirwaysDbQueryInterface *m_db;
+			std::string m_path[2];
+			time_t m_mtime[2];
+			elementvector_t m_elements;
+			std::vector<Rect> m_bbox;
+			tiles_t m_tiles;
+			names_t m_names;
+			bool m_loaded;
+
+			void revalidate(void);
+			void load(void);
+			void add_tiles(const Rect& r, unsigned int idx);
+			indexvector_t find_indices(const Rect& r) const;
+			elementvector_t get_elements(const indexvector_t& idx, unsigned int limit) const;
+		};
+
 		class AirwayGraphResult : public ResultBase {
 		public:
 			typedef AirwaysDb::element_t element_t;
@@ -691,14 +757,14 @@ private:
 
 		class AreaGraphResult : public AirwayGraphResult {
 		public:
-			AreaGraphResult(const Rect& rect, bool area = false, AirwaysDbQueryInterface *airwaydb = 0,
+			AreaGraphResult(const Rect& rect, bool area = false, AirwayCache *airwaycache = 0,
 					AirportsDbQueryInterface *airportdb = 0, NavaidsDbQueryInterface *navaiddb = 0,
 					WaypointsDbQueryInterface *waypointdb = 0, MapelementsDbQueryInterface *mapelementdb = 0,
 					const sigc::slot<void>& dbcancel = sigc::slot<void>());
 
 		protected:
 			Rect m_rect;
-			AirwaysDbQueryInterface *m_airwaydb;
+			AirwayCache *m_airwaycache;
 			AirportsDbQueryInterface *m_airportdb;
 			NavaidsDbQueryInterface *m_navaiddb;
 			WaypointsDbQueryInterface *m_waypointdb;
@@ -719,7 +785,14 @@ private:
 		DbThread(const std::string& dir_main = "", const std::string& dir_aux = "", bool pg = false);
 		~DbThread();
 
+		// unique per database thread instance, never reused within the process
+		unsigned int get_serial(void) const { return m_serial; }
+		// incremented whenever an element is saved through this thread
+		unsigned int get_revision(void) const { return g_atomic_int_get(&m_revision); }
+
 		Glib::RefPtr<AirportResult> airport_find_by_icao(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, AirportsDb::comp_t comp = AirportsDb::comp_contains, unsigned int loadsubtables = ~0);
+		// one query for a list of names; null on palm databases
+		Glib::RefPtr<AirportResult> airport_find_by_icao(const std::vector<std::string>& nm, AirportsDb::comp_t comp = AirportsDb::comp_exact, unsigned int loadsubtables = ~0);
 		Glib::RefPtr<AirportResult> airport_find_by_name(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, AirportsDb::comp_t comp = AirportsDb::comp_contains, unsigned int loadsubtables = ~0);
 		Glib::RefPtr<AirportResult> airport_find_by_text(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, AirportsDb::comp_t comp = AirportsDb::comp_contains, unsigned int loadsubtables = ~0);
 		Glib::RefPtr<AirportResult> airport_find_bbox(const Rect& rect, unsigned int limit = ~0, unsigned int loadsubtables = ~0);
@@ -734,6 +807,7 @@ private:
 		Glib::RefPtr<AirspaceSaveResult> airspace_save(const AirspacesDb::Airspace& e);
 
 		Glib::RefPtr<NavaidResult> navaid_find_by_icao(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, NavaidsDb::comp_t comp = NavaidsDb::comp_contains, unsigned int loadsubtables = ~0);
+		Glib::RefPtr<NavaidResult> navaid_find_by_icao(const std::vector<std::string>& nm, NavaidsDb::comp_t comp = NavaidsDb::comp_exact, unsigned int loadsubtables = ~0);
 		Glib::RefPtr<NavaidResult> navaid_find_by_name(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, NavaidsDb::comp_t comp = NavaidsDb::comp_contains, unsigned int loadsubtables = ~0);
 		Glib::RefPtr<NavaidResult> navaid_find_by_text(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, NavaidsDb::comp_t comp = NavaidsDb::comp_contains, unsigned int loadsubtables = ~0);
 		Glib::RefPtr<NavaidResult> navaid_find_bbox(const Rect& rect, unsigned int limit = ~0, unsigned int loadsubtables = ~0);
@@ -741,11 +815,13 @@ private:
 		Glib::RefPtr<NavaidSaveResult> navaid_save(const NavaidsDb::Navaid& e);
 
 		Glib::RefPtr<WaypointResult> waypoint_find_by_name(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, WaypointsDb::comp_t comp = WaypointsDb::comp_contains, unsigned int loadsubtables = ~0);
+		Glib::RefPtr<WaypointResult> waypoint_find_by_name(const std::vector<std::string>& nm, WaypointsDb::comp_t comp = WaypointsDb::comp_exact, unsigned int loadsubtables = ~0);
 		Glib::RefPtr<WaypointResult> waypoint_find_bbox(const Rect& rect, unsigned int limit = ~0, unsigned int loadsubtables = ~0);
 		Glib::RefPtr<WaypointResult> waypoint_find_nearest(const Point& pt, unsigned int limit = ~0, const Rect& rect = Rect(), unsigned int loadsubtables = ~0);
 		Glib::RefPtr<WaypointSaveResult> waypoint_save(const WaypointsDb::Waypoint& e);
 
 		Glib::RefPtr<AirwayResult> airway_find_by_name(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, AirwaysDb::comp_t comp = AirwaysDb::comp_contains, unsigned int loadsubtables = ~0);
+		Glib::RefPtr<AirwayResult> airway_find_by_name(const std::vector<std::string>& nm, AirwaysDb::comp_t comp = AirwaysDb::comp_exact, unsigned int loadsubtables = ~0);
 		Glib::RefPtr<AirwayResult> airway_find_by_text(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, AirwaysDb::comp_t comp = AirwaysDb::comp_contains, unsigned int loadsubtables = ~0);
 		Glib::RefPtr<AirwayResult> airway_find_bbox(const Rect& rect, unsigned int limit = ~0, unsigned int loadsubtables = ~0);
 		Glib::RefPtr<AirwayResult> airway_find_area(const Rect& rect, unsigned int limit = ~0, unsigned int loadsubtables = ~0);
@@ -764,6 +840,7 @@ private:
 #endif
 
 		Glib::RefPtr<MapelementResult> mapelement_find_by_name(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, MapelementsDb::comp_t comp = MapelementsDb::comp_contains, unsigned int loadsubtables = ~0);
+		Glib::RefPtr<MapelementResult> mapelement_find_by_name(const std::vector<std::string>& nm, MapelementsDb::comp_t comp = MapelementsDb::comp_exact, unsigned int loadsubtables = ~0);
 		Glib::RefPtr<MapelementResult> mapelement_find_bbox(const Rect& rect, unsigned int limit = ~0, unsigned int loadsubtables = ~0);
 		Glib::RefPtr<MapelementResult> mapelement_find_nearest(const Point& pt, unsigned int limit = ~0, const Rect& rect = Rect(), unsigned int loadsubtables = ~0);
 		Glib::RefPtr<MapelementSaveResult> mapelement_save(const MapelementsDb::Mapelement& e);
@@ -778,13 +855,37 @@ private:
 		Glib::RefPtr<ElevationProfileResult> elevation_profile(const Point& p0, const Point& p1, double corridor_width = 5);
 		Glib::RefPtr<ElevationRouteProfileResult> elevation_profile(const FPlanRoute& fpl, double corridor_width = 5);
 
+		LaneStats get_stats(lane_t lane) const;
+
 	private:
+		// terrain queries use a separate database and are executed by their own thread,
+		// so a long running elevation map does not delay navigation database lookups
+		typedef enum {
+			worker_nav,
+			worker_topo,
+			worker_count
+		} worker_t;
+
+		class Task {
+		public:
+			Task(const Glib::RefPtr<ResultBase>& task = Glib::RefPtr<ResultBase>());
+			const Glib::RefPtr<ResultBase>& get_task(void) const { return m_task; }
+			const Glib::TimeVal& get_queuetime(void) const { return m_queuetime; }
+
+		protected:
+			Glib::RefPtr<ResultBase> m_task;
+			Glib::TimeVal m_queuetime;
+		};
+
 		std::unique_ptr<AirportsDbQueryInterface> m_airportdb;
 		std::unique_ptr<NavaidsDbQueryInterface> m_navaiddb;
 		std::unique_ptr<WaypointsDbQueryInterface> m_waypointdb;
 		std::unique_ptr<AirwaysDbQueryInterface> m_airwaydb;
 		std::unique_ptr<AirspacesDbQueryInterface> m_airspacedb;
 		std::unique_ptr<MapelementsDbQueryInterface> m_mapelementdb;
+#ifdef HAVE_BOOST
+		std::unique_ptr<AirwayCache> m_airwaycache;
+#endif
 		TopoDb30 m_topodb;
 #ifdef HAVE_PQXX
 		typedef std::unique_ptr<pqxx::lazyconnection> pgconn_t;
@@ -798,14 +899,24 @@ private:
 		PalmMapelements m_palmmapelementdb;
 		PalmGtopo m_palmgtopodb;
 #endif
+		static gint serialcounter;
+		unsigned int m_serial;
+		mutable gint m_revision;
 		bool m_terminate;
-		Glib::Mutex m_mutex;
+		mutable Glib::Mutex m_mutex;
 		Glib::Cond m_cond;
-		Glib::Thread *m_thread;
-		std::list<Glib::RefPtr<ResultBase> > m_tasklist;
-
-		void thread(void);
-		template<class T> void queue(Glib::RefPtr<T>& p);
+		Glib::Thread *m_thread[worker_count];
+		std::list<Task> m_tasklist[worker_count][lane_count];
+		LaneStats m_stats[lane_count];
+
+		void thread(worker_t worker);
+		void db_changed(void);
+		void airport_save_action(AirportsDb::Airport& e);
+		void navaid_save_action(NavaidsDb::Navaid& e);
+		void waypoint_save_action(WaypointsDb::Waypoint& e);
+		void airway_save_action(AirwaysDb::Airway& e);
+		void mapelement_save_action(MapelementsDb::Mapelement& e);
+		template<class T> void queue(Glib::RefPtr<T>& p, lane_t lane, worker_t worker = worker_nav);
 	};
 
 public:
@@ -826,6 +937,8 @@ public:
 
 	const std::string& get_dir_main(void) const { return m_dir_main; }
 	const std::string& get_dir_aux(void) const { return m_dir_aux; }
+	unsigned int get_db_serial(void) const { return m_dbthread.get_serial(); }
+	unsigned int get_db_revision(void) const { return m_dbthread.get_revision(); }
 
 	void update_bitmapmaps(bool synchronous);
 
@@ -853,8 +966,11 @@ public:
 	typedef DbThread::ElevationRouteProfileResult ElevationRouteProfileResult;
 	typedef DbThread::ElevationMapResult ElevationMapResult;
 	typedef DbThread::ElevationMapCairoResult ElevationMapCairoResult;
+	typedef DbThread::lane_t dblane_t;
+	typedef DbThread::LaneStats DbLaneStats;
 
 	Glib::RefPtr<AirportResult> async_airport_find_by_icao(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, AirportsDb::comp_t comp = AirportsDb::comp_contains, unsigned int loadsubtables = ~0) { return m_dbthread.airport_find_by_icao(nm, limit, skip, comp, loadsubtables); }
+	Glib::RefPtr<AirportResult> async_airport_find_by_icao(const std::vector<std::string>& nm, AirportsDb::comp_t comp = AirportsDb::comp_exact, unsigned int loadsubtables = ~0) { return m_dbthread.airport_find_by_icao(nm, comp, loadsubtables); }
 	Glib::RefPtr<AirportResult> async_airport_find_by_name(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, AirportsDb::comp_t comp = AirportsDb::comp_contains, unsigned int loadsubtables = ~0) { return m_dbthread.airport_find_by_name(nm, limit, skip, comp, loadsubtables); }
 	Glib::RefPtr<AirportResult> async_airport_find_by_text(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, AirportsDb::comp_t comp = AirportsDb::comp_contains, unsigned int loadsubtables = ~0) { return m_dbthread.airport_find_by_text(nm, limit, skip, comp, loadsubtables); }
 	Glib::RefPtr<AirportResult> async_airport_find_bbox(const Rect& rect, unsigned int limit = ~0, unsigned int loadsubtables = ~0) { return m_dbthread.airport_find_bbox(rect, limit, loadsubtables); }
@@ -869,6 +985,7 @@ public:
 	Glib::RefPtr<AirspaceSaveResult> async_airspace_save(const AirspacesDb::Airspace& e) { return m_dbthread.airspace_save(e); }
 
 	Glib::RefPtr<NavaidResult> async_navaid_find_by_icao(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, NavaidsDb::comp_t comp = NavaidsDb::comp_contains, unsigned int loadsubtables = ~0) { return m_dbthread.navaid_find_by_icao(nm, limit, skip, comp, loadsubtables); }
+	Glib::RefPtr<NavaidResult> async_navaid_find_by_icao(const std::vector<std::string>& nm, NavaidsDb::comp_t comp = NavaidsDb::comp_exact, unsigned int loadsubtables = ~0) { return m_dbthread.navaid_find_by_icao(nm, comp, loadsubtables); }
 	Glib::RefPtr<NavaidResult> async_navaid_find_by_name(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, NavaidsDb::comp_t comp = NavaidsDb::comp_contains, unsigned int loadsubtables = ~0) { return m_dbthread.navaid_find_by_name(nm, limit, skip, comp, loadsubtables); }
 	Glib::RefPtr<NavaidResult> async_navaid_find_by_text(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, NavaidsDb::comp_t comp = NavaidsDb::comp_contains, unsigned int loadsubtables = ~0) { return m_dbthread.navaid_find_by_text(nm, limit, skip, comp, loadsubtables); }
 	Glib::RefPtr<NavaidResult> async_navaid_find_bbox(const Rect& rect, unsigned int limit = ~0, unsigned int loadsubtables = ~0) { return m_dbthread.navaid_find_bbox(rect, limit, loadsubtables); }
@@ -876,11 +993,13 @@ public:
 	Glib::RefPtr<NavaidSaveResult> async_navaid_save(const NavaidsDb::Navaid& e) { return m_dbthread.navaid_save(e); }
 
 	Glib::RefPtr<WaypointResult> async_waypoint_find_by_name(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, WaypointsDb::comp_t comp = WaypointsDb::comp_contains, unsigned int loadsubtables = ~0) { return m_dbthread.waypoint_find_by_name(nm, limit, skip, comp, loadsubtables); }
+	Glib::RefPtr<WaypointResult> async_waypoint_find_by_name(const std::vector<std::string>& nm, WaypointsDb::comp_t comp = WaypointsDb::comp_exact, unsigned int loadsubtables = ~0) { return m_dbthread.waypoint_find_by_name(nm, comp, loadsubtables); }
 	Glib::RefPtr<WaypointResult> async_waypoint_find_bbox(const Rect& rect, unsigned int limit = ~0, unsigned int loadsubtables = ~0) { return m_dbthread.waypoint_find_bbox(rect, limit, loadsubtables); }
 	Glib::RefPtr<WaypointResult> async_waypoint_find_nearest(const Point& pt, unsigned int limit = ~0, const Rect& rect = Rect(), unsigned int loadsubtables = ~0) { return m_dbthread.waypoint_find_nearest(pt, limit, rect, loadsubtables); }
 	Glib::RefPtr<WaypointSaveResult> async_waypoint_save(const WaypointsDb::Waypoint& e) { return m_dbthread.waypoint_save(e); }
 
 	Glib::RefPtr<AirwayResult> async_airway_find_by_name(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, AirwaysDb::comp_t comp = AirwaysDb::comp_contains, unsigned int loadsubtables = ~0) { return m_dbthread.airway_find_by_name(nm, limit, skip, comp, loadsubtables); }
+	Glib::RefPtr<AirwayResult> async_airway_find_by_name(const std::vector<std::string>& nm, AirwaysDb::comp_t comp = AirwaysDb::comp_exact, unsigned int loadsubtables = ~0) { return m_dbthread.airway_find_by_name(nm, comp, loadsubtables); }
 	Glib::RefPtr<AirwayResult> async_airway_find_by_text(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, AirwaysDb::comp_t comp = AirwaysDb::comp_contains, unsigned int loadsubtables = ~0) { return m_dbthread.airway_find_by_text(nm, limit, skip, comp, loadsubtables); }
 	Glib::RefPtr<AirwayResult> async_airway_find_bbox(const Rect& rect, unsigned int limit = ~0, unsigned int loadsubtables = ~0) { return m_dbthread.airway_find_bbox(rect, limit, loadsubtables); }
 	Glib::RefPtr<AirwayResult> async_airway_find_area(const Rect& rect, unsigned int limit = ~0, unsigned int loadsubtables = ~0) { return m_dbthread.airway_find_area(rect, limit, loadsubtables); }
@@ -899,6 +1018,7 @@ public:
 #endif
 
 	Glib::RefPtr<MapelementResult> async_mapelement_find_by_name(const Glib::ustring& nm = "", unsigned int limit = ~0, unsigned int skip = 0, MapelementsDb::comp_t comp = MapelementsDb::comp_contains, unsigned int loadsubtables = ~0) { return m_dbthread.mapelement_find_by_name(nm, limit, skip, comp, loadsubtables); }
+	Glib::RefPtr<MapelementResult> async_mapelement_find_by_name(const std::vector<std::string>& nm, MapelementsDb::comp_t comp = MapelementsDb::comp_exact, unsigned int loadsubtables = ~0) { return m_dbthread.mapelement_find_by_name(nm, comp, loadsubtables); }
 	Glib::RefPtr<MapelementResult> async_mapelement_find_bbox(const Rect& rect, unsigned int limit = ~0, unsigned int loadsubtables = ~0) { return m_dbthread.mapelement_find_bbox(rect, limit, loadsubtables); }
 	Glib::RefPtr<MapelementResult> async_mapelement_find_nearest(const Point& pt, unsigned int limit = ~0, const Rect& rect = Rect(), unsigned int loadsubtables = ~0) { return m_dbthread.mapelement_find_nearest(pt, limit, rect, loadsubtables); }
 	Glib::RefPtr<MapelementSaveResult> async_mapelement_save(const MapelementsDb::Mapelement& e) { return m_dbthread.mapelement_save(e); }
@@ -913,6 +1033,8 @@ public:
 	Glib::RefPtr<ElevationProfileResult> async_elevation_profile(const Point& p0, const Point& p1, double corridor_width = 5) { return m_dbthread.elevation_profile(p0, p1, corridor_width); }
 	Glib::RefPtr<ElevationRouteProfileResult> async_elevation_profile(const FPlanRoute& fpl, double corridor_width = 5) { return m_dbthread.elevation_profile(fpl, corridor_width); }
 
+	DbLaneStats get_db_stats(dblane_t lane) const { return m_dbthread.get_stats(lane); }
+
 	std::string get_aux_dir(auxdb_mode_t auxdbmode = auxdb_prefs, const std::string& dir_aux = "");
 	static std::string get_default_aux_dir(void);
 
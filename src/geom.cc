@@ -3728,30 +3728,17 @@ MultiPolygonHole PolygonSimple::make_fat_lines(float radius, bool roundcaps, flo
 	for (unsigned int i = 0, j = size() - 1, k = size(); i < k; j = i, ++i) {
 		PolygonSimple ps(operator[](i).make_fat_line(operator[](j), radius, roundcaps, angleincr, rawcoord));
 		ps.make_counterclockwise();
-		if (!(i & 1)) {
-			p.push_back(MultiPolygonHole());
-			p.back().push_back(PolygonHole(ps));
-			continue;
-		}
-		MultiPolygonHole ph2;
-		ph2.push_back(PolygonHole(ps));
-		p.back().geos_union(ph2);
-	}
-	while (p.size() > 1) {
-		std::vector<MultiPolygonHole> p2;
-		bool n(true);
-		for (std::vector<MultiPolygonHole>::const_iterator pi(p.begin()), pe(p.end()); pi != pe; ++pi, n = !n) {
-			if (n) {
-				p2.push_back(*pi);
-				continue;
-			}
-			p2.back().geos_union(*pi);
-		}
-		p.swap(p2);
+		p.push_back(MultiPolygonHole());
+		p.back().push_back(PolygonHole(ps));
 	}
 	if (p.empty())
 		return MultiPolygonHole();
-	return p.front();
+	MultiPolygonHole ph;
+	ph.swap(p.back());
+	p.pop_back();
+	if (!p.empty())
+		ph.geos_union(p);
+	return ph;
 }
 
 void PolygonSimple::bindblob(sqlite3x::sqlite3_command & cmd, int index) const
@@ -4653,6 +4640,125 @@ int MultiPolygonHole::windingnumber(const Point& pt) const
 	return wn;
 }
 
+PreparedPolygon::PreparedPolygon(const MultiPolygonHole& poly)
+	: m_latmin(0), m_latmax(-1), m_bucketsize(1), m_refcount(1)
+{
+	unsigned int ring(0);
+	for (MultiPolygonHole::const_iterator pi(poly.begin()), pe(poly.end()); pi != pe; ++pi) {
+		add_ring(pi->get_exterior(), ring++);
+		for (unsigned int i = 0, n = pi->get_nrinterior(); i < n; ++i)
+			add_ring((*pi)[i], ring++);
+	}
+	if (m_edges.empty()) {
+		m_bucketstart.resize(1, 0);
+		return;
+	}
+	m_latmin = std::numeric_limits<int64_t>::max();
+	m_latmax = std::numeric_limits<int64_t>::min();
+	for (edges_t::const_iterator ei(m_edges.begin()), ee(m_edges.end()); ei != ee; ++ei) {
+		m_latmin = std::min(m_latmin, (int64_t)std::min(ei->get_pt0().get_lat(), ei->get_pt1().get_lat()));
+		m_latmax = std::max(m_latmax, (int64_t)std::max(ei->get_pt0().get_lat(), ei->get_pt1().get_lat()));
+	}
+	unsigned int nrbuckets(std::max(std::min(m_edges.size() / 4, (edges_t::size_type)4096), (edges_t::size_type)1));
+	m_bucketsize = (m_latmax - m_latmin) / nrbuckets + 1;
+	m_bucketstart.resize(nrbuckets + 1, 0);
+	for (edges_t::const_iterator ei(m_edges.begin()), ee(m_edges.end()); ei != ee; ++ei) {
+		unsigned int b0(get_bucket(std::min(ei->get_pt0().get_lat(), ei->get_pt1().get_lat())));
+		unsigned int b1(get_bucket(std::max(ei->get_pt0().get_lat(), ei->get_pt1().get_lat())));
+		for (; b0 <= b1; ++b0)
+			++m_bucketstart[b0 + 1];
+	}
+	for (unsigned int b = 0; b < nrbuckets; ++b)
+		m_bucketstart[b + 1] += m_bucketstart[b];
+	m_bucketedges.resize(m_bucketstart[nrbuckets]);
+	std::vector<uint32_t> fill(m_bucketstart.begin(), m_bucketstart.end() - 1);
+	for (unsigned int i = 0, n = m_edges.size(); i < n; ++i) {
+		const Edge& e(m_edges[i]);
+		unsigned int b0(get_bucket(std::min(e.get_pt0().get_lat(), e.get_pt1().get_lat())));
+		unsigned int b1(get_bucket(std::max(e.get_pt0().get_lat(), e.get_pt1().get_lat())));
+		for (; b0 <= b1; ++b0)
+			m_bucketedges[fill[b0]++] = i;
+	}
+}
+
+void PreparedPolygon::add_ring(const PolygonSimple& ps, unsigned int ring)
+{
+	const unsigned int sz(ps.size());
+	unsigned int j = sz - 1;
+	for (unsigned int i = 0; i < sz; j = i, ++i)
+		m_edges.push_back(Edge(ps[j], ps[i], ring));
+}
+
+void PreparedPolygon::reference(void) const
+{
+	g_atomic_int_inc(&m_refcount);
+}
+
+void PreparedPolygon::unreference(void) const
+{
+	if (!g_atomic_int_dec_and_test(&m_refcount))
+		return;
+	delete this;
+}
+
+int PreparedPolygon::windingnumber(const Point& pt) const
+{
+	if (pt.get_lat() < m_latmin || pt.get_lat() > m_latmax)
+		return 0;
+	unsigned int b(get_bucket(pt.get_lat()));
+	// sum up the per ring winding numbers in ring order, like MultiPolygonHole::windingnumber
+	int wn(0), rwn(0);
+	unsigned int ring(~0U);
+	bool onedge(false);
+	for (std::vector<uint32_t>::const_iterator ii(m_bucketedges.begin() + m_bucketstart[b]), ie(m_bucketedges.begin() + m_bucketstart[b + 1]); ii != ie; ++ii) {
+		const Edge& e(m_edges[*ii]);
+		if (e.get_ring() != ring) {
+			if (ring != ~0U)
+				wn += onedge ? std::numeric_limits<int>::max() : rwn;
+			ring = e.get_ring();
+			rwn = 0;
+			onedge = false;
+		}
+		if (onedge)
+			continue;
+		const Point& ptj(e.get_pt0());
+		const Point& pti(e.get_pt1());
+		int64_t lon = Point::area2(ptj, pti, pt);
+		if (!lon) {
+			Rect bbox(ptj, ptj);
+			bbox = bbox.add(pti);
+			if (bbox.is_inside(pt)) {
+				onedge = true;
+				continue;
+			}
+		}
+		if (ptj.get_lat() <= pt.get_lat()) {
+			if (pti.get_lat() > pt.get_lat() && lon > 0)
+				++rwn;
+		} else {
+			if (pti.get_lat() <= pt.get_lat() && lon < 0)
+				--rwn;
+		}
+	}
+	if (ring != ~0U)
+		wn += onedge ? std::numeric_limits<int>::max() : rwn;
+	return wn;
+}
+
+bool PreparedPolygon::is_strict_intersection(const Point& la, const Point& lb) const
+{
+	int64_t latmin(std::min(la.get_lat(), lb.get_lat())), latmax(std::max(la.get_lat(), lb.get_lat()));
+	if (latmax < m_latmin || latmin > m_latmax)
+		return false;
+	unsigned int b0(get_bucket(std::max(latmin, m_latmin))), b1(get_bucket(std::min(latmax, m_latmax)));
+	for (std::vector<uint32_t>::const_iterator ii(m_bucketedges.begin() + m_bucketstart[b0]), ie(m_bucketedges.begin() + m_bucketstart[b1 + 1]); ii != ie; ++ii) {
+		const Edge& e(m_edges[*ii]);
+		if (Point::is_strict_intersection(la, lb, e.get_pt1(), e.get_pt0()))
+			return true;
+	}
+	return false;
+}
+
 MultiPolygonHole::ScanLine MultiPolygonHole::scanline(Point::coord_t lat) const
 {
 	ScanLine sl;
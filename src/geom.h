@@ -894,6 +894,8 @@ public:
 	void geos_make_valid(void);
 	void geos_union(const MultiPolygonHole& m);
 	void geos_union(const MultiPolygonHole& m, Point::coord_t lonoffs);
+	// union with all of m in a single operation, instead of one round trip per polygon
+	void geos_union(const std::vector<MultiPolygonHole>& m);
 	void geos_subtract(const MultiPolygonHole& m);
 	void geos_subtract(const MultiPolygonHole& m, Point::coord_t lonoffs);
 	void geos_intersect(const MultiPolygonHole& m);
@@ -932,6 +934,54 @@ protected:
 	static uint8_t const *blobdecode(PolygonHole& p, uint8_t const *data, uint8_t const *end);
 };
 
+// read-only copy of a MultiPolygonHole with its edges bucketed by latitude,
+// answers windingnumber and is_strict_intersection without scanning all edges
+class PreparedPolygon {
+public:
+	typedef Glib::RefPtr<PreparedPolygon> ptr_t;
+	typedef Glib::RefPtr<const PreparedPolygon> const_ptr_t;
+
+	PreparedPolygon(const MultiPolygonHole& poly = MultiPolygonHole());
+
+	void reference(void) const;
+	void unreference(void) const;
+
+	bool empty(void) const { return m_edges.empty(); }
+	unsigned int get_nredges(void) const { return m_edges.size(); }
+	unsigned int get_nrbuckets(void) const { return m_bucketstart.size() - 1; }
+	// same results as the corresponding MultiPolygonHole methods
+	int windingnumber(const Point& pt) const;
+	bool is_strict_intersection(const Point& la, const Point& lb) const;
+
+protected:
+	class Edge {
+	public:
+		Edge(const Point& pt0, const Point& pt1, unsigned int ring) : m_pt0(pt0), m_pt1(pt1), m_ring(ring) {}
+		const Point& get_pt0(void) const { return m_pt0; }
+		const Point& get_pt1(void) const { return m_pt1; }
+		unsigned int get_ring(void) const { return m_ring; }
+
+	protected:
+		Point m_pt0;
+		Point m_pt1;
+		unsigned int m_ring;
+	};
+
+	typedef std::vector<Edge> edges_t;
+	// edges in ring order
+	edges_t m_edges;
+	// bucket b contains m_bucketedges[m_bucketstart[b]] .. m_bucketedges[m_bucketstart[b+1]-1], in ascending edge order
+	std::vector<uint32_t> m_bucketstart;
+	std::vector<uint32_t> m_bucketedges;
+	int64_t m_latmin;
+	int64_t m_latmax;
+	int64_t m_bucketsize;
+	mutable gint m_refcount;
+
+	void add_ring(const PolygonSimple& ps, unsigned int ring);
+	unsigned int get_bucket(Point::coord_t lat) const { return (lat - m_latmin) / m_bucketsize; }
+};
+
 class Point3D : public Point {
 public:
 	typedef int32_t alt_t;
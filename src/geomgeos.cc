@@ -380,6 +380,53 @@ void MultiPolygonHole::geos_union(const MultiPolygonHole& m, Point::coord_t lono
 	swap(mp);
 }
 
+void MultiPolygonHole::geos_union(const std::vector<MultiPolygonHole>& m)
+{
+	Point::coord_t lonoffs;
+	ClipperLib::Clipper c;
+	{
+		std::vector<MultiPolygonHole> mp;
+		mp.reserve(m.size() + 1);
+		mp.push_back(*this);
+		mp.insert(mp.end(), m.begin(), m.end());
+		Rect bbox;
+		bbox.set_empty();
+		bool first(true);
+		for (std::vector<MultiPolygonHole>::iterator i(mp.begin()), e(mp.end()); i != e; ++i) {
+			i->normalize();
+			if (i->empty())
+				continue;
+			if (first)
+				bbox = i->get_bbox();
+			else
+				bbox = bbox.add(i->get_bbox());
+			first = false;
+		}
+		if (first) {
+			clear();
+			return;
+		}
+		lonoffs = bbox.get_west();
+		for (std::vector<MultiPolygonHole>::const_iterator i(mp.begin()), e(mp.end()); i != e; ++i) {
+			if (i->empty())
+				continue;
+#if defined(HAVE_CLIPPER_PATH)
+			ClipperLib::Paths cp;
+			to_clipper(cp, *i, lonoffs);
+			c.AddPaths(cp, ClipperLib::ptSubject, true);
+#else
+			ClipperLib::Polygons cp;
+			to_clipper(cp, *i, lonoffs);
+			c.AddPolygons(cp, ClipperLib::ptSubject);
+#endif
+		}
+	}
+	ClipperLibSolution sol;
+	c.Execute(ClipperLib::ctUnion, sol, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+	MultiPolygonHole mp(from_clipper(sol, lonoffs));
+	swap(mp);
+}
+
 void MultiPolygonHole::geos_subtract(const MultiPolygonHole& m)
 {
 	Point::coord_t lonoffs;
@@ -884,6 +931,54 @@ void MultiPolygonHole::geos_union(const MultiPolygonHole& m)
 	clear();
 }
 
+void MultiPolygonHole::geos_union(const std::vector<MultiPolygonHole>& m)
+{
+	for (unsigned int roundbits = 0; roundbits < 16; ++roundbits) {
+		bool dornd(!roundbits);
+		do {
+			geos::geom::GeometryFactory f;
+			::Point offs;
+			offs.set_invalid();
+			std::unique_ptr<std::vector<geos::geom::Geometry *> > polys(new std::vector<geos::geom::Geometry *>());
+			try {
+				for (std::vector<MultiPolygonHole>::size_type i = 0, n = m.size(); i <= n; ++i) {
+					MultiPolygonHole m1(i ? m[i - 1] : *this);
+					if (m1.empty())
+						continue;
+					if (dornd)
+						m1.randomize_bits(roundbits);
+					else
+						m1.snap_bits(roundbits);
+					polys->push_back(to_geos(f, m1, offs));
+				}
+			} catch (...) {
+				for (std::vector<geos::geom::Geometry *>::iterator i(polys->begin()), e(polys->end()); i != e; ++i)
+					delete *i;
+				throw;
+			}
+			dornd = !dornd;
+			geos::geom::GeometryCollection *gc(f.createGeometryCollection(polys.release()));
+			geos::geom::Geometry *g;
+			// unary union is a cascaded union over an STR tree
+			try {
+				g = gc->Union().release();
+			} catch (...) {
+				std::cerr << "MultiPolygonHole::geos_union: exception, roundbits " << roundbits << (dornd ? ", random" : "") << std::endl;
+				f.destroyGeometry(gc);
+				continue;
+			}
+			f.destroyGeometry(gc);
+			MultiPolygonHole ph(from_geos_any(g, offs));
+			f.destroyGeometry(g);
+			ph.remove_redundant_polypoints();
+			this->swap(ph);
+			return;
+		} while (dornd);
+	}
+	std::cerr << "MultiPolygonHole::geos_union: Warning: robustness error, zapping" << std::endl;
+	clear();
+}
+
 void MultiPolygonHole::geos_subtract(const MultiPolygonHole& m)
 {
 	for (unsigned int roundbits = 0; roundbits < 16; ++roundbits) {
@@ -1004,6 +1099,10 @@ void MultiPolygonHole::geos_union(const MultiPolygonHole& m)
 {
 }
 
+void MultiPolygonHole::geos_union(const std::vector<MultiPolygonHole>& m)
+{
+}
+
 void MultiPolygonHole::geos_subtract(const MultiPolygonHole& m)
 {
 }
@@ -109,9 +109,271 @@ const unsigned int IcaoFlightPlan::FindCoord::flag_coord;
 const unsigned int IcaoFlightPlan::FindCoord::flag_subtables;
 const std::string IcaoFlightPlan::FindCoord::empty;
 
+IcaoFlightPlan::FindCoord::CacheKey::CacheKey(const Engine& engine, bool byident, const std::string& ident,
+					      const std::string& name, unsigned int flags)
+	: m_ident(ident), m_name(name), m_dbserial(engine.get_db_serial()), m_dbrevision(engine.get_db_revision()),
+	  m_flags(flags), m_byident(byident)
+{
+}
+
+bool IcaoFlightPlan::FindCoord::CacheKey::operator<(const CacheKey& x) const
+{
+	if (m_dbserial < x.m_dbserial)
+		return true;
+	if (x.m_dbserial < m_dbserial)
+		return false;
+	if (m_dbrevision < x.m_dbrevision)
+		return true;
+	if (x.m_dbrevision < m_dbrevision)
+		return false;
+	if (m_byident < x.m_byident)
+		return true;
+	if (x.m_byident < m_byident)
+		return false;
+	if (m_flags < x.m_flags)
+		return true;
+	if (x.m_flags < m_flags)
+		return false;
+	int c(m_ident.compare(x.m_ident));
+	if (c)
+		return c < 0;
+	return m_name < x.m_name;
+}
+
+class IcaoFlightPlan::FindCoord::CacheEntry {
+public:
+	CacheEntry(void) : m_coordresult(Point::invalid) {}
+
+	Engine::AirportResult::elementvector_t m_airports;
+	Engine::NavaidResult::elementvector_t m_navaids;
+	Engine::WaypointResult::elementvector_t m_waypoints;
+	Engine::MapelementResult::elementvector_t m_mapelements;
+	Engine::AirwayResult::elementvector_t m_airways;
+	Point m_coordresult;
+	cachelru_t::iterator m_lru;
+};
+
+namespace {
+
+std::string prefetch_casefold(const std::string& s)
+{
+	// same folding as sqlite NOCASE collation: ASCII only
+	std::string r(s);
+	for (std::string::iterator i(r.begin()), e(r.end()); i != e; ++i)
+		if (*i >= 'a' && *i <= 'z')
+			*i += 'A' - 'a';
+	return r;
+}
+
+template <typename T> void prefetch_icao(T& out, const T& in, const std::string& ident)
+{
+	std::string id(prefetch_casefold(ident));
+	for (typename T::const_iterator i(in.begin()), e(in.end()); i != e; ++i)
+		if (prefetch_casefold(i->get_icao()) == id)
+			out.push_back(*i);
+}
+
+template <typename T> void prefetch_name(T& out, const T& in, const std::string& ident, bool contains)
+{
+	std::string id(prefetch_casefold(ident));
+	for (typename T::const_iterator i(in.begin()), e(in.end()); i != e; ++i) {
+		std::string nm(prefetch_casefold(i->get_name()));
+		if (contains ? (nm.find(id) != std::string::npos) : (nm == id))
+			out.push_back(*i);
+	}
+}
+
+};
+
+// batched lookups for all prefetched idents with the same subtables flag
+class IcaoFlightPlan::FindCoord::Prefetch {
+public:
+	void add(const std::string& ident, unsigned int flags) {
+		if (flags & flag_airport)
+			m_airportidents.push_back(ident);
+		if (flags & flag_navaid)
+			m_navaididents.push_back(ident);
+		if (flags & flag_waypoint)
+			m_waypointidents.push_back(ident);
+		if (flags & flag_mapelement)
+			m_mapelementidents.push_back(ident);
+		if (flags & flag_airway)
+			m_airwayidents.push_back(ident);
+	}
+
+	void query(Engine& eng, bool subtables) {
+		if (!m_airportidents.empty())
+			m_airportquery = eng.async_airport_find_by_icao(m_airportidents, AirportsDb::comp_exact,
+									subtables ? AirportsDb::element_t::subtables_all : AirportsDb::element_t::subtables_none);
+		if (!m_navaididents.empty())
+			m_navaidquery = eng.async_navaid_find_by_icao(m_navaididents, NavaidsDb::comp_exact,
+								      subtables ? NavaidsDb::element_t::subtables_all : NavaidsDb::element_t::subtables_none);
+		if (!m_waypointidents.empty())
+			m_waypointquery = eng.async_waypoint_find_by_name(m_waypointidents, WaypointsDb::comp_exact,
+									  subtables ? WaypointsDb::element_t::subtables_all : WaypointsDb::element_t::subtables_none);
+		if (!m_mapelementidents.empty())
+			m_mapelementquery = eng.async_mapelement_find_by_name(m_mapelementidents, MapelementsDb::comp_contains,
+									      subtables ? MapelementsDb::element_t::subtables_all : MapelementsDb::element_t::subtables_none);
+		if (!m_airwayidents.empty())
+			m_airwayelquery = eng.async_airway_find_by_name(m_airwayidents, AirwaysDb::comp_exact,
+									subtables ? AirwaysDb::element_t::subtables_all : AirwaysDb::element_t::subtables_none);
+	}
+
+	// false if the database cannot do batched lookups (palm)
+	bool is_queried(void) const {
+		return (m_airportidents.empty() || m_airportquery) &&
+			(m_navaididents.empty() || m_navaidquery) &&
+			(m_waypointidents.empty() || m_waypointquery) &&
+			(m_mapelementidents.empty() || m_mapelementquery) &&
+			(m_airwayidents.empty() || m_airwayelquery);
+	}
+
+	void connect(const sigc::slot<void>& done) {
+		if (m_airportquery)
+			m_airportquery->connect(done);
+		if (m_navaidquery)
+			m_navaidquery->connect(done);
+		if (m_waypointquery)
+			m_waypointquery->connect(done);
+		if (m_mapelementquery)
+			m_mapelementquery->connect(done);
+		if (m_airwayelquery)
+			m_airwayelquery->connect(done);
+	}
+
+	void cancel(void) {
+		Engine::AirportResult::cancel(m_airportquery);
+		Engine::NavaidResult::cancel(m_navaidquery);
+		Engine::WaypointResult::cancel(m_waypointquery);
+		Engine::MapelementResult::cancel(m_mapelementquery);
+		Engine::AirwayResult::cancel(m_airwayelquery);
+	}
+
+	bool is_done(void) const {
+		return (!m_airportquery || m_airportquery->is_done()) &&
+			(!m_navaidquery || m_navaidquery->is_done()) &&
+			(!m_waypointquery || m_waypointquery->is_done()) &&
+			(!m_mapelementquery || m_mapelementquery->is_done()) &&
+			(!m_airwayelquery || m_airwayelquery->is_done());
+	}
+
+	bool is_error(unsigned int flags) const {
+		return ((flags & flag_airport) && m_airportquery && m_airportquery->is_error()) ||
+			((flags & flag_navaid) && m_navaidquery && m_navaidquery->is_error()) ||
+			((flags & flag_waypoint) && m_waypointquery && m_waypointquery->is_error()) ||
+			((flags & flag_mapelement) && m_mapelementquery && m_mapelementquery->is_error()) ||
+			((flags & flag_airway) && m_airwayelquery && m_airwayelquery->is_error());
+	}
+
+	// pick the results for one ident out of the batched results
+	void get_result(FindCoord& fc, const std::string& ident, unsigned int flags) const {
+		if ((flags & flag_airport) && m_airportquery && !m_airportquery->is_error())
+			prefetch_icao(fc.m_airports, m_airportquery->get_result(), ident);
+		if ((flags & flag_navaid) && m_navaidquery && !m_navaidquery->is_error())
+			prefetch_icao(fc.m_navaids, m_navaidquery->get_result(), ident);
+		if ((flags & flag_waypoint) && m_waypointquery && !m_waypointquery->is_error())
+			prefetch_name(fc.m_waypoints, m_waypointquery->get_result(), ident, false);
+		if ((flags & flag_mapelement) && m_mapelementquery && !m_mapelementquery->is_error())
+			prefetch_name(fc.m_mapelements, m_mapelementquery->get_result(), ident, true);
+		if ((flags & flag_airway) && m_airwayelquery && !m_airwayelquery->is_error())
+			prefetch_name(fc.m_airways, m_airwayelquery->get_result(), ident, false);
+	}
+
+protected:
+	std::vector<std::string> m_airportidents;
+	std::vector<std::string> m_navaididents;
+	std::vector<std::string> m_waypointidents;
+	std::vector<std::string> m_mapelementidents;
+	std::vector<std::string> m_airwayidents;
+	Glib::RefPtr<Engine::AirportResult> m_airportquery;
+	Glib::RefPtr<Engine::NavaidResult> m_navaidquery;
+	Glib::RefPtr<Engine::WaypointResult> m_waypointquery;
+	Glib::RefPtr<Engine::MapelementResult> m_mapelementquery;
+	Glib::RefPtr<Engine::AirwayResult> m_airwayelquery;
+};
+
+IcaoFlightPlan::FindCoord::cache_t IcaoFlightPlan::FindCoord::m_cache;
+IcaoFlightPlan::FindCoord::cachelru_t IcaoFlightPlan::FindCoord::m_cachelru;
+Glib::Mutex IcaoFlightPlan::FindCoord::m_cachemutex;
+unsigned int IcaoFlightPlan::FindCoord::m_cachemaxsize = 4096;
+unsigned long IcaoFlightPlan::FindCoord::m_cachehits = 0;
+unsigned long IcaoFlightPlan::FindCoord::m_cachemisses = 0;
+
 IcaoFlightPlan::FindCoord::FindCoord(Engine& engine)
-	: m_engine(engine), m_coordresult(Point::invalid)
+	: m_engine(engine), m_coordresult(Point::invalid), m_queryerror(false)
+{
+}
+
+void IcaoFlightPlan::FindCoord::cache_clear(void)
+{
+	Glib::Mutex::Lock lock(m_cachemutex);
+	m_cache.clear();
+	m_cachelru.clear();
+}
+
+void IcaoFlightPlan::FindCoord::cache_set_maxsize(unsigned int sz)
+{
+	Glib::Mutex::Lock lock(m_cachemutex);
+	m_cachemaxsize = sz;
+	while (m_cache.size() > m_cachemaxsize && !m_cachelru.empty()) {
+		m_cache.erase(m_cachelru.back());
+		m_cachelru.pop_back();
+	}
+}
+
+void IcaoFlightPlan::FindCoord::cache_get_stats(unsigned long& hits, unsigned long& misses, unsigned int& size)
+{
+	Glib::Mutex::Lock lock(m_cachemutex);
+	hits = m_cachehits;
+	misses = m_cachemisses;
+	size = m_cache.size();
+}
+
+bool IcaoFlightPlan::FindCoord::cache_load(const CacheKey& key)
+{
+	Glib::Mutex::Lock lock(m_cachemutex);
+	cache_t::iterator ci(m_cache.find(key));
+	if (ci == m_cache.end()) {
+		++m_cachemisses;
+		return false;
+	}
+	++m_cachehits;
+	m_cachelru.splice(m_cachelru.begin(), m_cachelru, ci->second.m_lru);
+	m_airports = ci->second.m_airports;
+	m_navaids = ci->second.m_navaids;
+	m_waypoints = ci->second.m_waypoints;
+	m_mapelements = ci->second.m_mapelements;
+	m_airways = ci->second.m_airways;
+	m_coordresult = ci->second.m_coordresult;
+	return true;
+}
+
+void IcaoFlightPlan::FindCoord::cache_save(const CacheKey& key)
 {
+	// a failed query must not hide the ident until the entry is evicted
+	if (m_queryerror)
+		return;
+	Glib::Mutex::Lock lock(m_cachemutex);
+	if (!m_cachemaxsize)
+		return;
+	std::pair<cache_t::iterator,bool> ins(m_cache.insert(std::make_pair(key, CacheEntry())));
+	if (ins.second) {
+		m_cachelru.push_front(key);
+		ins.first->second.m_lru = m_cachelru.begin();
+	} else {
+		m_cachelru.splice(m_cachelru.begin(), m_cachelru, ins.first->second.m_lru);
+	}
+	CacheEntry& ce(ins.first->second);
+	ce.m_airports = m_airports;
+	ce.m_navaids = m_navaids;
+	ce.m_waypoints = m_waypoints;
+	ce.m_mapelements = m_mapelements;
+	ce.m_airways = m_airways;
+	ce.m_coordresult = m_coordresult;
+	while (m_cache.size() > m_cachemaxsize && !m_cachelru.empty()) {
+		m_cache.erase(m_cachelru.back());
+		m_cachelru.pop_back();
+	}
 }
 
 void IcaoFlightPlan::FindCoord::async_cancel(void)
@@ -142,7 +404,9 @@ void IcaoFlightPlan::FindCoord::async_clear(void)
 	m_navaids.clear();
 	m_waypoints.clear();
 	m_mapelements.clear();
+	m_airways.clear();
 	m_airwaygraph.clear();
+	m_queryerror = false;
 }
 
 void IcaoFlightPlan::FindCoord::async_connectdone(void)
@@ -180,6 +444,8 @@ unsigned int IcaoFlightPlan::FindCoord::async_waitdone(void)
         for (;;) {
 		if ((m_airportquery || m_airportquery1) && (!m_airportquery || m_airportquery->is_done()) && (!m_airportquery1 || m_airportquery1->is_done())) {
 			m_airports.clear();
+			m_queryerror = m_queryerror || (m_airportquery && m_airportquery->is_error()) ||
+				(m_airportquery1 && m_airportquery1->is_error());
 			if (m_airportquery && !m_airportquery->is_error()) {
 				m_airports = m_airportquery->get_result();
 			} else if (m_airportquery1 && !m_airportquery1->is_error()) {
@@ -191,6 +457,8 @@ unsigned int IcaoFlightPlan::FindCoord::async_waitdone(void)
 		}
 		if ((m_navaidquery || m_navaidquery1) && (!m_navaidquery || m_navaidquery->is_done()) && (!m_navaidquery1 || m_navaidquery1->is_done())) {
 			m_navaids.clear();
+			m_queryerror = m_queryerror || (m_navaidquery && m_navaidquery->is_error()) ||
+				(m_navaidquery1 && m_navaidquery1->is_error());
 			if (m_navaidquery && !m_navaidquery->is_error()) {
 				m_navaids = m_navaidquery->get_result();
 			} else if (m_navaidquery1 && !m_navaidquery1->is_error()) {
@@ -202,19 +470,25 @@ unsigned int IcaoFlightPlan::FindCoord::async_waitdone(void)
 		}
 		if (m_waypointquery && m_waypointquery->is_done()) {
 			m_waypoints.clear();
-			if (!m_waypointquery->is_error())
+			if (m_waypointquery->is_error())
+				m_queryerror = true;
+			else
 				m_waypoints = m_waypointquery->get_result();
 			m_waypointquery = Glib::RefPtr<Engine::WaypointResult>();
 		}
 		if (m_mapelementquery && m_mapelementquery->is_done()) {
 			m_mapelements.clear();
-			if (!m_mapelementquery->is_error())
+			if (m_mapelementquery->is_error())
+				m_queryerror = true;
+			else
 				m_mapelements = m_mapelementquery->get_result();
 			m_mapelementquery = Glib::RefPtr<Engine::MapelementResult>();
 		}
 		if (m_airwayelquery && m_airwayelquery->is_done()) {
 			m_airways.clear();
-			if (!m_airwayelquery->is_error())
+			if (m_airwayelquery->is_error())
+				m_queryerror = true;
+			else
 				m_airways = m_airwayelquery->get_result();
 			m_airwayelquery = Glib::RefPtr<Engine::AirwayResult>();
 		}
@@ -343,11 +617,55 @@ void IcaoFlightPlan::FindCoord::retain_shortest_dist(const Point& pt)
 		m_coordresult = Point::invalid;
 }
 
+void IcaoFlightPlan::FindCoord::discard_worse_names(unsigned int flags)
+{
+	// discard worse matching airports
+	if (flags & flag_airport) {
+		std::sort(m_airports.begin(), m_airports.end(), SortAirportNamelen());
+		std::string::size_type namelen(0);
+		if (!m_airports.empty())
+			namelen = m_airports.front().get_name().size();
+		for (Engine::AirportResult::elementvector_t::iterator i(m_airports.begin()), e(m_airports.end()); i != e; ++i) {
+			if (i->get_name().size() <= namelen)
+				continue;
+			m_airports.erase(i, e);
+			break;
+		}
+	}
+	if (flags & flag_navaid) {
+		std::sort(m_navaids.begin(), m_navaids.end(), SortNavaidNamelen());
+		std::string::size_type namelen(0);
+		if (!m_navaids.empty())
+			namelen = m_navaids.front().get_name().size();
+		for (Engine::NavaidResult::elementvector_t::iterator i(m_navaids.begin()), e(m_navaids.end()); i != e; ++i) {
+			if (i->get_name().size() <= namelen)
+				continue;
+			m_navaids.erase(i, e);
+			break;
+		}
+	}
+	{
+		std::sort(m_mapelements.begin(), m_mapelements.end(), SortMapelementNamelen());
+		std::string::size_type namelen(0);
+		if (!m_mapelements.empty())
+			namelen = m_mapelements.front().get_name().size();
+		for (Engine::MapelementResult::elementvector_t::iterator i(m_mapelements.begin()), e(m_mapelements.end()); i != e; ++i) {
+			if (i->get_name().size() <= namelen)
+				continue;
+			m_mapelements.erase(i, e);
+			break;
+		}
+	}
+}
+
 void IcaoFlightPlan::FindCoord::find_by_name(const std::string& icao, const std::string& name, unsigned int flags)
 {
 	m_coordresult = Point::invalid;
 	async_cancel();
 	async_clear();
+	CacheKey key(m_engine, false, icao, name, flags);
+	if (cache_load(key))
+		return;
 	if (!icao.empty()) {
 		if (flags & flag_airport)
 			m_airportquery = m_engine.async_airport_find_by_icao(icao, ~0, 0, AirportsDb::comp_exact,
@@ -379,46 +697,8 @@ void IcaoFlightPlan::FindCoord::find_by_name(const std::string& icao, const std:
 		}
 	}
 	async_connectdone();
-	{
-		unsigned int flags(async_waitdone());
-		// discard worse matching airports
-		if (flags & flag_airport) {
-			std::sort(m_airports.begin(), m_airports.end(), SortAirportNamelen());
-			std::string::size_type namelen(0);
-			if (!m_airports.empty())
-				namelen = m_airports.front().get_name().size();
-			for (Engine::AirportResult::elementvector_t::iterator i(m_airports.begin()), e(m_airports.end()); i != e; ++i) {
-				if (i->get_name().size() <= namelen)
-					continue;
-				m_airports.erase(i, e);
-				break;
-			}
-		}
-		if (flags & flag_navaid) {
-			std::sort(m_navaids.begin(), m_navaids.end(), SortNavaidNamelen());
-			std::string::size_type namelen(0);
-			if (!m_navaids.empty())
-				namelen = m_navaids.front().get_name().size();
-			for (Engine::NavaidResult::elementvector_t::iterator i(m_navaids.begin()), e(m_navaids.end()); i != e; ++i) {
-				if (i->get_name().size() <= namelen)
-					continue;
-				m_navaids.erase(i, e);
-				break;
-			}
-		}
-	}
-	{
-		std::sort(m_mapelements.begin(), m_mapelements.end(), SortMapelementNamelen());
-		std::string::size_type namelen(0);
-		if (!m_mapelements.empty())
-			namelen = m_mapelements.front().get_name().size();
-		for (Engine::MapelementResult::elementvector_t::iterator i(m_mapelements.begin()), e(m_mapelements.end()); i != e; ++i) {
-			if (i->get_name().size() <= namelen)
-				continue;
-			m_mapelements.erase(i, e);
-			break;
-		}
-	}
+	discard_worse_names(async_waitdone());
+	cache_save(key);
 }
 
 void IcaoFlightPlan::FindCoord::find_by_ident(const std::string& ident, const std::string& name, unsigned int flags)
@@ -426,6 +706,9 @@ void IcaoFlightPlan::FindCoord::find_by_ident(const std::string& ident, const st
 	m_coordresult = Point::invalid;
 	async_cancel();
 	async_clear();
+	CacheKey key(m_engine, true, ident, name, flags);
+	if (cache_load(key))
+		return;
 	if (!ident.empty()) {
 		if (flags & flag_airport)
 			m_airportquery = m_engine.async_airport_find_by_icao(ident, ~0, 0, AirportsDb::comp_exact,
@@ -457,50 +740,64 @@ void IcaoFlightPlan::FindCoord::find_by_ident(const std::string& ident, const st
 									    (flags & flag_subtables) ? NavaidsDb::element_t::subtables_all : AirportsDb::element_t::subtables_none);
 	}
 	async_connectdone();
+	discard_worse_names(async_waitdone());
+	cache_save(key);
+}
+
+
+
+void IcaoFlightPlan::FindCoord::prefetch_by_ident(const prefetch_t& idents)
+{
+	m_coordresult = Point::invalid;
+	async_cancel();
+	async_clear();
+	prefetch_t pf;
+	std::vector<CacheKey> pfkeys;
 	{
-		unsigned int flags(async_waitdone());
-		// discard worse matching airports
-		if (flags & flag_airport) {
-			std::sort(m_airports.begin(), m_airports.end(), SortAirportNamelen());
-			std::string::size_type namelen(0);
-			if (!m_airports.empty())
-				namelen = m_airports.front().get_name().size();
-			for (Engine::AirportResult::elementvector_t::iterator i(m_airports.begin()), e(m_airports.end()); i != e; ++i) {
-				if (i->get_name().size() <= namelen)
-					continue;
-				m_airports.erase(i, e);
-				break;
-			}
-		}
-		if (flags & flag_navaid) {
-			std::sort(m_navaids.begin(), m_navaids.end(), SortNavaidNamelen());
-			std::string::size_type namelen(0);
-			if (!m_navaids.empty())
-				namelen = m_navaids.front().get_name().size();
-			for (Engine::NavaidResult::elementvector_t::iterator i(m_navaids.begin()), e(m_navaids.end()); i != e; ++i) {
-				if (i->get_name().size() <= namelen)
-					continue;
-				m_navaids.erase(i, e);
-				break;
-			}
+		std::set<CacheKey> keys;
+		Glib::Mutex::Lock lock(m_cachemutex);
+		for (prefetch_t::const_iterator ii(idents.begin()), ie(idents.end()); ii != ie; ++ii) {
+			if (ii->first.empty())
+				continue;
+			CacheKey key(m_engine, true, ii->first, "", ii->second);
+			if (m_cache.find(key) != m_cache.end() || !keys.insert(key).second)
+				continue;
+			pf.push_back(*ii);
+			pfkeys.push_back(key);
 		}
 	}
+	if (pf.empty())
+		return;
+	// one query per database (and subtables mode) for all idents,
+	// the results are then split per ident and cached
+	Prefetch pq[2];
+	for (prefetch_t::const_iterator pi(pf.begin()), pe(pf.end()); pi != pe; ++pi)
+		pq[!!(pi->second & flag_subtables)].add(pi->first, pi->second);
+	for (unsigned int i = 0; i < 2; ++i)
+		pq[i].query(m_engine, i);
+	if (!pq[0].is_queried() || !pq[1].is_queried()) {
+		pq[0].cancel();
+		pq[1].cancel();
+		return;
+	}
+	for (unsigned int i = 0; i < 2; ++i)
+		pq[i].connect(sigc::mem_fun(*this, &FindCoord::async_done));
 	{
-		std::sort(m_mapelements.begin(), m_mapelements.end(), SortMapelementNamelen());
-		std::string::size_type namelen(0);
-		if (!m_mapelements.empty())
-			namelen = m_mapelements.front().get_name().size();
-		for (Engine::MapelementResult::elementvector_t::iterator i(m_mapelements.begin()), e(m_mapelements.end()); i != e; ++i) {
-			if (i->get_name().size() <= namelen)
-				continue;
-			m_mapelements.erase(i, e);
-			break;
-		}
+		Glib::Mutex::Lock lock(m_mutex);
+		while (!pq[0].is_done() || !pq[1].is_done())
+			m_cond.wait(m_mutex);
+	}
+	for (prefetch_t::size_type i(0), n(pf.size()); i < n; ++i) {
+		async_clear();
+		const Prefetch& q(pq[!!(pf[i].second & flag_subtables)]);
+		m_queryerror = q.is_error(pf[i].second);
+		q.get_result(*this, pf[i].first, pf[i].second);
+		discard_worse_names(0);
+		cache_save(pfkeys[i]);
 	}
+	async_clear();
 }
 
-
-
 bool IcaoFlightPlan::FindCoord::find(const std::string& icao, const std::string& name, unsigned int flags, const Point& pt)
 {
 	find_by_name(icao, name, flags);
@@ -1168,6 +1465,19 @@ void IcaoFlightPlan::ParseState::process_dblookup(void)
 {
 	FindCoord f(m_engine);
 	wpts_t::size_type n(m_wpts.size());
+	{
+		FindCoord::prefetch_t pf;
+		for (wpts_t::size_type i(0); i < n; ++i) {
+			const ParseWaypoint& wpt(m_wpts[i]);
+			if ((wpt.get_flags() & FPlanWaypoint::altflag_ifr) && Vertex::is_ident_numeric(wpt.get_icao()))
+				continue;
+			unsigned int flg(wpt.get_typemask());
+			if (AirportsDb::Airport::is_fpl_zzzz(wpt.get_icao()))
+				flg &= ~FindCoord::flag_airport;
+			pf.push_back(FindCoord::prefetch_t::value_type(wpt.get_icao(), flg));
+		}
+		f.prefetch_by_ident(pf);
+	}
 	for (wpts_t::size_type i(0); i < n; ) {
 		ParseWaypoint& wpt(m_wpts[i]);
 		if ((wpt.get_typemask() & Vertex::typemask_airport) && !wpt.get_coord().is_invalid()) {
@@ -15,6 +15,7 @@
 
 #include <string>
 #include <map>
+#include <list>
 #include "sysdeps.h"
 #include "engine.h"
 #include "fplan.h"
@@ -167,6 +168,12 @@ class IcaoFlightPlan {
 		FindCoord(Engine& engine);
 		void find_by_name(const std::string& icao, const std::string& name, unsigned int flags);
 		void find_by_ident(const std::string& ident, const std::string& name, unsigned int flags);
+		// issue the lookups for many idents at once and place the results into the ident cache
+		typedef std::vector<std::pair<std::string,unsigned int> > prefetch_t;
+		void prefetch_by_ident(const prefetch_t& idents);
+		static void cache_clear(void);
+		static void cache_set_maxsize(unsigned int sz);
+		static void cache_get_stats(unsigned long& hits, unsigned long& misses, unsigned int& size);
 		void find_by_coord(const Point& pt, unsigned int flags, float maxdist_km);
 		bool find(const std::string& icao, const std::string& name, unsigned int flags, const Point& pt = Point());
 		bool find(const Point& pt, unsigned int flags, float maxdist_km);
@@ -202,7 +209,34 @@ class IcaoFlightPlan {
 		class SortMapelementDist;
 		class SortAirwayDist;
 
+		class CacheKey {
+		  public:
+			CacheKey(void) : m_dbserial(0), m_dbrevision(0), m_flags(0), m_byident(false) {}
+			CacheKey(const Engine& engine, bool byident = false, const std::string& ident = "",
+				 const std::string& name = "", unsigned int flags = 0);
+			bool operator<(const CacheKey& x) const;
+
+		  protected:
+			std::string m_ident;
+			std::string m_name;
+			unsigned int m_dbserial;
+			unsigned int m_dbrevision;
+			unsigned int m_flags;
+			bool m_byident;
+		};
+
+		class CacheEntry;
+		class Prefetch;
+		typedef std::list<CacheKey> cachelru_t;
+		typedef std::map<CacheKey,CacheEntry> cache_t;
+
 		static const std::string empty;
+		static cache_t m_cache;
+		static cachelru_t m_cachelru;
+		static Glib::Mutex m_cachemutex;
+		static unsigned int m_cachemaxsize;
+		static unsigned long m_cachehits;
+		static unsigned long m_cachemisses;
 
 		Engine::AirportResult::elementvector_t m_airports;
 		Engine::NavaidResult::elementvector_t m_navaids;
@@ -223,6 +257,7 @@ class IcaoFlightPlan {
 		Glib::Mutex m_mutex;
 		Engine& m_engine;
 		Point m_coordresult;
+		bool m_queryerror;
 
 		void async_cancel(void);
 		void async_clear(void);
@@ -233,6 +268,9 @@ class IcaoFlightPlan {
 		void retain_first(void);
 		void cut_dist(const Point& pt, float maxdist_km);
 		void retain_shortest_dist(const Point& pt);
+		void discard_worse_names(unsigned int flags);
+		bool cache_load(const CacheKey& key);
+		void cache_save(const CacheKey& key);
 	};
 
   protected:
@@ -113,18 +113,146 @@ Interval<T> Interval<T>::operator&(const Interval& x) const
 			std::min(get_upper(), x.get_upper()));
 }
 
+template <typename T, unsigned int N>
+IntervalSmallVector<T,N>::IntervalSmallVector(const IntervalSmallVector& x)
+	: m_data(m_inline), m_size(0), m_capacity(N)
+{
+	reserve(x.m_size);
+	std::copy(x.begin(), x.end(), m_data);
+	m_size = x.m_size;
+}
+
+template <typename T, unsigned int N>
+IntervalSmallVector<T,N>::~IntervalSmallVector()
+{
+	if (m_data != m_inline)
+		delete[] m_data;
+}
+
+template <typename T, unsigned int N>
+IntervalSmallVector<T,N>& IntervalSmallVector<T,N>::operator=(const IntervalSmallVector& x)
+{
+	if (this == &x)
+		return *this;
+	m_size = 0;
+	reserve(x.m_size);
+	std::copy(x.begin(), x.end(), m_data);
+	m_size = x.m_size;
+	return *this;
+}
+
+template <typename T, unsigned int N>
+void IntervalSmallVector<T,N>::reserve(size_type n)
+{
+	if (n <= m_capacity)
+		return;
+	value_type *d(new value_type[n]);
+	std::copy(begin(), end(), d);
+	if (m_data != m_inline)
+		delete[] m_data;
+	m_data = d;
+	m_capacity = n;
+}
+
+template <typename T, unsigned int N>
+void IntervalSmallVector<T,N>::resize(size_type n)
+{
+	reserve(n);
+	for (; m_size < n; ++m_size)
+		m_data[m_size] = value_type();
+	m_size = n;
+}
+
+template <typename T, unsigned int N>
+void IntervalSmallVector<T,N>::push_back(const value_type& x)
+{
+	if (m_size >= m_capacity) {
+		value_type y(x);
+		reserve(m_capacity << 1);
+		m_data[m_size++] = y;
+		return;
+	}
+	m_data[m_size++] = x;
+}
+
+template <typename T, unsigned int N>
+typename IntervalSmallVector<T,N>::iterator IntervalSmallVector<T,N>::insert(iterator pos, const value_type& x)
+{
+	size_type idx(pos - begin());
+	value_type y(x);
+	if (m_size >= m_capacity)
+		reserve(m_capacity << 1);
+	std::copy_backward(begin() + idx, end(), end() + 1);
+	++m_size;
+	m_data[idx] = y;
+	return begin() + idx;
+}
+
+template <typename T, unsigned int N>
+typename IntervalSmallVector<T,N>::iterator IntervalSmallVector<T,N>::erase(iterator pos)
+{
+	std::copy(pos + 1, end(), pos);
+	--m_size;
+	return pos;
+}
+
+template <typename T, unsigned int N>
+void IntervalSmallVector<T,N>::swap(IntervalSmallVector& x)
+{
+	if (m_data != m_inline && x.m_data != x.m_inline) {
+		std::swap(m_data, x.m_data);
+		std::swap(m_size, x.m_size);
+		std::swap(m_capacity, x.m_capacity);
+		return;
+	}
+	if (m_data == m_inline && x.m_data == x.m_inline) {
+		std::swap_ranges(m_inline, m_inline + std::max(m_size, x.m_size), x.m_inline);
+		std::swap(m_size, x.m_size);
+		return;
+	}
+	if (m_data == m_inline) {
+		x.swap(*this);
+		return;
+	}
+	// heap storage changes owner, inline contents are copied
+	std::copy(x.begin(), x.end(), m_inline);
+	x.m_data = m_data;
+	m_data = m_inline;
+	std::swap(m_size, x.m_size);
+	std::swap(m_capacity, x.m_capacity);
+}
+
 template <typename T, typename ST>
 struct interval_traits {
 	typedef ST set_t;
 };
 
-template <typename T>
-struct interval_traits<T, std::set<Interval<T> > > {
-	typedef std::set<Interval<T> > set_t;
+template <typename T, typename ST>
+struct interval_common_traits {
+	typedef ST set_t;
 	typedef Interval<T> Intvl;
 
-	static inline void reserve(set_t& set, const set_t& a, const set_t& b) {
+	static inline void complement(set_t& r, const set_t& a) {
+		r.clear();
+		T v(std::numeric_limits<T>::min());
+		for (typename set_t::const_iterator i(a.begin()), e(a.end()); i != e; ++i) {
+			const Intvl& x(*i);
+			if (x.is_empty())
+				continue;
+			if (v < x.get_lower())
+				r.insert(r.end(), Intvl(v, x.get_lower()));
+			if (v < x.get_upper())
+				v = x.get_upper();
+		}
+		if (v < std::numeric_limits<T>::max())
+			r.insert(r.end(), Intvl(v, std::numeric_limits<T>::max()));
 	}
+};
+
+template <typename T>
+struct interval_traits<T, std::set<Interval<T> > > : public interval_common_traits<T, std::set<Interval<T> > > {
+	typedef std::set<Interval<T> > set_t;
+	typedef Interval<T> Intvl;
 
 	static inline void normalize(set_t& set) {
 		for (typename set_t::iterator i(set.begin()), e(set.end()); i != e; ) {
@@ -161,53 +289,148 @@ struct interval_traits<T, std::set<Interval<T> > > {
 			//e = set.end();
 		}
 	}
+
+	static inline void intersect(set_t& r, const set_t& a, const set_t& b) {
+		r.clear();
+		for (typename set_t::const_iterator bi(b.begin()), be(b.end()); bi != be; ++bi) {
+			const Intvl& bb(*bi);
+			if (bb.is_empty())
+				continue;
+			for (typename set_t::const_iterator ai(a.begin()), ae(a.end()); ai != ae; ++ai) {
+				const Intvl& aa(*ai);
+				if (aa.is_empty())
+					continue;
+				if (aa.get_lower() >= bb.get_upper())
+					break;
+				if (!aa.is_overlap_or_adjacent(bb))
+					continue;
+				Intvl x(std::max(bb.get_lower(), aa.get_lower()), std::min(bb.get_upper(), aa.get_upper()));
+				if (!x.is_empty())
+					r.insert(x);
+			}
+		}
+		normalize(r);
+	}
+
+	static inline void unite(set_t& r, const set_t& a, const set_t& b) {
+		r = a;
+		for (typename set_t::const_iterator i(b.begin()), e(b.end()); i != e; ++i)
+			if (!i->is_empty())
+				r.insert(*i);
+		normalize(r);
+	}
+
+	static inline void subtract(set_t& r, const set_t& a, const set_t& b) {
+		set_t c;
+		interval_common_traits<T,set_t>::complement(c, b);
+		intersect(r, a, c);
+	}
 };
 
-template <typename T>
-struct interval_traits<T, std::vector<Interval<T> > > {
-	typedef std::vector<Interval<T> > set_t;
+// sorted array storage: both operands are normalized, so the set
+// operations are linear merges that produce normalized output directly
+template <typename T, typename ST>
+struct interval_array_traits : public interval_common_traits<T,ST> {
+	typedef ST set_t;
 	typedef Interval<T> Intvl;
 
-	static inline void reserve(set_t& set, const set_t& a, const set_t& b) {
-		set.reserve(a.size() * b.size());
+	static inline void compact(set_t& set) {
+		typename set_t::iterator o(set.begin());
+		for (typename set_t::iterator i(set.begin()), e(set.end()); i != e; ++i) {
+			// remove empty subintervals
+			if (i->is_empty())
+				continue;
+			// merge adjacent
+			if (o != set.begin()) {
+				Intvl& p(*(o - 1));
+				if (p.is_overlap_or_adjacent(*i)) {
+					if (p.get_upper() < i->get_upper())
+						p.set_upper(i->get_upper());
+					continue;
+				}
+			}
+			*o = *i;
+			++o;
+		}
+		set.resize(o - set.begin());
 	}
 
 	static inline void normalize(set_t& set) {
 		std::sort(set.begin(), set.end());
-		for (typename set_t::iterator i(set.begin()), e(set.end()); i != e; ) {
-			Intvl& x(*i);
-			// remove empty subintervals
-			if (x.is_empty()) {
-				i = set.erase(i);
-				e = set.end();
+		compact(set);
+	}
+
+	static inline void intersect(set_t& r, const set_t& a, const set_t& b) {
+		r.clear();
+		r.reserve(a.size() + b.size());
+		typename set_t::const_iterator ai(a.begin()), ae(a.end()), bi(b.begin()), be(b.end());
+		while (ai != ae && bi != be) {
+			Intvl x(std::max(ai->get_lower(), bi->get_lower()), std::min(ai->get_upper(), bi->get_upper()));
+			if (!x.is_empty())
+				r.push_back(x);
+			if (ai->get_upper() < bi->get_upper())
+				++ai;
+			else
+				++bi;
+		}
+	}
+
+	static inline void unite(set_t& r, const set_t& a, const set_t& b) {
+		r.clear();
+		r.reserve(a.size() + b.size());
+		typename set_t::const_iterator ai(a.begin()), ae(a.end()), bi(b.begin()), be(b.end());
+		while (ai != ae || bi != be) {
+			typename set_t::const_iterator i;
+			if (bi == be || (ai != ae && ai->get_lower() <= bi->get_lower()))
+				i = ai++;
+			else
+				i = bi++;
+			if (i->is_empty())
 				continue;
-			}
-			typename set_t::iterator in(i);
-			++in;
-			if (in == e)
-				break;
-			const Intvl& y(*in);
-			// remove empty subintervals
-			if (y.is_empty()) {
-				i = set.erase(in);
-				e = set.end();
-				--i;
+			if (!r.empty() && r.back().is_overlap_or_adjacent(*i)) {
+				if (r.back().get_upper() < i->get_upper())
+					r.back().set_upper(i->get_upper());
 				continue;
 			}
-			// merge adjacent
-			if (!x.is_overlap_or_adjacent(y)) {
-				++i;
+			r.push_back(*i);
+		}
+	}
+
+	static inline void subtract(set_t& r, const set_t& a, const set_t& b) {
+		r.clear();
+		r.reserve(a.size() + b.size());
+		typename set_t::const_iterator bi(b.begin()), be(b.end());
+		for (typename set_t::const_iterator ai(a.begin()), ae(a.end()); ai != ae; ++ai) {
+			// the complement starts at numeric_limits::min, which is not the lowest value for floating point types
+			T lwr(std::max(ai->get_lower(), std::numeric_limits<T>::min()));
+			if (!(lwr < ai->get_upper()))
 				continue;
+			while (bi != be && bi->get_upper() <= lwr)
+				++bi;
+			for (typename set_t::const_iterator bj(bi); bj != be && bj->get_lower() < ai->get_upper(); ++bj) {
+				if (bj->is_empty())
+					continue;
+				if (lwr < bj->get_lower())
+					r.push_back(Intvl(lwr, bj->get_lower()));
+				if (lwr < bj->get_upper())
+					lwr = bj->get_upper();
+				if (!(lwr < ai->get_upper()))
+					break;
 			}
-			x = Intvl(std::min(x.get_lower(), y.get_lower()),
-				  std::max(x.get_upper(), y.get_upper()));
-			i = set.erase(in);
-			e = set.end();
-			--i;
+			if (lwr < ai->get_upper())
+				r.push_back(Intvl(lwr, ai->get_upper()));
 		}
 	}
 };
 
+template <typename T>
+struct interval_traits<T, std::vector<Interval<T> > > : public interval_array_traits<T, std::vector<Interval<T> > > {
+};
+
+template <typename T, unsigned int N>
+struct interval_traits<T, IntervalSmallVector<T,N> > : public interval_array_traits<T, IntervalSmallVector<T,N> > {
+};
+
 template <typename T, typename ST>
 IntervalSet<T,ST>::IntervalSet(void)
 {
@@ -317,42 +540,28 @@ IntervalSet<T,ST>& IntervalSet<T,ST>::operator^=(const Intvl& x)
 template <typename T, typename ST>
 IntervalSet<T,ST>& IntervalSet<T,ST>::operator-=(const Intvl& x)
 {
-	return (*this) &= ~IntervalSet(x);
+	return (*this) -= IntervalSet(x);
 }
 
 template <typename T, typename ST>
 IntervalSet<T,ST>& IntervalSet<T,ST>::operator&=(const IntervalSet& x)
 {
+	if (&x == this)
+		return *this;
 	IntervalSet y;
 	y.m_set.swap(m_set);
-	interval_traits<T,ST>::reserve(m_set, x.m_set, y.m_set);
-	for (typename set_t::const_iterator xi(x.m_set.begin()), xe(x.m_set.end()); xi != xe; ++xi) {
-		const Intvl& xx(*xi);
-		if (xx.is_empty())
-			continue;
-		for (typename set_t::const_iterator yi(y.m_set.begin()), ye(y.m_set.end()); yi != ye; ++yi) {
-			const Intvl& yy(*yi);
-			if (yy.is_empty())
-				continue;
-			if (yy.get_lower() >= xx.get_upper())
-				break;
-			if (!yy.is_overlap_or_adjacent(xx))
-				continue;
-			add_traits<T,ST>::add(m_set, Intvl(std::max(xx.get_lower(), yy.get_lower()), std::min(xx.get_upper(), yy.get_upper())));
-		}
-	}
-	normalize();
+	interval_traits<T,ST>::intersect(m_set, y.m_set, x.m_set);
 	return *this;
 }
 
 template <typename T, typename ST>
 IntervalSet<T,ST>& IntervalSet<T,ST>::operator|=(const IntervalSet& x)
 {
-	bool norm(false);
-	for (typename set_t::const_iterator i(x.m_set.begin()), e(x.m_set.end()); i != e; ++i)
-		norm = add_traits<T,ST>::add(m_set, *i) || norm;
-	if (norm)
-		normalize();
+	if (&x == this || x.m_set.empty())
+		return *this;
+	IntervalSet y;
+	y.m_set.swap(m_set);
+	interval_traits<T,ST>::unite(m_set, y.m_set, x.m_set);
 	return *this;
 }
 
@@ -368,25 +577,21 @@ IntervalSet<T,ST>& IntervalSet<T,ST>::operator^=(const IntervalSet& x)
 template <typename T, typename ST>
 IntervalSet<T,ST>& IntervalSet<T,ST>::operator-=(const IntervalSet& x)
 {
-	return (*this) &= ~x;
+	if (&x == this) {
+		m_set.clear();
+		return *this;
+	}
+	IntervalSet y;
+	y.m_set.swap(m_set);
+	interval_traits<T,ST>::subtract(m_set, y.m_set, x.m_set);
+	return *this;
 }
 
 template <typename T, typename ST>
 IntervalSet<T,ST> IntervalSet<T,ST>::operator~() const
 {
 	IntervalSet z;
-	type_t v(std::numeric_limits<type_t>::min());
-	for (typename set_t::const_iterator i(m_set.begin()), e(m_set.end()); i != e; ++i) {
-		const Intvl& x(*i);
-		if (x.is_empty())
-			continue;
-		if (v < x.get_lower())
-			add_traits<T,ST>::add(z.m_set, Intvl(v, x.get_lower()));
-		if (v < x.get_upper())
-			v = x.get_upper();
-	}
-	if (v < std::numeric_limits<type_t>::max())
-		add_traits<T,ST>::add(z.m_set, Intvl(v, std::numeric_limits<type_t>::max()));
+	interval_traits<T,ST>::complement(z.m_set, m_set);
 	return z;
 }
 
@@ -434,9 +639,13 @@ int IntervalSet<T,ST>::compare(const IntervalSet& x) const
 template class Interval<uint16_t>;
 template class IntervalSet<uint16_t, std::set<Interval<uint16_t> > >;
 template class IntervalSet<uint16_t, std::vector<Interval<uint16_t> > >;
+template class IntervalSmallVector<uint16_t>;
+template class IntervalSet<uint16_t, IntervalSmallVector<uint16_t> >;
 template class Interval<int32_t>;
 template class IntervalSet<int32_t, std::set<Interval<int32_t> > >;
 template class IntervalSet<int32_t, std::vector<Interval<int32_t> > >;
+template class IntervalSmallVector<int32_t>;
+template class IntervalSet<int32_t, IntervalSmallVector<int32_t> >;
 template class Interval<uint32_t>;
 template class IntervalSet<uint32_t, std::set<Interval<uint32_t> > >;
 template class IntervalSet<uint32_t, std::vector<Interval<uint32_t> > >;
@@ -446,6 +655,8 @@ template class IntervalSet<uint64_t, std::vector<Interval<uint64_t> > >;
 template class Interval<int64_t>;
 template class IntervalSet<int64_t, std::set<Interval<int64_t> > >;
 template class IntervalSet<int64_t, std::vector<Interval<int64_t> > >;
+template class IntervalSmallVector<int64_t>;
+template class IntervalSet<int64_t, IntervalSmallVector<int64_t> >;
 template class Interval<double>;
 template class IntervalSet<double, std::set<Interval<double> > >;
 template class IntervalSet<double, std::vector<Interval<double> > >;
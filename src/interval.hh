@@ -9,6 +9,8 @@
 #include <string>
 #include <set>
 #include <vector>
+#include <iterator>
+#include <algorithm>
 //#include <cstdint>
 #include <stdint.h>
 
@@ -54,6 +56,55 @@ protected:
 	type_t m_upper;
 };
 
+// sorted array storage for IntervalSet; the first N intervals are kept
+// inside the object, so typical altitude and time sets do not allocate
+template <typename T, unsigned int N = 4>
+class IntervalSmallVector {
+public:
+	typedef Interval<T> value_type;
+	typedef value_type& reference;
+	typedef const value_type& const_reference;
+	typedef value_type *iterator;
+	typedef const value_type *const_iterator;
+	typedef std::reverse_iterator<iterator> reverse_iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+	typedef unsigned int size_type;
+
+	IntervalSmallVector(void) : m_data(m_inline), m_size(0), m_capacity(N) {}
+	IntervalSmallVector(const IntervalSmallVector& x);
+	~IntervalSmallVector();
+	IntervalSmallVector& operator=(const IntervalSmallVector& x);
+
+	iterator begin(void) { return m_data; }
+	const_iterator begin(void) const { return m_data; }
+	iterator end(void) { return m_data + m_size; }
+	const_iterator end(void) const { return m_data + m_size; }
+	reverse_iterator rbegin(void) { return reverse_iterator(end()); }
+	const_reverse_iterator rbegin(void) const { return const_reverse_iterator(end()); }
+	reverse_iterator rend(void) { return reverse_iterator(begin()); }
+	const_reverse_iterator rend(void) const { return const_reverse_iterator(begin()); }
+	reference operator[](size_type i) { return m_data[i]; }
+	const_reference operator[](size_type i) const { return m_data[i]; }
+	reference back(void) { return m_data[m_size - 1]; }
+	const_reference back(void) const { return m_data[m_size - 1]; }
+	size_type size(void) const { return m_size; }
+	size_type capacity(void) const { return m_capacity; }
+	bool empty(void) const { return !m_size; }
+	void clear(void) { m_size = 0; }
+	void reserve(size_type n);
+	void resize(size_type n);
+	void push_back(const value_type& x);
+	iterator insert(iterator pos, const value_type& x);
+	iterator erase(iterator pos);
+	void swap(IntervalSmallVector& x);
+
+protected:
+	value_type *m_data;
+	size_type m_size;
+	size_type m_capacity;
+	value_type m_inline[N];
+};
+
 template <typename T, typename ST = std::vector<Interval<T> > >
 class IntervalSet {
 public:
@@ -152,6 +203,19 @@ protected:
 		}
 	};
 
+	template <typename TT, unsigned int NN>
+	struct add_traits<TT, IntervalSmallVector<TT,NN> > {
+		typedef IntervalSmallVector<TT,NN> set_t;
+		typedef Interval<TT> Intvl;
+
+		static inline bool add(set_t& set, const Interval<TT>& iv) {
+			if (iv.is_empty())
+				return false;
+			set.push_back(iv);
+			return true;
+		}
+	};
+
 public:
 	typedef typename set_t::const_iterator const_iterator;
 	const_iterator begin(void) const { return m_set.begin(); }
@@ -2,6 +2,9 @@
 #include "config.h"
 #endif
 
+#include <algorithm>
+#include <iostream>
+
 #include <sqlite3x.hpp>
 
 #ifdef HAVE_PQXX
@@ -633,6 +636,15 @@ void MetarTafSet::add_fir(const std::string& id, const MultiPolygonHole& poly)
 	m_firs.insert(FIR(id, poly));
 }
 
+MetarTafSet::Station& MetarTafSet::add_station(const std::string& stationid, const Point& coord, double elevm)
+{
+	Station stn(stationid, coord, elevm);
+	stations_t::iterator si(std::lower_bound(m_stations.begin(), m_stations.end(), stn, OrderStadionId()));
+	if (si == m_stations.end() || si->get_stationid() != stn.get_stationid())
+		si = m_stations.insert(si, stn);
+	return *si;
+}
+
 void MetarTafSet::loadstn_sqlite(const std::string& dbpath, const Rect& bbox,
 				 unsigned int metarhistory, unsigned int tafhistory)
 {
@@ -717,3 +729,199 @@ void MetarTafSet::compute_poly(void)
 	for (firs_t::iterator fi(m_firs.begin()), fe(m_firs.end()); fi != fe; ++fi)
 		const_cast<FIR&>(*fi).compute_poly();
 }
+
+MetarTafStore::MetarTafStore(unsigned int metarhistory, unsigned int tafhistory)
+	: m_grid(grid_size * grid_size), m_metarhistory(metarhistory), m_tafhistory(tafhistory)
+{
+}
+
+Rect MetarTafStore::get_world(void)
+{
+	return Rect(Point(Point::lon_min, Point::lat_min), Point(Point::lon_max, Point::lat_max));
+}
+
+unsigned int MetarTafStore::grid_lon(int64_t lon)
+{
+	return (static_cast<uint32_t>(lon) >> (32 - grid_bits)) & (grid_size - 1);
+}
+
+unsigned int MetarTafStore::grid_lat(Point::coord_t lat)
+{
+	int64_t l(lat);
+	l -= static_cast<int64_t>(Point::lat_min);
+	l >>= (31 - grid_bits);
+	return std::max(std::min(l, static_cast<int64_t>(grid_size - 1)), static_cast<int64_t>(0));
+}
+
+void MetarTafStore::rebuild_grid(void)
+{
+	for (grid_t::iterator gi(m_grid.begin()), ge(m_grid.end()); gi != ge; ++gi)
+		gi->clear();
+	const MetarTafSet::stations_t& stns(m_set.get_stations());
+	for (MetarTafSet::stations_t::size_type i(0), n(stns.size()); i < n; ++i) {
+		const Point& pt(stns[i].get_coord());
+		if (pt.is_invalid())
+			continue;
+		m_grid[grid_lat(pt.get_lat()) * grid_size + grid_lon(pt.get_lon())].push_back(i);
+	}
+}
+
+void MetarTafStore::add_fir(const std::string& id, const MultiPolygonHole& poly)
+{
+	Glib::Threads::RWLock::WriterLock lock(m_lock);
+	m_set.add_fir(id, poly);
+}
+
+void MetarTafStore::bulkload_sqlite(const std::string& dbpath)
+{
+	MetarTafSet mtset;
+	mtset.loadstn_sqlite(dbpath, get_world(), m_metarhistory, m_tafhistory);
+	update(mtset);
+}
+
+#ifdef HAVE_PQXX
+
+void MetarTafStore::bulkload_pg(pqxx::connection_base& conn, time_t tmin, time_t tmax)
+{
+	MetarTafSet mtset;
+	{
+		Glib::Threads::RWLock::ReaderLock lock(m_lock);
+		for (MetarTafSet::firs_t::const_iterator fi(m_set.get_firs().begin()), fe(m_set.get_firs().end()); fi != fe; ++fi)
+			mtset.add_fir(fi->get_ident(), fi->get_poly());
+	}
+	mtset.loadstn_pg(conn, get_world(), tmin, tmax, m_metarhistory, m_tafhistory);
+	update(mtset);
+}
+
+#endif
+
+void MetarTafStore::update(const MetarTafSet& mtset)
+{
+	Glib::Threads::RWLock::WriterLock lock(m_lock);
+	bool newstn(false);
+	MetarTafSet::stations_t& stns(m_set.get_stations());
+	for (MetarTafSet::stations_t::const_iterator ui(mtset.get_stations().begin()), ue(mtset.get_stations().end()); ui != ue; ++ui) {
+		MetarTafSet::stations_t::iterator si(std::lower_bound(stns.begin(), stns.end(), *ui, MetarTafSet::OrderStadionId()));
+		if (si == stns.end() || si->get_stationid() != ui->get_stationid()) {
+			si = stns.insert(si, MetarTafSet::Station(ui->get_stationid(), ui->get_coord(), ui->get_elev()));
+			newstn = true;
+		}
+		// reports compare by time only, so a corrected or amended report has to replace the original
+		for (MetarTafSet::Station::metar_t::const_iterator mi(ui->get_metar().begin()), me(ui->get_metar().end()); mi != me; ++mi) {
+			si->get_metar().erase(*mi);
+			si->get_metar().insert(*mi);
+		}
+		for (MetarTafSet::Station::taf_t::const_iterator ti(ui->get_taf().begin()), te(ui->get_taf().end()); ti != te; ++ti) {
+			si->get_taf().erase(*ti);
+			si->get_taf().insert(*ti);
+		}
+		// keep only the most recent reports per station
+		while (si->get_metar().size() > m_metarhistory)
+			si->get_metar().erase(si->get_metar().begin());
+		while (si->get_taf().size() > m_tafhistory)
+			si->get_taf().erase(si->get_taf().begin());
+	}
+	for (MetarTafSet::firs_t::const_iterator ui(mtset.get_firs().begin()), ue(mtset.get_firs().end()); ui != ue; ++ui) {
+		if (ui->get_sigmet().empty())
+			continue;
+		MetarTafSet::firs_t::iterator fi(m_set.get_firs().find(*ui));
+		if (fi == m_set.get_firs().end())
+			continue;
+		MetarTafSet::FIR::sigmet_t& sigmets(const_cast<MetarTafSet::FIR&>(*fi).get_sigmet());
+		for (MetarTafSet::FIR::sigmet_t::const_iterator si(ui->get_sigmet().begin()), se(ui->get_sigmet().end()); si != se; ++si) {
+			sigmets.erase(*si);
+			sigmets.insert(*si);
+		}
+	}
+	if (newstn)
+		rebuild_grid();
+	if (false)
+		std::cerr << "MetarTafStore: " << stns.size() << " stations after update with "
+			  << mtset.get_stations().size() << " stations" << std::endl;
+}
+
+void MetarTafStore::expire(time_t tmin)
+{
+	Glib::Threads::RWLock::WriterLock lock(m_lock);
+	for (MetarTafSet::firs_t::iterator fi(m_set.get_firs().begin()), fe(m_set.get_firs().end()); fi != fe; ++fi) {
+		MetarTafSet::FIR::sigmet_t& sigmets(const_cast<MetarTafSet::FIR&>(*fi).get_sigmet());
+		for (MetarTafSet::FIR::sigmet_t::iterator si(sigmets.begin()), se(sigmets.end()); si != se; ) {
+			MetarTafSet::FIR::sigmet_t::iterator si2(si);
+			++si;
+			if (si2->get_validto() < tmin)
+				sigmets.erase(si2);
+		}
+	}
+}
+
+void MetarTafStore::load(MetarTafSet& mtset, const Rect& bbox, time_t tmin, time_t tmax,
+			 unsigned int metarhistory, unsigned int tafhistory) const
+{
+	Glib::Threads::RWLock::ReaderLock lock(m_lock);
+	const MetarTafSet::stations_t& stns(m_set.get_stations());
+	MetarTafSet::stations_t& res(mtset.get_stations());
+	unsigned int lat0(grid_lat(bbox.get_south())), lat1(grid_lat(bbox.get_north()));
+	unsigned int lon0(grid_lon(bbox.get_west())), nlon(grid_size);
+	{
+		int64_t w(bbox.get_east_unwrapped() - static_cast<int64_t>(bbox.get_west()));
+		w >>= (32 - grid_bits);
+		if (w + 1 < static_cast<int64_t>(grid_size))
+			nlon = w + 1;
+	}
+	for (unsigned int lat(lat0); lat <= lat1; ++lat) {
+		for (unsigned int i(0); i < nlon; ++i) {
+			const cell_t& cell(m_grid[lat * grid_size + ((lon0 + i) & (grid_size - 1))]);
+			for (cell_t::const_iterator ci(cell.begin()), ce(cell.end()); ci != ce; ++ci) {
+				const MetarTafSet::Station& stn(stns[*ci]);
+				if (!bbox.is_inside(stn.get_coord()))
+					continue;
+				MetarTafSet::stations_t::iterator si(std::lower_bound(res.begin(), res.end(), stn, MetarTafSet::OrderStadionId()));
+				if (si == res.end() || si->get_stationid() != stn.get_stationid())
+					si = res.insert(si, MetarTafSet::Station(stn.get_stationid(), stn.get_coord(), stn.get_elev()));
+				{
+					MetarTafSet::Station::metar_t::const_iterator mi(stn.get_metar().end());
+					for (unsigned int n(0); n < metarhistory && mi != stn.get_metar().begin(); ++n)
+						--mi;
+					si->get_metar().insert(mi, stn.get_metar().end());
+				}
+				{
+					MetarTafSet::Station::taf_t::const_iterator ti(stn.get_taf().end());
+					for (unsigned int n(0); n < tafhistory && ti != stn.get_taf().begin(); ++n)
+						--ti;
+					si->get_taf().insert(ti, stn.get_taf().end());
+				}
+			}
+		}
+	}
+	if (tmin > tmax)
+		return;
+	bool sigmet(false);
+	for (MetarTafSet::firs_t::iterator fi(mtset.get_firs().begin()), fe(mtset.get_firs().end()); fi != fe; ++fi) {
+		MetarTafSet::firs_t::const_iterator fi2(m_set.get_firs().find(*fi));
+		if (fi2 == m_set.get_firs().end())
+			continue;
+		for (MetarTafSet::FIR::sigmet_t::const_iterator si(fi2->get_sigmet().begin()), se(fi2->get_sigmet().end()); si != se; ++si) {
+			if (si->get_validfrom() > tmax || si->get_validto() < tmin)
+				continue;
+			const_cast<MetarTafSet::FIR&>(*fi).get_sigmet().insert(*si);
+			sigmet = true;
+		}
+	}
+	if (sigmet)
+		mtset.compute_poly();
+}
+
+unsigned int MetarTafStore::get_nrstations(void) const
+{
+	Glib::Threads::RWLock::ReaderLock lock(m_lock);
+	return m_set.get_stations().size();
+}
+
+unsigned int MetarTafStore::get_nrsigmets(void) const
+{
+	Glib::Threads::RWLock::ReaderLock lock(m_lock);
+	unsigned int n(0);
+	for (MetarTafSet::firs_t::const_iterator fi(m_set.get_firs().begin()), fe(m_set.get_firs().end()); fi != fe; ++fi)
+		n += fi->get_sigmet().size();
+	return n;
+}
@@ -9,6 +9,7 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <glibmm.h>
 
 #include "sysdeps.h"
 #include "geom.h"
@@ -191,6 +192,9 @@ public:
 
 	const stations_t& get_stations(void) const { return m_stations; }
 	stations_t& get_stations(void) { return m_stations; }
+	// find or insert a station, keeping the station vector sorted
+	Station& add_station(const std::string& stationid, const Point& coord = Point(),
+			     double elevm = std::numeric_limits<double>::quiet_NaN());
 	const firs_t& get_firs(void) const { return m_firs; }
 	firs_t& get_firs(void) { return m_firs; }
 
@@ -211,4 +215,39 @@ protected:
 	class PGSigmetTransactor;
 };
 
+// In-memory METAR/TAF/SIGMET store, fed by bulk loads and queried
+// instead of the database for every chart request
+class MetarTafStore {
+public:
+	MetarTafStore(unsigned int metarhistory = 8, unsigned int tafhistory = 4);
+	void add_fir(const std::string& id = "", const MultiPolygonHole& poly = MultiPolygonHole());
+	void bulkload_sqlite(const std::string& dbpath);
+#ifdef HAVE_PQXX
+	void bulkload_pg(pqxx::connection_base& conn, time_t tmin, time_t tmax);
+#endif
+	// merge reports; a report replaces a stored one with the same station and time (COR/AMD)
+	void update(const MetarTafSet& mtset);
+	void expire(time_t tmin);
+	void load(MetarTafSet& mtset, const Rect& bbox, time_t tmin, time_t tmax,
+		  unsigned int metarhistory, unsigned int tafhistory) const;
+	unsigned int get_nrstations(void) const;
+	unsigned int get_nrsigmets(void) const;
+
+protected:
+	static const unsigned int grid_bits = 8;
+	static const unsigned int grid_size = 1U << grid_bits;
+	mutable Glib::Threads::RWLock m_lock;
+	MetarTafSet m_set;
+	typedef std::vector<unsigned int> cell_t;
+	typedef std::vector<cell_t> grid_t;
+	grid_t m_grid;
+	unsigned int m_metarhistory;
+	unsigned int m_tafhistory;
+
+	static Rect get_world(void);
+	static unsigned int grid_lon(int64_t lon);
+	static unsigned int grid_lat(Point::coord_t lat);
+	void rebuild_grid(void);
+};
+
 #endif /* METARTAF_H */
@@ -25,6 +25,7 @@
 
 #include <iomanip>
 #include <fstream>
+#include <unistd.h>
 
 #include <librsvg/rsvg.h>
 
@@ -112,9 +113,39 @@ int MeteoProfile::LinePoint::compare(const LinePoint& x) const
 	return 0;
 }
 
+Glib::Threads::Mutex MeteoProfile::m_assetmutex;
+
+namespace {
+
+// parsed SVG files are kept for the lifetime of the process; surfaces are rendered from them
+// for every draw call. RsvgHandle is not thread safe, the caller must hold the asset mutex
+RsvgHandle *get_svghandle(const std::string& fname)
+{
+	typedef std::map<std::string,RsvgHandle *> cache_t;
+	static cache_t cache;
+	cache_t::iterator i(cache.find(fname));
+	if (i != cache.end())
+		return i->second;
+	GError *err(0);
+	RsvgHandle *h(rsvg_handle_new_from_file(fname.c_str(), &err));
+	if (!h) {
+		std::cerr << "Cannot open " << fname;
+		if (err)
+			std::cerr << ": " << err->message;
+		std::cerr << std::endl;
+		g_error_free(err);
+		err = 0;
+	}
+	cache.insert(cache_t::value_type(fname, h));
+	return h;
+}
+
+};
+
 MeteoProfile::CloudIcons::CloudIcons(const std::string& basefile, const Cairo::RefPtr<Cairo::Surface> sfc)
 	: m_ok(true)
 {
+	Glib::Threads::Mutex::Lock lock(m_assetmutex);
 	for (unsigned int i = 0; i < 4; ++i) {
 		std::string fname;
 		{
@@ -122,15 +153,8 @@ MeteoProfile::CloudIcons::CloudIcons(const std::string& basefile, const Cairo::R
 			fn << basefile << ((i + 1) * 25) << ".svg";
 			fname = Glib::build_filename(PACKAGE_DATA_DIR, "gramet", fn.str());
 		}
-		GError *err(0);
-		RsvgHandle *h(rsvg_handle_new_from_file(fname.c_str(), &err));
+		RsvgHandle *h(get_svghandle(fname));
 		if (!h) {
-			std::cerr << "Cannot open " << fname;
-			if (err)
-				std::cerr << ": " << err->message;
-			std::cerr << std::endl;
-			g_error_free(err);
-			err = 0;
 			m_ok = false;
 			break;
 		}
@@ -142,7 +166,6 @@ MeteoProfile::CloudIcons::CloudIcons(const std::string& basefile, const Cairo::R
 						    dim.width, dim.height);
 		Cairo::RefPtr<Cairo::Context> ctx(Cairo::Context::create(m_icons[i]));
 		m_ok = rsvg_handle_render_cairo(h, ctx->cobj());
-		g_object_unref(G_OBJECT(h));
 		if (!m_ok) {
 			std::cerr << "Cannot render " << fname << std::endl;
 			break;
@@ -206,6 +229,7 @@ MeteoProfile::ConvCloudIcons::Icon::Icon(const Cairo::RefPtr<Cairo::Surface>& sf
 
 MeteoProfile::ConvCloudIcons::ConvCloudIcons(const std::string& basefile, const Cairo::RefPtr<Cairo::Surface> sfc)
 {
+	Glib::Threads::Mutex::Lock lock(m_assetmutex);
 	for (unsigned int i = 1; i <= 1024; ++i) {
 		std::string fname;
 		{
@@ -215,15 +239,8 @@ MeteoProfile::ConvCloudIcons::ConvCloudIcons(const std::string& basefile, const
 		}
 		if (!Glib::file_test(fname, Glib::FILE_TEST_EXISTS) || !Glib::file_test(fname, Glib::FILE_TEST_IS_REGULAR))
 			break;
-		GError *err(0);
-		RsvgHandle *h(rsvg_handle_new_from_file(fname.c_str(), &err));
+		RsvgHandle *h(get_svghandle(fname));
 		if (!h) {
-			std::cerr << "Cannot open " << fname;
-			if (err)
-				std::cerr << ": " << err->message;
-			std::cerr << std::endl;
-			g_error_free(err);
-			err = 0;
 			m_icons.clear();
 			break;
 		}
@@ -235,7 +252,6 @@ MeteoProfile::ConvCloudIcons::ConvCloudIcons(const std::string& basefile, const
 									   dim.width, dim.height));
 		Cairo::RefPtr<Cairo::Context> ctx(Cairo::Context::create(sfc1));
 		bool ok(rsvg_handle_render_cairo(h, ctx->cobj()));
-		g_object_unref(G_OBJECT(h));
 		if (!ok) {
 			m_icons.clear();
 			std::cerr << "Cannot render " << fname << std::endl;
@@ -328,23 +344,15 @@ int MeteoProfile::StratusCloudBlueNoise::Group::compare(const Group& x) const
 	return 0;
 }
 
-MeteoProfile::StratusCloudBlueNoise::StratusCloudBlueNoise(const std::string& filename, const Cairo::RefPtr<Cairo::Surface> sfc)
+MeteoProfile::StratusCloudBlueNoise::StratusCloudBlueNoise(const std::string& filename)
 	: m_width(0), m_height(0), m_x(0), m_y(0)
 {
 	// load cloud file
 	{
 		std::string fname(Glib::build_filename(PACKAGE_DATA_DIR, "gramet", filename));
-		GError *err(0);
-		RsvgHandle *h(rsvg_handle_new_from_file(fname.c_str(), &err));
-		if (!h) {
-			std::cerr << "Cannot open " << fname;
-			if (err)
-				std::cerr << ": " << err->message;
-			std::cerr << std::endl;
-			g_error_free(err);
-			err = 0;
+		RsvgHandle *h(get_svghandle(fname));
+		if (!h)
 			return;
-		}
 		RsvgDimensionData dim;
 		rsvg_handle_get_dimensions(h, &dim);
 		if (false)
@@ -352,10 +360,8 @@ MeteoProfile::StratusCloudBlueNoise::StratusCloudBlueNoise(const std::string& fi
 		RsvgDimensionData dimtile;
 		RsvgPositionData postile;
 		if (!rsvg_handle_get_dimensions_sub(h, &dimtile, "#tilearea") ||
-		    !rsvg_handle_get_position_sub(h, &postile, "#tilearea")) {
-			g_object_unref(G_OBJECT(h));
+		    !rsvg_handle_get_position_sub(h, &postile, "#tilearea"))
 			return;
-		}
 		if (true)
 			std::cerr << "Stratus Icon " << fname << " WxH " << dim.width << ' ' << dim.height
 				  << " Tile WxH " << dimtile.width << ' ' << dimtile.height
@@ -365,8 +371,7 @@ MeteoProfile::StratusCloudBlueNoise::StratusCloudBlueNoise(const std::string& fi
 			gnrstr << "#g" << std::setw(3) << std::setfill('0') << gnr;
 			if (!rsvg_handle_has_sub(h, gnrstr.str().c_str()))
 				break;
-			Cairo::RefPtr<Cairo::Surface> sfcg(Cairo::Surface::create(sfc, Cairo::CONTENT_COLOR_ALPHA,
-										  dim.width, dim.height));
+			Cairo::RefPtr<Cairo::Surface> sfcg(Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, dim.width, dim.height));
 			Cairo::RefPtr<Cairo::Context> ctx(Cairo::Context::create(sfcg));
 			if (!rsvg_handle_render_cairo_sub(h, ctx->cobj(), gnrstr.str().c_str()))
 				break;
@@ -387,7 +392,6 @@ MeteoProfile::StratusCloudBlueNoise::StratusCloudBlueNoise(const std::string& fi
 				std::cerr << "sfcg type " << sfcg->get_type() << " alpha type " << alpha->get_type() << std::endl;
 			m_groups.push_back(Group(sfcg, alpha, gnr, mx, my));
 		}
-		g_object_unref(G_OBJECT(h));
 		if (m_groups.empty())
 			return;
 		m_width = dimtile.width;
@@ -428,6 +432,52 @@ MeteoProfile::StratusCloudBlueNoise::StratusCloudBlueNoise(const std::string& fi
 		}
 	}
 	std::sort(m_groups.begin(), m_groups.end());
+	// the layout is shared between threads, drop the surfaces it was computed from
+	for (groups_t::iterator gi(m_groups.begin()), ge(m_groups.end()); gi != ge; ++gi)
+		gi->set_surface(Cairo::RefPtr<Cairo::Surface>());
+}
+
+MeteoProfile::StratusCloudBlueNoise::StratusCloudBlueNoise(const std::string& filename, const Cairo::RefPtr<Cairo::Surface> sfc)
+	: m_width(0), m_height(0), m_x(0), m_y(0)
+{
+	Glib::Threads::Mutex::Lock lock(m_assetmutex);
+	const StratusCloudBlueNoise& layout(get_stratuslayout(filename));
+	if (!layout)
+		return;
+	RsvgHandle *h(get_svghandle(Glib::build_filename(PACKAGE_DATA_DIR, "gramet", filename)));
+	if (!h)
+		return;
+	RsvgDimensionData dim;
+	rsvg_handle_get_dimensions(h, &dim);
+	for (groups_t::const_iterator gi(layout.m_groups.begin()), ge(layout.m_groups.end()); gi != ge; ++gi) {
+		std::ostringstream gnrstr;
+		gnrstr << "#g" << std::setw(3) << std::setfill('0') << gi->get_nr();
+		Cairo::RefPtr<Cairo::Surface> sfcg(Cairo::Surface::create(sfc, Cairo::CONTENT_COLOR_ALPHA,
+									  dim.width, dim.height));
+		Cairo::RefPtr<Cairo::Context> ctx(Cairo::Context::create(sfcg));
+		if (!rsvg_handle_render_cairo_sub(h, ctx->cobj(), gnrstr.str().c_str())) {
+			m_groups.clear();
+			return;
+		}
+		m_groups.push_back(*gi);
+		m_groups.back().set_surface(sfcg);
+	}
+	m_width = layout.m_width;
+	m_height = layout.m_height;
+	m_x = layout.m_x;
+	m_y = layout.m_y;
+}
+
+// group positions and blue noise densities only depend on the SVG file, compute them once;
+// the caller must hold the asset mutex
+const MeteoProfile::StratusCloudBlueNoise& MeteoProfile::get_stratuslayout(const std::string& filename)
+{
+	typedef std::map<std::string,StratusCloudBlueNoise> cache_t;
+	static cache_t cache;
+	cache_t::iterator i(cache.find(filename));
+	if (i == cache.end())
+		i = cache.insert(cache_t::value_type(filename, StratusCloudBlueNoise(filename))).first;
+	return i->second;
 }
 
 MeteoProfile::MeteoProfile(const FPlanRoute& route, const TopoDb30::RouteProfile& routeprofile,
@@ -4658,6 +4708,198 @@ void MeteoChart::draw(const Cairo::RefPtr<Cairo::Context>& cr, int width, int he
 	cr->restore();
 }
 
+class MeteoPageRenderer::ProfilePage : public Page {
+public:
+	ProfilePage(const MeteoProfile& prof, double pagewidth, double pageheight, int width, int height,
+		    double origindist, double scaledist, double originelev, double scaleelev, MeteoProfile::yaxis_t yaxis);
+
+protected:
+	const MeteoProfile& m_prof;
+	double m_origindist;
+	double m_scaledist;
+	double m_originelev;
+	double m_scaleelev;
+	MeteoProfile::yaxis_t m_yaxis;
+
+	virtual void draw(const Cairo::RefPtr<Cairo::Context>& cr);
+};
+
+class MeteoPageRenderer::ChartPage : public Page {
+public:
+	ChartPage(const MeteoChart& chart, double pagewidth, double pageheight, int width, int height,
+		  const Point& center, double scalelon, double scalelat, double pressure);
+
+protected:
+	// MeteoChart::draw loads the layers of its pressure level, so every page needs its own copy
+	MeteoChart m_chart;
+	Point m_center;
+	double m_scalelon;
+	double m_scalelat;
+	double m_pressure;
+
+	virtual void draw(const Cairo::RefPtr<Cairo::Context>& cr);
+};
+
+MeteoPageRenderer::Page::Page(double pagewidth, double pageheight, int width, int height)
+	: m_pagewidth(pagewidth), m_pageheight(pageheight), m_time(0), m_width(width), m_height(height)
+{
+}
+
+MeteoPageRenderer::Page::~Page()
+{
+}
+
+void MeteoPageRenderer::Page::render(void)
+{
+	gint64 tstart(g_get_monotonic_time());
+	try {
+		cairo_rectangle_t ext;
+		ext.x = 0;
+		ext.y = 0;
+		ext.width = m_pagewidth;
+		ext.height = m_pageheight;
+		m_surface = Cairo::RefPtr<Cairo::Surface>(new Cairo::Surface(cairo_recording_surface_create(CAIRO_CONTENT_COLOR_ALPHA, &ext), true));
+		Cairo::RefPtr<Cairo::Context> ctx(Cairo::Context::create(m_surface));
+		ctx->translate((m_pagewidth - m_width) * 0.5, (m_pageheight - m_height) * 0.5);
+		draw(ctx);
+		m_surface->flush();
+	} catch (const std::exception& e) {
+		m_surface.clear();
+		m_error = e.what();
+	}
+	m_time = (g_get_monotonic_time() - tstart) * 1e-6;
+}
+
+void MeteoPageRenderer::Page::output(const Cairo::RefPtr<Cairo::Surface>& surface)
+{
+	{
+		Cairo::RefPtr<Cairo::PdfSurface> pdfsurface(Cairo::RefPtr<Cairo::PdfSurface>::cast_dynamic(surface));
+		if (pdfsurface)
+			pdfsurface->set_size(m_pagewidth, m_pageheight);
+	}
+	Cairo::RefPtr<Cairo::Context> ctx(Cairo::Context::create(surface));
+	if (m_surface) {
+		ctx->set_source(m_surface, 0, 0);
+		ctx->paint();
+	}
+	ctx->show_page();
+}
+
+MeteoPageRenderer::ProfilePage::ProfilePage(const MeteoProfile& prof, double pagewidth, double pageheight, int width, int height,
+					    double origindist, double scaledist, double originelev, double scaleelev, MeteoProfile::yaxis_t yaxis)
+	: Page(pagewidth, pageheight, width, height), m_prof(prof), m_origindist(origindist), m_scaledist(scaledist),
+	  m_originelev(originelev), m_scaleelev(scaleelev), m_yaxis(yaxis)
+{
+}
+
+void MeteoPageRenderer::ProfilePage::draw(const Cairo::RefPtr<Cairo::Context>& cr)
+{
+	m_prof.draw(cr, m_width, m_height, m_origindist, m_scaledist, m_originelev, m_scaleelev, m_yaxis);
+}
+
+MeteoPageRenderer::ChartPage::ChartPage(const MeteoChart& chart, double pagewidth, double pageheight, int width, int height,
+					const Point& center, double scalelon, double scalelat, double pressure)
+	: Page(pagewidth, pageheight, width, height), m_chart(chart), m_center(center),
+	  m_scalelon(scalelon), m_scalelat(scalelat), m_pressure(pressure)
+{
+}
+
+void MeteoPageRenderer::ChartPage::draw(const Cairo::RefPtr<Cairo::Context>& cr)
+{
+	m_chart.draw(cr, m_width, m_height, m_center, m_scalelon, m_scalelat, m_pressure);
+}
+
+MeteoPageRenderer::MeteoPageRenderer(void)
+	: m_next(0), m_rendertime(0), m_outputtime(0)
+{
+}
+
+MeteoPageRenderer::~MeteoPageRenderer()
+{
+	for (pages_t::iterator pi(m_pages.begin()), pe(m_pages.end()); pi != pe; ++pi)
+		delete *pi;
+}
+
+void MeteoPageRenderer::add_profile(const MeteoProfile& prof, double pagewidth, double pageheight, int width, int height,
+				    double origindist, double scaledist, double originelev, double scaleelev,
+				    MeteoProfile::yaxis_t yaxis)
+{
+	m_pages.push_back(new ProfilePage(prof, pagewidth, pageheight, width, height,
+					  origindist, scaledist, originelev, scaleelev, yaxis));
+}
+
+void MeteoPageRenderer::add_chart(const MeteoChart& chart, double pagewidth, double pageheight, int width, int height,
+				  const Point& center, double scalelon, double scalelat, double pressure)
+{
+	m_pages.push_back(new ChartPage(chart, pagewidth, pageheight, width, height,
+					center, scalelon, scalelat, pressure));
+}
+
+void MeteoPageRenderer::render_thread(void)
+{
+	for (;;) {
+		unsigned int i;
+		{
+			Glib::Threads::Mutex::Lock lock(m_mutex);
+			if (m_next >= m_pages.size())
+				break;
+			i = m_next++;
+		}
+		m_pages[i]->render();
+	}
+}
+
+void MeteoPageRenderer::render(unsigned int worker)
+{
+	gint64 tstart(g_get_monotonic_time());
+	m_next = 0;
+	if (!worker) {
+		long nproc(sysconf(_SC_NPROCESSORS_ONLN));
+		worker = std::max(nproc, 1L);
+	}
+	worker = std::min(worker, (unsigned int)m_pages.size());
+	if (worker <= 1) {
+		render_thread();
+	} else {
+		std::vector<Glib::Threads::Thread *> thr;
+		for (unsigned int i = 0; i < worker; ++i)
+			thr.push_back(Glib::Threads::Thread::create(sigc::mem_fun(*this, &MeteoPageRenderer::render_thread)));
+		for (std::vector<Glib::Threads::Thread *>::iterator ti(thr.begin()), te(thr.end()); ti != te; ++ti)
+			(*ti)->join();
+	}
+	m_rendertime = (g_get_monotonic_time() - tstart) * 1e-6;
+	if (false) {
+		std::cerr << "MeteoPageRenderer: " << m_pages.size() << " pages, " << worker << " threads, "
+			  << m_rendertime << 's' << std::endl;
+		for (unsigned int i = 0; i < m_pages.size(); ++i)
+			std::cerr << "  page " << i << ' ' << m_pages[i]->get_time() << 's' << std::endl;
+	}
+}
+
+void MeteoPageRenderer::output(const Cairo::RefPtr<Cairo::Surface>& surface)
+{
+	gint64 tstart(g_get_monotonic_time());
+	for (pages_t::iterator pi(m_pages.begin()), pe(m_pages.end()); pi != pe; ++pi)
+		(*pi)->output(surface);
+	surface->finish();
+	m_outputtime = (g_get_monotonic_time() - tstart) * 1e-6;
+}
+
+double MeteoPageRenderer::get_pagetime(unsigned int i) const
+{
+	if (i >= m_pages.size())
+		return 0;
+	return m_pages[i]->get_time();
+}
+
+const std::string& MeteoPageRenderer::get_pageerror(unsigned int i) const
+{
+	static const std::string noerr;
+	if (i >= m_pages.size())
+		return noerr;
+	return m_pages[i]->get_error();
+}
+
 const std::string& to_str(Cairo::SurfaceType st)
 {
 	switch (st) {
@@ -4879,6 +5121,12 @@ void METARTAFChart::DbLoaderSqlite::load(MetarTafSet& mtset, const Rect& bbox, t
 	mtset.loadstn_sqlite(m_db, bbox, metarhistory, tafhistory);
 }
 
+void METARTAFChart::DbLoaderStore::load(MetarTafSet& mtset, const Rect& bbox, time_t tmin, time_t tmax,
+					unsigned int metarhistory, unsigned int tafhistory)
+{
+	m_store.load(mtset, bbox, tmin, tmax, metarhistory, tafhistory);
+}
+
 #ifdef HAVE_PQXX
 
 void METARTAFChart::DbLoaderPG::load(MetarTafSet& mtset, const Rect& bbox, time_t tmin, time_t tmax,
@@ -5159,6 +5407,11 @@ void METARTAFChart::set_db_sqlite(const std::string& db)
 	m_dbloader = dbloader_t(new DbLoaderSqlite(db));
 }
 
+void METARTAFChart::set_db_store(const MetarTafStore& store)
+{
+	m_dbloader = dbloader_t(new DbLoaderStore(store));
+}
+
 #ifdef HAVE_PQXX
 
 void METARTAFChart::set_db_pg(pqxx::connection_base& conn)
@@ -268,6 +268,7 @@ protected:
 	class StratusCloudBlueNoise {
 	public:
 		StratusCloudBlueNoise(const std::string& filename, const Cairo::RefPtr<Cairo::Surface> sfc);
+		explicit StratusCloudBlueNoise(const std::string& filename);
 		operator bool(void) const { return get_width() && get_height() && !m_groups.empty(); }
 		unsigned int get_width(void) const { return m_width; }
 		unsigned int get_height(void) const { return m_height; }
@@ -281,6 +282,7 @@ protected:
 			      unsigned int nr, double x, double y);
 			const Cairo::RefPtr<Cairo::Surface>& get_surface(void) const { return m_surface; }
 			const Cairo::RefPtr<Cairo::Surface>& get_alphasurface(void) const { return m_alphasurface; }
+			void set_surface(const Cairo::RefPtr<Cairo::Surface>& sfc) { m_surface = sfc; m_alphasurface.clear(); }
 			Cairo::RefPtr<Cairo::Pattern> get_pattern(void) const;
 			Cairo::RefPtr<Cairo::Pattern> get_alphapattern(void) const;
 			unsigned int get_nr(void) const { return m_nr; }
@@ -312,6 +314,10 @@ protected:
 		int m_y;
 	};
 
+	// parsed SVG assets and the stratus layout are kept per process, surfaces are created per draw call
+	static const StratusCloudBlueNoise& get_stratuslayout(const std::string& filename);
+	static Glib::Threads::Mutex m_assetmutex;
+
 	static void extract_remainder(std::vector<LinePoint>& ln, std::multiset<LinePoint>& lp, uint32_t maxydiff = 1000);
 	static std::vector<LinePoint> extract_line(std::multiset<LinePoint>& lp, uint32_t maxydiff = 1000);
 	static std::vector<LinePoint> extract_area(std::multiset<LinePoint>& lp, uint32_t maxydiff = 1000);
@@ -547,6 +553,61 @@ protected:
 	};
 };
 
+// Renders profile pages and charts concurrently into recording surfaces,
+// then replays them in order onto the output surface
+class MeteoPageRenderer {
+public:
+	MeteoPageRenderer(void);
+	~MeteoPageRenderer();
+	void add_profile(const MeteoProfile& prof, double pagewidth, double pageheight, int width, int height,
+			 double origindist, double scaledist, double originelev, double scaleelev,
+			 MeteoProfile::yaxis_t yaxis = MeteoProfile::yaxis_altitude);
+	void add_chart(const MeteoChart& chart, double pagewidth, double pageheight, int width, int height,
+		       const Point& center, double scalelon, double scalelat, double pressure);
+	void render(unsigned int worker = 0);
+	void output(const Cairo::RefPtr<Cairo::Surface>& surface);
+	unsigned int size(void) const { return m_pages.size(); }
+	// stage timings in seconds
+	double get_rendertime(void) const { return m_rendertime; }
+	double get_outputtime(void) const { return m_outputtime; }
+	double get_pagetime(unsigned int i) const;
+	const std::string& get_pageerror(unsigned int i) const;
+
+protected:
+	class Page {
+	public:
+		Page(double pagewidth, double pageheight, int width, int height);
+		virtual ~Page();
+		void render(void);
+		void output(const Cairo::RefPtr<Cairo::Surface>& surface);
+		double get_time(void) const { return m_time; }
+		const std::string& get_error(void) const { return m_error; }
+
+	protected:
+		Cairo::RefPtr<Cairo::Surface> m_surface;
+		std::string m_error;
+		double m_pagewidth;
+		double m_pageheight;
+		double m_time;
+		int m_width;
+		int m_height;
+
+		virtual void draw(const Cairo::RefPtr<Cairo::Context>& cr) = 0;
+	};
+
+	class ProfilePage;
+	class ChartPage;
+
+	typedef std::vector<Page *> pages_t;
+	pages_t m_pages;
+	Glib::Threads::Mutex m_mutex;
+	unsigned int m_next;
+	double m_rendertime;
+	double m_outputtime;
+
+	void render_thread(void);
+};
+
 class WMOStation {
 public:
 	WMOStation(const char *icao = 0, const char *name = 0, const char *state = 0, const char *country = 0,
@@ -708,6 +769,7 @@ public:
 #ifdef HAVE_PQXX
 	void set_db_pg(pqxx::connection_base& conn);
 #endif
+	void set_db_store(const MetarTafStore& store);
 	const FPlanRoute& get_route(void) const { return m_route; }
 	void set_route(const FPlanRoute& r = FPlanRoute(*(FPlan *)0)) { m_route = r; }
 	const alternates_t& get_alternates(void) const { return m_altn; }
@@ -862,6 +924,15 @@ protected:
 		std::string m_db;
 	};
 
+	class DbLoaderStore : public DbLoader {
+	public:
+		DbLoaderStore(const MetarTafStore& store) : m_store(store) {}
+		virtual void load(MetarTafSet& mtset, const Rect& bbox, time_t tmin, time_t tmax, unsigned int metarhistory, unsigned int tafhistory);
+
+	protected:
+		const MetarTafStore& m_store;
+	};
+
 #ifdef HAVE_PQXX
 
 	class DbLoaderPG : public DbLoader {
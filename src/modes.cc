@@ -136,6 +136,27 @@ int ModeSMessage::correct(uint32_t addr)
 	return r;
 }
 
+ModeSMessage::addrcorrections_t ModeSMessage::get_addr_corrections(bool islong, unsigned int maxerr)
+{
+	addrcorrections_t r;
+	r.push_back(addrcorrections_t::value_type(0U, 0U));
+	for (unsigned int nerr = 1; nerr <= maxerr && nerr <= 2; ++nerr) {
+		for (unsigned int idx = 0; idx < sizeof(msg112_crc_residue)/sizeof(msg112_crc_residue[0]); ++idx) {
+			if (!islong && (msg112_crc_errloc[idx][0] < 56 || msg112_crc_errloc[idx][1] < 56))
+				continue;
+			unsigned int n(0);
+			for (unsigned int i = 0; i < 2; ++i)
+				if (msg112_crc_errloc[idx][i] != 255)
+					++n;
+			if (n != nerr)
+				continue;
+			// the syndrome against address a is addr_to_crc(addr() ^ a)
+			r.push_back(addrcorrections_t::value_type(crc_to_addr(msg112_crc_residue[idx]), nerr));
+		}
+	}
+	return r;
+}
+
 std::string::const_iterator ModeSMessage::parse_raw(std::string::const_iterator si, std::string::const_iterator se)
 {
 	std::string::const_iterator si1(si);
@@ -17,6 +17,7 @@
 
 #include <limits>
 #include <set>
+#include <vector>
 #include <glibmm.h>
 
 #include "geom.h"
@@ -42,6 +43,10 @@ class ModeSMessage {
 	static uint32_t addr_to_crc(uint32_t addr);
 	static uint32_t crc_to_addr(uint32_t crc);
 	int correct(uint32_t addr = 0U);
+	// address field differences (received XOR true address) that correct() can repair
+	// with at most maxerr bit errors, paired with the number of bit errors, fewest first
+	typedef std::vector<std::pair<uint32_t,unsigned int> > addrcorrections_t;
+	static addrcorrections_t get_addr_corrections(bool islong, unsigned int maxerr);
 	std::string::const_iterator parse_raw(std::string::const_iterator si, std::string::const_iterator se);
 	std::string::const_iterator parse_line(std::string::const_iterator si, std::string::const_iterator se);
 	std::string get_raw_string(void) const;
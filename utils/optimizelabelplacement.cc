@@ -32,6 +32,10 @@
 #include <stdexcept>
 #include <stdarg.h>
 #include <set>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <functional>
 
 #include <stdlib.h>
 #include <string.h>
@@ -50,7 +54,7 @@
 
 class LabelPlacementOpt {
         public:
-                LabelPlacementOpt(const Glib::ustring& output_dir);
+                LabelPlacementOpt(const Glib::ustring& output_dir, unsigned int worker = 0);
                 ~LabelPlacementOpt();
                 void optimize(unsigned int arpt_nav_wpt_passes = 3, unsigned int bdry_passes = 3,
                               bool arptmutable = false, bool navmutable = false, bool wptmutable = false, bool bdrymutable = false);
@@ -62,6 +66,10 @@ class LabelPlacementOpt {
                 AirspacesDb m_airspacedb;
                 AirwaysDb m_airwaysdb;
                 LabelsDb m_labelsdb;
+                unsigned int m_worker;
+
+                // in memory label set, optimized in parallel on tile partitions
+                class LabelSet;
 
                 static Point label_offset(const Point& p, LabelsDb::Label::label_placement_t lp = LabelsDb::Label::label_center);
                 static double label_metric(const Point& p1, const Point& p2);
@@ -70,21 +78,17 @@ class LabelPlacementOpt {
                 void save_label(LabelsDb::Label& e);
                 void copy_arpt_nav_wpt_to_labelsdb(bool arptmutable = false, bool navmutable = false, bool wptmutable = false);
                 void update_arpt_nav_wpt(void);
-                double compute_metric(const LabelsDb::Label& e, const Point& pt, LabelsDb::Label::label_placement_t lp);
-                double compute_metric(const LabelsDb::Label& e) { return compute_metric(e, e.get_coord(), e.get_label_placement()); }
-                void compute_metrics(void);
-                void optimize_pass(void);
                 void optimize_arpt_nav_wpt(unsigned int passes = 3, bool arptmutable = false, bool navmutable = false, bool wptmutable = false);
                 void copy_bdry_to_labelsdb(bool bdrymutable = false);
                 void update_bdry(void);
-                void optimize_bdry_pass(void);
                 void optimize_bdry(unsigned int passes = 3, bool bdrymutable = false);
 };
 
 
 /* ---------------------------------------------------------------------- */
 
-LabelPlacementOpt::LabelPlacementOpt(const Glib::ustring& output_dir)
+LabelPlacementOpt::LabelPlacementOpt(const Glib::ustring& output_dir, unsigned int worker)
+        : m_worker(worker)
 {
         try {
                 m_airportdb.open(output_dir);
@@ -364,49 +368,187 @@ void LabelPlacementOpt::update_arpt_nav_wpt(void)
         m_waypointdb.vacuum();
 }
 
-double LabelPlacementOpt::compute_metric(const LabelsDb::Label& e, const Point& pt, LabelsDb::Label::label_placement_t lp)
+class LabelPlacementOpt::LabelSet {
+        public:
+                LabelSet(LabelsDb& db, unsigned int worker = 0);
+                void load_polygons(AirspacesDb& db);
+                void compute_metrics(void);
+                void optimize_pass(bool bdry = false);
+                void save(void);
+                unsigned int size(void) const { return m_labels.size(); }
+
+        protected:
+                typedef std::vector<unsigned int> indexvector_t;
+                typedef std::map<unsigned int,indexvector_t> tiles_t;
+
+                class Loader : public LabelsDb::ForEach {
+                        public:
+                                Loader(LabelsDb::elementvector_t& ev) : m_ev(ev) {}
+                                bool operator()(const LabelsDb::Label& e) { m_ev.push_back(e); return true; }
+                                bool operator()(const std::string& id) { return true; }
+
+                        protected:
+                                LabelsDb::elementvector_t& m_ev;
+                };
+
+                LabelsDb& m_db;
+                LabelsDb::elementvector_t m_labels;
+                // label_offset of each label, kept in sync with m_labels
+                std::vector<Point> m_lblcoord;
+                std::vector<MultiPolygonHole> m_poly;
+                tiles_t m_tiles;
+                Glib::Threads::Mutex m_mutex;
+                indexvector_t m_worktiles;
+                unsigned int m_worknext;
+                unsigned int m_workdone;
+                unsigned int m_workchg;
+                unsigned int m_worker;
+                bool m_bdry;
+
+                static unsigned int tile_key(int lat, int lon);
+                static void tile_coord(const Point& pt, int& lat, int& lon);
+                static unsigned int tile_color(unsigned int key);
+                void build_tiles(void);
+                double compute_metric(unsigned int idx, const Point& pt, LabelsDb::Label::label_placement_t lp) const;
+                void run_threads(const sigc::slot<void,unsigned int>& fn);
+                void metrics_thread(unsigned int nr);
+                void optimize_thread(unsigned int nr);
+                bool optimize_label(unsigned int idx);
+};
+
+LabelPlacementOpt::LabelSet::LabelSet(LabelsDb& db, unsigned int worker)
+        : m_db(db), m_worknext(0), m_workdone(0), m_workchg(0), m_worker(worker), m_bdry(false)
+{
+        {
+                Loader ld(m_labels);
+                m_db.for_each(ld, false);
+        }
+        m_lblcoord.reserve(m_labels.size());
+        unsigned int nrmut(0);
+        for (LabelsDb::elementvector_t::const_iterator ei(m_labels.begin()), ee(m_labels.end()); ei != ee; ++ei) {
+                m_lblcoord.push_back(label_offset(ei->get_coord(), ei->get_label_placement()));
+                if (ei->get_mutable())
+                        ++nrmut;
+        }
+        std::cerr << "Loaded " << m_labels.size() << " labels, " << nrmut << " mutable" << std::endl;
+}
+
+void LabelPlacementOpt::LabelSet::load_polygons(AirspacesDb& db)
+{
+        m_poly.clear();
+        m_poly.resize(m_labels.size());
+        for (unsigned int i = 0; i < m_labels.size(); ++i) {
+                LabelsDb::Label& e(m_labels[i]);
+                if (!e.get_mutable())
+                        continue;
+                AirspacesDb::Airspace as(db(e.get_subid(), e.get_subtable()));
+                if (!as.is_valid()) {
+                        std::cerr << "Airspace: ID " << e.get_subid() << '/' << e.get_subtable() << " not found" << std::endl;
+                        // only in memory; update_bdry reports it again
+                        e.set_mutable(false);
+                        continue;
+                }
+                m_poly[i] = as.get_polygon();
+        }
+}
+
+unsigned int LabelPlacementOpt::LabelSet::tile_key(int lat, int lon)
+{
+        lat = std::max(std::min(lat + 90, 180), 0);
+        lon = (lon + 180) % 360;
+        if (lon < 0)
+                lon += 360;
+        return lat * 360 + lon;
+}
+
+void LabelPlacementOpt::LabelSet::tile_coord(const Point& pt, int& lat, int& lon)
+{
+        lat = (int)floor(pt.get_lat_deg_dbl());
+        lon = (int)floor(pt.get_lon_deg_dbl());
+}
+
+unsigned int LabelPlacementOpt::LabelSet::tile_color(unsigned int key)
+{
+        // tiles of the same color are at least two tiles apart, and a label
+        // only looks at labels within one degree, so they are independent
+        unsigned int lat(key / 360), lon(key % 360);
+        return (lat % 3) * 3 + (lon % 3);
+}
+
+void LabelPlacementOpt::LabelSet::build_tiles(void)
+{
+        m_tiles.clear();
+        for (unsigned int i = 0; i < m_labels.size(); ++i) {
+                int lat, lon;
+                tile_coord(m_labels[i].get_coord(), lat, lon);
+                m_tiles[tile_key(lat, lon)].push_back(i);
+        }
+}
+
+double LabelPlacementOpt::LabelSet::compute_metric(unsigned int idx, const Point& pt, LabelsDb::Label::label_placement_t lp) const
 {
         double m(0);
         Point pdim((Point::coord_t)(Point::from_deg_dbl), (Point::coord_t)(Point::from_deg_dbl));
-        LabelsDb::elementvector_t ev(m_labelsdb.find_by_rect(Rect(pt - pdim, pt + pdim)));
+        Rect bbox(pt - pdim, pt + pdim);
         Point plbl(label_offset(pt, lp));
-        for (LabelsDb::elementvector_t::iterator ei(ev.begin()), ee(ev.end()); ei != ee; ei++) {
-                if (ei->get_id() == e.get_id())
+        int lat0, lon0;
+        tile_coord(pt, lat0, lon0);
+        for (int lat = lat0 - 1; lat <= lat0 + 1; ++lat) {
+                if (lat < -90 || lat > 90)
                         continue;
-                m += label_metric(label_offset(ei->get_coord(), ei->get_label_placement()), plbl);
+                for (int lon = lon0 - 1; lon <= lon0 + 1; ++lon) {
+                        tiles_t::const_iterator ti(m_tiles.find(tile_key(lat, lon)));
+                        if (ti == m_tiles.end())
+                                continue;
+                        for (indexvector_t::const_iterator ii(ti->second.begin()), ie(ti->second.end()); ii != ie; ++ii) {
+                                if (*ii == idx)
+                                        continue;
+                                if (!bbox.is_inside(m_labels[*ii].get_coord()))
+                                        continue;
+                                m += label_metric(m_lblcoord[*ii], plbl);
+                        }
+                }
         }
         return m;
 }
 
-void LabelPlacementOpt::compute_metrics(void)
+void LabelPlacementOpt::LabelSet::run_threads(const sigc::slot<void,unsigned int>& fn)
 {
-        unsigned int nr(0);
-        LabelsDb::Label e;
-        m_labelsdb.loadfirst(e);
-        while (e.is_valid()) {
-                if (e.get_mutable()) {
-                        nr++;
-                        if ((nr & 1023) == 1)
-                                std::cerr << "Computing Metrics " << nr << "..." << std::endl;
-                        e.set_metric(compute_metric(e));
-                        m_labelsdb.save(e);
-                }
-                m_labelsdb.loadnext(e);
+        if (m_worker <= 1) {
+                fn(0);
+                return;
         }
+        typedef std::vector<Glib::Threads::Thread *> threads_t;
+        threads_t thr;
+        for (unsigned int i = 0; i < m_worker; ++i)
+                thr.push_back(Glib::Threads::Thread::create(sigc::bind(fn, i)));
+        for (threads_t::iterator ti(thr.begin()), te(thr.end()); ti != te; ++ti)
+                (*ti)->join();
 }
 
-void LabelPlacementOpt::optimize_pass(void)
+void LabelPlacementOpt::LabelSet::metrics_thread(unsigned int nr)
 {
-        unsigned int nr(0);
-        LabelsDb::elementvector_t ev(m_labelsdb.find_mutable_by_metric());
-        for (LabelsDb::elementvector_t::iterator ei(ev.begin()), ee(ev.end()); ei != ee; ei++) {
-                if (!ei->get_mutable())
+        unsigned int stride(std::max(m_worker, 1U));
+        for (unsigned int i = nr; i < m_labels.size(); i += stride) {
+                LabelsDb::Label& e(m_labels[i]);
+                if (!e.get_mutable())
                         continue;
-                nr++;
-                if ((nr & 1023) == 1)
-                        std::cerr << "Optimizing " << nr << "..." << std::endl;
-                double m(ei->get_metric());
-                LabelsDb::Label::label_placement_t lp(ei->get_label_placement());
+                e.set_metric(compute_metric(i, e.get_coord(), e.get_label_placement()));
+        }
+}
+
+void LabelPlacementOpt::LabelSet::compute_metrics(void)
+{
+        build_tiles();
+        run_threads(sigc::mem_fun(*this, &LabelSet::metrics_thread));
+}
+
+bool LabelPlacementOpt::LabelSet::optimize_label(unsigned int idx)
+{
+        LabelsDb::Label& e(m_labels[idx]);
+        double m(e.get_metric());
+        if (!m_bdry) {
+                LabelsDb::Label::label_placement_t lp(e.get_label_placement());
                 bool chg(false);
                 static const LabelsDb::Label::label_placement_t lps[] = {
                         LabelsDb::Label::label_e,
@@ -418,40 +560,138 @@ void LabelPlacementOpt::optimize_pass(void)
                         LabelsDb::Label::label_placement_t lp1(lps[lpi]);
                         if (lp == lp1)
                                 continue;
-                        double m1(compute_metric(*ei, ei->get_coord(), lp1));
+                        double m1(compute_metric(idx, e.get_coord(), lp1));
                         if (m1 < m) {
                                 m = m1;
                                 lp = lp1;
                                 chg = true;
                         }
                 }
-                if (chg) {
-                        ei->set_label_placement(lp);
-                        ei->set_metric(m);
-                        save_label(*ei);
+                if (!chg)
+                        return false;
+                e.set_label_placement(lp);
+                e.set_metric(m);
+                m_lblcoord[idx] = label_offset(e.get_coord(), lp);
+                return true;
+        }
+        Point coord(e.get_coord());
+        bool chg(false);
+        static const Point offs[] = {
+                Point((Point::coord_t)(Point::from_deg_dbl / 60.0 / 2), 0),
+                Point(0, (Point::coord_t)(Point::from_deg_dbl / 60.0 / 2)),
+                Point(-(Point::coord_t)(Point::from_deg_dbl / 60.0 / 2), 0),
+                Point(0, -(Point::coord_t)(Point::from_deg_dbl / 60.0 / 2))
+        };
+        for (unsigned int oi = 0; oi < sizeof(offs)/sizeof(offs[0]); oi++) {
+                Point pt(e.get_coord() + offs[oi]);
+                if (!m_poly[idx].windingnumber(pt))
+                        continue;
+                double m1(compute_metric(idx, pt, e.get_label_placement()));
+                if (m1 < m) {
+                        m = m1;
+                        coord = pt;
+                        chg = true;
                 }
         }
+        if (!chg)
+                return false;
+        // the label stays in its tile's bucket until the next build_tiles;
+        // moves are half a minute, so the one degree neighbourhood still covers it
+        e.set_coord(coord);
+        e.set_metric(m);
+        m_lblcoord[idx] = label_offset(coord, e.get_label_placement());
+        return true;
+}
+
+void LabelPlacementOpt::LabelSet::optimize_thread(unsigned int nr)
+{
+        unsigned int done(0), chg(0);
+        for (;;) {
+                unsigned int key;
+                {
+                        Glib::Threads::Mutex::Lock lock(m_mutex);
+                        if (m_worknext >= m_worktiles.size())
+                                break;
+                        key = m_worktiles[m_worknext++];
+                }
+                tiles_t::const_iterator ti(m_tiles.find(key));
+                if (ti == m_tiles.end())
+                        continue;
+                const indexvector_t& tile(ti->second);
+                // greedy, worst label first
+                typedef std::multimap<double,unsigned int,std::greater<double> > order_t;
+                order_t order;
+                for (indexvector_t::const_iterator ii(tile.begin()), ie(tile.end()); ii != ie; ++ii)
+                        if (m_labels[*ii].get_mutable())
+                                order.insert(order_t::value_type(m_labels[*ii].get_metric(), *ii));
+                for (order_t::const_iterator oi(order.begin()), oe(order.end()); oi != oe; ++oi) {
+                        ++done;
+                        if (optimize_label(oi->second))
+                                ++chg;
+                }
+        }
+        Glib::Threads::Mutex::Lock lock(m_mutex);
+        m_workdone += done;
+        m_workchg += chg;
+}
+
+void LabelPlacementOpt::LabelSet::optimize_pass(bool bdry)
+{
+        Glib::TimeVal tv0;
+        tv0.assign_current_time();
+        compute_metrics();
+        double mtot(0);
+        for (LabelsDb::elementvector_t::const_iterator ei(m_labels.begin()), ee(m_labels.end()); ei != ee; ++ei)
+                if (ei->get_mutable())
+                        mtot += ei->get_metric();
+        m_bdry = bdry && m_poly.size() == m_labels.size();
+        m_workdone = m_workchg = 0;
+        for (unsigned int color = 0; color < 9; ++color) {
+                m_worktiles.clear();
+                for (tiles_t::const_iterator ti(m_tiles.begin()), te(m_tiles.end()); ti != te; ++ti)
+                        if (tile_color(ti->first) == color)
+                                m_worktiles.push_back(ti->first);
+                m_worknext = 0;
+                run_threads(sigc::mem_fun(*this, &LabelSet::optimize_thread));
+        }
+        Glib::TimeVal tv1;
+        tv1.assign_current_time();
+        tv1 -= tv0;
+        double t(tv1.as_double());
+        std::cerr << "Optimized " << m_workdone << " labels, " << m_workchg << " changed, metric " << mtot
+                  << ", " << t << "s";
+        if (t > 0)
+                std::cerr << " (" << (m_workdone / t) << " labels/s)";
+        std::cerr << std::endl;
+}
+
+void LabelPlacementOpt::LabelSet::save(void)
+{
+        LabelsDb::elementvector_t ev;
+        for (LabelsDb::elementvector_t::const_iterator ei(m_labels.begin()), ee(m_labels.end()); ei != ee; ++ei)
+                if (ei->get_mutable())
+                        ev.push_back(*ei);
+        std::cerr << "Saving " << ev.size() << " labels..." << std::endl;
+        m_db.save_placement(ev);
 }
 
 void LabelPlacementOpt::optimize_arpt_nav_wpt(unsigned int passes, bool arptmutable, bool navmutable, bool wptmutable)
 {
         copy_arpt_nav_wpt_to_labelsdb(arptmutable, navmutable, wptmutable);
-        for (unsigned int pass = 1; pass <= passes; pass++) {
-                std::cerr << "Optimize Airport/Waypoint/Navaid labels pass " << pass << "..." << std::endl;
-                compute_metrics();
-                optimize_pass();
+        {
+                LabelSet ls(m_labelsdb, m_worker);
+                for (unsigned int pass = 1; pass <= passes; pass++) {
+                        std::cerr << "Optimize Airport/Waypoint/Navaid labels pass " << pass << "..." << std::endl;
+                        ls.optimize_pass();
+                }
+                ls.compute_metrics();
+                ls.save();
         }
-        compute_metrics();
         update_arpt_nav_wpt();
         // set all mutable to nonmutable
-        LabelsDb::Label lbl;
-        m_labelsdb.loadfirst(lbl);
-        while (lbl.is_valid()) {
-                if (lbl.get_mutable()) {
-                        lbl.set_mutable(false);
-                        m_labelsdb.save(lbl);
-                }
-                m_labelsdb.loadnext(lbl);
+        {
+                sqlite3x::sqlite3_command cmd(m_labelsdb.get_db(), "UPDATE labels SET MUTABLE=0 WHERE MUTABLE!=0;");
+                cmd.executenonquery();
         }
 }
 
@@ -502,56 +742,17 @@ void LabelPlacementOpt::update_bdry(void)
         m_airspacedb.vacuum();
 }
 
-void LabelPlacementOpt::optimize_bdry_pass(void)
-{
-        unsigned int nr(0);
-        LabelsDb::elementvector_t ev(m_labelsdb.find_mutable_by_metric());
-        for (LabelsDb::elementvector_t::iterator ei(ev.begin()), ee(ev.end()); ei != ee; ei++) {
-                if (!ei->get_mutable())
-                        continue;
-                AirspacesDb::Airspace as(m_airspacedb(ei->get_subid(), ei->get_subtable()));
-                if (!as.is_valid()) {
-                        std::cerr << "Airspace: ID " << ei->get_subid() << '/' << ei->get_subtable() << " not found" << std::endl;
-                        continue;
-                }
-                nr++;
-                if ((nr & 1023) == 1)
-                        std::cerr << "Optimizing " << nr << "..." << std::endl;
-                double m(ei->get_metric());
-                Point coord(ei->get_coord());
-                bool chg(false);
-                static const Point offs[] = {
-                        Point((Point::coord_t)(Point::from_deg_dbl / 60.0 / 2), 0),
-                        Point(0, (Point::coord_t)(Point::from_deg_dbl / 60.0 / 2)),
-                        Point(-(Point::coord_t)(Point::from_deg_dbl / 60.0 / 2), 0),
-                        Point(0, -(Point::coord_t)(Point::from_deg_dbl / 60.0 / 2))
-                };
-                for (unsigned int oi = 0; oi < sizeof(offs)/sizeof(offs[0]); oi++) {
-                        Point pt(ei->get_coord() + offs[oi]);
-                        if (!as.get_polygon().windingnumber(pt))
-                                continue;
-                        double m1(compute_metric(*ei, pt, ei->get_label_placement()));
-                        if (m1 < m) {
-                                m = m1;
-                                coord = pt;
-                                chg = true;
-                        }
-                }
-                if (chg) {
-                        ei->set_coord(coord);
-                        ei->set_metric(m);
-                        save_label(*ei);
-                }
-        }
-}
-
 void LabelPlacementOpt::optimize_bdry(unsigned int passes, bool bdrymutable)
 {
         copy_bdry_to_labelsdb(bdrymutable);
-        for (unsigned int pass = 1; pass <= passes; pass++) {
-                std::cerr << "Optimize Airspace labels pass " << pass << "..." << std::endl;
-                compute_metrics();
-                optimize_bdry_pass();
+        {
+                LabelSet ls(m_labelsdb, m_worker);
+                ls.load_polygons(m_airspacedb);
+                for (unsigned int pass = 1; pass <= passes; pass++) {
+                        std::cerr << "Optimize Airspace labels pass " << pass << "..." << std::endl;
+                        ls.optimize_pass(true);
+                }
+                ls.save();
         }
         update_bdry();
 }
@@ -926,6 +1127,7 @@ int main(int argc, char *argv[])
                 { "output-dir",          required_argument, NULL, 'o' },
                 { "arpt-nav-wpt-passes", required_argument, NULL, 0x400 },
                 { "bdry-passes",         required_argument, NULL, 0x401 },
+                { "worker",              required_argument, NULL, 0x402 },
                 { "arpt-mutable",        no_argument,       NULL, 0x500 },
                 { "nav-mutable",         no_argument,       NULL, 0x501 },
                 { "wpt-mutable",         no_argument,       NULL, 0x502 },
@@ -934,7 +1136,7 @@ int main(int argc, char *argv[])
         };
         int c, err(0);
         Glib::ustring output_dir(".");
-        unsigned int arpt_nav_wpt_passes = 3, bdry_passes = 3;
+        unsigned int arpt_nav_wpt_passes = 3, bdry_passes = 3, worker = 0;
         bool arptmutable = false, navmutable = false, wptmutable = false, bdrymutable = false;
 
         while ((c = getopt_long(argc, argv, "hvo:", long_options, NULL)) != -1) {
@@ -955,6 +1157,10 @@ int main(int argc, char *argv[])
                                 bdry_passes = strtoul(optarg, 0, 0);
                                 break;
 
+                        case 0x402:
+                                worker = strtoul(optarg, 0, 0);
+                                break;
+
                         case 0x500:
                                 arptmutable = true;
                                 break;
@@ -984,6 +1190,7 @@ int main(int argc, char *argv[])
                           << "     -o, --output-dir       Output (Database) Directory" << std::endl
                           << "     --arpt-nav-wpt-passes  Number of Airport/Navaid/Waypoint passes" << std::endl
                           << "     --bdry-passes          Number of Airspace passes" << std::endl
+                          << "     --worker               Number of optimizer threads (0: number of CPUs)" << std::endl
                           << "     --arpt-mutable         Optimize all non-off airport labels (instead of only \"any\" labels)" << std::endl
                           << "     --nav-mutable          Optimize all non-off navaid labels (instead of only \"any\" labels)" << std::endl
                           << "     --wpt-mutable          Optimize all non-off waypoint labels (instead of only \"any\" labels)" << std::endl
@@ -991,7 +1198,9 @@ int main(int argc, char *argv[])
                 return EX_USAGE;
         }
         try {
-                LabelPlacementOpt opt(output_dir);
+                if (!worker)
+                        worker = std::max(sysconf(_SC_NPROCESSORS_ONLN), 1L);
+                LabelPlacementOpt opt(output_dir, worker);
                 opt.optimize(arpt_nav_wpt_passes, bdry_passes, arptmutable, navmutable, wptmutable, bdrymutable);
 
         } catch (const std::exception& e) {
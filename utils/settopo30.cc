@@ -197,18 +197,41 @@ int main(int argc, char *argv[])
                 db.sync_off();
 
                 TopoDb30::TopoCoordinate tcmin(bbox.get_southwest()), tcmax(bbox.get_northeast());
-                for (TopoDb30::TopoCoordinate tc(tcmin);; ) {
-                        std::cerr << "Point " << (Point)tc << " set to " << elev << " (previous " << db.get_elev(tc) << ")" << std::endl;
-                        db.set_elev(tc, elev);
-                        if (tc.get_lon() != tcmax.get_lon()) {
-                                tc.advance_east();
-                                continue;
+                typedef TopoDb30::TopoTileCoordinate ttc_t;
+                static const TopoDb30::TopoCoordinate::coord_t lonpix(ttc_t::lon_tiles * TopoDb30::tile_size);
+                TopoDb30::TopoCoordinate::coord_t lonspan((tcmax.get_lon() + lonpix - tcmin.get_lon()) % lonpix);
+                ttc_t ttcmin(tcmin), ttcmax(tcmax);
+                unsigned int lontiles((ttcmax.get_lon_tile() + ttc_t::lon_tiles - ttcmin.get_lon_tile()) % ttc_t::lon_tiles + 1);
+                if (lonspan + TopoDb30::tile_size >= lonpix)
+                        lontiles = ttc_t::lon_tiles;
+                // whole tiles are modified in memory and written in batched transactions
+                TopoDb30::TileWriter wr(db);
+                for (uint16_t lat = ttcmin.get_lat_tile(); lat <= ttcmax.get_lat_tile(); ++lat) {
+                        for (unsigned int i = 0; i < lontiles; ++i) {
+                                ttc_t ttc((ttcmin.get_lon_tile() + i) % ttc_t::lon_tiles, lat);
+                                TopoDb30::Tile tile(db.get_db(), ttc.get_tile_index());
+                                unsigned int cnt(0);
+                                for (uint16_t lato = 0; lato < TopoDb30::tile_size; ++lato) {
+                                        ttc.set_lat_offs(lato);
+                                        for (uint16_t lono = 0; lono < TopoDb30::tile_size; ++lono) {
+                                                ttc.set_lon_offs(lono);
+                                                TopoDb30::TopoCoordinate tc(ttc);
+                                                if (tc.get_lat() < tcmin.get_lat() || tc.get_lat() > tcmax.get_lat())
+                                                        continue;
+                                                if ((tc.get_lon() + lonpix - tcmin.get_lon()) % lonpix > lonspan)
+                                                        continue;
+                                                tile.set_elev(ttc.get_pixel_index(), elev);
+                                                ++cnt;
+                                        }
+                                }
+                                if (!cnt)
+                                        continue;
+                                if (!quiet)
+                                        std::cerr << "Tile " << tile.get_index() << ": " << cnt << " points set to " << elev << std::endl;
+                                wr.save(tile);
                         }
-                        if (tc.get_lat() == tcmax.get_lat())
-                                break;
-                        tc.set_lon(tcmin.get_lon());
-                        tc.advance_north();
                 }
+                wr.finish();
                 if (doanalyze)
                         db.analyze();
                 if (dovacuum)
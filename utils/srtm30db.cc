@@ -20,8 +20,10 @@
 #include "sysdeps.h"
 
 #include <getopt.h>
+#include <unistd.h>
 #include <cstring>
 #include <memory>
+#include <algorithm>
 #include <iostream>
 #include <zfstream.hpp>
 #include <glibmm.h>
@@ -40,7 +42,7 @@ class DirScanner {
                 DirScanner(void);
                 ~DirScanner();
                 void scan_directory(const Glib::ustring& dir);
-                void save_tiles(TopoDb30& db);
+                void save_tiles(TopoDb30& db, TopoDb30::TileWriter& wr, const Rect& bbox, unsigned int worker = 1, bool resume = false);
 
                 class HdrDict : protected std::map<std::string,std::string> {
                         public:
@@ -67,6 +69,8 @@ class DirScanner {
                 typedef std::vector<DEMTile *> demtiles_t;
                 demtiles_t m_demtiles;
 
+                class RowBuilder;
+
                 void parse_header(const Glib::ustring& fn);
 };
 
@@ -74,7 +78,11 @@ class DEMTile {
         public:
                 static DEMTile *create(const Glib::ustring& fname, const DirScanner::HdrDict& dict);
                 ~DEMTile();
-                void save(TopoDb30& db);
+                void load_dem(void);
+                void clear_dem(void);
+                bool is_loaded(void) const { return !!m_elev; }
+                Rect get_rect(void) const;
+                TopoDb30::elev_t get_elev(double lon, double lat) const;
                 const Glib::ustring& get_name(void) const { return m_filename; }
 
                 class Sorter {
@@ -87,8 +95,6 @@ class DEMTile {
 
         private:
                 DEMTile(const Glib::ustring& fname, double lon, double lat, double dlon, double dlat, unsigned int ncols, unsigned int nrows, int nodata);
-                void load_dem(void);
-                void clear_dem(void);
 
                 static constexpr double tilesize = 1.0;
 
@@ -283,12 +289,6 @@ void DirScanner::parse_header(const Glib::ustring & fn)
         m_demtiles.push_back(tile);
 }
 
-void DirScanner::save_tiles(TopoDb30 & db)
-{
-        for (demtiles_t::iterator ti(m_demtiles.begin()), te(m_demtiles.end()); ti != te; ti++)
-                (*ti)->save(db);
-}
-
 /* ---------------------------------------------------------------------- */
 
 constexpr double DEMTile::tilesize;
@@ -383,35 +383,223 @@ void DEMTile::clear_dem(void)
         m_elev = 0;
 }
 
-void DEMTile::save(TopoDb30 & db)
+Rect DEMTile::get_rect(void) const
 {
-        load_dem();
+        Point psw, pne;
+        psw.set_lon_deg_dbl(m_lon);
+        psw.set_lat_deg_dbl(m_lat);
+        pne.set_lon_deg_dbl(m_dlon * m_ncols);
+        pne.set_lat_deg_dbl(m_dlat * m_nrows);
+        pne += psw;
+        return Rect(psw, pne);
+}
+
+TopoDb30::elev_t DEMTile::get_elev(double lon, double lat) const
+{
+        if (!m_elev)
+                return TopoDb30::nodata;
+        double x((lon - m_lon) / m_dlon);
+        double y((lat - m_lat) / m_dlat);
         {
-                Point psw, pne;
-                psw.set_lon_deg_dbl(m_lon);
-                psw.set_lat_deg_dbl(m_lat);
-                pne.set_lon_deg_dbl(m_dlon * m_ncols);
-                pne.set_lat_deg_dbl(m_dlat * m_nrows);
-                pne += psw;
-                std::cerr << "DEM: saving " << Rect(psw, pne) << std::endl;
+                double xw(360.0 / m_dlon);
+                if (x < 0)
+                        x += xw;
+                else if (x >= xw)
+                        x -= xw;
+        }
+        if (x < 0 || y < 0)
+                return TopoDb30::nodata;
+        unsigned int ix(x), iy(y);
+        if (ix >= m_ncols || iy >= m_nrows)
+                return TopoDb30::nodata;
+        // note: data is in row major mode; first row is the northernmost one
+        return m_elev[(m_nrows - 1 - iy) * m_ncols + ix];
+}
+
+/* ---------------------------------------------------------------------- */
+
+class DirScanner::RowBuilder {
+        public:
+                RowBuilder(unsigned int worker = 1) : m_next(0), m_worker(std::max(worker, 1U)) {}
+                void add(const TopoDb30::Tile::ptr_t& tile, const demtiles_t& dems);
+                void build(void);
+                void save(TopoDb30::TileWriter& wr);
+                bool empty(void) const { return m_jobs.empty(); }
+                unsigned int size(void) const { return m_jobs.size(); }
+
+        protected:
+                class Job {
+                        public:
+                                Job(const TopoDb30::Tile::ptr_t& tile, const demtiles_t& dems) : m_tile(tile), m_dems(dems) {}
+                                TopoDb30::Tile::ptr_t m_tile;
+                                demtiles_t m_dems;
+                                std::vector<uint8_t> m_blob;
+                };
+                typedef std::vector<Job> jobs_t;
+                jobs_t m_jobs;
+                demtiles_t m_load;
+                Glib::Threads::Mutex m_mutex;
+                unsigned int m_next;
+                unsigned int m_worker;
+
+                void run(void (RowBuilder::*fn)(void));
+                void load_thread(void);
+                void build_thread(void);
+                static void build(Job& job);
+};
+
+void DirScanner::RowBuilder::add(const TopoDb30::Tile::ptr_t& tile, const demtiles_t& dems)
+{
+        m_jobs.push_back(Job(tile, dems));
+        for (demtiles_t::const_iterator di(dems.begin()), de(dems.end()); di != de; ++di)
+                if (!(*di)->is_loaded() && std::find(m_load.begin(), m_load.end(), *di) == m_load.end())
+                        m_load.push_back(*di);
+}
+
+void DirScanner::RowBuilder::run(void (RowBuilder::*fn)(void))
+{
+        m_next = 0;
+        if (m_worker <= 1) {
+                (this->*fn)();
+                return;
         }
-        // note: data is in row major mode; first row 1, then row 2. rows encode latitude!
-        for (unsigned int y = 0; y < m_nrows; y++) {
-                double lat = m_lat + m_dlat * y + 0.5 * m_dlat;
-                Point pt;
-                pt.set_lat_deg_dbl(lat);
-                for (unsigned int x = 0; x < m_ncols; x++) {
-                        double lon = m_lon + m_dlon * x + 0.5 * m_dlon;
-                        pt.set_lon_deg_dbl(lon);
-                        TopoDb30::TopoCoordinate tc(pt);
-                        TopoDb30::elev_t elev(m_elev[(m_nrows - 1 - y) * m_ncols + x]);
-                        //tc.print(std::cerr << "Point " << pt << " TopoCoord ") << ' ' << ((Point)tc) << " elev " << elev << std::endl;
-                        if (elev != TopoDb30::nodata)
-                                db.set_elev(tc, elev);
+        typedef std::vector<Glib::Threads::Thread *> threads_t;
+        threads_t thr;
+        for (unsigned int i = 0; i < m_worker; ++i)
+                thr.push_back(Glib::Threads::Thread::create(sigc::mem_fun(*this, fn)));
+        for (threads_t::iterator ti(thr.begin()), te(thr.end()); ti != te; ++ti)
+                (*ti)->join();
+}
+
+void DirScanner::RowBuilder::load_thread(void)
+{
+        for (;;) {
+                DEMTile *t;
+                {
+                        Glib::Threads::Mutex::Lock lock(m_mutex);
+                        if (m_next >= m_load.size())
+                                return;
+                        t = m_load[m_next++];
                 }
+                t->load_dem();
         }
-        clear_dem();
-        db.cache_commit();
+}
+
+void DirScanner::RowBuilder::build_thread(void)
+{
+        for (;;) {
+                Job *job;
+                {
+                        Glib::Threads::Mutex::Lock lock(m_mutex);
+                        if (m_next >= m_jobs.size())
+                                return;
+                        job = &m_jobs[m_next++];
+                }
+                build(*job);
+        }
+}
+
+void DirScanner::RowBuilder::build(Job& job)
+{
+        typedef TopoDb30::TopoTileCoordinate ttc_t;
+        static const double ppd(ttc_t::lon_tiles * (double)TopoDb30::tile_size / 360.0);
+        TopoDb30::Tile& tile(*job.m_tile);
+        ttc_t ttc(tile.get_index() % ttc_t::lon_tiles, tile.get_index() / ttc_t::lon_tiles);
+        for (uint16_t lato = 0; lato < TopoDb30::tile_size; ++lato) {
+                ttc.set_lat_offs(lato);
+                for (uint16_t lono = 0; lono < TopoDb30::tile_size; ++lono) {
+                        ttc.set_lon_offs(lono);
+                        TopoDb30::TopoCoordinate tc(ttc);
+                        // pixel center
+                        double lon((tc.get_lon() + 0.5) / ppd);
+                        double lat((tc.get_lat() + 0.5) / ppd - 90.0);
+                        if (lon >= 180.0)
+                                lon -= 360.0;
+                        for (demtiles_t::const_iterator di(job.m_dems.begin()), de(job.m_dems.end()); di != de; ++di) {
+                                TopoDb30::elev_t elev((*di)->get_elev(lon, lat));
+                                if (elev == TopoDb30::nodata)
+                                        continue;
+                                tile.set_elev(ttc.get_pixel_index(), elev);
+                                break;
+                        }
+                }
+        }
+        tile.compress(job.m_blob);
+}
+
+void DirScanner::RowBuilder::build(void)
+{
+        run(&RowBuilder::load_thread);
+        m_load.clear();
+        run(&RowBuilder::build_thread);
+}
+
+void DirScanner::RowBuilder::save(TopoDb30::TileWriter& wr)
+{
+        for (jobs_t::const_iterator ji(m_jobs.begin()), je(m_jobs.end()); ji != je; ++ji)
+                wr.save(*ji->m_tile, ji->m_blob);
+        m_jobs.clear();
+}
+
+void DirScanner::save_tiles(TopoDb30& db, TopoDb30::TileWriter& wr, const Rect& bbox, unsigned int worker, bool resume)
+{
+        typedef TopoDb30::TopoTileCoordinate ttc_t;
+        ttc_t tcsw((TopoDb30::TopoCoordinate)bbox.get_southwest());
+        ttc_t tcne((TopoDb30::TopoCoordinate)bbox.get_northeast());
+        unsigned int lontiles((tcne.get_lon_tile() + ttc_t::lon_tiles - tcsw.get_lon_tile()) % ttc_t::lon_tiles + 1);
+        std::vector<Rect> demrect;
+        for (demtiles_t::const_iterator ti(m_demtiles.begin()), te(m_demtiles.end()); ti != te; ++ti)
+                demrect.push_back((*ti)->get_rect());
+        Glib::TimeVal tv0;
+        tv0.assign_current_time();
+        unsigned int nrtiles(0), nrskip(0);
+        // rows are processed south to north in tile index order, so the
+        // bin file is written sequentially; only the DEMs of the current
+        // row are kept in memory
+        for (uint16_t lat = tcsw.get_lat_tile(); lat <= tcne.get_lat_tile(); ++lat) {
+                RowBuilder row(worker);
+                std::vector<bool> demused(m_demtiles.size(), false);
+                for (unsigned int i = 0; i < lontiles; ++i) {
+                        ttc_t ttc((tcsw.get_lon_tile() + i) % ttc_t::lon_tiles, lat);
+                        TopoDb30::tile_index_t idx(ttc.get_tile_index());
+                        if (resume && wr.is_saved(idx)) {
+                                ++nrskip;
+                                continue;
+                        }
+                        Rect r((TopoDb30::TopoCoordinate)ttc,
+                               (TopoDb30::TopoCoordinate)ttc_t(ttc.get_lon_tile(), lat, TopoDb30::tile_size - 1, TopoDb30::tile_size - 1));
+                        demtiles_t dems;
+                        for (unsigned int j = 0; j < m_demtiles.size(); ++j) {
+                                if (!demrect[j].is_intersect(r))
+                                        continue;
+                                dems.push_back(m_demtiles[j]);
+                                demused[j] = true;
+                        }
+                        if (dems.empty())
+                                continue;
+                        // start from the database contents, DEM nodata pixels keep their previous value
+                        row.add(TopoDb30::Tile::ptr_t(new TopoDb30::Tile(db.get_db(), idx)), dems);
+                }
+                for (unsigned int j = 0; j < m_demtiles.size(); ++j)
+                        if (!demused[j])
+                                m_demtiles[j]->clear_dem();
+                if (row.empty())
+                        continue;
+                row.build();
+                nrtiles += row.size();
+                row.save(wr);
+                Glib::TimeVal tv;
+                tv.assign_current_time();
+                tv -= tv0;
+                double t(tv.as_double());
+                std::cerr << "Tile row " << lat << ": " << nrtiles << " tiles saved, " << nrskip << " skipped, "
+                          << t << "s";
+                if (t > 0)
+                        std::cerr << " (" << (nrtiles / t) << " tiles/s)";
+                std::cerr << std::endl;
+        }
+        for (demtiles_t::iterator ti(m_demtiles.begin()), te(m_demtiles.end()); ti != te; ++ti)
+                (*ti)->clear_dem();
 }
 
 /* ---------------------------------------------------------------------- */
@@ -429,15 +617,19 @@ int main(int argc, char *argv[])
                 { "max-lat",            required_argument, NULL, 0x401 },
                 { "min-lon",            required_argument, NULL, 0x402 },
                 { "max-lon",            required_argument, NULL, 0x403 },
+                { "binfile",            no_argument,       NULL, 'b' },
+                { "resume",             no_argument,       NULL, 'r' },
+                { "worker",             required_argument, NULL, 0x404 },
                 { NULL,                 0,                 NULL, 0 }
         };
         int c, err(0);
-        bool quiet(false), purge(true);
+        bool quiet(false), purge(true), binfile(false), resume(false);
+        unsigned int worker(0);
         Glib::ustring output_dir(".");
         Glib::ustring gtopo_dir("/usr/local/download/srtm/version2/SRTM30");
         Rect bbox(Point(Point::lon_min, Point::lat_min), Point(Point::lon_max, Point::lat_max));
 
-        while (((c = getopt_long(argc, argv, "hvqwd:o:k:g:a:W:n", long_options, NULL)) != -1)) {
+        while (((c = getopt_long(argc, argv, "hvqwd:o:k:g:a:W:nbr", long_options, NULL)) != -1)) {
                 switch (c) {
                         case 'v':
                                 std::cout << argv[0] << ": (C) 2007 Thomas Sailer" << std::endl;
@@ -459,6 +651,19 @@ int main(int argc, char *argv[])
                                 purge = false;
                                 break;
 
+                        case 'b':
+                                binfile = true;
+                                break;
+
+                        case 'r':
+                                resume = true;
+                                purge = false;
+                                break;
+
+                        case 0x404:
+                                worker = strtoul(optarg, 0, 0);
+                                break;
+
                         case 0x400:
                         {
                                 Point sw(bbox.get_southwest());
@@ -511,7 +716,15 @@ int main(int argc, char *argv[])
                           << "     -h, --help        Display this information" << std::endl
                           << "     -v, --version     Display version information" << std::endl
                           << "     -g, --gtopo-dir   GTopo (or SRTM30) Directory" << std::endl
-                          << "     -o, --output-dir  Database Output Directory" << std::endl << std::endl;
+                          << "     -o, --output-dir  Database Output Directory" << std::endl
+                          << "     -n, --nopurge     Do not purge the existing database" << std::endl
+                          << "     -b, --binfile     Also write topo30.bin" << std::endl
+                          << "     -r, --resume      Skip tiles already in the database (implies --nopurge)" << std::endl
+                          << "     --worker          Number of tile builder threads (0: number of CPUs)" << std::endl
+                          << "     --min-lat         South border" << std::endl
+                          << "     --max-lat         North border" << std::endl
+                          << "     --min-lon         West border" << std::endl
+                          << "     --max-lon         East border" << std::endl << std::endl;
                 return EX_USAGE;
         }
         std::cout << "DB Boundary: " << (std::string)bbox.get_southwest().get_lat_str()
@@ -528,11 +741,15 @@ int main(int argc, char *argv[])
                 if (purge)
                         db.purgedb();
                 db.sync_off();
-                ds.save_tiles(db);
-
-
+                if (!worker)
+                        worker = std::max(sysconf(_SC_NPROCESSORS_ONLN), 1L);
+                TopoDb30::TileWriter wr(db, binfile ? Glib::build_filename(output_dir, "topo30.bin") : Glib::ustring());
+                ds.save_tiles(db, wr, bbox, worker, resume);
+                wr.commit();
                 db.analyze();
                 db.vacuum();
+                // after vacuum, so the bin file is not older than the database
+                wr.finish();
                 db.close();
         } catch (const std::exception& e) {
                 std::cerr << "Error: " << e.what() << std::endl;
@@ -101,35 +101,11 @@ int main(int argc, char *argv[])
                 TopoDb30 db;
                 db.open(output_dir);
                 db.sync_off();
-		TopoDb30::BinFileHeader header;
-		std::ofstream of(argv[optind], std::ofstream::binary);
-		if (!of.good())
-			throw std::runtime_error("Cannot write to file " + std::string(argv[optind]));
-		uint64_t ptr(sizeof(header));
-		of.seekp(ptr, std::ofstream::beg);
 		{
-			sqlite3x::sqlite3_command cmd(db.get_db(), "SELECT MINELEV,MAXELEV,ELEV,ID FROM topo ORDER BY ID;");
-			sqlite3x::sqlite3_cursor cursor(cmd.executecursor());
-			while (cursor.step()) {
-				TopoDb30::Tile tile(cursor);
-		        	TopoDb30::BinFileHeader::Tile& htile(header[tile.get_index()]);
-				htile.set_minelev(tile.get_minelev());
-				htile.set_maxelev(tile.get_maxelev());
-				htile.set_offset(ptr);
-				static const unsigned int nrpixels(TopoDb30::tile_size * TopoDb30::tile_size);
-				uint8_t data[nrpixels * 2];
-				for (unsigned int i = 0; i < nrpixels; ++i) {
-					TopoDb30::elev_t e(tile.get_elev(i));
-					data[2 * i] = e;
-					data[2 * i + 1] = e >> 8;
-				}
-				of.seekp(ptr, std::ofstream::beg);
-				of.write((char *)data, nrpixels * 2);
-				ptr += nrpixels * 2;
-			}
+			// streams all database tiles in index order
+			TopoDb30::TileWriter wr(db, argv[optind]);
+			wr.finish();
 		}
-		of.seekp(0, std::ofstream::beg);
-		of.write((char *)&header, sizeof(header));
                 db.close();
         } catch (const std::exception& e) {
                 std::cerr << "Error: " << e.what() << std::endl;
@@ -37,8 +37,13 @@ char *alloca ();
 #endif
 
 #include <getopt.h>
+#include <unistd.h>
+#include <stdlib.h>
 #include <iostream>
 #include <limits>
+#include <map>
+#include <vector>
+#include <algorithm>
 
 #ifdef HAVE_SYSEXITS_H
 #include <sysexits.h>
@@ -53,135 +58,330 @@ char *alloca ();
 
 /* ---------------------------------------------------------------------- */
 
-static bool update_airspaces(AirspacesDb::Airspace& e, TopoDb30& topodb, bool force)
+// elements are sorted into the topo tiles they touch; tiles are processed
+// in parallel, each tile once for all elements touching it
+class TileSweep {
+        public:
+                typedef TopoDb30::tile_index_t tile_index_t;
+                typedef std::vector<unsigned int> jobs_t;
+
+                TileSweep(TopoDb30& topodb, unsigned int worker = 1) : m_topodb(topodb), m_next(0), m_worker(std::max(worker, 1U)) {}
+                virtual ~TileSweep() {}
+                void add(tile_index_t tile, unsigned int job) { m_tiles[tile].push_back(job); }
+                void add(const Rect& r, unsigned int job);
+                void run(void);
+
+        protected:
+                typedef std::map<tile_index_t,jobs_t> tiles_t;
+                TopoDb30& m_topodb;
+                tiles_t m_tiles;
+                std::vector<tiles_t::const_iterator> m_work;
+                Glib::Threads::Mutex m_mutex;
+                unsigned int m_next;
+                unsigned int m_worker;
+
+                void thread(void);
+                virtual void process_tile(tile_index_t tile, const jobs_t& jobs) = 0;
+};
+
+void TileSweep::add(const Rect& r, unsigned int job)
+{
+        typedef TopoDb30::TopoTileCoordinate ttc_t;
+        ttc_t tmin((TopoDb30::TopoCoordinate)r.get_southwest()), tmax((TopoDb30::TopoCoordinate)r.get_northeast());
+        for (ttc_t tc(tmin);;) {
+                add(tc.get_tile_index(), job);
+                if (tc.get_lon_tile() != tmax.get_lon_tile()) {
+                        tc.advance_tile_east();
+                        continue;
+                }
+                if (tc.get_lat_tile() == tmax.get_lat_tile())
+                        break;
+                tc.set_lon_tile(tmin.get_lon_tile());
+                tc.advance_tile_north();
+        }
+}
+
+void TileSweep::thread(void)
+{
+        for (;;) {
+                tiles_t::const_iterator ti;
+                {
+                        Glib::Threads::Mutex::Lock lock(m_mutex);
+                        if (m_next >= m_work.size())
+                                return;
+                        ti = m_work[m_next++];
+                }
+                process_tile(ti->first, ti->second);
+        }
+}
+
+void TileSweep::run(void)
+{
+        Glib::TimeVal tv0;
+        tv0.assign_current_time();
+        m_work.clear();
+        unsigned int nrjobs(0);
+        for (tiles_t::const_iterator ti(m_tiles.begin()), te(m_tiles.end()); ti != te; ++ti) {
+                m_work.push_back(ti);
+                nrjobs += ti->second.size();
+        }
+        m_next = 0;
+        if (m_worker <= 1) {
+                thread();
+        } else {
+                typedef std::vector<Glib::Threads::Thread *> threads_t;
+                threads_t thr;
+                for (unsigned int i = 0; i < m_worker; ++i)
+                        thr.push_back(Glib::Threads::Thread::create(sigc::mem_fun(*this, &TileSweep::thread)));
+                for (threads_t::iterator ti(thr.begin()), te(thr.end()); ti != te; ++ti)
+                        (*ti)->join();
+        }
+        Glib::TimeVal tv;
+        tv.assign_current_time();
+        tv -= tv0;
+        double t(tv.as_double());
+        std::cerr << "Swept " << m_work.size() << " tiles, " << nrjobs << " tile/element pairs, " << t << "s";
+        if (t > 0)
+                std::cerr << " (" << (m_work.size() / t) << " tiles/s)";
+        std::cerr << std::endl;
+}
+
+/* ---------------------------------------------------------------------- */
+
+template <class DB> class ElementLoader : public DB::ForEach {
+        public:
+                ElementLoader(typename DB::elementvector_t& ev, bool force) : m_ev(ev), m_force(force) {}
+                bool operator()(const typename DB::element_t& e) { if (m_force || need_update(e)) m_ev.push_back(e); return true; }
+                bool operator()(const std::string& id) { return true; }
+
+        protected:
+                typename DB::elementvector_t& m_ev;
+                bool m_force;
+
+                static bool need_update(const AirspacesDb::Airspace& e) {
+                        return e.get_gndelevmin() == AirspacesDb::Airspace::gndelev_unknown ||
+                                e.get_gndelevmax() == AirspacesDb::Airspace::gndelev_unknown;
+                }
+                static bool need_update(const AirwaysDb::Airway& e) {
+                        return e.get_terrain_elev() == AirwaysDb::Airway::nodata ||
+                                e.get_corridor5_elev() == AirwaysDb::Airway::nodata;
+                }
+};
+
+template <class DB> static void save_elements(DB& db, typename DB::elementvector_t& ev, void (DB::*savebatch)(const typename DB::elementvector_t&))
 {
-        if (!force &&
-	    e.get_gndelevmin() != AirspacesDb::Airspace::gndelev_unknown &&
-            e.get_gndelevmax() != AirspacesDb::Airspace::gndelev_unknown)
-                return false;
-        TopoDb30::minmax_elev_t mme(topodb.get_minmax_elev(e.get_polygon()));
-        if ((e.get_gndelevmin() == AirspacesDb::Airspace::gndelev_unknown || force) && mme.first != TopoDb30::nodata)
-                e.set_gndelevmin(Point::round<AirspacesDb::Airspace::gndelev_t,float>(mme.first * Point::m_to_ft));
-        if ((e.get_gndelevmax() == AirspacesDb::Airspace::gndelev_unknown || force) && mme.second != TopoDb30::nodata)
-                e.set_gndelevmax(Point::round<AirspacesDb::Airspace::gndelev_t,float>(mme.second * Point::m_to_ft));
-        return true;
+        static const unsigned int batchsize = 1024;
+        typename DB::elementvector_t batch;
+        for (typename DB::elementvector_t::iterator ei(ev.begin()), ee(ev.end()); ei != ee; ++ei) {
+                if (ei->get_table() != DB::element_t::table_main) {
+                        // aux elements are copied into the main table
+                        db.save(*ei);
+                        continue;
+                }
+                batch.push_back(*ei);
+                if (batch.size() < batchsize)
+                        continue;
+                (db.*savebatch)(batch);
+                batch.clear();
+        }
+        if (!batch.empty())
+                (db.*savebatch)(batch);
 }
 
 /* ---------------------------------------------------------------------- */
 
-static void process_airspaces(const Glib::ustring& output_dir, bool force)
+class AirspaceSweep : public TileSweep {
+        public:
+                AirspaceSweep(TopoDb30& topodb, AirspacesDb::elementvector_t& ev, unsigned int worker);
+                TopoDb30::minmax_elev_t get_result(unsigned int idx) const { return m_result[idx]; }
+
+        protected:
+                AirspacesDb::elementvector_t& m_ev;
+                // (element, polygon) pairs
+                std::vector<std::pair<unsigned int,unsigned int> > m_parts;
+                std::vector<TopoDb30::minmax_elev_t> m_result;
+
+                void process_tile(tile_index_t tile, const jobs_t& jobs);
+};
+
+AirspaceSweep::AirspaceSweep(TopoDb30& topodb, AirspacesDb::elementvector_t& ev, unsigned int worker)
+        : TileSweep(topodb, worker), m_ev(ev), m_result(ev.size(), TopoDb30::minmax_elev_t(TopoDb30::nodata, TopoDb30::nodata))
+{
+        for (unsigned int i = 0; i < m_ev.size(); ++i) {
+                const MultiPolygonHole& poly(m_ev[i].get_polygon());
+                for (unsigned int j = 0; j < poly.size(); ++j) {
+                        if (poly[j].get_exterior().empty())
+                                continue;
+                        add(poly[j].get_bbox(), m_parts.size());
+                        m_parts.push_back(std::make_pair(i, j));
+                }
+        }
+}
+
+void AirspaceSweep::process_tile(tile_index_t tile, const jobs_t& jobs)
+{
+        TopoDb30::Tile::const_ptr_t t(m_topodb.get_tile(tile));
+        if (!t) {
+                std::cerr << "TopoDb: cannot find tile " << tile << std::endl;
+                return;
+        }
+        for (jobs_t::const_iterator ji(jobs.begin()), je(jobs.end()); ji != je; ++ji) {
+                const std::pair<unsigned int,unsigned int>& part(m_parts[*ji]);
+                TopoDb30::minmax_elev_t mm(m_topodb.get_minmax_elev(m_ev[part.first].get_polygon()[part.second], *t));
+                Glib::Threads::Mutex::Lock lock(m_mutex);
+                m_result[part.first] = TopoDb30::merge_minmax_elev(m_result[part.first], mm);
+        }
+}
+
+static void process_airspaces(TopoDb30& topodb, const Glib::ustring& output_dir, bool force, unsigned int worker)
 {
-        TopoDb30 topodb;
-        topodb.open(output_dir);
-        topodb.sync_off();
         AirspacesDb db;
         db.open(output_dir);
         db.sync_off();
-        AirspacesDb::Airspace e;
-        db.loadfirst(e);
-        while (e.is_valid()) {
-                if (update_airspaces(e, topodb, force)) {
-                        std::cerr << "Saving Airspace " << e.get_icao() << ' ' << e.get_name() << ' ' << e.get_ident() << ' ' << e.get_sourceid()
-                                  << " elev min: " << e.get_gndelevmin() << " max: " << e.get_gndelevmax() << std::endl;
-                        db.save(e);
-                }
-                db.loadnext(e);
+        AirspacesDb::elementvector_t ev;
+        {
+                ElementLoader<AirspacesDb> ld(ev, force);
+                db.for_each(ld);
         }
+        std::cerr << "Updating " << ev.size() << " Airspaces" << std::endl;
+        AirspaceSweep sweep(topodb, ev, worker);
+        sweep.run();
+        for (unsigned int i = 0; i < ev.size(); ++i) {
+                AirspacesDb::Airspace& e(ev[i]);
+                TopoDb30::minmax_elev_t mme(sweep.get_result(i));
+                if ((e.get_gndelevmin() == AirspacesDb::Airspace::gndelev_unknown || force) && mme.first != TopoDb30::nodata)
+                        e.set_gndelevmin(Point::round<AirspacesDb::Airspace::gndelev_t,float>(mme.first * Point::m_to_ft));
+                if ((e.get_gndelevmax() == AirspacesDb::Airspace::gndelev_unknown || force) && mme.second != TopoDb30::nodata)
+                        e.set_gndelevmax(Point::round<AirspacesDb::Airspace::gndelev_t,float>(mme.second * Point::m_to_ft));
+                std::cerr << "Saving Airspace " << e.get_icao() << ' ' << e.get_name() << ' ' << e.get_ident() << ' ' << e.get_sourceid()
+                          << " elev min: " << e.get_gndelevmin() << " max: " << e.get_gndelevmax() << std::endl;
+        }
+        save_elements(db, ev, &AirspacesDb::save_gndelev);
         db.analyze();
         db.vacuum();
 }
 
 /* ---------------------------------------------------------------------- */
 
-static void compute_profile(TopoDb30& topodb, std::vector<TopoDb30::Profile>& profs, const Point& p0, const Point& p1,
-			    unsigned int itercnt = 0)
+// maximum terrain elevation along the line and within the 5nmi corridor
+static bool compute_profile(TopoDb30& topodb, TopoDb30::elev_t& terrain, TopoDb30::elev_t& corridor,
+                            const Point& p0, const Point& p1, unsigned int itercnt = 0)
 {
 	TopoDb30::Profile prof(topodb.get_profile(p0, p1, 5));
 	if (!prof.empty()) {
-		profs.push_back(prof);
-		return;
+                for (TopoDb30::Profile::const_iterator i(prof.begin()), e(prof.end()); i != e; ++i) {
+                        TopoDb30::elev_t el(i->get_elev());
+                        if (el != TopoDb30::nodata)
+                                terrain = std::max(terrain, el);
+                }
+                TopoDb30::elev_t el(prof.get_maxelev());
+                if (el != TopoDb30::nodata)
+                        corridor = std::max(corridor, el);
+		return true;
 	}
 	if (itercnt >= 8) {
 		std::cerr << "compute_profile: aborting due to iteration count" << std::endl;
-		return;
+		return false;
 	}
 	// fixme: should half according to great circle distance
 	Point pm(p0.halfway(p1));
 	++itercnt;
-	compute_profile(topodb, profs, p0, pm, itercnt);
-	compute_profile(topodb, profs, pm, p1, itercnt);
+	bool ok(compute_profile(topodb, terrain, corridor, p0, pm, itercnt));
+	ok = compute_profile(topodb, terrain, corridor, pm, p1, itercnt) || ok;
+        return ok;
 }
 
 /* ---------------------------------------------------------------------- */
 
-static bool update_airways(AirwaysDb::Airway& e, TopoDb30& topodb, bool force)
+// profiles do not split along tiles; airways are bucketed by the tile of
+// their start point so that neighbouring airways share the topo tile cache
+class AirwaySweep : public TileSweep {
+        public:
+                AirwaySweep(TopoDb30& topodb, AirwaysDb::elementvector_t& ev, unsigned int worker);
+                bool get_result(unsigned int idx, TopoDb30::elev_t& terrain, TopoDb30::elev_t& corridor) const;
+
+        protected:
+                AirwaysDb::elementvector_t& m_ev;
+                std::vector<TopoDb30::elev_t> m_terrain;
+                std::vector<TopoDb30::elev_t> m_corridor;
+                std::vector<bool> m_ok;
+
+                void process_tile(tile_index_t tile, const jobs_t& jobs);
+};
+
+AirwaySweep::AirwaySweep(TopoDb30& topodb, AirwaysDb::elementvector_t& ev, unsigned int worker)
+        : TileSweep(topodb, worker), m_ev(ev), m_terrain(ev.size(), std::numeric_limits<TopoDb30::elev_t>::min()),
+          m_corridor(ev.size(), std::numeric_limits<TopoDb30::elev_t>::min()), m_ok(ev.size(), false)
 {
-        if (!force &&
-	    e.get_terrain_elev() != AirwaysDb::Airway::nodata &&
-            e.get_corridor5_elev() != AirwaysDb::Airway::nodata)
-                return false;
-	std::vector<TopoDb30::Profile> profs;
-	compute_profile(topodb, profs, e.get_begin_coord(), e.get_end_coord());
-	if (profs.empty()) {
-		std::cerr << "Cannot compute profile: Airway " << e.get_name() << ' ' << e.get_begin_name()
-			  << ' ' << e.get_end_name() << ' ' << e.get_sourceid() << std::endl;
-		return false;
-	}
-        if (force || e.get_terrain_elev() == AirwaysDb::Airway::nodata) {
-		AirwaysDb::Airway::elev_t elev(std::numeric_limits<AirwaysDb::Airway::elev_t>::min());
-		for (std::vector<TopoDb30::Profile>::const_iterator psi(profs.begin()), pse(profs.end()); psi != pse; ++psi) {
-			const TopoDb30::Profile& prof(*psi);
-			for (TopoDb30::Profile::const_iterator i(prof.begin()), e(prof.end()); i != e; ++i) {
-				TopoDb30::elev_t el(i->get_elev());
-				if (el != TopoDb30::nodata)
-					elev = std::max(elev, el);
-			}
-		}
-		if (elev == std::numeric_limits<AirwaysDb::Airway::elev_t>::min()) {
-			if (force)
-				e.set_terrain_elev();
-		} else
-			e.set_terrain_elev(elev * Point::m_to_ft);
-	}
-	if (force || e.get_corridor5_elev() == AirwaysDb::Airway::nodata) {
-		AirwaysDb::Airway::elev_t elev(std::numeric_limits<AirwaysDb::Airway::elev_t>::min());
-		for (std::vector<TopoDb30::Profile>::const_iterator psi(profs.begin()), pse(profs.end()); psi != pse; ++psi) {
-			const TopoDb30::Profile& prof(*psi);
-			TopoDb30::elev_t el(prof.get_maxelev());
-			if (el != TopoDb30::nodata)
-				elev = std::max(elev, el);
-		}
-		if (elev == std::numeric_limits<AirwaysDb::Airway::elev_t>::min()) {
-			if (force)
-				e.set_corridor5_elev();
-		} else
-			e.set_corridor5_elev(elev * Point::m_to_ft);
-	}
-        return true;
+        for (unsigned int i = 0; i < m_ev.size(); ++i)
+                TileSweep::add(TopoDb30::TopoTileCoordinate((TopoDb30::TopoCoordinate)m_ev[i].get_begin_coord()).get_tile_index(), i);
 }
 
-/* ---------------------------------------------------------------------- */
+bool AirwaySweep::get_result(unsigned int idx, TopoDb30::elev_t& terrain, TopoDb30::elev_t& corridor) const
+{
+        terrain = m_terrain[idx];
+        corridor = m_corridor[idx];
+        return m_ok[idx];
+}
+
+void AirwaySweep::process_tile(tile_index_t tile, const jobs_t& jobs)
+{
+        for (jobs_t::const_iterator ji(jobs.begin()), je(jobs.end()); ji != je; ++ji) {
+                // each airway is in exactly one bucket
+                const AirwaysDb::Airway& e(m_ev[*ji]);
+                TopoDb30::elev_t terrain(std::numeric_limits<TopoDb30::elev_t>::min()), corridor(terrain);
+                bool ok(compute_profile(m_topodb, terrain, corridor, e.get_begin_coord(), e.get_end_coord()));
+                m_terrain[*ji] = terrain;
+                m_corridor[*ji] = corridor;
+                // std::vector<bool> elements share storage words
+                Glib::Threads::Mutex::Lock lock(m_mutex);
+                m_ok[*ji] = ok;
+        }
+}
 
-static void process_airways(const Glib::ustring& output_dir, bool force)
+static void process_airways(TopoDb30& topodb, const Glib::ustring& output_dir, bool force, unsigned int worker)
 {
-        TopoDb30 topodb;
-        topodb.open(output_dir);
-        topodb.sync_off();
         AirwaysDb db;
         db.open(output_dir);
         db.sync_off();
-        AirwaysDb::Airway e;
-        db.loadfirst(e);
-        while (e.is_valid()) {
-                if (update_airways(e, topodb, force)) {
-                        std::cerr << "Saving Airway " << e.get_name() << ' ' << e.get_begin_name() << ' '
-				  << e.get_end_name() << ' ' << e.get_sourceid()
-                                  << " terrain elev: " << e.get_terrain_elev()
-				  << " 5nmi corridor elev: " << e.get_corridor5_elev() << std::endl;
-                        db.save(e);
+        AirwaysDb::elementvector_t ev;
+        {
+                ElementLoader<AirwaysDb> ld(ev, force);
+                db.for_each(ld);
+        }
+        std::cerr << "Updating " << ev.size() << " Airways" << std::endl;
+        AirwaySweep sweep(topodb, ev, worker);
+        sweep.run();
+        AirwaysDb::elementvector_t evs;
+        for (unsigned int i = 0; i < ev.size(); ++i) {
+                AirwaysDb::Airway& e(ev[i]);
+                TopoDb30::elev_t terrain, corridor;
+                if (!sweep.get_result(i, terrain, corridor)) {
+                        std::cerr << "Cannot compute profile: Airway " << e.get_name() << ' ' << e.get_begin_name()
+                                  << ' ' << e.get_end_name() << ' ' << e.get_sourceid() << std::endl;
+                        continue;
                 }
-                db.loadnext(e);
+                if (force || e.get_terrain_elev() == AirwaysDb::Airway::nodata) {
+                        if (terrain == std::numeric_limits<TopoDb30::elev_t>::min()) {
+                                if (force)
+                                        e.set_terrain_elev();
+                        } else
+                                e.set_terrain_elev(terrain * Point::m_to_ft);
+                }
+                if (force || e.get_corridor5_elev() == AirwaysDb::Airway::nodata) {
+                        if (corridor == std::numeric_limits<TopoDb30::elev_t>::min()) {
+                                if (force)
+                                        e.set_corridor5_elev();
+                        } else
+                                e.set_corridor5_elev(corridor * Point::m_to_ft);
+                }
+                std::cerr << "Saving Airway " << e.get_name() << ' ' << e.get_begin_name() << ' '
+                          << e.get_end_name() << ' ' << e.get_sourceid()
+                          << " terrain elev: " << e.get_terrain_elev()
+                          << " 5nmi corridor elev: " << e.get_corridor5_elev() << std::endl;
+                evs.push_back(e);
         }
+        save_elements(db, evs, &AirwaysDb::save_elev);
         db.analyze();
         db.vacuum();
 }
@@ -197,10 +397,12 @@ int main(int argc, char *argv[])
                 { "airways",            no_argument,       NULL, 'A' },
                 { "force",              no_argument,       NULL, 'f' },
                 { "output-dir",         required_argument, NULL, 'o' },
+                { "worker",             required_argument, NULL, 0x400 },
                 { NULL,                 0,                 NULL, 0 }
         };
         int c, err(0);
         bool doairspaces(false), doairways(false), force(false);
+        unsigned int worker(0);
         Glib::ustring output_dir(".");
 
         while ((c = getopt_long(argc, argv, "hvaAfo:", long_options, NULL)) != -1) {
@@ -225,6 +427,10 @@ int main(int argc, char *argv[])
 			force = true;
 			break;
 
+		case 0x400:
+			worker = strtoul(optarg, 0, 0);
+			break;
+
 		case 'h':
 		default:
 			err++;
@@ -236,17 +442,23 @@ int main(int argc, char *argv[])
                           << "     -a, --airspaces   Process Airspaces" << std::endl
                           << "     -A, --airways     Process Airways" << std::endl
                           << "     -f, --force       Update existing elevations" << std::endl
+                          << "     --worker          Number of threads (0: number of CPUs)" << std::endl
                           << "     -h, --help        Display this information" << std::endl
                           << "     -v, --version     Display version information" << std::endl << std::endl;
                 return EX_USAGE;
         }
 	if (!doairspaces && !doairways)
 		doairspaces = true;
+	if (!worker)
+		worker = std::max(sysconf(_SC_NPROCESSORS_ONLN), 1L);
         try {
+		// read only; uses topo30.bin if it is up to date, which makes tile access lock free
+		TopoDb30 topodb;
+		topodb.open_readonly(output_dir, true);
 		if (doairspaces)
-			process_airspaces(output_dir, force);
+			process_airspaces(topodb, output_dir, force, worker);
 		if (doairways)
-			process_airways(output_dir, force);
+			process_airways(topodb, output_dir, force, worker);
         } catch (const std::exception& e) {
                 std::cerr << "Error: " << e.what() << std::endl;
                 return EX_DATAERR;